@@ -3,7 +3,7 @@
  *
  *       Filename:  clientipc.c
  *
- *    Description: This file implements IPC interaction between conn_mgmt module and clients 
+ *    Description: This file implements IPC interaction between conn_mgmt module and clients
  *
  *        Version:  1.0
  *        Created:  05/29/2021 09:39:40 PM
@@ -16,4 +16,556 @@
  * =====================================================================================
  */
 
+#define _GNU_SOURCE	/* memfd_create() */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/eventfd.h>
+#include "clientipc.h"
 
+/* Per client state in shared memory, written by the client */
+typedef struct clientipc_client_shm_ {
+
+    /* Client is about to sleep on its eventfd */
+    volatile uint32_t waiting;
+    volatile uint32_t in_use;
+    /* Next position the client reads */
+    volatile uint64_t tail;
+} __attribute__((aligned(64))) clientipc_client_shm_t;
+
+typedef struct clientipc_shm_ {
+
+    uint32_t magic;
+    uint32_t n_slots;   /* Power of 2 */
+    /* Next position the server writes, on its own cache line */
+    volatile uint64_t head __attribute__((aligned(64)));
+    clientipc_client_shm_t clients[CLIENTIPC_MAX_CLIENTS];
+    clientipc_event_t ring[0];
+} clientipc_shm_t;
+
+/* Sent to a client when it connects, along with the shared memory fd
+ * and the client's eventfd */
+typedef struct clientipc_hello_ {
+
+    uint32_t client_index;
+    uint32_t n_slots;
+    uint64_t shm_size;
+} clientipc_hello_t;
+
+/* Server */
+
+typedef struct clientipc_server_ {
+
+    bool running;
+    int shm_fd;
+    uint64_t shm_size;
+    clientipc_shm_t *shm;
+    int listen_fd;
+    int client_sock_fd[CLIENTIPC_MAX_CLIENTS];
+    int client_event_fd[CLIENTIPC_MAX_CLIENTS];
+    uint32_t n_clients;
+    /* Single producer : serializes the conn_mgmt threads publishing */
+    pthread_mutex_t publish_mutex;
+    pthread_t accept_thread;
+} clientipc_server_t;
+
+static clientipc_server_t clientipc_server = {
+    .publish_mutex = PTHREAD_MUTEX_INITIALIZER
+};
+
+/* Client */
+
+struct clientipc_client_ {
+
+    int sock_fd;
+    int event_fd;
+    uint32_t client_index;
+    uint64_t shm_size;
+    clientipc_shm_t *shm;
+    clientipc_client_shm_t *client_shm;
+    uint64_t tail;
+    uint64_t lost;
+    /* waiting is set, the eventfd may have been rung */
+    bool armed;
+};
+
+static uint64_t
+clientipc_get_time_nsec() {
+
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (ts.tv_sec * 1000000000ULL) + ts.tv_nsec;
+}
+
+static bool
+clientipc_send_hello(int sock_fd, clientipc_hello_t *hello,
+                     int shm_fd, int event_fd) {
+
+    struct msghdr msg;
+    struct iovec iov;
+    struct cmsghdr *cmsg;
+    int fds[2] = {shm_fd, event_fd};
+    char cmsg_buf[CMSG_SPACE(sizeof(fds))];
+
+    memset(&msg, 0, sizeof(msg));
+    memset(cmsg_buf, 0, sizeof(cmsg_buf));
+    iov.iov_base = hello;
+    iov.iov_len = sizeof(*hello);
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = cmsg_buf;
+    msg.msg_controllen = sizeof(cmsg_buf);
+
+    cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(fds));
+    memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+
+    return sendmsg(sock_fd, &msg, 0) == sizeof(*hello);
+}
+
+static void
+clientipc_server_add_client(int sock_fd) {
+
+    uint32_t i;
+    int event_fd;
+    clientipc_hello_t hello;
+    clientipc_server_t *server = &clientipc_server;
+
+    pthread_mutex_lock(&server->publish_mutex);
+
+    for (i = 0; i < CLIENTIPC_MAX_CLIENTS; i++) {
+        if (server->client_sock_fd[i] < 0) break;
+    }
+
+    if (i == CLIENTIPC_MAX_CLIENTS) {
+        pthread_mutex_unlock(&server->publish_mutex);
+        printf("Error : clientipc : no room for more clients\n");
+        close(sock_fd);
+        return;
+    }
+
+    event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+    /* New clients see the events published from now on */
+    server->shm->clients[i].waiting = 0;
+    server->shm->clients[i].tail = server->shm->head;
+    server->shm->clients[i].in_use = 1;
+
+    hello.client_index = i;
+    hello.n_slots = server->shm->n_slots;
+    hello.shm_size = server->shm_size;
+
+    if (event_fd < 0 ||
+        !clientipc_send_hello(sock_fd, &hello, server->shm_fd, event_fd)) {
+        server->shm->clients[i].in_use = 0;
+        pthread_mutex_unlock(&server->publish_mutex);
+        printf("Error : clientipc : client handshake failed\n");
+        if (event_fd >= 0) close(event_fd);
+        close(sock_fd);
+        return;
+    }
+
+    server->client_sock_fd[i] = sock_fd;
+    server->client_event_fd[i] = event_fd;
+    server->n_clients++;
+    pthread_mutex_unlock(&server->publish_mutex);
+}
+
+static void
+clientipc_server_remove_client(uint32_t i) {
+
+    clientipc_server_t *server = &clientipc_server;
+
+    pthread_mutex_lock(&server->publish_mutex);
+    server->shm->clients[i].in_use = 0;
+    close(server->client_sock_fd[i]);
+    close(server->client_event_fd[i]);
+    server->client_sock_fd[i] = -1;
+    server->client_event_fd[i] = -1;
+    server->n_clients--;
+    pthread_mutex_unlock(&server->publish_mutex);
+}
+
+/* Accepts clients, and notices when they go away. Nothing but the
+ * handshake ever goes over the unix socket */
+static void *
+clientipc_server_accept_fn(void *arg) {
+
+    uint32_t i, n_fds;
+    int sock_fd;
+    ssize_t n;
+    char buf[64];
+    struct pollfd pfds[CLIENTIPC_MAX_CLIENTS + 1];
+    uint32_t pfd_client[CLIENTIPC_MAX_CLIENTS + 1];
+    clientipc_server_t *server = &clientipc_server;
+
+    while (1) {
+
+        pfds[0].fd = server->listen_fd;
+        pfds[0].events = POLLIN;
+        n_fds = 1;
+
+        for (i = 0; i < CLIENTIPC_MAX_CLIENTS; i++) {
+            if (server->client_sock_fd[i] < 0) continue;
+            pfds[n_fds].fd = server->client_sock_fd[i];
+            pfds[n_fds].events = POLLIN;
+            pfd_client[n_fds] = i;
+            n_fds++;
+        }
+
+        if (poll(pfds, n_fds, -1) < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+
+        for (i = 1; i < n_fds; i++) {
+            if (!pfds[i].revents) continue;
+            n = recv(pfds[i].fd, buf, sizeof(buf), MSG_DONTWAIT);
+            /* Client gone, a spurious wake up is no reason to drop it */
+            if (n == 0 ||
+                (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK &&
+                 errno != EINTR)) {
+                clientipc_server_remove_client(pfd_client[i]);
+            }
+        }
+
+        if (pfds[0].revents & POLLIN) {
+            sock_fd = accept(server->listen_fd, NULL, NULL);
+            if (sock_fd >= 0) clientipc_server_add_client(sock_fd);
+        }
+    }
+    return NULL;
+}
+
+bool
+clientipc_server_init(const char *sock_path, uint32_t n_slots) {
+
+    uint32_t i;
+    struct sockaddr_un addr;
+    clientipc_server_t *server = &clientipc_server;
+
+    if (server->running) return true;
+
+    /* Round up to a power of 2, positions are masked into the ring */
+    if (n_slots < 2) n_slots = 2;
+    n_slots = 1U << (32 - __builtin_clz(n_slots - 1));
+
+    server->shm_size = sizeof(clientipc_shm_t) +
+                       (n_slots * sizeof(clientipc_event_t));
+    server->shm_fd = memfd_create("conn_mgmt_clientipc", MFD_CLOEXEC);
+
+    if (server->shm_fd < 0 ||
+        ftruncate(server->shm_fd, server->shm_size) < 0) {
+        printf("Error : clientipc : shared memory creation failed, "
+               "errno = %d\n", errno);
+        return false;
+    }
+
+    server->shm = mmap(NULL, server->shm_size, PROT_READ | PROT_WRITE,
+                       MAP_SHARED, server->shm_fd, 0);
+    if (server->shm == MAP_FAILED) {
+        printf("Error : clientipc : mmap failed, errno = %d\n", errno);
+        close(server->shm_fd);
+        return false;
+    }
+
+    server->shm->magic = CLIENTIPC_MAGIC;
+    server->shm->n_slots = n_slots;
+    server->shm->head = 0;
+
+    for (i = 0; i < CLIENTIPC_MAX_CLIENTS; i++) {
+        server->client_sock_fd[i] = -1;
+        server->client_event_fd[i] = -1;
+    }
+
+    server->listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, sock_path, sizeof(addr.sun_path) - 1);
+    unlink(sock_path);
+
+    if (bind(server->listen_fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+        listen(server->listen_fd, CLIENTIPC_MAX_CLIENTS) < 0) {
+        printf("Error : clientipc : could not listen on %s, errno = %d\n",
+               sock_path, errno);
+        close(server->listen_fd);
+        munmap(server->shm, server->shm_size);
+        close(server->shm_fd);
+        return false;
+    }
+
+    pthread_create(&server->accept_thread, NULL,
+                   clientipc_server_accept_fn, NULL);
+    pthread_detach(server->accept_thread);
+    server->running = true;
+    return true;
+}
+
+bool
+clientipc_server_is_running(void) {
+
+    return clientipc_server.running;
+}
+
+uint32_t
+clientipc_server_get_n_clients(void) {
+
+    return clientipc_server.n_clients;
+}
+
+void
+clientipc_server_publish(clientipc_event_t *event) {
+
+    uint32_t i;
+    uint64_t pos, one = 1;
+    clientipc_event_t *slot;
+    clientipc_server_t *server = &clientipc_server;
+
+    if (!server->running) return;
+
+    if (!event->timestamp) event->timestamp = clientipc_get_time_nsec();
+
+    pthread_mutex_lock(&server->publish_mutex);
+
+    pos = server->shm->head;
+    slot = &server->shm->ring[pos & (server->shm->n_slots - 1)];
+
+    /* Seqlock : a client racing with this write sees an odd or a newer
+     * slot_seq, and knows the slot is not the event it expected */
+    slot->slot_seq = (2 * pos) + 1;
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    memcpy((char *)slot + sizeof(slot->slot_seq),
+           (char *)event + sizeof(event->slot_seq),
+           sizeof(clientipc_event_t) - sizeof(slot->slot_seq));
+    __atomic_store_n(&slot->slot_seq, 2 * (pos + 1), __ATOMIC_RELEASE);
+    __atomic_store_n(&server->shm->head, pos + 1, __ATOMIC_RELEASE);
+
+    /* Pairs with the fence in clientipc_client_wait() : either the
+     * client sees the new head, or the server sees it waiting */
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+    for (i = 0; i < CLIENTIPC_MAX_CLIENTS; i++) {
+        if (server->client_event_fd[i] < 0) continue;
+        if (server->shm->clients[i].waiting) {
+            write(server->client_event_fd[i], &one, sizeof(one));
+        }
+    }
+    pthread_mutex_unlock(&server->publish_mutex);
+}
+
+/* Client */
+
+static bool
+clientipc_recv_hello(int sock_fd, clientipc_hello_t *hello,
+                     int *shm_fd, int *event_fd) {
+
+    struct msghdr msg;
+    struct iovec iov;
+    struct cmsghdr *cmsg;
+    int fds[2];
+    char cmsg_buf[CMSG_SPACE(sizeof(fds))];
+
+    memset(&msg, 0, sizeof(msg));
+    iov.iov_base = hello;
+    iov.iov_len = sizeof(*hello);
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = cmsg_buf;
+    msg.msg_controllen = sizeof(cmsg_buf);
+
+    if (recvmsg(sock_fd, &msg, MSG_CMSG_CLOEXEC) != sizeof(*hello)) {
+        return false;
+    }
+
+    cmsg = CMSG_FIRSTHDR(&msg);
+    if (!cmsg || cmsg->cmsg_type != SCM_RIGHTS ||
+        cmsg->cmsg_len != CMSG_LEN(sizeof(fds))) {
+        return false;
+    }
+    memcpy(fds, CMSG_DATA(cmsg), sizeof(fds));
+    *shm_fd = fds[0];
+    *event_fd = fds[1];
+    return true;
+}
+
+clientipc_client_t *
+clientipc_client_connect(const char *sock_path) {
+
+    int shm_fd;
+    struct sockaddr_un addr;
+    clientipc_hello_t hello;
+    clientipc_client_t *client;
+
+    client = calloc(1, sizeof(clientipc_client_t));
+    client->sock_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, sock_path, sizeof(addr.sun_path) - 1);
+
+    if (connect(client->sock_fd, (struct sockaddr *)&addr,
+                sizeof(addr)) < 0 ||
+        !clientipc_recv_hello(client->sock_fd, &hello,
+                              &shm_fd, &client->event_fd)) {
+        printf("Error : clientipc : could not connect to %s\n", sock_path);
+        close(client->sock_fd);
+        free(client);
+        return NULL;
+    }
+
+    client->shm = mmap(NULL, hello.shm_size, PROT_READ | PROT_WRITE,
+                       MAP_SHARED, shm_fd, 0);
+    close(shm_fd);
+
+    if (client->shm == MAP_FAILED || client->shm->magic != CLIENTIPC_MAGIC) {
+        printf("Error : clientipc : bad shared memory\n");
+        close(client->event_fd);
+        close(client->sock_fd);
+        free(client);
+        return NULL;
+    }
+
+    client->shm_size = hello.shm_size;
+    client->client_index = hello.client_index;
+    client->client_shm = &client->shm->clients[hello.client_index];
+    client->tail = client->client_shm->tail;
+    return client;
+}
+
+void
+clientipc_client_close(clientipc_client_t *client) {
+
+    munmap(client->shm, client->shm_size);
+    close(client->event_fd);
+    /* Server notices and frees the client's slot */
+    close(client->sock_fd);
+    free(client);
+}
+
+const clientipc_event_t *
+clientipc_client_peek(clientipc_client_t *client) {
+
+    uint64_t head, seq;
+    uint32_t n_slots = client->shm->n_slots;
+    clientipc_event_t *slot;
+
+    while (1) {
+
+        head = __atomic_load_n(&client->shm->head, __ATOMIC_ACQUIRE);
+        if (client->tail == head) return NULL;
+
+        /* Lapped by the server, skip to the oldest event still there */
+        if (head - client->tail > n_slots) {
+            client->lost += head - client->tail - n_slots;
+            client->tail = head - n_slots;
+        }
+
+        slot = &client->shm->ring[client->tail & (n_slots - 1)];
+        seq = __atomic_load_n(&slot->slot_seq, __ATOMIC_ACQUIRE);
+
+        if (seq == 2 * (client->tail + 1)) return slot;
+
+        /* Being overwritten right now */
+        client->lost++;
+        client->tail++;
+    }
+}
+
+bool
+clientipc_client_release(clientipc_client_t *client) {
+
+    uint64_t seq;
+    clientipc_event_t *slot;
+
+    slot = &client->shm->ring[client->tail & (client->shm->n_slots - 1)];
+
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    seq = __atomic_load_n(&slot->slot_seq, __ATOMIC_RELAXED);
+
+    client->tail++;
+    client->client_shm->tail = client->tail;
+
+    if (seq != 2 * client->tail) {
+        client->lost++;
+        return false;
+    }
+    return true;
+}
+
+static bool
+clientipc_client_has_event(clientipc_client_t *client) {
+
+    return __atomic_load_n(&client->shm->head, __ATOMIC_ACQUIRE) !=
+           client->tail;
+}
+
+static void
+clientipc_client_disarm(clientipc_client_t *client) {
+
+    uint64_t count;
+
+    if (!client->armed) return;
+    client->client_shm->waiting = 0;
+    /* Drain, or a level triggered poll on the eventfd keeps firing */
+    read(client->event_fd, &count, sizeof(count));
+    client->armed = false;
+}
+
+bool
+clientipc_client_wait(clientipc_client_t *client, int timeout_msec) {
+
+    struct pollfd pfd;
+
+    while (1) {
+
+        if (clientipc_client_has_event(client)) {
+            clientipc_client_disarm(client);
+            return true;
+        }
+
+        /* Ask for the doorbell, then look again : the server may have
+         * published just before seeing the flag */
+        client->client_shm->waiting = 1;
+        client->armed = true;
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+        if (clientipc_client_has_event(client)) {
+            clientipc_client_disarm(client);
+            return true;
+        }
+
+        /* Stays armed, for callers polling the eventfd themselves */
+        if (timeout_msec == 0) return false;
+
+        pfd.fd = client->event_fd;
+        pfd.events = POLLIN;
+        if (poll(&pfd, 1, timeout_msec) == 0) {
+            clientipc_client_disarm(client);
+            return clientipc_client_has_event(client);
+        }
+    }
+}
+
+int
+clientipc_client_get_fd(clientipc_client_t *client) {
+
+    return client->event_fd;
+}
+
+uint64_t
+clientipc_client_get_lost(clientipc_client_t *client) {
+
+    return client->lost;
+}
@@ -3,7 +3,7 @@
  *
  *       Filename:  clientipc.c
  *
- *    Description: This file defines IPC interaction routines and data structures between conn_mgmt module and clients 
+ *    Description: This file defines IPC interaction routines and data structures between conn_mgmt module and clients
  *
  *        Version:  1.0
  *        Created:  05/29/2021 09:39:40 PM
@@ -16,4 +16,105 @@
  * =====================================================================================
  */
 
+#ifndef __CLIENTIPC__
+#define __CLIENTIPC__
 
+#include <stdint.h>
+#include <stdbool.h>
+
+/* conn_mgmt (the server) publishes connection events into a ring in
+ * shared memory, every client process maps the ring and reads it at its
+ * own pace : one producer, many consumers, events are never copied
+ * through the kernel. A client which finds the ring empty sleeps on
+ * its own eventfd, the server rings it only when the client sleeps.
+ *
+ * A client connects to the server's unix socket once, and gets the
+ * shared memory fd and its eventfd back over it. A client which falls
+ * more than a ring's worth of events behind loses the oldest ones */
+
+#define CLIENTIPC_DEFAULT_SOCK_PATH	"/tmp/conn_mgmt_clientipc"
+#define CLIENTIPC_DEFAULT_RING_SLOTS	1024
+#define CLIENTIPC_MAX_CLIENTS		8
+#define CLIENTIPC_MAGIC			0x434d4950	/* "CMIP" */
+
+typedef enum {
+
+    /* conn_status changed */
+    CLIENTIPC_EVENT_CONN_STATUS,
+    CLIENTIPC_EVENT_PRE_SWITCHOVER,
+    CLIENTIPC_EVENT_POST_SWITCHOVER
+} clientipc_event_type_t;
+
+/* One ring slot, two cache lines */
+typedef struct clientipc_event_ {
+
+    /* Written by the server around the rest of the slot : odd while
+     * the slot is being written, 2 * (position + 1) once written */
+    volatile uint64_t slot_seq;
+    /* clientipc_event_type_t */
+    uint32_t event_type;
+    /* conn_mgmt_conn_status_t and conn_mgmt_mastership_state */
+    uint8_t conn_status;
+    uint8_t mastership_state;
+    uint16_t reserved;
+    /* Monotonic time in nsec of the state change */
+    uint64_t timestamp;
+    uint32_t src_port_no;
+    uint32_t dst_port_no;
+    char src_ip[16];
+    char dest_ip[16];
+    char conn_name[64];
+} __attribute__((aligned(64))) clientipc_event_t;
+
+/* Server side */
+
+bool
+clientipc_server_init(const char *sock_path, uint32_t n_slots);
+
+bool
+clientipc_server_is_running(void);
+
+/* event is copied into the ring, its slot_seq and timestamp (if 0) are
+ * filled in. Never blocks on slow clients */
+void
+clientipc_server_publish(clientipc_event_t *event);
+
+uint32_t
+clientipc_server_get_n_clients(void);
+
+/* Client side */
+
+typedef struct clientipc_client_ clientipc_client_t;
+
+clientipc_client_t *
+clientipc_client_connect(const char *sock_path);
+
+void
+clientipc_client_close(clientipc_client_t *client);
+
+/* Next unread event, in place in the shared ring, or NULL if there is
+ * none. Non blocking */
+const clientipc_event_t *
+clientipc_client_peek(clientipc_client_t *client);
+
+/* Done with the event returned by clientipc_client_peek(). Returns
+ * false if the server overwrote the event while it was being read,
+ * whatever was read from it must then be discarded */
+bool
+clientipc_client_release(clientipc_client_t *client);
+
+/* Blocks until an event is available or timeout_msec expires (-1 :
+ * forever), returns true if an event is available */
+bool
+clientipc_client_wait(clientipc_client_t *client, int timeout_msec);
+
+/* The client's doorbell, to be polled along with the client's own fds.
+ * Once it fires, clientipc_client_wait(client, 0) re-arms it */
+int
+clientipc_client_get_fd(clientipc_client_t *client);
+
+/* Events overwritten before the client could read them */
+uint64_t
+clientipc_client_get_lost(clientipc_client_t *client);
+
+#endif /* __CLIENTIPC__ */
@@ -0,0 +1,255 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  clientipc_bench.c
+ *
+ *    Description: This file benchmarks the latency from a connection event being
+ *                 published to a client process seeing it, over the shared memory
+ *                 ring of clientipc and over a unix socket per client, and from
+ *                 real conn_mgmt state changes to the clients
+ *
+ *        Version:  1.0
+ *        Created:  10/17/2026 06:45:30 PM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  ABHISHEK SAGAR (), sachinites@gmail.com
+ *   Organization:  Juniper Networks
+ *
+ * =====================================================================================
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include "conn_mgmt.h"
+#include "clientipc.h"
+
+#define BENCH_SOCK_PATH		"/tmp/conn_mgmt_clientipc_bench"
+/* Tells the clients the run is over */
+#define BENCH_EVENT_END		0xff
+#define BENCH_N_FLAPS		20
+
+static uint32_t client_counts[] = {1, 4};
+
+static uint64_t
+bench_now_nsec() {
+
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void
+bench_print_result(const char *channel, uint32_t client_id,
+				   uint32_t gap_usec, conn_mgmt_hist_t *hist,
+				   uint64_t lost) {
+
+	printf("%-8s %6u %6u %8lu %8.2f %8.2f %8.2f %8.2f %6lu\n",
+		channel, client_id, gap_usec, hist->count,
+		conn_mgmt_hist_percentile(hist, 50) / 1000.0,
+		conn_mgmt_hist_percentile(hist, 99) / 1000.0,
+		conn_mgmt_hist_percentile(hist, 99.9) / 1000.0,
+		hist->max / 1000.0, lost);
+	fflush(stdout);
+}
+
+static void
+bench_ring_client(uint32_t client_id, const char *channel,
+				  uint32_t gap_usec) {
+
+	bool end = false;
+	uint64_t latency;
+	conn_mgmt_hist_t hist;
+	clientipc_client_t *client;
+	const clientipc_event_t *event;
+
+	memset(&hist, 0, sizeof(hist));
+	client = clientipc_client_connect(BENCH_SOCK_PATH);
+	if (!client) exit(-1);
+
+	while (!end) {
+
+		clientipc_client_wait(client, -1);
+
+		while ((event = clientipc_client_peek(client))) {
+
+			latency = bench_now_nsec() - event->timestamp;
+			end = event->event_type == BENCH_EVENT_END;
+			if (clientipc_client_release(client) && !end) {
+				conn_mgmt_hist_add(&hist, latency);
+			}
+		}
+	}
+
+	bench_print_result(channel, client_id, gap_usec, &hist,
+		clientipc_client_get_lost(client));
+	clientipc_client_close(client);
+}
+
+/* Publishes n_events, gap_usec apart, to n_clients client processes */
+static void
+bench_ring(uint32_t n_clients, uint32_t n_events, uint32_t gap_usec) {
+
+	uint32_t i;
+	clientipc_event_t event;
+
+	for (i = 0; i < n_clients; i++) {
+		if (fork() == 0) {
+			bench_ring_client(i, "shm ring", gap_usec);
+			exit(0);
+		}
+	}
+
+	while (clientipc_server_get_n_clients() < n_clients) usleep(1000);
+
+	memset(&event, 0, sizeof(event));
+	event.event_type = CLIENTIPC_EVENT_CONN_STATUS;
+	strncpy(event.conn_name, "bench", sizeof(event.conn_name));
+
+	for (i = 0; i < n_events; i++) {
+		event.timestamp = 0;
+		clientipc_server_publish(&event);
+		if (gap_usec) usleep(gap_usec);
+	}
+
+	event.event_type = BENCH_EVENT_END;
+	event.timestamp = 0;
+	clientipc_server_publish(&event);
+
+	for (i = 0; i < n_clients; i++) wait(NULL);
+	while (clientipc_server_get_n_clients()) usleep(1000);
+}
+
+/* What a socket per client costs : a send() per client per event and
+ * a recv() on the client side, every event copied in and out of the
+ * kernel */
+static void
+bench_unix_sock(uint32_t n_clients, uint32_t n_events, uint32_t gap_usec) {
+
+	uint32_t i, j;
+	int fds[CLIENTIPC_MAX_CLIENTS][2];
+	conn_mgmt_hist_t hist;
+	clientipc_event_t event;
+
+	for (i = 0; i < n_clients; i++) {
+
+		socketpair(AF_UNIX, SOCK_SEQPACKET, 0, fds[i]);
+
+		if (fork() == 0) {
+
+			memset(&hist, 0, sizeof(hist));
+
+			while (recv(fds[i][1], &event, sizeof(event), 0) > 0 &&
+				   event.event_type != BENCH_EVENT_END) {
+				conn_mgmt_hist_add(&hist, bench_now_nsec() - event.timestamp);
+			}
+			bench_print_result("unix", i, gap_usec, &hist, 0);
+			exit(0);
+		}
+		close(fds[i][1]);
+	}
+
+	memset(&event, 0, sizeof(event));
+	event.event_type = CLIENTIPC_EVENT_CONN_STATUS;
+
+	for (i = 0; i <= n_events; i++) {
+
+		if (i == n_events) event.event_type = BENCH_EVENT_END;
+		event.timestamp = bench_now_nsec();
+
+		for (j = 0; j < n_clients; j++) {
+			send(fds[j][0], &event, sizeof(event), 0);
+		}
+		if (gap_usec && i < n_events) usleep(gap_usec);
+	}
+
+	for (i = 0; i < n_clients; i++) {
+		wait(NULL);
+		close(fds[i][0]);
+	}
+}
+
+/* Flaps a real master/backup pair : the events are published by
+ * conn_mgmt as the backup goes down, switches over and comes back */
+static void
+bench_conn_mgmt(uint32_t n_clients) {
+
+	uint32_t i;
+	clientipc_event_t event;
+	conn_mgmt_conn_state_t *master, *backup;
+
+	for (i = 0; i < n_clients; i++) {
+		if (fork() == 0) {
+			bench_ring_client(i, "conn", 0);
+			exit(0);
+		}
+	}
+
+	while (clientipc_server_get_n_clients() < n_clients) usleep(1000);
+
+	conn_mgmt_set_io_mode(CONN_MGMT_IO_EVENT_LOOP, 1);
+	conn_mgmt_configure_connection("master", "127.0.0.1", 22000,
+		"127.0.0.1", 22001, "master");
+	conn_mgmt_configure_connection("backup", "127.0.0.1", 22001,
+		"127.0.0.1", 22000, "backup");
+	master = conn_mgmt_lookup_connection_by_name("master");
+	backup = conn_mgmt_lookup_connection_by_name("backup");
+	conn_mgmt_set_conn_ka_interval(master, 20);
+	conn_mgmt_set_conn_ka_interval(backup, 20);
+
+	for (i = 0; i < BENCH_N_FLAPS; i++) {
+
+		while (backup->conn_status != COMM_MGMT_CONN_UP) usleep(1000);
+		conn_mgmt_pause_sending_kas(master);
+		while (backup->conn_status == COMM_MGMT_CONN_UP) usleep(1000);
+		conn_mgmt_resume_sending_kas(master);
+	}
+
+	memset(&event, 0, sizeof(event));
+	event.event_type = BENCH_EVENT_END;
+	clientipc_server_publish(&event);
+
+	for (i = 0; i < n_clients; i++) wait(NULL);
+}
+
+int
+main(int argc, char **argv) {
+
+	uint32_t i;
+	uint32_t n_events = 20000;
+	uint32_t gap_usec = 100;
+
+	if (argc > 1) n_events = atoi(argv[1]);
+	if (argc > 2) gap_usec = atoi(argv[2]);
+
+	if (!clientipc_server_init(BENCH_SOCK_PATH,
+							   CLIENTIPC_DEFAULT_RING_SLOTS)) {
+		return -1;
+	}
+	conn_mgmt_init();
+
+	printf("%-8s %6s %6s %8s %8s %8s %8s %8s %6s\n", "channel", "client",
+		"gap us", "events", "p50 us", "p99 us", "p99.9 us", "max us", "lost");
+	fflush(stdout);
+
+	for (i = 0; i < sizeof(client_counts)/sizeof(client_counts[0]); i++) {
+
+		/* Clients asleep between events : the doorbell path */
+		bench_ring(client_counts[i], n_events, gap_usec);
+		bench_unix_sock(client_counts[i], n_events, gap_usec);
+		/* Back to back events : clients mostly find the next event
+		 * already in the ring */
+		bench_ring(client_counts[i], n_events, 0);
+		bench_unix_sock(client_counts[i], n_events, 0);
+	}
+
+	bench_conn_mgmt(2);
+	unlink(BENCH_SOCK_PATH);
+	return 0;
+}
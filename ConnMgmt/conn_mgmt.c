@@ -16,6 +16,7 @@
  * =====================================================================================
  */
 
+#define _GNU_SOURCE	/* recvmmsg(), sendmmsg() */
 #include <stdio.h>
 #include <stdlib.h>
 #include <memory.h>
@@ -26,18 +27,185 @@
 #include <errno.h>
 #include <netdb.h> 
 #include <unistd.h>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/uio.h>
+#include <arpa/inet.h>
+#include <time.h>
 #include "conn_mgmt.h"
-
-static glthread_t connection_db;
+#include "clientipc.h"
+
+/* Connection DB : list of all connections + three hash indexes */
+#define CONN_MGMT_DB_INIT_BUCKETS	1024
+
+typedef struct conn_mgmt_conn_db_ {
+
+    pthread_rwlock_t db_lock;
+    /* All connections, in creation order */
+    glthread_t conn_list;
+    uint32_t n_conns;
+    /* Power of 2 */
+    uint32_t n_buckets;
+    glthread_t *key_buckets;
+    glthread_t *name_buckets;
+    /* Started connections on shared sockets, by their binary
+     * (src addr, src port, peer addr, peer port) */
+    glthread_t *addr_buckets;
+} conn_mgmt_conn_db_t;
+
+static conn_mgmt_conn_db_t connection_db;
 static wheel_timer_t *global_timer;
 
+static void
+conn_mgmt_init_conn_db(conn_mgmt_conn_db_t *db) {
+
+    pthread_rwlock_init(&db->db_lock, NULL);
+    init_glthread(&db->conn_list);
+    db->n_conns = 0;
+    db->n_buckets = CONN_MGMT_DB_INIT_BUCKETS;
+    db->key_buckets = calloc(db->n_buckets, sizeof(glthread_t));
+    db->name_buckets = calloc(db->n_buckets, sizeof(glthread_t));
+    db->addr_buckets = calloc(db->n_buckets, sizeof(glthread_t));
+}
+
 void conn_mgmt_init() {
 
-	init_glthread(&connection_db);
-	global_timer = init_wheel_timer(60, 1, TIMER_SECONDS);
+	conn_mgmt_init_conn_db(&connection_db);
+	global_timer = init_wheel_timer(CONN_MGMT_TIMER_WHEEL_SIZE,
+                                    CONN_MGMT_TIMER_TIC_MSEC,
+                                    TIMER_MILLI_SECONDS);
 	start_wheel_timer(global_timer);
 }
 
+#define MAX_PACKET_BUFFER_SIZE 256
+#define CONN_MGMT_IO_MAX_EVENTS 64
+/* Idle I/O loops still wake up this often, so that a destroyed
+ * connection does not wait for traffic to be freed */
+#define CONN_MGMT_IO_LOOP_IDLE_MSEC 1000
+/* Max msgs moved by one recvmmsg()/sendmmsg() call */
+#define CONN_MGMT_IO_BATCH_SIZE 64
+#define CONN_MGMT_IO_TX_BATCH_MAX   1024
+#define CONN_MGMT_SHARED_SOCK_RCVBUF    (16 * 1024 * 1024)
+
+#define CONN_MGMT_RX_RING_SLOTS 8
+#define CONN_MGMT_CACHE_LINE_SIZE   64
+
+/* One recv slot, a whole no of cache lines */
+typedef struct conn_mgmt_rx_slot_ {
+
+    unsigned char pkt[MAX_PACKET_BUFFER_SIZE];
+} __attribute__((aligned(CONN_MGMT_CACHE_LINE_SIZE))) conn_mgmt_rx_slot_t;
+
+/* Preallocated recv slots, filled in place by recvmmsg(). The
+ * iovecs and msg headers are set up once and never rebuilt */
+typedef struct conn_mgmt_rx_ring_ {
+
+    conn_mgmt_rx_slot_t *slots;
+    uint32_t n_slots;
+    struct iovec *iovs;
+    struct mmsghdr *msgs;
+} conn_mgmt_rx_ring_t;
+
+/* One epoll instance and the thread polling it */
+typedef struct conn_mgmt_io_loop_ {
+
+    int epoll_fd;
+    pthread_t io_thread_handle;
+    /* Bumped before every epoll_wait() */
+    uint64_t n_passes;
+} conn_mgmt_io_loop_t;
+
+/* A socket bound to one src port, shared by all the connections
+ * using that src port in batched I/O mode */
+typedef struct conn_mgmt_shared_sock_ {
+
+    int sock_fd;
+    uint32_t src_port_no;
+    uint32_t ref_count;
+    /* KA msgs queued for transmission in the current tic */
+    pthread_mutex_t tx_mutex;
+    uint32_t n_tx;
+    uint32_t tx_capacity;
+    struct iovec *tx_iovs;
+    struct sockaddr_in *tx_addrs;
+    struct mmsghdr *tx_msgs;
+    /* Inbound KA msgs of all the connections on this socket */
+    conn_mgmt_rx_ring_t *rx_ring;
+    glthread_t glue;
+} conn_mgmt_shared_sock_t;
+GLTHREAD_TO_STRUCT(glthread_glue_to_shared_sock,
+                   conn_mgmt_shared_sock_t, glue);
+
+static glthread_t conn_mgmt_shared_socks;
+static pthread_mutex_t conn_mgmt_shared_socks_mutex =
+    PTHREAD_MUTEX_INITIALIZER;
+static conn_mgmt_io_stats_t conn_mgmt_io_stats;
+
+static void
+conn_mgmt_rx_ring_destroy(conn_mgmt_rx_ring_t *rx_ring) {
+
+    if (!rx_ring) return;
+    free(rx_ring->slots);
+    free(rx_ring->iovs);
+    free(rx_ring->msgs);
+    free(rx_ring);
+}
+
+static conn_mgmt_rx_ring_t *
+conn_mgmt_rx_ring_create(uint32_t n_slots) {
+
+    uint32_t i;
+    conn_mgmt_rx_ring_t *rx_ring = calloc(1, sizeof(conn_mgmt_rx_ring_t));
+
+    if (!rx_ring) return NULL;
+
+    if (posix_memalign((void **)&rx_ring->slots, CONN_MGMT_CACHE_LINE_SIZE,
+                       n_slots * sizeof(conn_mgmt_rx_slot_t)) != 0) {
+        free(rx_ring);
+        return NULL;
+    }
+
+    rx_ring->n_slots = n_slots;
+    rx_ring->iovs = calloc(n_slots, sizeof(struct iovec));
+    rx_ring->msgs = calloc(n_slots, sizeof(struct mmsghdr));
+
+    if (!rx_ring->iovs || !rx_ring->msgs) {
+        conn_mgmt_rx_ring_destroy(rx_ring);
+        return NULL;
+    }
+
+    for (i = 0; i < n_slots; i++) {
+        rx_ring->iovs[i].iov_base = rx_ring->slots[i].pkt;
+        rx_ring->iovs[i].iov_len = sizeof(rx_ring->slots[i].pkt);
+        rx_ring->msgs[i].msg_hdr.msg_iov = &rx_ring->iovs[i];
+        rx_ring->msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+    return rx_ring;
+}
+
+/* Fills up to n_slots slots of the ring with one syscall, returns
+ * the no of msgs recvd */
+static int
+conn_mgmt_rx_ring_recv(conn_mgmt_rx_ring_t *rx_ring,
+                       int sock_fd, int flags) {
+
+    int n_msgs;
+
+    n_msgs = recvmmsg(sock_fd, rx_ring->msgs, rx_ring->n_slots,
+                      flags, NULL);
+    __sync_fetch_and_add(&conn_mgmt_io_stats.ka_rx_syscalls, 1);
+
+    if (n_msgs > 0) {
+        __sync_fetch_and_add(&conn_mgmt_io_stats.ka_rx_pkts, n_msgs);
+    }
+    return n_msgs;
+}
+
+static conn_mgmt_io_mode_t conn_mgmt_io_mode = CONN_MGMT_IO_THREAD_PER_CONN;
+static conn_mgmt_io_loop_t conn_mgmt_io_loops[CONN_MGMT_MAX_IO_THREADS];
+static uint8_t conn_mgmt_n_io_loops = 0;
+static uint32_t conn_mgmt_next_io_loop = 0;
+
 
 
 static void
@@ -45,6 +213,14 @@ conn_mgmt_report_connection_state(
 	conn_mgmt_conn_state_t *conn,
 	conn_mgmt_conn_status_t conn_status);
 
+static conn_mgmt_conn_state_t *
+conn_mgmt_conn_db_lookup_by_addr(conn_mgmt_conn_db_t *db,
+                                 uint32_t src_ip_addr, uint32_t src_port_no,
+                                 uint32_t dst_ip_addr, uint32_t dst_port_no);
+
+static void
+conn_mgmt_conn_db_add_addr(conn_mgmt_conn_state_t *conn);
+
 static void
 conn_mgmt_update_conn_state(
                 conn_mgmt_conn_state_t *conn,
@@ -52,10 +228,42 @@ conn_mgmt_update_conn_state(
 	
 	
 static void
-conn_mgmt_init_conn_thread(
-	conn_mgmt_conn_thread_t *conn_thread) {
+conn_mgmt_ka_timer_expired(void *arg, unsigned int arg_size);
 
-    pthread_cond_init(&conn_thread->cv, 0);
+static int
+conn_mgmt_update_ka_pkt (conn_mgmt_conn_state_t *conn,
+				unsigned char *ka_pkt,
+				uint32_t ka_pkt_size);
+static void
+conn_mgmt_rebuild_ka_msg(conn_mgmt_conn_state_t *conn);
+
+static uint64_t
+conn_mgmt_get_time_usec() {
+
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (ts.tv_sec * 1000000ULL) + (ts.tv_nsec / 1000);
+}
+
+/* Wheel timer only accepts multiples of its tic */
+static uint32_t
+conn_mgmt_round_up_to_tic(uint32_t msec) {
+
+    msec = ((msec + CONN_MGMT_TIMER_TIC_MSEC - 1) /
+             CONN_MGMT_TIMER_TIC_MSEC) * CONN_MGMT_TIMER_TIC_MSEC;
+    return msec ? msec : CONN_MGMT_TIMER_TIC_MSEC;
+}
+
+/* Stamped into v2 KA msgs, wall clock so that the peer can make sense
+ * of it */
+static uint64_t
+conn_mgmt_get_wall_time_usec() {
+
+    struct timespec ts;
+
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (ts.tv_sec * 1000000ULL) + (ts.tv_nsec / 1000);
 }
 
 conn_mgmt_conn_state_t *
@@ -70,27 +278,120 @@ conn_mgmt_create_new_connection(
                              COMM_MGMT_MASTER :
                              COMM_MGMT_BACKUP;
 	conn->keep_alive_interval = CONN_MGMT_DEFAULT_KA_INTERVAL;
-	conn_mgmt_init_conn_thread(&conn->conn_thread);
 	conn->ka_recvd = 0;
 	conn->ka_sent = 0;
 	conn->down_count = 0;
     pthread_mutex_init(&conn->conn_mutex, NULL);
+    pthread_cond_init(&conn->ka_piggyback_cond, NULL);
+    conn->ka_piggyback_busy = 0;
     conn->pause_sending_kas = false;
+    conn->ka_tx_version = CONN_MGMT_KA_VERSION_1;
+    conn->ka_v2_enabled = true;
     memset(conn->ka_msg.ka_msg, 0, sizeof(conn->ka_msg.ka_msg));
     conn->ka_msg.ka_msg_size = 0;
     memset(conn->peer_ka_msg.ka_msg, 0, sizeof(conn->peer_ka_msg.ka_msg));
     conn->peer_ka_msg.ka_msg_size = 0;
     init_glthread(&conn->glue);
+    init_glthread(&conn->key_glue);
+    init_glthread(&conn->name_glue);
+    init_glthread(&conn->addr_glue);
 	return conn;
 }
 
+/* KA msgs are sent by a recurring event on the connection's wheel
+ * timer, called with conn mutex locked */
+static void
+conn_mgmt_register_ka_timer(conn_mgmt_conn_state_t *conn) {
+
+    conn->ka_timer = timer_register_app_event(
+                                conn->wt,
+                                conn_mgmt_ka_timer_expired,
+                                (void *)conn, sizeof(conn),
+                                conn->keep_alive_interval,
+                                1);
+}
+
+void
+conn_mgmt_set_conn_ka_v2_enabled(
+        conn_mgmt_conn_state_t *conn,
+        bool ka_v2_enabled) {
+
+    pthread_mutex_lock(&conn->conn_mutex);
+    conn->ka_v2_enabled = ka_v2_enabled;
+    if (!ka_v2_enabled &&
+        conn->ka_tx_version == CONN_MGMT_KA_VERSION_2) {
+        conn->ka_tx_version = CONN_MGMT_KA_VERSION_1;
+    }
+    /* Not started yet, the KA msg is built at start */
+    if (conn->ka_msg.ka_msg_size) {
+        conn->ka_msg.ka_msg_size =
+            conn_mgmt_update_ka_pkt(conn,
+                       conn->ka_msg.ka_msg,
+                       sizeof(conn->ka_msg.ka_msg));
+    }
+    pthread_mutex_unlock(&conn->conn_mutex);
+}
+
+void
+conn_mgmt_set_ka_piggyback(
+        conn_mgmt_conn_state_t *conn,
+        conn_mgmt_ka_piggyback_fill_fn fill_fn,
+        conn_mgmt_ka_piggyback_recv_fn recv_fn,
+        void *arg) {
+
+    pthread_mutex_lock(&conn->conn_mutex);
+    conn->ka_piggyback_arg = arg;
+    conn->ka_piggyback_fill = fill_fn;
+    conn->ka_piggyback_recv = recv_fn;
+    /* The old arg may be freed as soon as we return */
+    while (conn->ka_piggyback_busy) {
+        pthread_cond_wait(&conn->ka_piggyback_cond, &conn->conn_mutex);
+    }
+    pthread_mutex_unlock(&conn->conn_mutex);
+}
+
+/* Snapshots the piggyback fns and arg, and holds them until
+ * conn_mgmt_ka_piggyback_put() if any is registered */
+static bool
+conn_mgmt_ka_piggyback_get(conn_mgmt_conn_state_t *conn,
+                           conn_mgmt_ka_piggyback_fill_fn *fill_fn,
+                           conn_mgmt_ka_piggyback_recv_fn *recv_fn,
+                           void **arg) {
+
+    pthread_mutex_lock(&conn->conn_mutex);
+    *fill_fn = conn->ka_piggyback_fill;
+    *recv_fn = conn->ka_piggyback_recv;
+    *arg = conn->ka_piggyback_arg;
+    if (*fill_fn || *recv_fn) conn->ka_piggyback_busy++;
+    pthread_mutex_unlock(&conn->conn_mutex);
+    return *fill_fn || *recv_fn;
+}
+
+static void
+conn_mgmt_ka_piggyback_put(conn_mgmt_conn_state_t *conn) {
+
+    pthread_mutex_lock(&conn->conn_mutex);
+    if (--conn->ka_piggyback_busy == 0) {
+        pthread_cond_broadcast(&conn->ka_piggyback_cond);
+    }
+    pthread_mutex_unlock(&conn->conn_mutex);
+}
+
 bool
 conn_mgmt_pause_sending_kas(
         conn_mgmt_conn_state_t *conn) {
 
+    bool was_paused;
+
     pthread_mutex_lock(&conn->conn_mutex);
+    was_paused = conn->pause_sending_kas;
     conn->pause_sending_kas = true;
+    if (conn->ka_timer) {
+        timer_de_register_app_event(conn->ka_timer);
+        conn->ka_timer = NULL;
+    }
     pthread_mutex_unlock(&conn->conn_mutex);
+    return !was_paused;
 }
 
 void
@@ -99,7 +400,10 @@ conn_mgmt_resume_sending_kas(
 
     pthread_mutex_lock(&conn->conn_mutex);
     conn->pause_sending_kas = false;
-    pthread_cond_signal(&conn->conn_thread.cv);
+    /* Connection may not have been started yet */
+    if (!conn->ka_timer && conn->wt && !conn->destroyed) {
+        conn_mgmt_register_ka_timer(conn);
+    }
     pthread_mutex_unlock(&conn->conn_mutex);
 }
 
@@ -108,12 +412,17 @@ conn_mgmt_set_conn_ka_interval(
         conn_mgmt_conn_state_t *conn,
         uint32_t ka_interval) {
    
-    conn_mgmt_pause_sending_kas(conn);
+    ka_interval = conn_mgmt_round_up_to_tic(ka_interval);
+
     pthread_mutex_lock(&conn->conn_mutex);
     conn->keep_alive_interval = ka_interval;
     conn->hold_time = conn->keep_alive_interval * 2;
+    /* Takes effect right away, no need to wait for the pending KA */
+    if (conn->ka_timer) {
+        wt_elem_reschedule(conn->ka_timer,
+                           conn->keep_alive_interval);
+    }
     pthread_mutex_unlock(&conn->conn_mutex);
-    conn_mgmt_resume_sending_kas(conn);
 }
 
 static int
@@ -121,34 +430,65 @@ conn_mgmt_update_ka_pkt (conn_mgmt_conn_state_t *conn,
 				unsigned char *ka_pkt,
 				uint32_t ka_pkt_size) {
 
-    assert(ka_pkt_size >= sizeof(ka_pkt_fmt_t));
+    conn_mgmt_ka_info_t ka_info;
+
+    /* Tells the peer to run its state machine on our next KA msg */
+    conn->ka_state_gen++;
+
+    ka_info.version = conn->ka_tx_version;
+    ka_info.flags = (conn->ka_tx_version == CONN_MGMT_KA_VERSION_1 &&
+                     conn->ka_v2_enabled) ? CONN_MGMT_KA_F_V2_CAPABLE : 0;
+    ka_info.state_gen = conn->ka_state_gen;
+    ka_info.seq_no = conn->ka_seq_no;
+    ka_info.src_ip_addr = conn->src_addr.s_addr;
+    ka_info.dst_ip_addr = conn->peer_addr.sin_addr.s_addr;
+    ka_info.src_port_no = conn->conn_key.src_port_no;
+    ka_info.dst_port_no = conn->conn_key.dst_port_no;
+    ka_info.mastership_state = conn->mastership_state;
+    ka_info.conn_state = conn->conn_status;
+    ka_info.hold_time = conn->hold_time;
+    ka_info.send_time = conn_mgmt_get_wall_time_usec();
+
+    ka_pkt_size = conn_mgmt_ka_encode(&ka_info, ka_pkt, ka_pkt_size);
+    assert(ka_pkt_size);
+    return ka_pkt_size;
+}
 
-    ka_pkt_fmt_t *ka_pkt_fmt = (ka_pkt_fmt_t *)ka_pkt;
+/* For the recv and hold timer paths, which do not hold conn_mutex : the
+ * KA timer stamps the same buffer from the wheel timer thread */
+static void
+conn_mgmt_rebuild_ka_msg(conn_mgmt_conn_state_t *conn) {
 
-    strncpy(ka_pkt_fmt->src_ip_addr, conn->conn_key.src_ip,
-            sizeof(conn->conn_key.src_ip));
-    ka_pkt_fmt->src_port_no = conn->conn_key.src_port_no;
-    strncpy(ka_pkt_fmt->dst_ip_addr, conn->conn_key.dest_ip,
-            sizeof(conn->conn_key.dest_ip));
-    ka_pkt_fmt->dst_port_no = conn->conn_key.dst_port_no;
-    ka_pkt_fmt->mastership_state = conn->mastership_state;
-    ka_pkt_fmt->conn_state = conn->conn_status;
-    memset(ka_pkt_fmt->my_mac, 0xff, sizeof(ka_pkt_fmt->my_mac));
-    memset(ka_pkt_fmt->peer_reported_my_mac, 0xff, 
-           sizeof(ka_pkt_fmt->peer_reported_my_mac));
-    ka_pkt_fmt->hold_time = conn->keep_alive_interval * 2;
-    return sizeof(ka_pkt_fmt_t);
+    pthread_mutex_lock(&conn->conn_mutex);
+    conn->ka_msg.ka_msg_size =
+        conn_mgmt_update_ka_pkt(conn,
+                       conn->ka_msg.ka_msg,
+                       sizeof(conn->ka_msg.ka_msg));
+    pthread_mutex_unlock(&conn->conn_mutex);
 }
 
 static void
-ka_pkt_print(ka_pkt_fmt_t *ka_pkt_fmt) {
+ka_pkt_print(unsigned char *ka_pkt, uint32_t ka_pkt_size) {
+
+    conn_mgmt_ka_info_t ka_info;
+    char src_ip[INET_ADDRSTRLEN], dst_ip[INET_ADDRSTRLEN];
+
+    if (!conn_mgmt_ka_decode(ka_pkt, ka_pkt_size, &ka_info)) {
+        printf("\t\tNone\n");
+        return;
+    }
+
+    inet_ntop(AF_INET, &ka_info.src_ip_addr, src_ip, sizeof(src_ip));
+    inet_ntop(AF_INET, &ka_info.dst_ip_addr, dst_ip, sizeof(dst_ip));
 
+    printf("\t\tversion : %u, state gen : %u, seq no : %u\n",
+            ka_info.version, ka_info.state_gen, ka_info.seq_no);
     printf("\t\tSrc ip and Port No : %s %u\n",
-            ka_pkt_fmt->src_ip_addr, ka_pkt_fmt->src_port_no);
+            src_ip, ka_info.src_port_no);
     printf("\t\tdst ip and Port No : %s %u\n",
-            ka_pkt_fmt->dst_ip_addr, ka_pkt_fmt->dst_port_no);
+            dst_ip, ka_info.dst_port_no);
     
-    switch(ka_pkt_fmt->mastership_state) {
+    switch(ka_info.mastership_state) {
         case COMM_MGMT_MASTER:
             printf("\t\tmastership state : Master\n");
             break;
@@ -157,7 +497,7 @@ ka_pkt_print(ka_pkt_fmt_t *ka_pkt_fmt) {
             break;
         default: ;
     }
-    switch(ka_pkt_fmt->conn_state){
+    switch(ka_info.conn_state){
         case COMM_MGMT_CONN_DOWN:
             printf("\t\tConn State : Down\n");
             break;
@@ -169,36 +509,50 @@ ka_pkt_print(ka_pkt_fmt_t *ka_pkt_fmt) {
             break;
         default : ;
     }
-    printf("\t\tmy mac : %s\n", ka_pkt_fmt->my_mac);
-    printf("\t\tpeer reported my mac : %s\n",
-            ka_pkt_fmt->peer_reported_my_mac);
-    printf("\t\thold time : %u\n", ka_pkt_fmt->hold_time);
+    printf("\t\thold time : %u msec\n", ka_info.hold_time);
 }
 
 
-#define MAX_PACKET_BUFFER_SIZE 256
-static unsigned char recv_buffer[MAX_PACKET_BUFFER_SIZE];
+static void
+conn_mgmt_publish_client_event(conn_mgmt_conn_state_t *conn,
+                               clientipc_event_type_t event_type) {
+
+    clientipc_event_t event;
+
+    if (!clientipc_server_is_running()) return;
+
+    memset(&event, 0, sizeof(event));
+    event.event_type = event_type;
+    event.conn_status = conn->conn_status;
+    event.mastership_state = conn->mastership_state;
+    event.src_port_no = conn->conn_key.src_port_no;
+    event.dst_port_no = conn->conn_key.dst_port_no;
+    memcpy(event.src_ip, conn->conn_key.src_ip, sizeof(event.src_ip));
+    memcpy(event.dest_ip, conn->conn_key.dest_ip, sizeof(event.dest_ip));
+    memcpy(event.conn_name, conn->conn_name, sizeof(event.conn_name));
+    clientipc_server_publish(&event);
+}
 
 static void
 conn_mgmt_report_connection_status_to_clients(
 	conn_mgmt_conn_state_t *conn) {
 
-    
+    conn_mgmt_notif_enqueue(conn);
+    conn_mgmt_publish_client_event(conn, CLIENTIPC_EVENT_CONN_STATUS);
 }
 
 static void
 conn_mgmt_report_pre_switchover_to_clients(
         conn_mgmt_conn_state_t *conn) {
 
-    
-
+    conn_mgmt_publish_client_event(conn, CLIENTIPC_EVENT_PRE_SWITCHOVER);
 }
 
 static void
 conn_mgmt_report_post_switchover_to_clients(
         conn_mgmt_conn_state_t *conn) {
 
-    
+    conn_mgmt_publish_client_event(conn, CLIENTIPC_EVENT_POST_SWITCHOVER);
 }
 
 static void
@@ -211,28 +565,46 @@ conn_mgmt_switchover(conn_mgmt_conn_state_t *conn) {
 
         conn->mastership_state = COMM_MGMT_MASTER;
     
-        conn_mgmt_update_ka_pkt(conn, 
-                       conn->ka_msg.ka_msg,
-                       sizeof(conn->ka_msg.ka_msg));
+        conn_mgmt_rebuild_ka_msg(conn);
         conn_mgmt_report_post_switchover_to_clients(conn);
+        conn->last_switchover_time = conn_mgmt_get_time_usec();
     }
 }
 
 static void
-conn_mgmt_tear_conn_down (void *arg, unsigned int arg_size) {
+conn_mgmt_tear_conn_down (conn_mgmt_conn_state_t *conn) {
 
-	conn_mgmt_conn_state_t *conn = (conn_mgmt_conn_state_t *)arg;
     timer_de_register_app_event(conn->conn_hold_timer);
     conn->conn_hold_timer = NULL;
-    conn_mgmt_update_conn_state(conn,
-            COMM_MGMT_CONN_DOWN);
-    conn_mgmt_update_ka_pkt(conn, 
-                       conn->ka_msg.ka_msg,
-                       sizeof(conn->ka_msg.ka_msg));
+    conn->conn_status = COMM_MGMT_CONN_DOWN;
+    conn->down_count++;
+    conn->last_down_time = conn_mgmt_get_time_usec();
+    conn_mgmt_rebuild_ka_msg(conn);
     conn_mgmt_report_connection_status_to_clients(conn);
     conn_mgmt_switchover(conn);
 }
 
+/* KA msgs with an unchanged state gen do not touch the hold timer, they
+ * only stamp last_ka_rx_time. So when the hold timer fires, the peer may
+ * well be alive : re-arm the timer for whatever remains of the hold time
+ * since the last KA msg, and tear down only if nothing is left */
+static void
+conn_mgmt_hold_timer_expired (void *arg, unsigned int arg_size) {
+
+	conn_mgmt_conn_state_t *conn = (conn_mgmt_conn_state_t *)arg;
+    uint64_t elapsed =
+        (conn_mgmt_get_time_usec() - conn->last_ka_rx_time) / 1000;
+
+    if (conn->destroyed) return;
+
+    if (elapsed < conn->hold_time) {
+        wt_elem_reschedule(conn->conn_hold_timer,
+            conn_mgmt_round_up_to_tic(conn->hold_time - elapsed));
+        return;
+    }
+    conn_mgmt_tear_conn_down(conn);
+}
+
 static void
 conn_mgmt_refresh_conn_expiration_timer(
 	conn_mgmt_conn_state_t *conn) {
@@ -240,15 +612,15 @@ conn_mgmt_refresh_conn_expiration_timer(
 	if (!conn->conn_hold_timer) {
 		conn->conn_hold_timer = timer_register_app_event(
                                 conn->wt,
-								conn_mgmt_tear_conn_down,
+								conn_mgmt_hold_timer_expired,
 								(void *)conn, sizeof(conn),
-								conn->hold_time * 1000,
+								conn->hold_time,
 								0); 
 		return;				
 	}
 	
 	wt_elem_reschedule(conn->conn_hold_timer,
-                       conn->hold_time * 1000);
+                       conn->hold_time);
 }
 
 static void
@@ -279,9 +651,7 @@ conn_mgmt_update_conn_state(
 	}
 	
 	if (conn_state_changed) {
-        conn_mgmt_update_ka_pkt(conn, 
-                       conn->ka_msg.ka_msg,
-                       sizeof(conn->ka_msg.ka_msg));
+        conn_mgmt_rebuild_ka_msg(conn);
 		conn_mgmt_report_connection_status_to_clients(conn);
 	}
 }
@@ -291,43 +661,110 @@ pkt_receive( conn_mgmt_conn_state_t *conn,
 			 unsigned char *pkt,
 			 uint32_t pkt_size) {
   
+    uint8_t ka_tx_version;
+    uint16_t piggyback_len;
+    uint64_t now, inter_arrival, ka_interval;
+    conn_mgmt_ka_info_t ka_info;
+    const unsigned char *piggyback;
+    conn_mgmt_ka_piggyback_fill_fn piggyback_fill;
+    conn_mgmt_ka_piggyback_recv_fn piggyback_recv;
+    void *piggyback_arg;
+
     assert(pkt_size <= CONN_MGMT_KA_PKT_MAX_SIZE);
+
+    /* Drained after destroy, before the socket is closed */
+    if (conn->destroyed) return;
+
+    /* Truncated, unknown version or bad checksum */
+    if (!conn_mgmt_ka_decode_hdr(pkt, pkt_size, &ka_info)) {
+        return;
+    }
+
     conn->ka_recvd++;
-    
-    if (conn->peer_ka_msg.ka_msg_size != pkt_size ||
-    	 memcmp(conn->peer_ka_msg.ka_msg, pkt, pkt_size)) {
-    	
-    	memcpy(conn->peer_ka_msg.ka_msg, pkt, pkt_size);
-    	conn_mgmt_update_conn_state(conn,
-                conn_mgmt_get_next_conn_state(conn->conn_status));
+    now = conn_mgmt_get_time_usec();
+
+    /* How far off the KA interval the peer's KA msgs arrive */
+    if (conn->conn_status == COMM_MGMT_CONN_UP) {
+        inter_arrival = now - conn->last_ka_rx_time;
+        ka_interval = conn->keep_alive_interval * 1000ULL;
+        conn_mgmt_hist_add(&conn_mgmt_io_stats.ka_rx_jitter,
+                           inter_arrival > ka_interval ?
+                           inter_arrival - ka_interval :
+                           ka_interval - inter_arrival);
+    }
+    conn->last_ka_rx_time = now;
+
+    if ((ka_info.flags & CONN_MGMT_KA_F_PIGGYBACK) &&
+        conn_mgmt_ka_get_piggyback(pkt, pkt_size, &piggyback,
+                                   &piggyback_len) &&
+        conn_mgmt_ka_piggyback_get(conn, &piggyback_fill,
+                                   &piggyback_recv, &piggyback_arg)) {
+        if (piggyback_recv) {
+            piggyback_recv(conn, piggyback_arg, piggyback, piggyback_len);
+        }
+        conn_mgmt_ka_piggyback_put(conn);
+    }
+
+    /* Talk v2 as soon as the peer can, fall back to v1 if the peer
+     * turns out to be an older one, and to legacy KA msgs if it
+     * predates v1 */
+    if (ka_info.version == CONN_MGMT_KA_VERSION_LEGACY) {
+        ka_tx_version = CONN_MGMT_KA_VERSION_LEGACY;
+    } else {
+        ka_tx_version = (conn->ka_v2_enabled &&
+                         (ka_info.version == CONN_MGMT_KA_VERSION_2 ||
+                          (ka_info.flags & CONN_MGMT_KA_F_V2_CAPABLE))) ?
+                        CONN_MGMT_KA_VERSION_2 : CONN_MGMT_KA_VERSION_1;
+    }
+
+    if (ka_tx_version != conn->ka_tx_version) {
+        conn->ka_tx_version = ka_tx_version;
+        conn_mgmt_rebuild_ka_msg(conn);
+    }
+
+    /* Steady state : peer's state has not changed since its last KA
+     * msg, the timestamp above is all the hold timer needs */
+    if (conn->conn_status == COMM_MGMT_CONN_UP &&
+        conn->peer_ka_msg.ka_msg_size &&
+        ka_info.state_gen == conn->peer_state_gen) {
+        return;
     }
+
+    /* pkt points into a recv slot which is reused */
+    memcpy(conn->peer_ka_msg.ka_msg, pkt, pkt_size);
+    conn->peer_ka_msg.ka_msg_size = pkt_size;
+    conn->peer_state_gen = ka_info.state_gen;
+
+    conn_mgmt_update_conn_state(conn,
+            conn_mgmt_get_next_conn_state(conn->conn_status));
 }
 
 
 static void*
 conn_mgmt_pkt_recv(void *arg) {
 
-	uint32_t bytes_recvd;
-    
-    int addr_len = sizeof(struct sockaddr);
-    
+    int i, n_msgs;
     conn_mgmt_conn_state_t *conn = (conn_mgmt_conn_state_t *)arg;
-    
-	struct sockaddr_in sender_addr;
-    sender_addr.sin_family      = AF_INET;
-    sender_addr.sin_port        = conn->conn_key.src_port_no;
-    sender_addr.sin_addr.s_addr = INADDR_ANY;
-	
+    conn_mgmt_rx_ring_t *rx_ring = conn->rx_ring;
+
     while(1) {
-    
-    	memset(recv_buffer, 0, MAX_PACKET_BUFFER_SIZE);
-        bytes_recvd = recvfrom(conn->sock_fd, 
-							   (char *)recv_buffer, 
-                               MAX_PACKET_BUFFER_SIZE, 0,
-                               (struct sockaddr *)&sender_addr,
-                               &addr_len);
-                
-        pkt_receive(conn, recv_buffer, bytes_recvd);
+
+        /* Block for the first msg, then take whatever else is queued */
+        n_msgs = conn_mgmt_rx_ring_recv(rx_ring, conn->sock_fd,
+                                        MSG_WAITFORONE);
+        /* Socket shut down by conn_mgmt_destroy_connection() */
+        if (conn->destroyed) break;
+
+        if (n_msgs < 0) {
+            if (errno == EINTR) continue;
+            printf("Error : recv failed on connection %s, errno = %d\n",
+                   conn->conn_name, errno);
+            break;
+        }
+
+        for (i = 0; i < n_msgs; i++) {
+            pkt_receive(conn, rx_ring->slots[i].pkt, rx_ring->msgs[i].msg_len);
+        }
     }
     return 0;
 }
@@ -335,83 +772,593 @@ conn_mgmt_pkt_recv(void *arg) {
 static void
 conn_mgmt_start_pkt_recvr_thread(conn_mgmt_conn_state_t *conn) {
 
-	pthread_attr_t attr;
-    pthread_t recv_pkt_thread;
+    /* Joined when the connection is destroyed */
+    if (pthread_create(&conn->recv_thread, NULL,
+                       conn_mgmt_pkt_recv, (void *)conn) == 0) {
+        conn->recv_thread_running = true;
+    }
+}
+
+/* Dotted decimal or host name to a binary IPv4 address */
+static bool
+conn_mgmt_resolve_ip(const char *host, struct in_addr *addr) {
+
+    struct addrinfo hints, *res = NULL;
+
+    /* Dotted decimal, no lookup needed */
+    if (inet_pton(AF_INET, host, addr) == 1) {
+        return true;
+    }
+
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_DGRAM;
+
+    if (getaddrinfo(host, NULL, &hints, &res) != 0 || !res) {
+        return false;
+    }
+
+    *addr = ((struct sockaddr_in *)res->ai_addr)->sin_addr;
+    freeaddrinfo(res);
+    return true;
+}
+
+/* Resolve the peer address once, instead of on every KA msg */
+static bool
+conn_mgmt_resolve_peer_addr(conn_mgmt_conn_state_t *conn) {
+
+    memset(&conn->peer_addr, 0, sizeof(conn->peer_addr));
+    conn->peer_addr.sin_family = AF_INET;
+    conn->peer_addr.sin_port = conn->conn_key.dst_port_no;
+
+    if (!conn_mgmt_resolve_ip(conn->conn_key.dest_ip,
+                              &conn->peer_addr.sin_addr)) {
+        printf("Error : could not resolve %s\n", conn->conn_key.dest_ip);
+        return false;
+    }
+    return true;
+}
+
+int
+conn_mgmt_send_msg(conn_mgmt_conn_state_t *conn,
+                   unsigned char *msg,
+                   uint32_t msg_size) {
+
+    __sync_fetch_and_add(&conn_mgmt_io_stats.ka_tx_syscalls, 1);
+    __sync_fetch_and_add(&conn_mgmt_io_stats.ka_tx_pkts, 1);
+
+    if (conn->udp_sock_connected) {
+        return send(conn->sock_fd, msg, msg_size, 0);
+    }
+
+    return sendto(conn->sock_fd, msg, msg_size, 0,
+                  (struct sockaddr *)&conn->peer_addr,
+                  sizeof(conn->peer_addr));
+}
+
+void
+conn_mgmt_set_conn_connect_udp_sock(
+        conn_mgmt_conn_state_t *conn,
+        bool connect_udp_sock) {
+
+    conn->connect_udp_sock = connect_udp_sock;
+}
+
+
+/* Event loop mode */
+
+/* Batched I/O mode : the peer's KA msg carries the peer's view of the
+ * conn addresses, the local view is the same with src and dst swapped.
+ * A connection whose src ip did not resolve is indexed by INADDR_ANY */
+static conn_mgmt_conn_state_t *
+conn_mgmt_demux_ka_pkt(unsigned char *pkt, uint32_t pkt_size) {
+
+    conn_mgmt_ka_info_t ka_info;
+    conn_mgmt_conn_state_t *conn;
+
+    if (!conn_mgmt_ka_decode(pkt, pkt_size, &ka_info)) return NULL;
+
+    pthread_rwlock_rdlock(&connection_db.db_lock);
+
+    conn = conn_mgmt_conn_db_lookup_by_addr(&connection_db,
+                ka_info.dst_ip_addr, ka_info.dst_port_no,
+                ka_info.src_ip_addr, ka_info.src_port_no);
+    if (!conn) {
+        conn = conn_mgmt_conn_db_lookup_by_addr(&connection_db,
+                    INADDR_ANY, ka_info.dst_port_no,
+                    ka_info.src_ip_addr, ka_info.src_port_no);
+    }
+
+    pthread_rwlock_unlock(&connection_db.db_lock);
+    return conn;
+}
+
+static void
+conn_mgmt_shared_sock_drain(conn_mgmt_shared_sock_t *shared_sock) {
+
+    int i, n_msgs;
+    conn_mgmt_conn_state_t *conn;
+    conn_mgmt_rx_ring_t *rx_ring = shared_sock->rx_ring;
+
+    while(1) {
+
+        n_msgs = conn_mgmt_rx_ring_recv(rx_ring, shared_sock->sock_fd,
+                                        MSG_DONTWAIT);
+        if (n_msgs <= 0) break;
+
+        for (i = 0; i < n_msgs; i++) {
+
+            conn = conn_mgmt_demux_ka_pkt(rx_ring->slots[i].pkt,
+                                          rx_ring->msgs[i].msg_len);
+            if (!conn) {
+                __sync_fetch_and_add(&conn_mgmt_io_stats.ka_rx_unknown, 1);
+                continue;
+            }
+            pkt_receive(conn, rx_ring->slots[i].pkt,
+                        rx_ring->msgs[i].msg_len);
+        }
+
+        /* Socket is drained */
+        if (n_msgs < rx_ring->n_slots) break;
+    }
+}
+
+/* Queue the connection's KA msg, it is sent out at the end of the
+ * current wheel timer tic */
+static void
+conn_mgmt_shared_sock_queue_ka(conn_mgmt_conn_state_t *conn) {
+
+    uint32_t new_capacity;
+    conn_mgmt_shared_sock_t *shared_sock = conn->shared_sock;
+
+    pthread_mutex_lock(&shared_sock->tx_mutex);
+
+    if (shared_sock->n_tx == shared_sock->tx_capacity) {
+
+        new_capacity = shared_sock->tx_capacity ?
+                       shared_sock->tx_capacity * 2 : 64;
+        shared_sock->tx_iovs = realloc(shared_sock->tx_iovs,
+                                new_capacity * sizeof(struct iovec));
+        shared_sock->tx_addrs = realloc(shared_sock->tx_addrs,
+                                new_capacity * sizeof(struct sockaddr_in));
+        shared_sock->tx_msgs = realloc(shared_sock->tx_msgs,
+                                new_capacity * sizeof(struct mmsghdr));
+        shared_sock->tx_capacity = new_capacity;
+    }
+
+    shared_sock->tx_addrs[shared_sock->n_tx] = conn->peer_addr;
+    /* Sent straight out of the connection's tx copy, which the recv
+     * thread never rebuilds */
+    shared_sock->tx_iovs[shared_sock->n_tx].iov_base = conn->ka_tx_msg.ka_msg;
+    shared_sock->tx_iovs[shared_sock->n_tx].iov_len =
+        conn->ka_tx_msg.ka_msg_size;
+    shared_sock->n_tx++;
+    conn->ka_sent++;
+
+    pthread_mutex_unlock(&shared_sock->tx_mutex);
+}
+
+static void
+conn_mgmt_shared_sock_flush(conn_mgmt_shared_sock_t *shared_sock) {
+
+    int n_sent;
+    uint32_t i, n_done = 0;
+
+    pthread_mutex_lock(&shared_sock->tx_mutex);
+
+    for (i = 0; i < shared_sock->n_tx; i++) {
+        memset(&shared_sock->tx_msgs[i].msg_hdr, 0,
+               sizeof(shared_sock->tx_msgs[i].msg_hdr));
+        shared_sock->tx_msgs[i].msg_hdr.msg_name = &shared_sock->tx_addrs[i];
+        shared_sock->tx_msgs[i].msg_hdr.msg_namelen =
+            sizeof(struct sockaddr_in);
+        shared_sock->tx_msgs[i].msg_hdr.msg_iov = &shared_sock->tx_iovs[i];
+        shared_sock->tx_msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    while (n_done < shared_sock->n_tx) {
+
+        n_sent = sendmmsg(shared_sock->sock_fd,
+                          &shared_sock->tx_msgs[n_done],
+                          shared_sock->n_tx - n_done > CONN_MGMT_IO_TX_BATCH_MAX ?
+                          CONN_MGMT_IO_TX_BATCH_MAX : shared_sock->n_tx - n_done,
+                          0);
+        __sync_fetch_and_add(&conn_mgmt_io_stats.ka_tx_syscalls, 1);
+
+        if (n_sent <= 0) {
+            /* Skip the msg which could not be sent */
+            n_done++;
+            continue;
+        }
+        n_done += n_sent;
+        __sync_fetch_and_add(&conn_mgmt_io_stats.ka_tx_pkts, n_sent);
+    }
+
+    shared_sock->n_tx = 0;
+    pthread_mutex_unlock(&shared_sock->tx_mutex);
+}
+
+/* Registered as the global wheel timer's tick end callback */
+static void
+conn_mgmt_flush_shared_socks(void *arg, unsigned int arg_size) {
+
+    glthread_t *curr;
+
+    pthread_mutex_lock(&conn_mgmt_shared_socks_mutex);
+
+    ITERATE_GLTHREAD_BEGIN(&conn_mgmt_shared_socks, curr) {
+
+        conn_mgmt_shared_sock_flush(glthread_glue_to_shared_sock(curr));
+    } ITERATE_GLTHREAD_END(&conn_mgmt_shared_socks, curr);
+
+    pthread_mutex_unlock(&conn_mgmt_shared_socks_mutex);
+}
+
+static void
+conn_mgmt_shared_sock_free(conn_mgmt_shared_sock_t *shared_sock) {
+
+    if (shared_sock->sock_fd >= 0) close(shared_sock->sock_fd);
+    conn_mgmt_rx_ring_destroy(shared_sock->rx_ring);
+    pthread_mutex_destroy(&shared_sock->tx_mutex);
+    free(shared_sock->tx_iovs);
+    free(shared_sock->tx_addrs);
+    free(shared_sock->tx_msgs);
+    free(shared_sock);
+}
+
+/* The fd is registered with one of the loops, which one is not kept */
+static void
+conn_mgmt_io_loops_del_fd(int fd) {
+
+    uint8_t i;
+
+    for (i = 0; i < conn_mgmt_n_io_loops; i++) {
+        epoll_ctl(conn_mgmt_io_loops[i].epoll_fd, EPOLL_CTL_DEL, fd, NULL);
+    }
+}
+
+/* A loop which has been round epoll_wait() since the snapshot no
+ * longer holds any event it got before */
+static void
+conn_mgmt_io_loops_snapshot_passes(uint64_t *passes) {
+
+    uint8_t i;
+
+    for (i = 0; i < conn_mgmt_n_io_loops; i++) {
+        passes[i] = __atomic_load_n(&conn_mgmt_io_loops[i].n_passes,
+                                    __ATOMIC_SEQ_CST);
+    }
+}
+
+static bool
+conn_mgmt_io_loops_passed(const uint64_t *passes) {
+
+    uint8_t i;
+
+    for (i = 0; i < conn_mgmt_n_io_loops; i++) {
+        if (__atomic_load_n(&conn_mgmt_io_loops[i].n_passes,
+                            __ATOMIC_SEQ_CST) == passes[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static conn_mgmt_shared_sock_t *
+conn_mgmt_get_shared_sock(uint32_t src_port_no) {
+
+    int rcvbuf;
+    glthread_t *curr;
+    struct epoll_event ev;
+    struct sockaddr_in sender_addr;
+    conn_mgmt_shared_sock_t *shared_sock;
+
+    pthread_mutex_lock(&conn_mgmt_shared_socks_mutex);
+
+    ITERATE_GLTHREAD_BEGIN(&conn_mgmt_shared_socks, curr) {
+
+        shared_sock = glthread_glue_to_shared_sock(curr);
+        if (shared_sock->src_port_no == src_port_no) {
+            shared_sock->ref_count++;
+            pthread_mutex_unlock(&conn_mgmt_shared_socks_mutex);
+            return shared_sock;
+        }
+    } ITERATE_GLTHREAD_END(&conn_mgmt_shared_socks, curr);
+
+    shared_sock = calloc(1, sizeof(conn_mgmt_shared_sock_t));
+    shared_sock->src_port_no = src_port_no;
+    pthread_mutex_init(&shared_sock->tx_mutex, NULL);
+    init_glthread(&shared_sock->glue);
+
+    shared_sock->sock_fd = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    shared_sock->rx_ring = conn_mgmt_rx_ring_create(CONN_MGMT_IO_BATCH_SIZE);
+
+    if (!shared_sock->rx_ring) {
+        printf("Error : recv ring allocation failed\n");
+        goto fail;
+    }
+
+    if (shared_sock->sock_fd < 0) {
+        printf("Socket creation failed, error no = %d\n", errno);
+        goto fail;
+    }
+
+    /* Burst of KA msgs from all the peers arrive in the same tic */
+    rcvbuf = CONN_MGMT_SHARED_SOCK_RCVBUF;
+    if (setsockopt(shared_sock->sock_fd, SOL_SOCKET, SO_RCVBUFFORCE,
+                   &rcvbuf, sizeof(rcvbuf)) < 0) {
+        setsockopt(shared_sock->sock_fd, SOL_SOCKET, SO_RCVBUF,
+                   &rcvbuf, sizeof(rcvbuf));
+    }
+
+    sender_addr.sin_family      = AF_INET;
+    sender_addr.sin_port        = src_port_no;
+    sender_addr.sin_addr.s_addr = INADDR_ANY;
+
+    if (bind(shared_sock->sock_fd,
+             (struct sockaddr *)&sender_addr,
+             sizeof(struct sockaddr)) == -1) {
+        printf("Error : socket bind failed\n");
+        goto fail;
+    }
+
+    fcntl(shared_sock->sock_fd, F_SETFL,
+          fcntl(shared_sock->sock_fd, F_GETFL, 0) | O_NONBLOCK);
+
+    ev.events = EPOLLIN;
+    ev.data.ptr = (void *)shared_sock;
+
+    if (epoll_ctl(conn_mgmt_io_loops[
+                    __sync_fetch_and_add(&conn_mgmt_next_io_loop, 1) %
+                        conn_mgmt_n_io_loops].epoll_fd,
+                  EPOLL_CTL_ADD, shared_sock->sock_fd, &ev) < 0) {
+        printf("Error : epoll_ctl failed, errno = %d\n", errno);
+        goto fail;
+    }
+
+    shared_sock->ref_count = 1;
+    glthread_add_next(&conn_mgmt_shared_socks, &shared_sock->glue);
+    pthread_mutex_unlock(&conn_mgmt_shared_socks_mutex);
+    return shared_sock;
+
+fail:
+    conn_mgmt_shared_sock_free(shared_sock);
+    pthread_mutex_unlock(&conn_mgmt_shared_socks_mutex);
+    return NULL;
+}
+
+/* Drops a connection's ref, and takes the socket out of the I/O loops
+ * once it is the last one. Returns true if the caller must free the
+ * socket, once the I/O loops have moved on */
+static bool
+conn_mgmt_put_shared_sock(conn_mgmt_shared_sock_t *shared_sock) {
+
+    bool last;
+
+    pthread_mutex_lock(&conn_mgmt_shared_socks_mutex);
+    last = (--shared_sock->ref_count == 0);
+    if (last) {
+        remove_glthread(&shared_sock->glue);
+        conn_mgmt_io_loops_del_fd(shared_sock->sock_fd);
+    }
+    pthread_mutex_unlock(&conn_mgmt_shared_socks_mutex);
+    return last;
+}
+
+static void *
+conn_mgmt_io_loop_fn(void *arg) {
+
+    int i, j, n_events, n_msgs;
+    conn_mgmt_conn_state_t *conn;
+    conn_mgmt_rx_ring_t *rx_ring;
+    struct epoll_event events[CONN_MGMT_IO_MAX_EVENTS];
+
+    conn_mgmt_io_loop_t *io_loop = (conn_mgmt_io_loop_t *)arg;
+
+    while(1) {
+
+        __atomic_add_fetch(&io_loop->n_passes, 1, __ATOMIC_SEQ_CST);
+        n_events = epoll_wait(io_loop->epoll_fd, events,
+                              CONN_MGMT_IO_MAX_EVENTS,
+                              CONN_MGMT_IO_LOOP_IDLE_MSEC);
+
+        if (n_events < 0) {
+            if (errno == EINTR) continue;
+            printf("Error : epoll_wait failed, errno = %d\n", errno);
+            break;
+        }
+
+        for (i = 0; i < n_events; i++) {
+
+            if (conn_mgmt_io_mode == CONN_MGMT_IO_BATCHED) {
+                conn_mgmt_shared_sock_drain(
+                    (conn_mgmt_shared_sock_t *)events[i].data.ptr);
+                continue;
+            }
+
+            conn = (conn_mgmt_conn_state_t *)events[i].data.ptr;
+            rx_ring = conn->rx_ring;
+
+            /* Sockets are non-blocking, drain them completely */
+            while(1) {
+
+                n_msgs = conn_mgmt_rx_ring_recv(rx_ring, conn->sock_fd,
+                                                MSG_DONTWAIT);
+                if (n_msgs <= 0) break;
+
+                for (j = 0; j < n_msgs; j++) {
+                    pkt_receive(conn, rx_ring->slots[j].pkt,
+                                rx_ring->msgs[j].msg_len);
+                }
+                if (n_msgs < rx_ring->n_slots) break;
+            }
+        }
+    }
+    return NULL;
+}
+
+void
+conn_mgmt_set_io_mode(conn_mgmt_io_mode_t io_mode,
+                      uint8_t n_io_threads) {
+
+    uint8_t i;
+    pthread_attr_t attr;
+
+    /* Mode cannot be switched once the loops are running */
+    assert(conn_mgmt_n_io_loops == 0);
+
+    conn_mgmt_io_mode = io_mode;
+
+    if (io_mode == CONN_MGMT_IO_THREAD_PER_CONN) return;
+
+    if (n_io_threads == 0) n_io_threads = 1;
+    if (n_io_threads > CONN_MGMT_MAX_IO_THREADS)
+        n_io_threads = CONN_MGMT_MAX_IO_THREADS;
 
     pthread_attr_init(&attr);
     pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
 
-    pthread_create(&recv_pkt_thread, &attr, 
-                    conn_mgmt_pkt_recv, (void *)conn);
+    for (i = 0; i < n_io_threads; i++) {
+
+        conn_mgmt_io_loops[i].epoll_fd = epoll_create1(0);
+        assert(conn_mgmt_io_loops[i].epoll_fd >= 0);
+        pthread_create(&conn_mgmt_io_loops[i].io_thread_handle, &attr,
+                       conn_mgmt_io_loop_fn,
+                       (void *)&conn_mgmt_io_loops[i]);
+    }
+    conn_mgmt_n_io_loops = n_io_threads;
+
+    if (io_mode == CONN_MGMT_IO_BATCHED) {
+        init_glthread(&conn_mgmt_shared_socks);
+    }
 }
 
-static int
-send_udp_msg(char *dest_ip_addr,
-             uint32_t dest_port_no,
-             char *msg,
-             uint32_t msg_size,
-			 int sock_fd) {
-    
-	struct sockaddr_in dest;
+conn_mgmt_io_mode_t
+conn_mgmt_get_io_mode(void) {
 
-    dest.sin_family = AF_INET;
-    dest.sin_port = dest_port_no;
-    struct hostent *host = (struct hostent *)gethostbyname(dest_ip_addr);
-    dest.sin_addr = *((struct in_addr *)host->h_addr);
-    int addr_len = sizeof(struct sockaddr);
+    return conn_mgmt_io_mode;
+}
 
-    return sendto(sock_fd, msg, msg_size,
-            0, (struct sockaddr *)&dest,
-            sizeof(struct sockaddr));
+void
+conn_mgmt_get_io_stats(conn_mgmt_io_stats_t *io_stats) {
+
+    io_stats->ka_tx_pkts = conn_mgmt_io_stats.ka_tx_pkts;
+    io_stats->ka_tx_syscalls = conn_mgmt_io_stats.ka_tx_syscalls;
+    io_stats->ka_rx_pkts = conn_mgmt_io_stats.ka_rx_pkts;
+    io_stats->ka_rx_syscalls = conn_mgmt_io_stats.ka_rx_syscalls;
+    io_stats->ka_rx_unknown = conn_mgmt_io_stats.ka_rx_unknown;
+    memcpy(&io_stats->ka_rx_jitter, &conn_mgmt_io_stats.ka_rx_jitter,
+           sizeof(io_stats->ka_rx_jitter));
 }
 
+static void
+conn_mgmt_ka_timer_expired(void *arg, unsigned int arg_size) {
 
-static void *
-conn_mgmt_send_ka_pkt(void *arg) {
+    uint16_t piggyback_len = 0;
+    unsigned char piggyback[CONN_MGMT_KA_PIGGYBACK_MAX_SIZE];
+    conn_mgmt_ka_piggyback_fill_fn piggyback_fill;
+    conn_mgmt_ka_piggyback_recv_fn piggyback_recv;
+    void *piggyback_arg;
+    conn_mgmt_conn_state_t *conn = (conn_mgmt_conn_state_t *)arg;
+
+    /* De-registered, but may still fire in the current tic */
+    if (conn->pause_sending_kas || conn->destroyed) return;
 
-	conn_mgmt_conn_state_t *conn =
-		(conn_mgmt_conn_state_t *)arg;
+    /* Whatever the app has to say, if the peer talks v2 */
+    if (conn->ka_tx_version == CONN_MGMT_KA_VERSION_2 &&
+        conn_mgmt_ka_piggyback_get(conn, &piggyback_fill,
+                                   &piggyback_recv, &piggyback_arg)) {
+        if (piggyback_fill) {
+            piggyback_len = piggyback_fill(conn, piggyback_arg, piggyback,
+                                           sizeof(piggyback));
+        }
+        conn_mgmt_ka_piggyback_put(conn);
+    }
+
+    pthread_mutex_lock(&conn->conn_mutex);
+    if (piggyback_len ||
+        conn_mgmt_ka_has_piggyback(conn->ka_msg.ka_msg,
+                                   conn->ka_msg.ka_msg_size)) {
+        conn->ka_msg.ka_msg_size = conn_mgmt_ka_set_piggyback(
+            conn->ka_msg.ka_msg, conn->ka_msg.ka_msg_size, piggyback,
+            piggyback_len);
+    }
+
+    /* Patched in place, the rest of the KA msg only changes along
+     * with the state gen */
+    conn_mgmt_ka_stamp(conn->ka_msg.ka_msg, conn->ka_msg.ka_msg_size,
+                       ++conn->ka_seq_no, conn_mgmt_get_wall_time_usec());
+    memcpy(conn->ka_tx_msg.ka_msg, conn->ka_msg.ka_msg,
+           conn->ka_msg.ka_msg_size);
+    conn->ka_tx_msg.ka_msg_size = conn->ka_msg.ka_msg_size;
+    pthread_mutex_unlock(&conn->conn_mutex);
+
+    if (conn->shared_sock) {
+        conn_mgmt_shared_sock_queue_ka(conn);
+        return;
+    }
+
+    conn_mgmt_send_msg(conn,
+                       conn->ka_tx_msg.ka_msg,
+                       conn->ka_tx_msg.ka_msg_size);
+    conn->ka_sent++;
+}
+
+static void
+conn_mgmt_start_ka_timer(conn_mgmt_conn_state_t *conn) {
+
+    pthread_mutex_lock(&conn->conn_mutex);
 
 	conn->ka_msg.ka_msg_size = 
         conn_mgmt_update_ka_pkt(conn, 
                        conn->ka_msg.ka_msg,
                        sizeof(conn->ka_msg.ka_msg));
 
-	while(1) {
+    if (!conn->pause_sending_kas && !conn->ka_timer) {
+        conn_mgmt_register_ka_timer(conn);
+    }
+    pthread_mutex_unlock(&conn->conn_mutex);
+}
 
-        send_udp_msg (conn->conn_key.dest_ip,
-					  conn->conn_key.dst_port_no,
-					  conn->ka_msg.ka_msg,
-                      conn->ka_msg.ka_msg_size,
-					  conn->sock_fd);
-					  
-		conn->ka_sent++;
-		sleep(conn->keep_alive_interval);
-		
-        pthread_mutex_lock(&conn->conn_mutex);
+static void
+conn_mgmt_start_conn_batched(conn_mgmt_conn_state_t *conn) {
 
-        while (conn->pause_sending_kas) {
-            pthread_cond_wait(&conn->conn_thread.cv, &conn->conn_mutex);
-        }
-        pthread_mutex_unlock(&conn->conn_mutex);
-	}
-	
-	return NULL;
+    conn->shared_sock = conn_mgmt_get_shared_sock(conn->conn_key.src_port_no);
+
+    if (!conn->shared_sock) return;
+
+    conn->sock_fd = conn->shared_sock->sock_fd;
+    conn_mgmt_conn_db_add_addr(conn);
+    /* Idempotent, every connection registers the same callback */
+    wt_register_tick_end_callback(conn->wt,
+                                  conn_mgmt_flush_shared_socks, NULL);
+    conn_mgmt_start_ka_timer(conn);
 }
 
 static void
-conn_mgmt_start_ka_sending_thread(
-        conn_mgmt_conn_state_t *conn) {
+conn_mgmt_start_conn_in_io_loop(conn_mgmt_conn_state_t *conn) {
 
-	pthread_attr_t attr;
+    struct epoll_event ev;
+    conn_mgmt_io_loop_t *io_loop;
 
-    pthread_attr_init(&attr);
-    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    io_loop = &conn_mgmt_io_loops[
+        __sync_fetch_and_add(&conn_mgmt_next_io_loop, 1) %
+                                conn_mgmt_n_io_loops];
 
-    pthread_create(&conn->conn_thread.ka_thread_handle, &attr, 
-                    conn_mgmt_send_ka_pkt, (void *)conn);
-}
+    fcntl(conn->sock_fd, F_SETFL,
+          fcntl(conn->sock_fd, F_GETFL, 0) | O_NONBLOCK);
 
+    ev.events = EPOLLIN;
+    ev.data.ptr = (void *)conn;
+
+    if (epoll_ctl(io_loop->epoll_fd, EPOLL_CTL_ADD,
+                  conn->sock_fd, &ev) < 0) {
+        printf("Error : epoll_ctl failed, errno = %d\n", errno);
+        return;
+    }
+
+    conn_mgmt_start_ka_timer(conn);
+}
 
 void
 conn_mgmt_start_connection(
@@ -423,11 +1370,33 @@ conn_mgmt_start_connection(
 	if (conn->sock_fd > 0) {
 		assert(0);
 	}
+
+    if (!conn_mgmt_resolve_peer_addr(conn)) {
+        return;
+    }
+    if (!conn_mgmt_resolve_ip(conn->conn_key.src_ip, &conn->src_addr)) {
+        conn->src_addr.s_addr = INADDR_ANY;
+    }
+
+    if (conn_mgmt_io_mode == CONN_MGMT_IO_BATCHED) {
+        conn->wt = global_timer;
+        conn_mgmt_start_conn_batched(conn);
+        return;
+    }
 	
+    conn->rx_ring = conn_mgmt_rx_ring_create(CONN_MGMT_RX_RING_SLOTS);
+
+    if (!conn->rx_ring) {
+        printf("Error : recv ring allocation failed\n");
+        return;
+    }
+
     int udp_sock_fd = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP );
 	
 	if (udp_sock_fd < 0 ) {
 		printf("Socket creation failed, error no = %d\n", udp_sock_fd);
+        conn_mgmt_rx_ring_destroy(conn->rx_ring);
+        conn->rx_ring = NULL;
 		return;
 	}
 	
@@ -447,13 +1416,30 @@ conn_mgmt_start_connection(
         return;
     }
 
+    if (conn->connect_udp_sock) {
+
+        if (connect(conn->sock_fd,
+                    (struct sockaddr *)&conn->peer_addr,
+                    sizeof(conn->peer_addr)) == 0) {
+            conn->udp_sock_connected = true;
+        }
+        else {
+            printf("Error : socket connect failed, errno = %d\n", errno);
+        }
+    }
+
     conn->wt = global_timer;
 
+    if (conn_mgmt_io_mode == CONN_MGMT_IO_EVENT_LOOP) {
+        conn_mgmt_start_conn_in_io_loop(conn);
+        return;
+    }
+
 	/* Start the thread to recv KA msgs from the other machine */
     conn_mgmt_start_pkt_recvr_thread(conn);
 	
-	/*Start the thread to send periodic KA messags */
-    conn_mgmt_start_ka_sending_thread(conn);
+	/* Periodic KA msgs are sent from the wheel timer */
+    conn_mgmt_start_ka_timer(conn);
 }
 
 static void
@@ -466,16 +1452,285 @@ conn_mgmt_report_connection_state(
 
 /* mgmt APIs */
 
+/* FNV-1a, strings are hashed only up to their NUL so that
+ * garbage after the terminator does not matter */
+static inline uint32_t
+conn_mgmt_hash_bytes(uint32_t hash, const unsigned char *data,
+                     uint32_t len, bool is_string) {
+
+    uint32_t i;
+
+    for (i = 0; i < len; i++) {
+        if (is_string && data[i] == '\0') break;
+        hash ^= data[i];
+        hash *= 16777619U;
+    }
+    return hash;
+}
+
+static inline uint32_t
+conn_mgmt_hash_conn_name(const unsigned char *conn_name) {
+
+    return conn_mgmt_hash_bytes(2166136261U, conn_name, 64, true);
+}
+
+static inline uint32_t
+conn_mgmt_hash_conn_key(const conn_mgmt_conn_key_t *conn_key) {
+
+    uint32_t hash = 2166136261U;
+
+    hash = conn_mgmt_hash_bytes(hash, conn_key->src_ip,
+                                sizeof(conn_key->src_ip), true);
+    hash = conn_mgmt_hash_bytes(hash, conn_key->dest_ip,
+                                sizeof(conn_key->dest_ip), true);
+    hash = conn_mgmt_hash_bytes(hash,
+                (const unsigned char *)&conn_key->src_port_no,
+                sizeof(conn_key->src_port_no), false);
+    hash = conn_mgmt_hash_bytes(hash,
+                (const unsigned char *)&conn_key->dst_port_no,
+                sizeof(conn_key->dst_port_no), false);
+    return hash;
+}
+
+static inline uint32_t
+conn_mgmt_hash_conn_addr(uint32_t src_ip_addr, uint32_t src_port_no,
+                         uint32_t dst_ip_addr, uint32_t dst_port_no) {
+
+    uint32_t hash = 2166136261U;
+
+    hash = conn_mgmt_hash_bytes(hash, (const unsigned char *)&src_ip_addr,
+                                sizeof(src_ip_addr), false);
+    hash = conn_mgmt_hash_bytes(hash, (const unsigned char *)&src_port_no,
+                                sizeof(src_port_no), false);
+    hash = conn_mgmt_hash_bytes(hash, (const unsigned char *)&dst_ip_addr,
+                                sizeof(dst_ip_addr), false);
+    hash = conn_mgmt_hash_bytes(hash, (const unsigned char *)&dst_port_no,
+                                sizeof(dst_port_no), false);
+    return hash;
+}
+
+static inline uint32_t
+conn_mgmt_hash_conn_addr_of(const conn_mgmt_conn_state_t *conn) {
+
+    return conn_mgmt_hash_conn_addr(conn->src_addr.s_addr,
+                                    conn->conn_key.src_port_no,
+                                    conn->peer_addr.sin_addr.s_addr,
+                                    conn->conn_key.dst_port_no);
+}
+
+static inline bool
+conn_mgmt_conn_key_match(const conn_mgmt_conn_key_t *key1,
+                         const conn_mgmt_conn_key_t *key2) {
+
+    return key1->src_port_no == key2->src_port_no &&
+           key1->dst_port_no == key2->dst_port_no &&
+           strncmp(key1->src_ip, key2->src_ip, sizeof(key1->src_ip)) == 0 &&
+           strncmp(key1->dest_ip, key2->dest_ip, sizeof(key1->dest_ip)) == 0;
+}
+
+/* Double the no of buckets, called with DB write locked */
+static void
+conn_mgmt_conn_db_grow(conn_mgmt_conn_db_t *db) {
+
+    uint32_t i;
+    glthread_t *curr;
+    conn_mgmt_conn_state_t *conn;
+    uint32_t new_n_buckets = db->n_buckets * 2;
+    glthread_t *new_key_buckets = calloc(new_n_buckets, sizeof(glthread_t));
+    glthread_t *new_name_buckets = calloc(new_n_buckets, sizeof(glthread_t));
+    glthread_t *new_addr_buckets = calloc(new_n_buckets, sizeof(glthread_t));
+
+    if (!new_key_buckets || !new_name_buckets || !new_addr_buckets) {
+        free(new_key_buckets);
+        free(new_name_buckets);
+        free(new_addr_buckets);
+        return;
+    }
+
+    for (i = 0; i < db->n_buckets; i++) {
+
+        ITERATE_GLTHREAD_BEGIN(&db->key_buckets[i], curr) {
+
+            conn = glthread_key_glue_to_connection(curr);
+            remove_glthread(&conn->key_glue);
+            glthread_add_next(&new_key_buckets[
+                conn_mgmt_hash_conn_key(&conn->conn_key) &
+                    (new_n_buckets - 1)], &conn->key_glue);
+        } ITERATE_GLTHREAD_END(&db->key_buckets[i], curr);
+
+        ITERATE_GLTHREAD_BEGIN(&db->name_buckets[i], curr) {
+
+            conn = glthread_name_glue_to_connection(curr);
+            remove_glthread(&conn->name_glue);
+            glthread_add_next(&new_name_buckets[
+                conn_mgmt_hash_conn_name(conn->conn_name) &
+                    (new_n_buckets - 1)], &conn->name_glue);
+        } ITERATE_GLTHREAD_END(&db->name_buckets[i], curr);
+
+        ITERATE_GLTHREAD_BEGIN(&db->addr_buckets[i], curr) {
+
+            conn = glthread_addr_glue_to_connection(curr);
+            remove_glthread(&conn->addr_glue);
+            glthread_add_next(&new_addr_buckets[
+                conn_mgmt_hash_conn_addr_of(conn) &
+                    (new_n_buckets - 1)], &conn->addr_glue);
+        } ITERATE_GLTHREAD_END(&db->addr_buckets[i], curr);
+    }
+
+    free(db->key_buckets);
+    free(db->name_buckets);
+    free(db->addr_buckets);
+    db->key_buckets = new_key_buckets;
+    db->name_buckets = new_name_buckets;
+    db->addr_buckets = new_addr_buckets;
+    db->n_buckets = new_n_buckets;
+}
+
+static conn_mgmt_conn_state_t *
+conn_mgmt_conn_db_lookup_by_name(conn_mgmt_conn_db_t *db,
+                                 char *conn_name) {
+
+    glthread_t *curr;
+    conn_mgmt_conn_state_t *conn;
+    glthread_t *bucket = &db->name_buckets[
+        conn_mgmt_hash_conn_name(conn_name) & (db->n_buckets - 1)];
+
+    ITERATE_GLTHREAD_BEGIN(bucket, curr) {
+
+        conn = glthread_name_glue_to_connection(curr);
+        if (strncmp(conn_name, conn->conn_name,
+                    sizeof(conn->conn_name)) == 0) {
+            return conn;
+        }
+    } ITERATE_GLTHREAD_END(bucket, curr);
+    return NULL;
+}
+
+static conn_mgmt_conn_state_t *
+conn_mgmt_conn_db_lookup_by_key(conn_mgmt_conn_db_t *db,
+                                conn_mgmt_conn_key_t *conn_key) {
+
+    glthread_t *curr;
+    conn_mgmt_conn_state_t *conn;
+    glthread_t *bucket = &db->key_buckets[
+        conn_mgmt_hash_conn_key(conn_key) & (db->n_buckets - 1)];
+
+    ITERATE_GLTHREAD_BEGIN(bucket, curr) {
+
+        conn = glthread_key_glue_to_connection(curr);
+        if (conn_mgmt_conn_key_match(conn_key, &conn->conn_key)) {
+            return conn;
+        }
+    } ITERATE_GLTHREAD_END(bucket, curr);
+    return NULL;
+}
+
+static conn_mgmt_conn_state_t *
+conn_mgmt_conn_db_lookup_by_addr(conn_mgmt_conn_db_t *db,
+                                 uint32_t src_ip_addr, uint32_t src_port_no,
+                                 uint32_t dst_ip_addr, uint32_t dst_port_no) {
+
+    glthread_t *curr;
+    conn_mgmt_conn_state_t *conn;
+    glthread_t *bucket = &db->addr_buckets[
+        conn_mgmt_hash_conn_addr(src_ip_addr, src_port_no,
+                                 dst_ip_addr, dst_port_no) &
+            (db->n_buckets - 1)];
+
+    ITERATE_GLTHREAD_BEGIN(bucket, curr) {
+
+        conn = glthread_addr_glue_to_connection(curr);
+        if (conn->src_addr.s_addr == src_ip_addr &&
+            conn->conn_key.src_port_no == src_port_no &&
+            conn->peer_addr.sin_addr.s_addr == dst_ip_addr &&
+            conn->conn_key.dst_port_no == dst_port_no) {
+            return conn;
+        }
+    } ITERATE_GLTHREAD_END(bucket, curr);
+    return NULL;
+}
+
+/* Index a started connection by its resolved addresses */
+static void
+conn_mgmt_conn_db_add_addr(conn_mgmt_conn_state_t *conn) {
+
+    conn_mgmt_conn_db_t *db = &connection_db;
+
+    pthread_rwlock_wrlock(&db->db_lock);
+    remove_glthread(&conn->addr_glue);
+    glthread_add_next(&db->addr_buckets[
+        conn_mgmt_hash_conn_addr_of(conn) & (db->n_buckets - 1)],
+        &conn->addr_glue);
+    pthread_rwlock_unlock(&db->db_lock);
+}
+
+/* Returns false if a connection with the same name or key
+ * already exists */
+bool
+conn_mgmt_add_connection_to_db(conn_mgmt_conn_state_t *conn) {
+
+    conn_mgmt_conn_db_t *db = &connection_db;
+
+    pthread_rwlock_wrlock(&db->db_lock);
+
+    if (conn_mgmt_conn_db_lookup_by_name(db, conn->conn_name) ||
+        conn_mgmt_conn_db_lookup_by_key(db, &conn->conn_key)) {
+
+        pthread_rwlock_unlock(&db->db_lock);
+        return false;
+    }
+
+    if (db->n_conns >= db->n_buckets) {
+        conn_mgmt_conn_db_grow(db);
+    }
+
+    glthread_add_next(&db->key_buckets[
+        conn_mgmt_hash_conn_key(&conn->conn_key) & (db->n_buckets - 1)],
+        &conn->key_glue);
+    glthread_add_next(&db->name_buckets[
+        conn_mgmt_hash_conn_name(conn->conn_name) & (db->n_buckets - 1)],
+        &conn->name_glue);
+    glthread_add_last(&db->conn_list, &conn->glue);
+    db->n_conns++;
+
+    pthread_rwlock_unlock(&db->db_lock);
+    return true;
+}
+
+void
+conn_mgmt_remove_connection_from_db(conn_mgmt_conn_state_t *conn) {
+
+    conn_mgmt_conn_db_t *db = &connection_db;
+
+    pthread_rwlock_wrlock(&db->db_lock);
+    remove_glthread(&conn->key_glue);
+    remove_glthread(&conn->name_glue);
+    remove_glthread(&conn->addr_glue);
+    remove_glthread(&conn->glue);
+    db->n_conns--;
+    pthread_rwlock_unlock(&db->db_lock);
+}
+
 conn_mgmt_conn_state_t *
 conn_mgmt_lookup_connection_by_name(char *conn_name) {
 	
-	return NULL;
+    conn_mgmt_conn_state_t *conn;
+
+    pthread_rwlock_rdlock(&connection_db.db_lock);
+    conn = conn_mgmt_conn_db_lookup_by_name(&connection_db, conn_name);
+    pthread_rwlock_unlock(&connection_db.db_lock);
+	return conn;
 }
 
 conn_mgmt_conn_state_t *
 conn_mgmt_lookup_connection_by_key(conn_mgmt_conn_key_t *conn_key) {
 	
-	return NULL;
+    conn_mgmt_conn_state_t *conn;
+
+    pthread_rwlock_rdlock(&connection_db.db_lock);
+    conn = conn_mgmt_conn_db_lookup_by_key(&connection_db, conn_key);
+    pthread_rwlock_unlock(&connection_db.db_lock);
+	return conn;
 }
 
 /* backend handlers */
@@ -497,6 +1752,7 @@ conn_mgmt_configure_connection(char *conn_name,
  		return;  
    }
    
+   memset(&conn_key, 0, sizeof(conn_key));
    strncpy((char *)&conn_key.src_ip,  src_ip, 16);
    conn_key.src_port_no = src_port_no;
    strncpy((char *)&conn_key.dest_ip, dst_ip, 16);
@@ -513,17 +1769,104 @@ conn_mgmt_configure_connection(char *conn_name,
 	conn = conn_mgmt_create_new_connection(&conn_key, mastership);
 	strncpy(conn->conn_name, conn_name, sizeof(conn->conn_name));
     /* Set KA interval, if not set, default shall be used */
-    conn_mgmt_set_conn_ka_interval(conn, 2);
+    conn_mgmt_set_conn_ka_interval(conn, 2000);
+
+	if (!conn_mgmt_add_connection_to_db(conn)) {
+		printf("connection %s could not be added\n", conn_name);
+		free(conn);
+		return;
+	}
+
     /* Start send KA msgs, and get ready to recv msgs */
 	conn_mgmt_start_connection(conn);
+}
+
+/* Recurring on the global timer, frees a destroyed connection in
+ * stages once nothing can reach it any more */
+static void
+conn_mgmt_free_timer_expired(void *arg, unsigned int arg_size) {
+
+    conn_mgmt_conn_state_t *conn = (conn_mgmt_conn_state_t *)arg;
 
-	glthread_add_next(&connection_db, &conn->glue);
+    switch (conn->free_stage) {
+
+        case 0:
+            /* An I/O loop still in pkt_receive() may re-arm the hold
+             * timer, and queue a state change */
+            if (!conn_mgmt_io_loops_passed(conn->io_loop_passes)) return;
+            /* Hold timer is only touched from the I/O and timer
+             * threads, never under conn_mutex */
+            if (conn->conn_hold_timer) {
+                timer_de_register_app_event(conn->conn_hold_timer);
+                conn->conn_hold_timer = NULL;
+            }
+            conn->free_stage++;
+            /* Fall through */
+        case 1:
+            if (conn_mgmt_notif_conn_queued(conn)) return;
+            conn_mgmt_notif_snapshot_passes(conn->notif_passes);
+            conn->free_stage++;
+            return;
+        default:
+            if (!conn_mgmt_notif_passes_done(conn->notif_passes)) return;
+            break;
+    }
+
+    if (conn->shared_sock) {
+        conn_mgmt_shared_sock_free(conn->shared_sock);
+    } else if (conn->sock_fd > 0) {
+        close(conn->sock_fd);
+    }
+    conn_mgmt_rx_ring_destroy(conn->rx_ring);
+
+    timer_de_register_app_event(conn->free_timer);
+    pthread_cond_destroy(&conn->ka_piggyback_cond);
+    pthread_mutex_destroy(&conn->conn_mutex);
+    free(conn);
 }
 
 static void
 conn_mgmt_destroy_connection(conn_mgmt_conn_state_t *conn) {
 
+    uint32_t i;
+
+    conn_mgmt_remove_connection_from_db(conn);
+
+    pthread_mutex_lock(&conn->conn_mutex);
+    conn->destroyed = true;
+    if (conn->ka_timer) {
+        timer_de_register_app_event(conn->ka_timer);
+        conn->ka_timer = NULL;
+    }
+    pthread_mutex_unlock(&conn->conn_mutex);
+
+    for (i = 0; i < CONN_MGMT_MAX_CLIENTS_SUPPORTED; i++) {
+        if (conn->app_notif_cb[i]) {
+            conn_mgmt_unregister_app_notif_cb(conn, conn->app_notif_cb[i]);
+        }
+    }
+
+    /* Stop the I/O, the fds are closed once the conn is freed */
+    if (conn->shared_sock) {
+        /* Other connections still use it, not ours to free */
+        if (!conn_mgmt_put_shared_sock(conn->shared_sock)) {
+            conn->shared_sock = NULL;
+        }
+        conn->sock_fd = 0;
+    } else if (conn->recv_thread_running) {
+        /* Wakes up the recv thread blocked in recvmmsg() */
+        shutdown(conn->sock_fd, SHUT_RDWR);
+        pthread_join(conn->recv_thread, NULL);
+        conn->recv_thread_running = false;
+    } else if (conn->sock_fd > 0) {
+        conn_mgmt_io_loops_del_fd(conn->sock_fd);
+    }
+    conn_mgmt_io_loops_snapshot_passes(conn->io_loop_passes);
 
+    conn->free_timer = timer_register_app_event(global_timer,
+                            conn_mgmt_free_timer_expired,
+                            (void *)conn, sizeof(conn),
+                            CONN_MGMT_TIMER_TIC_MSEC, 1);
 }
 
 
@@ -552,7 +1895,7 @@ conn_mgmt_print_connection_details(conn_mgmt_conn_state_t *conn) {
 	printf("\tmastership status : %s\n", conn_mgmt_get_conn_mastership_state_str(conn->mastership_state));
 	printf("\tconnection state : %s\n", conn_mgmt_get_conn_state_name_str(conn->conn_status));
 	
-	printf("\tKA Interval : %u  hold time : %u\n",
+	printf("\tKA Interval : %u msec  hold time : %u msec\n",
 		conn->keep_alive_interval, conn->hold_time);
 		
 	printf("\tKA recvd :%u   KA sent :%u   Down Count :%u\n",
@@ -564,10 +1907,10 @@ conn_mgmt_print_connection_details(conn_mgmt_conn_state_t *conn) {
         0);
 		
 	printf("\t Local KA msg : \n");
-	ka_pkt_print(conn->ka_msg.ka_msg);
+	ka_pkt_print(conn->ka_msg.ka_msg, conn->ka_msg.ka_msg_size);
 	
 	printf("\n\t Peer KA msg \n");
-	ka_pkt_print(conn->peer_ka_msg.ka_msg);
+	ka_pkt_print(conn->peer_ka_msg.ka_msg, conn->peer_ka_msg.ka_msg_size);
 		
 	printf("*** connection details end *****\n");
 	
@@ -579,7 +1922,9 @@ conn_mgmt_print_all_connection_brief() {
 	glthread_t *curr;
 	conn_mgmt_conn_state_t *conn;
 	
-	ITERATE_GLTHREAD_BEGIN(&connection_db, curr) {
+	pthread_rwlock_rdlock(&connection_db.db_lock);
+
+	ITERATE_GLTHREAD_BEGIN(&connection_db.conn_list, curr) {
 	
 		conn = glthread_glue_to_connection(curr);
 		
@@ -590,14 +1935,14 @@ conn_mgmt_print_all_connection_brief() {
 			conn_mgmt_get_conn_state_name_str(conn->conn_status),
 			conn_mgmt_get_conn_mastership_state_str(conn->mastership_state));
 		
-	} ITERATE_GLTHREAD_END(&connection_db, curr);
+	} ITERATE_GLTHREAD_END(&connection_db.conn_list, curr);
+
+	pthread_rwlock_unlock(&connection_db.db_lock);
 }
 
 void
 conn_mgmt_show_connections(char *conn_name) {
 
-
-	glthread_t *curr;
 	conn_mgmt_conn_state_t *conn;
 	
 	if (!conn_name) {
@@ -606,16 +1951,14 @@ conn_mgmt_show_connections(char *conn_name) {
 		return;
 	}
 	
-	ITERATE_GLTHREAD_BEGIN(&connection_db, curr) {
-	
-		conn = glthread_glue_to_connection(curr);
-		
-		if (strncmp(conn_name, conn->conn_name, sizeof(conn->conn_name)) == 0) {
-			conn_mgmt_print_connection_details(conn);
-			return;
-		}
-		
-	} ITERATE_GLTHREAD_END(&connection_db, curr);
+	conn = conn_mgmt_lookup_connection_by_name(conn_name);
+
+	if (!conn) {
+		printf("connection %s could not be found\n", conn_name);
+		return;
+	}
+
+	conn_mgmt_print_connection_details(conn);
 }
 
 
@@ -21,7 +21,11 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include <pthread.h>
+#include <netinet/in.h>
 #include "../libtimer/WheelTimer.h"
+#include "conn_mgmt_ka.h"
+#include "conn_mgmt_hist.h"
+#include "conn_mgmt_notif.h"
 
 typedef enum {
 
@@ -84,8 +88,44 @@ conn_mgmt_get_conn_mastership_state_str(
 
 
 #define CONN_MGMT_MAX_CLIENTS_SUPPORTED	8
-#define CONN_MGMT_DEFAULT_KA_INTERVAL   5
+/* All KA intervals and hold times are in msec */
+#define CONN_MGMT_DEFAULT_KA_INTERVAL   5000
+/* Resolution of the global wheel timer, KA intervals and hold times
+ * are rounded up to a multiple of it */
+#define CONN_MGMT_TIMER_TIC_MSEC	10
+#define CONN_MGMT_TIMER_WHEEL_SIZE	1000
 #define CONN_MGMT_KA_PKT_MAX_SIZE	256
+#define CONN_MGMT_MAX_IO_THREADS	8
+
+/* How the connections recv their KA msgs. In every mode KA msgs are
+ * sent from recurring events on the global wheel timer */
+typedef enum {
+
+    /* Every connection gets its own recv thread */
+    CONN_MGMT_IO_THREAD_PER_CONN,
+    /* All connections are multiplexed over a small fixed set of
+     * epoll threads */
+    CONN_MGMT_IO_EVENT_LOOP,
+    /* Event loop mode, plus connections with the same src port share
+     * one socket : KA msgs due in the same wheel timer tic go out in
+     * one sendmmsg(), and inbound KA msgs are drained with recvmmsg()
+     * and demultiplexed on the conn key carried in the KA msg */
+    CONN_MGMT_IO_BATCHED
+} conn_mgmt_io_mode_t;
+
+/* Global KA I/O counters, across all connections */
+typedef struct conn_mgmt_io_stats_ {
+
+    uint64_t ka_tx_pkts;
+    uint64_t ka_tx_syscalls;
+    uint64_t ka_rx_pkts;
+    uint64_t ka_rx_syscalls;
+    /* KA msgs recvd on a shared socket matching no connection */
+    uint64_t ka_rx_unknown;
+    /* usecs between the KA interval and the actual gap between two
+     * KA msgs recvd on an UP connection */
+    conn_mgmt_hist_t ka_rx_jitter;
+} conn_mgmt_io_stats_t;
 
 typedef struct conn_mgmt_conn_key_ {
 
@@ -95,18 +135,29 @@ typedef struct conn_mgmt_conn_key_ {
     uint32_t dst_port_no;
 } conn_mgmt_conn_key_t;
 
-typedef struct comm_mgmt_conn_thread_ {
-
-	pthread_t ka_thread_handle;
-	pthread_cond_t cv;
-} conn_mgmt_conn_thread_t;
-
 typedef void *(*conn_mgmt_app_notif_fn_ptr)(
 				conn_mgmt_conn_status_t conn_code, 
                 conn_mgmt_conn_key_t *conn_key,
 				void *msg,
 				uint32_t msg_size);
 
+struct conn_mgmt_conn_state_;
+
+/* Fills up to buf_size bytes of app data to piggyback on the next KA
+ * msg, returns the no of bytes filled */
+typedef uint16_t (*conn_mgmt_ka_piggyback_fill_fn)(
+                struct conn_mgmt_conn_state_ *conn,
+                void *arg,
+                unsigned char *buf,
+                uint16_t buf_size);
+
+/* Called with the app data piggybacked on a KA msg recvd */
+typedef void (*conn_mgmt_ka_piggyback_recv_fn)(
+                struct conn_mgmt_conn_state_ *conn,
+                void *arg,
+                const unsigned char *data,
+                uint16_t len);
+
 typedef struct ka_msg_ {
     
     unsigned char ka_msg[CONN_MGMT_KA_PKT_MAX_SIZE];
@@ -125,38 +176,118 @@ typedef struct conn_mgmt_conn_state_{
     conn_mgmt_conn_status_t conn_status;
     /* Socket FD created to send and recv msgs */
 	int sock_fd;
-    /* Time interval in sec to send out KA msgs */
-	uint16_t keep_alive_interval;
-	/* Time interval to report the connection down*/
+    /* Socket shared with other connections, in batched I/O mode */
+    struct conn_mgmt_shared_sock_ *shared_sock;
+    /* Private ring of recv slots, KA msgs are parsed in place */
+    struct conn_mgmt_rx_ring_ *rx_ring;
+    /* Peer address, resolved once when the connection starts */
+    struct sockaddr_in peer_addr;
+    /* Local address, binary form of conn_key.src_ip */
+    struct in_addr src_addr;
+    /* connect() the socket to the peer and send with send(). The
+     * socket then only recvs msgs whose source is exactly peer_addr */
+    bool connect_udp_sock;
+    bool udp_sock_connected;
+    /* Time interval in msec to send out KA msgs */
+	uint32_t keep_alive_interval;
+	/* Time interval in msec to report the connection down*/
 	uint32_t hold_time;
-    /* Connection thread, to send out KA msgs */
-	conn_mgmt_conn_thread_t conn_thread;
     /* Some statistics to keep track */
 	uint32_t ka_recvd;
 	uint32_t ka_sent;
 	uint32_t down_count;
+    /* Bumped whenever the content of our KA msg changes */
+    uint16_t ka_state_gen;
+    /* Bumped on every KA msg sent */
+    uint32_t ka_seq_no;
+    /* State generation carried in the last KA msg recvd from peer */
+    uint16_t peer_state_gen;
+    /* Monotonic time in usec when the last KA msg was recvd, the hold
+     * timer checks it before tearing the connection down */
+    uint64_t last_ka_rx_time;
+    /* Monotonic time in usec when the connection last went down, and
+     * when the switchover which followed completed */
+    uint64_t last_down_time;
+    uint64_t last_switchover_time;
+    /* KA msg format sent : v1 until the peer advertises v2 support */
+    uint8_t ka_tx_version;
+    /* Advertise v2 support and switch to v2 when the peer does too */
+    bool ka_v2_enabled;
     /* Flag to track if sending KA msgs need to be paused */
     bool pause_sending_kas;
-    /* KA msg to be sent */
+    /* KA msg to be sent, rebuilt and stamped under conn_mutex */
     ka_msg_t ka_msg;
+    /* Copy of ka_msg taken at stamping time, the one actually sent.
+     * Only the wheel timer thread touches it, in batched I/O mode it
+     * stays queued until the end of the tic */
+    ka_msg_t ka_tx_msg;
     /* KA msg recvd from peer */
     ka_msg_t peer_ka_msg;
+    /* App data exchanged on the KA msgs, v2 only */
+    conn_mgmt_ka_piggyback_fill_fn ka_piggyback_fill;
+    conn_mgmt_ka_piggyback_recv_fn ka_piggyback_recv;
+    void *ka_piggyback_arg;
+    /* No of piggyback callbacks running, unregistering waits for
+     * them to return on ka_piggyback_cond */
+    uint32_t ka_piggyback_busy;
+    pthread_cond_t ka_piggyback_cond;
     /* Mutex to update the connection;s properties in a
      * thread safe manner */
     pthread_mutex_t conn_mutex;
-    /* List of appln callnacks to be notified */
+    /* List of appln callnacks to be notified, indexed by client */
 	conn_mgmt_app_notif_fn_ptr
         app_notif_cb[CONN_MGMT_MAX_CLIENTS_SUPPORTED];
+    /* Queue node of the connection in each client's notif queue */
+    conn_mgmt_notif_node_t notif_node[CONN_MGMT_MAX_CLIENTS_SUPPORTED];
     /* KA Expiry timer */
     wheel_timer_t *wt; /* Timer instance */
     wheel_timer_elem_t *conn_hold_timer;
+    /* Recurring KA transmission timer, NULL while KAs are paused */
+    wheel_timer_elem_t *ka_timer;
+    /* Recv thread, in thread per connection I/O mode */
+    pthread_t recv_thread;
+    bool recv_thread_running;
+    /* Set once the connection is destroyed. free_timer frees it a few
+     * tics later, once neither the I/O loops nor the notif dispatchers
+     * can still be holding it */
+    bool destroyed;
+    uint8_t free_stage;
+    wheel_timer_elem_t *free_timer;
+    uint64_t io_loop_passes[CONN_MGMT_MAX_IO_THREADS];
+    uint64_t notif_passes[CONN_MGMT_MAX_CLIENTS_SUPPORTED];
     /* Glue to the linked list */
     glthread_t glue;
+    /* Glues to the hash buckets of the connection DB */
+    glthread_t key_glue;
+    glthread_t name_glue;
+    /* Glue to the resolved addr index, linked while the connection
+     * runs on a shared socket */
+    glthread_t addr_glue;
 } conn_mgmt_conn_state_t;
 
 GLTHREAD_TO_STRUCT(glthread_glue_to_connection,
 				   conn_mgmt_conn_state_t, glue);
+GLTHREAD_TO_STRUCT(glthread_key_glue_to_connection,
+				   conn_mgmt_conn_state_t, key_glue);
+GLTHREAD_TO_STRUCT(glthread_name_glue_to_connection,
+				   conn_mgmt_conn_state_t, name_glue);
+GLTHREAD_TO_STRUCT(glthread_addr_glue_to_connection,
+				   conn_mgmt_conn_state_t, addr_glue);
+
+
+void
+conn_mgmt_init(void);
 
+/* Must be called before any connection is started */
+void
+conn_mgmt_set_io_mode(conn_mgmt_io_mode_t io_mode,
+                      uint8_t n_io_threads);
+
+conn_mgmt_io_mode_t
+conn_mgmt_get_io_mode(void);
+
+void
+conn_mgmt_get_io_stats(conn_mgmt_io_stats_t *io_stats);
 
 conn_mgmt_conn_state_t *
 conn_mgmt_create_new_connection(
@@ -167,11 +298,43 @@ void
 conn_mgmt_start_connection(
         conn_mgmt_conn_state_t *conn);
 
+/* Must be called before the connection is started, ignored in
+ * batched I/O mode where the socket is shared */
+void
+conn_mgmt_set_conn_connect_udp_sock(
+        conn_mgmt_conn_state_t *conn,
+        bool connect_udp_sock);
+
+/* Sends a msg to the peer of the connection */
+int
+conn_mgmt_send_msg(conn_mgmt_conn_state_t *conn,
+                   unsigned char *msg,
+                   uint32_t msg_size);
+
+/* ka_interval is in msec, hold time is set to twice the KA interval */
 void
 conn_mgmt_set_conn_ka_interval(
         conn_mgmt_conn_state_t *conn,
         uint32_t ka_interval);
 
+/* Allows or prevents the use of the v2 KA msg format on the connection,
+ * v2 is used only when both ends allow it */
+void
+conn_mgmt_set_conn_ka_v2_enabled(
+        conn_mgmt_conn_state_t *conn,
+        bool ka_v2_enabled);
+
+/* Lets an app send a few bytes on every KA msg of the connection and
+ * get the peer's. Only v2 KA msgs carry them, NULL fns unregister.
+ * Returns once no callback is running with the previous fns and arg,
+ * so must not be called from within those callbacks */
+void
+conn_mgmt_set_ka_piggyback(
+        conn_mgmt_conn_state_t *conn,
+        conn_mgmt_ka_piggyback_fill_fn fill_fn,
+        conn_mgmt_ka_piggyback_recv_fn recv_fn,
+        void *arg);
+
 bool
 conn_mgmt_pause_sending_kas(
         conn_mgmt_conn_state_t *conn);
@@ -181,6 +344,30 @@ conn_mgmt_resume_sending_kas(
         conn_mgmt_conn_state_t *conn);
 
 
+/* cb is called with every state change of conn, from a dispatcher
+ * thread of its own. A client is identified by its cb, the first
+ * registration of a cb creates the client */
+bool
+conn_mgmt_register_app_notif_cb(
+        conn_mgmt_conn_state_t *conn,
+        conn_mgmt_app_notif_fn_ptr cb);
+
+/* cb stops getting the state changes of conn. A state change queued
+ * already is dropped, unless its delivery is under way */
+void
+conn_mgmt_unregister_app_notif_cb(
+        conn_mgmt_conn_state_t *conn,
+        conn_mgmt_app_notif_fn_ptr cb);
+
+/* Returns false if cb was never registered */
+bool
+conn_mgmt_get_app_notif_stats(
+        conn_mgmt_app_notif_fn_ptr cb,
+        conn_mgmt_app_notif_stats_t *stats);
+
+void
+conn_mgmt_show_app_notif_stats(void);
+
 void
 conn_mgmt_configure_connection(char *conn_name,
 							   char *src_ip,
@@ -189,9 +376,20 @@ conn_mgmt_configure_connection(char *conn_name,
     						   uint16_t dst_port_no,
     						   char *mastership);
 
+/* Stops the connection and takes it out of the DB, it is freed a few
+ * tics later. Mirrors and xports running on the connection must be
+ * destroyed first */
 void
 conn_mgmt_ui_destory_connection(char *conn_name);
 
+/* Connection DB, indexed by conn name and by conn key. Lookups
+ * take the DB lock in read mode and may run concurrently */
+bool
+conn_mgmt_add_connection_to_db(conn_mgmt_conn_state_t *conn);
+
+void
+conn_mgmt_remove_connection_from_db(conn_mgmt_conn_state_t *conn);
+
 conn_mgmt_conn_state_t *
 conn_mgmt_lookup_connection_by_name(char *conn_name);
 
@@ -200,25 +398,6 @@ conn_mgmt_lookup_connection_by_key(conn_mgmt_conn_key_t *conn_key);
 
 void
 conn_mgmt_show_connections(char *conn_name);
-    						   
-/* KA pkt format  */
-
-#pragma pack (push,1)
-
-typedef struct ka_pkt_fmt_ {
-
-    unsigned char src_ip_addr[16];
-    uint32_t src_port_no;
-    unsigned char dst_ip_addr[16];
-    uint32_t dst_port_no;
-    uint8_t  mastership_state;
-    uint8_t conn_state;
-    unsigned char my_mac[8];
-    unsigned char peer_reported_my_mac[8];
-    uint16_t hold_time;
-} ka_pkt_fmt_t;
-
-#pragma pack(pop)
 
 #endif /* __CONN_MGMT__  */
 
@@ -0,0 +1,181 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  conn_mgmt_db_bench.c
+ *
+ *    Description: This file benchmarks the lookups in the connection DB by
+ *                 conn name and by conn key, against a linear list scan
+ *
+ *        Version:  1.0
+ *        Created:  10/17/2026 10:02:15 AM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  ABHISHEK SAGAR (), sachinites@gmail.com
+ *   Organization:  Juniper Networks
+ *
+ * =====================================================================================
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "conn_mgmt.h"
+
+#define BENCH_N_LOOKUPS	1000000
+#define BENCH_MAX_READERS	4
+
+static uint32_t conn_counts[] = {100, 1000, 10000, 100000};
+
+static conn_mgmt_conn_state_t **bench_conns;
+static uint32_t bench_n_conns;
+
+typedef struct bench_reader_ {
+
+	pthread_t thread;
+	bool by_key;
+	uint32_t seed;
+	uint32_t misses;
+} bench_reader_t;
+
+static double
+bench_now_sec() {
+
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void
+bench_fill_conn_key(conn_mgmt_conn_key_t *conn_key, uint32_t i) {
+
+	memset(conn_key, 0, sizeof(*conn_key));
+	snprintf(conn_key->src_ip, sizeof(conn_key->src_ip),
+		"10.%u.%u.%u", (i >> 16) & 0xff, (i >> 8) & 0xff, i & 0xff);
+	snprintf(conn_key->dest_ip, sizeof(conn_key->dest_ip),
+		"11.%u.%u.%u", (i >> 16) & 0xff, (i >> 8) & 0xff, i & 0xff);
+	conn_key->src_port_no = 4000;
+	conn_key->dst_port_no = 5000;
+}
+
+static void *
+bench_reader_fn(void *arg) {
+
+	uint32_t i, idx;
+	conn_mgmt_conn_key_t conn_key;
+	bench_reader_t *reader = (bench_reader_t *)arg;
+	conn_mgmt_conn_state_t *conn;
+
+	for (i = 0; i < BENCH_N_LOOKUPS; i++) {
+
+		idx = rand_r(&reader->seed) % bench_n_conns;
+
+		if (reader->by_key) {
+			conn_key = bench_conns[idx]->conn_key;
+			conn = conn_mgmt_lookup_connection_by_key(&conn_key);
+		}
+		else {
+			conn = conn_mgmt_lookup_connection_by_name(
+					bench_conns[idx]->conn_name);
+		}
+		if (conn != bench_conns[idx]) reader->misses++;
+	}
+	return NULL;
+}
+
+/* Mops/sec achieved by n_readers threads doing lookups concurrently */
+static double
+bench_lookups(uint32_t n_readers, bool by_key) {
+
+	uint32_t i;
+	double start;
+	bench_reader_t readers[BENCH_MAX_READERS];
+
+	start = bench_now_sec();
+
+	for (i = 0; i < n_readers; i++) {
+		readers[i].by_key = by_key;
+		readers[i].seed = i + 1;
+		readers[i].misses = 0;
+		pthread_create(&readers[i].thread, NULL,
+				bench_reader_fn, (void *)&readers[i]);
+	}
+
+	for (i = 0; i < n_readers; i++) {
+		pthread_join(readers[i].thread, NULL);
+		if (readers[i].misses)
+			printf("Error : %u lookups failed\n", readers[i].misses);
+	}
+
+	return (n_readers * (double)BENCH_N_LOOKUPS) /
+		   (bench_now_sec() - start) / 1e6;
+}
+
+/* What conn_mgmt_show_connections() used to do : a strncmp scan of
+ * the whole connection list */
+static double
+bench_linear_scan() {
+
+	uint32_t i, j, idx;
+	uint32_t seed = 1;
+	uint32_t n_lookups = 1000;
+	double start;
+
+	start = bench_now_sec();
+
+	for (i = 0; i < n_lookups; i++) {
+
+		idx = rand_r(&seed) % bench_n_conns;
+
+		for (j = 0; j < bench_n_conns; j++) {
+			if (strncmp(bench_conns[idx]->conn_name,
+						bench_conns[j]->conn_name,
+						sizeof(bench_conns[j]->conn_name)) == 0) {
+				break;
+			}
+		}
+	}
+	return n_lookups / (bench_now_sec() - start) / 1e6;
+}
+
+int
+main(int argc, char **argv) {
+
+	uint32_t i, n;
+	conn_mgmt_conn_key_t conn_key;
+
+	conn_mgmt_init();
+
+	printf("%8s %12s %12s %12s %12s %12s\n",
+		"conns", "linear Mops", "name 1T", "name 4T", "key 1T", "key 4T");
+
+	for (n = 0; n < sizeof(conn_counts)/sizeof(conn_counts[0]); n++) {
+
+		bench_conns = realloc(bench_conns,
+					conn_counts[n] * sizeof(conn_mgmt_conn_state_t *));
+
+		/* Connections are only added to the DB, never started */
+		for (i = bench_n_conns; i < conn_counts[n]; i++) {
+
+			bench_fill_conn_key(&conn_key, i);
+			bench_conns[i] = conn_mgmt_create_new_connection(
+								&conn_key, "master");
+			snprintf(bench_conns[i]->conn_name,
+				sizeof(bench_conns[i]->conn_name), "conn%u", i);
+			if (!conn_mgmt_add_connection_to_db(bench_conns[i])) {
+				printf("Error : conn%u could not be added\n", i);
+				return -1;
+			}
+		}
+		bench_n_conns = conn_counts[n];
+
+		printf("%8u %12.4f %12.2f %12.2f %12.2f %12.2f\n",
+			bench_n_conns,
+			bench_linear_scan(),
+			bench_lookups(1, false), bench_lookups(4, false),
+			bench_lookups(1, true), bench_lookups(4, true));
+	}
+	return 0;
+}
@@ -0,0 +1,128 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  conn_mgmt_detect_test.c
+ *
+ *    Description: This file measures the actual failure detection latency on
+ *                 loopback : the master stops sending KA msgs and the time
+ *                 until the backup reports the connection down is recorded
+ *
+ *        Version:  1.0
+ *        Created:  10/17/2026 01:40:22 PM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  ABHISHEK SAGAR (), sachinites@gmail.com
+ *   Organization:  Juniper Networks
+ *
+ * =====================================================================================
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "conn_mgmt.h"
+
+#define TEST_N_TRIALS	10
+#define TEST_TIMEOUT_MSEC	5000
+
+static uint64_t
+test_now_usec() {
+
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+/* Polls the connection state every 100 usec, returns the usecs
+ * it took to reach the state, or 0 on timeout */
+static uint64_t
+test_wait_for_state(conn_mgmt_conn_state_t *conn,
+					conn_mgmt_conn_status_t state) {
+
+	uint64_t start = test_now_usec();
+
+	while (conn->conn_status != state) {
+
+		if (test_now_usec() - start > TEST_TIMEOUT_MSEC * 1000ULL)
+			return 0;
+		usleep(100);
+	}
+	return test_now_usec() - start;
+}
+
+int
+main(int argc, char **argv) {
+
+	uint32_t i;
+	uint64_t latency, sum = 0, min = ~0ULL, max = 0;
+	uint32_t ka_interval = 20;
+	conn_mgmt_conn_state_t *master, *backup;
+
+	if (argc > 1)
+		ka_interval = atoi(argv[1]);
+
+	conn_mgmt_init();
+	conn_mgmt_set_io_mode(CONN_MGMT_IO_EVENT_LOOP, 1);
+
+	conn_mgmt_configure_connection("master", "127.0.0.1", 21000,
+		"127.0.0.1", 21001, "master");
+	conn_mgmt_configure_connection("backup", "127.0.0.1", 21001,
+		"127.0.0.1", 21000, "backup");
+
+	master = conn_mgmt_lookup_connection_by_name("master");
+	backup = conn_mgmt_lookup_connection_by_name("backup");
+	conn_mgmt_set_conn_ka_interval(master, ka_interval);
+	conn_mgmt_set_conn_ka_interval(backup, ka_interval);
+
+	printf("KA interval %u msec, hold time %u msec, timer tic %u msec\n",
+		backup->keep_alive_interval, backup->hold_time,
+		CONN_MGMT_TIMER_TIC_MSEC);
+
+	for (i = 0; i < TEST_N_TRIALS; i++) {
+
+		conn_mgmt_resume_sending_kas(master);
+
+		if (!test_wait_for_state(backup, COMM_MGMT_CONN_UP)) {
+			printf("FAIL : connection did not come up\n");
+			return -1;
+		}
+
+		/* Stay up for a few hold times before the peer goes silent */
+		usleep(backup->hold_time * 3 * 1000);
+
+		if (backup->conn_status != COMM_MGMT_CONN_UP) {
+			printf("FAIL : connection went down while KA msgs were flowing\n");
+			return -1;
+		}
+
+		conn_mgmt_pause_sending_kas(master);
+
+		latency = test_wait_for_state(backup, COMM_MGMT_CONN_DOWN);
+
+		if (!latency) {
+			printf("FAIL : peer silence was not detected\n");
+			return -1;
+		}
+
+		printf("trial %2u : detected in %6.2f msec\n", i, latency / 1000.0);
+		sum += latency;
+		if (latency < min) min = latency;
+		if (latency > max) max = latency;
+	}
+
+	printf("detection latency msec : min %.2f avg %.2f max %.2f\n",
+		min / 1000.0, sum / 1000.0 / TEST_N_TRIALS, max / 1000.0);
+
+	/* Never later than the hold time plus a tic of timer slack and a
+	 * tic for the reschedule to be processed */
+	if (max > (backup->hold_time + (2 * CONN_MGMT_TIMER_TIC_MSEC)) * 1000ULL) {
+		printf("FAIL : detection slower than the hold time\n");
+		return -1;
+	}
+	printf("PASS\n");
+	return 0;
+}
@@ -0,0 +1,175 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  conn_mgmt_hist.h
+ *
+ *    Description: This file defines a fixed size latency histogram. Buckets are
+ *                 powers of 2 split in 8 linear sub buckets, so any recorded
+ *                 value is off by at most 12.5% whatever its magnitude
+ *
+ *        Version:  1.0
+ *        Created:  10/17/2026 04:20:44 PM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  ABHISHEK SAGAR (), sachinites@gmail.com
+ *   Organization:  Juniper Networks
+ *
+ * =====================================================================================
+ */
+#ifndef __CONN_MGMT_HIST__
+#define __CONN_MGMT_HIST__
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#define CONN_MGMT_HIST_SUB_BITS		3
+#define CONN_MGMT_HIST_SUB_BUCKETS	(1 << CONN_MGMT_HIST_SUB_BITS)
+#define CONN_MGMT_HIST_N_BUCKETS	\
+    (CONN_MGMT_HIST_SUB_BUCKETS * (64 - CONN_MGMT_HIST_SUB_BITS + 1))
+
+typedef struct conn_mgmt_hist_ {
+
+    uint64_t count;
+    uint64_t sum;
+    uint64_t max;
+    uint64_t buckets[CONN_MGMT_HIST_N_BUCKETS];
+} conn_mgmt_hist_t;
+
+static inline uint32_t
+conn_mgmt_hist_bucket(uint64_t value) {
+
+    uint32_t msb;
+
+    if (value < CONN_MGMT_HIST_SUB_BUCKETS) return value;
+
+    msb = 63 - __builtin_clzll(value);
+    return ((msb - CONN_MGMT_HIST_SUB_BITS + 1) * CONN_MGMT_HIST_SUB_BUCKETS) +
+           ((value >> (msb - CONN_MGMT_HIST_SUB_BITS)) &
+            (CONN_MGMT_HIST_SUB_BUCKETS - 1));
+}
+
+/* Smallest value which falls into the bucket */
+static inline uint64_t
+conn_mgmt_hist_bucket_value(uint32_t bucket) {
+
+    uint32_t shift;
+
+    if (bucket < CONN_MGMT_HIST_SUB_BUCKETS) return bucket;
+
+    shift = (bucket / CONN_MGMT_HIST_SUB_BUCKETS) - 1;
+    return (uint64_t)(CONN_MGMT_HIST_SUB_BUCKETS +
+                      (bucket % CONN_MGMT_HIST_SUB_BUCKETS)) << shift;
+}
+
+/* May be called from several threads at once */
+static inline void
+conn_mgmt_hist_add(conn_mgmt_hist_t *hist, uint64_t value) {
+
+    uint64_t max = hist->max;
+
+    __sync_fetch_and_add(&hist->buckets[conn_mgmt_hist_bucket(value)], 1);
+    __sync_fetch_and_add(&hist->count, 1);
+    __sync_fetch_and_add(&hist->sum, value);
+
+    while (value > max) {
+        if (__sync_bool_compare_and_swap(&hist->max, max, value)) break;
+        max = hist->max;
+    }
+}
+
+/* hist -= base, to get what was recorded between two snapshots. max
+ * can not be subtracted, it is kept as is */
+static inline void
+conn_mgmt_hist_sub(conn_mgmt_hist_t *hist, const conn_mgmt_hist_t *base) {
+
+    uint32_t i;
+
+    hist->count -= base->count;
+    hist->sum -= base->sum;
+    for (i = 0; i < CONN_MGMT_HIST_N_BUCKETS; i++) {
+        hist->buckets[i] -= base->buckets[i];
+    }
+}
+
+/* hist += other, to sum up what several threads recorded */
+static inline void
+conn_mgmt_hist_merge(conn_mgmt_hist_t *hist, const conn_mgmt_hist_t *other) {
+
+    uint32_t i;
+
+    hist->count += other->count;
+    hist->sum += other->sum;
+    if (other->max > hist->max) hist->max = other->max;
+    for (i = 0; i < CONN_MGMT_HIST_N_BUCKETS; i++) {
+        hist->buckets[i] += other->buckets[i];
+    }
+}
+
+/* pct in [0, 100] */
+static inline uint64_t
+conn_mgmt_hist_percentile(const conn_mgmt_hist_t *hist, double pct) {
+
+    uint32_t i;
+    uint64_t seen = 0;
+    uint64_t rank = (uint64_t)((hist->count * pct) / 100);
+
+    if (!hist->count) return 0;
+    if (rank >= hist->count) rank = hist->count - 1;
+
+    for (i = 0; i < CONN_MGMT_HIST_N_BUCKETS; i++) {
+        seen += hist->buckets[i];
+        if (seen > rank) return conn_mgmt_hist_bucket_value(i);
+    }
+    return hist->max;
+}
+
+static inline double
+conn_mgmt_hist_mean(const conn_mgmt_hist_t *hist) {
+
+    return hist->count ? (double)hist->sum / hist->count : 0;
+}
+
+/* One line summary, values divided by div (e.g. 1000 to print usecs
+ * recorded in nsecs as usecs) */
+static inline void
+conn_mgmt_hist_print_summary(const conn_mgmt_hist_t *hist,
+                             const char *unit, double div) {
+
+    printf("n %lu  mean %.2f  p50 %.2f  p90 %.2f  p99 %.2f  "
+           "p99.9 %.2f  max %.2f %s\n",
+           hist->count, conn_mgmt_hist_mean(hist) / div,
+           conn_mgmt_hist_percentile(hist, 50) / div,
+           conn_mgmt_hist_percentile(hist, 90) / div,
+           conn_mgmt_hist_percentile(hist, 99) / div,
+           conn_mgmt_hist_percentile(hist, 99.9) / div,
+           hist->max / div, unit);
+}
+
+/* Non empty buckets, one per line, with a bar scaled to the fullest */
+static inline void
+conn_mgmt_hist_print(const conn_mgmt_hist_t *hist,
+                     const char *unit, double div) {
+
+    uint32_t i, j, bar;
+    uint64_t fullest = 0;
+
+    for (i = 0; i < CONN_MGMT_HIST_N_BUCKETS; i++) {
+        if (hist->buckets[i] > fullest) fullest = hist->buckets[i];
+    }
+    if (!fullest) return;
+
+    for (i = 0; i < CONN_MGMT_HIST_N_BUCKETS; i++) {
+
+        if (!hist->buckets[i]) continue;
+
+        printf("\t>= %12.2f %-5s %10lu ", conn_mgmt_hist_bucket_value(i) / div,
+               unit, hist->buckets[i]);
+        bar = (hist->buckets[i] * 40) / fullest;
+        for (j = 0; j < bar; j++) putchar('#');
+        putchar('\n');
+    }
+}
+
+#endif /* __CONN_MGMT_HIST__ */
@@ -0,0 +1,137 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  conn_mgmt_io_bench.c
+ *
+ *    Description: This file benchmarks the thread count and CPU usage of the
+ *                 connection mgmt I/O modes against the no of connections
+ *
+ *        Version:  1.0
+ *        Created:  10/17/2026 09:12:40 AM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  ABHISHEK SAGAR (), sachinites@gmail.com
+ *   Organization:  Juniper Networks
+ *
+ * =====================================================================================
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include "conn_mgmt.h"
+
+#define BENCH_BASE_PORT	20000
+
+static uint32_t conn_counts[] = {1, 10, 50, 100, 250, 500};
+
+static int
+bench_get_thread_count() {
+
+	FILE *fp;
+	char line[128];
+	int threads = -1;
+
+	fp = fopen("/proc/self/status", "r");
+	if (!fp) return -1;
+
+	while (fgets(line, sizeof(line), fp)) {
+		if (strncmp(line, "Threads:", strlen("Threads:")) == 0) {
+			threads = atoi(line + strlen("Threads:"));
+			break;
+		}
+	}
+	fclose(fp);
+	return threads;
+}
+
+static double
+bench_get_cpu_time_sec() {
+
+	struct rusage ru;
+
+	getrusage(RUSAGE_SELF, &ru);
+	return ru.ru_utime.tv_sec + ru.ru_stime.tv_sec +
+		   (ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) / 1e6;
+}
+
+/* Creates n_pairs master/backup connection pairs on loopback and
+ * measures the steady state cost of keeping them alive */
+static void
+bench_run(conn_mgmt_io_mode_t io_mode, uint32_t n_pairs,
+		  uint32_t duration) {
+
+	uint32_t i;
+	char name[32];
+	double cpu_start, cpu_end;
+
+	conn_mgmt_init();
+	conn_mgmt_set_io_mode(io_mode, 1);
+
+	for (i = 0; i < n_pairs; i++) {
+
+		snprintf(name, sizeof(name), "m%u", i);
+		conn_mgmt_configure_connection(name,
+			"127.0.0.1", BENCH_BASE_PORT + (2 * i),
+			"127.0.0.1", BENCH_BASE_PORT + (2 * i) + 1,
+			"master");
+
+		snprintf(name, sizeof(name), "b%u", i);
+		conn_mgmt_configure_connection(name,
+			"127.0.0.1", BENCH_BASE_PORT + (2 * i) + 1,
+			"127.0.0.1", BENCH_BASE_PORT + (2 * i),
+			"backup");
+	}
+
+	/* Let the connections come up before measuring */
+	sleep(2);
+
+	cpu_start = bench_get_cpu_time_sec();
+	sleep(duration);
+	cpu_end = bench_get_cpu_time_sec();
+
+	printf("%-10s %8u %8d %12.3f %16.2f\n",
+		io_mode == CONN_MGMT_IO_EVENT_LOOP ? "evloop" : "threads",
+		n_pairs * 2, bench_get_thread_count(),
+		(cpu_end - cpu_start) * 100 / duration,
+		(cpu_end - cpu_start) * 1e6 / duration / (n_pairs * 2));
+	fflush(stdout);
+}
+
+int
+main(int argc, char **argv) {
+
+	uint32_t i;
+	pid_t pid;
+	uint32_t duration = 5;
+	conn_mgmt_io_mode_t io_mode = CONN_MGMT_IO_EVENT_LOOP;
+
+	if (argc > 1 && strncmp(argv[1], "threads", strlen("threads")) == 0)
+		io_mode = CONN_MGMT_IO_THREAD_PER_CONN;
+
+	if (argc > 2)
+		duration = atoi(argv[2]);
+
+	printf("%-10s %8s %8s %12s %16s\n",
+		"mode", "conns", "threads", "cpu %", "cpu usec/conn/s");
+	fflush(stdout);
+
+	/* Every data point runs in its own process so that the
+	 * threads and sockets of the previous run do not leak in */
+	for (i = 0; i < sizeof(conn_counts)/sizeof(conn_counts[0]); i++) {
+
+		pid = fork();
+
+		if (pid == 0) {
+			bench_run(io_mode, conn_counts[i], duration);
+			exit(0);
+		}
+		waitpid(pid, NULL, 0);
+	}
+	return 0;
+}
@@ -0,0 +1,434 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  conn_mgmt_ka.c
+ *
+ *    Description: This file implements the encoding and decoding of KA msgs
+ *
+ *        Version:  1.0
+ *        Created:  10/17/2026 03:10:05 PM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  ABHISHEK SAGAR (), sachinites@gmail.com
+ *   Organization:  Juniper Networks
+ *
+ * =====================================================================================
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stddef.h>
+#include <pthread.h>
+#include <endian.h>
+#include <arpa/inet.h>
+#include "conn_mgmt_ka.h"
+
+#if defined(__x86_64__)
+#include <nmmintrin.h>
+#endif
+
+/* CRC32C (Castagnoli), reflected polynomial */
+#define CRC32C_POLY	0x82F63B78
+
+typedef uint32_t (*crc32c_fn_ptr)(uint32_t crc,
+                                  const unsigned char *buf,
+                                  uint32_t len);
+
+static uint32_t crc32c_table[256];
+static crc32c_fn_ptr crc32c_fn;
+static pthread_once_t crc32c_once = PTHREAD_ONCE_INIT;
+
+static uint32_t
+conn_mgmt_crc32c_sw(uint32_t crc, const unsigned char *buf,
+                    uint32_t len) {
+
+    while (len--) {
+        crc = crc32c_table[(crc ^ *buf++) & 0xff] ^ (crc >> 8);
+    }
+    return crc;
+}
+
+#if defined(__x86_64__)
+/* SSE 4.2 crc32 instruction, 8 bytes at a time */
+__attribute__((target("sse4.2")))
+static uint32_t
+conn_mgmt_crc32c_hw(uint32_t crc, const unsigned char *buf,
+                    uint32_t len) {
+
+    uint64_t word;
+    uint64_t crc64 = crc;
+
+    while (len >= sizeof(word)) {
+        memcpy(&word, buf, sizeof(word));
+        crc64 = _mm_crc32_u64(crc64, word);
+        buf += sizeof(word);
+        len -= sizeof(word);
+    }
+    crc = (uint32_t)crc64;
+    while (len--) {
+        crc = _mm_crc32_u8(crc, *buf++);
+    }
+    return crc;
+}
+#endif
+
+static void
+conn_mgmt_crc32c_init() {
+
+    uint32_t i, j, crc;
+
+    for (i = 0; i < 256; i++) {
+        crc = i;
+        for (j = 0; j < 8; j++) {
+            crc = (crc & 1) ? (crc >> 1) ^ CRC32C_POLY : crc >> 1;
+        }
+        crc32c_table[i] = crc;
+    }
+
+    crc32c_fn = conn_mgmt_crc32c_sw;
+#if defined(__x86_64__)
+    if (__builtin_cpu_supports("sse4.2")) {
+        crc32c_fn = conn_mgmt_crc32c_hw;
+    }
+#endif
+}
+
+uint32_t
+conn_mgmt_crc32c(uint32_t crc, const unsigned char *buf, uint32_t len) {
+
+    pthread_once(&crc32c_once, conn_mgmt_crc32c_init);
+    return ~crc32c_fn(~crc, buf, len);
+}
+
+static uint32_t
+conn_mgmt_ka_v2_crc(const ka_pkt_v2_fmt_t *ka_pkt_v2) {
+
+    return conn_mgmt_crc32c(0, (const unsigned char *)ka_pkt_v2,
+                            offsetof(ka_pkt_v2_fmt_t, crc));
+}
+
+/* Legacy KA msgs are the only ones of their size starting with a
+ * digit, unless the bytes check out as a v2 KA msg with piggyback */
+static uint8_t
+conn_mgmt_ka_pkt_version(const unsigned char *pkt, uint32_t pkt_size) {
+
+    if (pkt_size == sizeof(ka_pkt_legacy_fmt_t) &&
+        pkt[0] >= '0' && pkt[0] <= '9' &&
+        ((pkt[0] & 0x0f) != CONN_MGMT_KA_VERSION_2 ||
+         ntohl(((const ka_pkt_v2_fmt_t *)pkt)->crc) !=
+         conn_mgmt_ka_v2_crc((const ka_pkt_v2_fmt_t *)pkt))) {
+        return CONN_MGMT_KA_VERSION_LEGACY;
+    }
+    return pkt[0] & 0x0f;
+}
+
+static uint32_t
+conn_mgmt_ka_encode_legacy(const conn_mgmt_ka_info_t *ka_info,
+                           unsigned char *buf) {
+
+    uint32_t hold_time_sec;
+    ka_pkt_legacy_fmt_t *ka_pkt_fmt = (ka_pkt_legacy_fmt_t *)buf;
+
+    memset(ka_pkt_fmt, 0, sizeof(ka_pkt_legacy_fmt_t));
+    inet_ntop(AF_INET, &ka_info->src_ip_addr,
+              (char *)ka_pkt_fmt->src_ip_addr, sizeof(ka_pkt_fmt->src_ip_addr));
+    ka_pkt_fmt->src_port_no = ka_info->src_port_no;
+    inet_ntop(AF_INET, &ka_info->dst_ip_addr,
+              (char *)ka_pkt_fmt->dst_ip_addr, sizeof(ka_pkt_fmt->dst_ip_addr));
+    ka_pkt_fmt->dst_port_no = ka_info->dst_port_no;
+    ka_pkt_fmt->mastership_state = ka_info->mastership_state;
+    ka_pkt_fmt->conn_state = ka_info->conn_state;
+    memset(ka_pkt_fmt->my_mac, 0xff, sizeof(ka_pkt_fmt->my_mac));
+    memset(ka_pkt_fmt->peer_reported_my_mac, 0xff,
+           sizeof(ka_pkt_fmt->peer_reported_my_mac));
+    /* Whole secs, rounded up : 0 would have the peer time out at once */
+    hold_time_sec = (ka_info->hold_time + 999) / 1000;
+    ka_pkt_fmt->hold_time = hold_time_sec > UINT16_MAX ?
+                            UINT16_MAX : hold_time_sec;
+    return sizeof(ka_pkt_legacy_fmt_t);
+}
+
+static uint32_t
+conn_mgmt_ka_encode_v1(const conn_mgmt_ka_info_t *ka_info,
+                       unsigned char *buf) {
+
+    ka_pkt_fmt_t *ka_pkt_fmt = (ka_pkt_fmt_t *)buf;
+
+    memset(ka_pkt_fmt, 0, sizeof(ka_pkt_fmt_t));
+    ka_pkt_fmt->hdr.version = CONN_MGMT_KA_VERSION_1;
+    ka_pkt_fmt->hdr.flags = ka_info->flags;
+    ka_pkt_fmt->hdr.state_gen = ka_info->state_gen;
+    ka_pkt_fmt->hdr.seq_no = ka_info->seq_no;
+    inet_ntop(AF_INET, &ka_info->src_ip_addr,
+              (char *)ka_pkt_fmt->src_ip_addr, sizeof(ka_pkt_fmt->src_ip_addr));
+    ka_pkt_fmt->src_port_no = ka_info->src_port_no;
+    inet_ntop(AF_INET, &ka_info->dst_ip_addr,
+              (char *)ka_pkt_fmt->dst_ip_addr, sizeof(ka_pkt_fmt->dst_ip_addr));
+    ka_pkt_fmt->dst_port_no = ka_info->dst_port_no;
+    ka_pkt_fmt->mastership_state = ka_info->mastership_state;
+    ka_pkt_fmt->conn_state = ka_info->conn_state;
+    memset(ka_pkt_fmt->my_mac, 0xff, sizeof(ka_pkt_fmt->my_mac));
+    memset(ka_pkt_fmt->peer_reported_my_mac, 0xff,
+           sizeof(ka_pkt_fmt->peer_reported_my_mac));
+    ka_pkt_fmt->hold_time = ka_info->hold_time;
+    return sizeof(ka_pkt_fmt_t);
+}
+
+static uint32_t
+conn_mgmt_ka_encode_v2(const conn_mgmt_ka_info_t *ka_info,
+                       unsigned char *buf) {
+
+    ka_pkt_v2_fmt_t *ka_pkt_v2 = (ka_pkt_v2_fmt_t *)buf;
+
+    ka_pkt_v2->version_flags = (ka_info->flags << 4) |
+                               CONN_MGMT_KA_VERSION_2;
+    ka_pkt_v2->state = (ka_info->mastership_state << 4) |
+                       (ka_info->conn_state & 0x0f);
+    ka_pkt_v2->state_gen = htons(ka_info->state_gen);
+    ka_pkt_v2->seq_no = htonl(ka_info->seq_no);
+    ka_pkt_v2->src_ip_addr = ka_info->src_ip_addr;
+    ka_pkt_v2->dst_ip_addr = ka_info->dst_ip_addr;
+    ka_pkt_v2->src_port_no = htons(ka_info->src_port_no);
+    ka_pkt_v2->dst_port_no = htons(ka_info->dst_port_no);
+    ka_pkt_v2->hold_time = htonl(ka_info->hold_time);
+    ka_pkt_v2->send_time = htobe64(ka_info->send_time);
+    ka_pkt_v2->crc = htonl(conn_mgmt_ka_v2_crc(ka_pkt_v2));
+    return sizeof(ka_pkt_v2_fmt_t);
+}
+
+uint32_t
+conn_mgmt_ka_encode(const conn_mgmt_ka_info_t *ka_info,
+                    unsigned char *buf,
+                    uint32_t buf_size) {
+
+    switch(ka_info->version) {
+        case CONN_MGMT_KA_VERSION_LEGACY:
+            if (buf_size < sizeof(ka_pkt_legacy_fmt_t)) return 0;
+            return conn_mgmt_ka_encode_legacy(ka_info, buf);
+        case CONN_MGMT_KA_VERSION_1:
+            if (buf_size < sizeof(ka_pkt_fmt_t)) return 0;
+            return conn_mgmt_ka_encode_v1(ka_info, buf);
+        case CONN_MGMT_KA_VERSION_2:
+            if (buf_size < sizeof(ka_pkt_v2_fmt_t)) return 0;
+            return conn_mgmt_ka_encode_v2(ka_info, buf);
+        default: ;
+    }
+    return 0;
+}
+
+void
+conn_mgmt_ka_stamp(unsigned char *pkt,
+                   uint32_t pkt_size,
+                   uint32_t seq_no,
+                   uint64_t send_time) {
+
+    ka_pkt_v2_fmt_t *ka_pkt_v2;
+
+    switch(conn_mgmt_ka_pkt_version(pkt, pkt_size)) {
+        case CONN_MGMT_KA_VERSION_LEGACY:
+            return;
+        case CONN_MGMT_KA_VERSION_1:
+            ((ka_hdr_t *)pkt)->seq_no = seq_no;
+            return;
+        default: ;
+    }
+
+    ka_pkt_v2 = (ka_pkt_v2_fmt_t *)pkt;
+    ka_pkt_v2->seq_no = htonl(seq_no);
+    ka_pkt_v2->send_time = htobe64(send_time);
+    ka_pkt_v2->crc = htonl(conn_mgmt_ka_v2_crc(ka_pkt_v2));
+}
+
+uint32_t
+conn_mgmt_ka_set_piggyback(unsigned char *pkt,
+                           uint32_t pkt_size,
+                           const unsigned char *data,
+                           uint16_t len) {
+
+    uint16_t len_n;
+    uint32_t crc;
+    unsigned char *block = pkt + sizeof(ka_pkt_v2_fmt_t);
+
+    switch(conn_mgmt_ka_pkt_version(pkt, pkt_size)) {
+        case CONN_MGMT_KA_VERSION_LEGACY:
+        case CONN_MGMT_KA_VERSION_1:
+            return pkt_size;
+        default: ;
+    }
+
+    if (!len || len > CONN_MGMT_KA_PIGGYBACK_MAX_SIZE) {
+        pkt[0] &= ~(CONN_MGMT_KA_F_PIGGYBACK << 4);
+        return sizeof(ka_pkt_v2_fmt_t);
+    }
+
+    pkt[0] |= CONN_MGMT_KA_F_PIGGYBACK << 4;
+    len_n = htons(len);
+    memcpy(block, &len_n, sizeof(len_n));
+    memcpy(block + sizeof(len_n), data, len);
+    crc = htonl(conn_mgmt_crc32c(0, block, sizeof(len_n) + len));
+    memcpy(block + sizeof(len_n) + len, &crc, sizeof(crc));
+    return sizeof(ka_pkt_v2_fmt_t) + sizeof(len_n) + len + sizeof(crc);
+}
+
+bool
+conn_mgmt_ka_has_piggyback(const unsigned char *pkt,
+                           uint32_t pkt_size) {
+
+    return conn_mgmt_ka_pkt_version(pkt, pkt_size) ==
+               CONN_MGMT_KA_VERSION_2 &&
+           ((pkt[0] >> 4) & CONN_MGMT_KA_F_PIGGYBACK);
+}
+
+bool
+conn_mgmt_ka_get_piggyback(const unsigned char *pkt,
+                           uint32_t pkt_size,
+                           const unsigned char **data,
+                           uint16_t *len) {
+
+    uint16_t len_n;
+    uint32_t crc;
+    const unsigned char *block = pkt + sizeof(ka_pkt_v2_fmt_t);
+
+    if (!conn_mgmt_ka_has_piggyback(pkt, pkt_size) ||
+        pkt_size < sizeof(ka_pkt_v2_fmt_t) + sizeof(len_n)) {
+        return false;
+    }
+
+    memcpy(&len_n, block, sizeof(len_n));
+    *len = ntohs(len_n);
+
+    if (pkt_size < sizeof(ka_pkt_v2_fmt_t) + sizeof(len_n) + *len +
+                   sizeof(crc)) {
+        return false;
+    }
+
+    memcpy(&crc, block + sizeof(len_n) + *len, sizeof(crc));
+    if (ntohl(crc) != conn_mgmt_crc32c(0, block, sizeof(len_n) + *len)) {
+        return false;
+    }
+    *data = block + sizeof(len_n);
+    return true;
+}
+
+bool
+conn_mgmt_ka_decode_hdr(const unsigned char *pkt,
+                        uint32_t pkt_size,
+                        conn_mgmt_ka_info_t *ka_info) {
+
+    const ka_hdr_t *ka_hdr;
+    const ka_pkt_v2_fmt_t *ka_pkt_v2;
+    const ka_pkt_legacy_fmt_t *ka_pkt_legacy;
+
+    if (!pkt_size) return false;
+
+    switch(conn_mgmt_ka_pkt_version(pkt, pkt_size)) {
+
+        case CONN_MGMT_KA_VERSION_LEGACY:
+            /* Every legacy KA msg ran the state machine, the state gen
+             * changes with the peer's states at least */
+            ka_pkt_legacy = (const ka_pkt_legacy_fmt_t *)pkt;
+            ka_info->version = CONN_MGMT_KA_VERSION_LEGACY;
+            ka_info->flags = 0;
+            ka_info->state_gen = 1 + ((ka_pkt_legacy->mastership_state << 8) |
+                                      ka_pkt_legacy->conn_state);
+            ka_info->seq_no = 0;
+            return true;
+
+        case CONN_MGMT_KA_VERSION_1:
+            if (pkt_size < sizeof(ka_pkt_fmt_t)) return false;
+            ka_hdr = (const ka_hdr_t *)pkt;
+            ka_info->version = CONN_MGMT_KA_VERSION_1;
+            ka_info->flags = ka_hdr->flags;
+            ka_info->state_gen = ka_hdr->state_gen;
+            ka_info->seq_no = ka_hdr->seq_no;
+            return true;
+
+        case CONN_MGMT_KA_VERSION_2:
+            if (pkt_size < sizeof(ka_pkt_v2_fmt_t)) return false;
+            ka_pkt_v2 = (const ka_pkt_v2_fmt_t *)pkt;
+            if (ntohl(ka_pkt_v2->crc) != conn_mgmt_ka_v2_crc(ka_pkt_v2)) {
+                return false;
+            }
+            ka_info->version = CONN_MGMT_KA_VERSION_2;
+            ka_info->flags = ka_pkt_v2->version_flags >> 4;
+            ka_info->state_gen = ntohs(ka_pkt_v2->state_gen);
+            ka_info->seq_no = ntohl(ka_pkt_v2->seq_no);
+            return true;
+
+        default: ;
+    }
+    return false;
+}
+
+static bool
+conn_mgmt_ka_decode_v1_ip(const unsigned char *ip_str,
+                          uint32_t *ip_addr) {
+
+    char ip[17];
+
+    memcpy(ip, ip_str, 16);
+    ip[16] = '\0';
+    return inet_pton(AF_INET, ip, ip_addr) == 1;
+}
+
+bool
+conn_mgmt_ka_decode(const unsigned char *pkt,
+                    uint32_t pkt_size,
+                    conn_mgmt_ka_info_t *ka_info) {
+
+    const ka_pkt_fmt_t *ka_pkt_fmt;
+    const ka_pkt_v2_fmt_t *ka_pkt_v2;
+    const ka_pkt_legacy_fmt_t *ka_pkt_legacy;
+
+    if (!conn_mgmt_ka_decode_hdr(pkt, pkt_size, ka_info)) {
+        return false;
+    }
+
+    if (ka_info->version == CONN_MGMT_KA_VERSION_LEGACY) {
+
+        ka_pkt_legacy = (const ka_pkt_legacy_fmt_t *)pkt;
+        if (!conn_mgmt_ka_decode_v1_ip(ka_pkt_legacy->src_ip_addr,
+                                       &ka_info->src_ip_addr) ||
+            !conn_mgmt_ka_decode_v1_ip(ka_pkt_legacy->dst_ip_addr,
+                                       &ka_info->dst_ip_addr)) {
+            return false;
+        }
+        ka_info->src_port_no = ka_pkt_legacy->src_port_no;
+        ka_info->dst_port_no = ka_pkt_legacy->dst_port_no;
+        ka_info->mastership_state = ka_pkt_legacy->mastership_state;
+        ka_info->conn_state = ka_pkt_legacy->conn_state;
+        ka_info->hold_time = ka_pkt_legacy->hold_time * 1000;
+        ka_info->send_time = 0;
+        return true;
+    }
+
+    if (ka_info->version == CONN_MGMT_KA_VERSION_1) {
+
+        ka_pkt_fmt = (const ka_pkt_fmt_t *)pkt;
+        if (!conn_mgmt_ka_decode_v1_ip(ka_pkt_fmt->src_ip_addr,
+                                       &ka_info->src_ip_addr) ||
+            !conn_mgmt_ka_decode_v1_ip(ka_pkt_fmt->dst_ip_addr,
+                                       &ka_info->dst_ip_addr)) {
+            return false;
+        }
+        ka_info->src_port_no = ka_pkt_fmt->src_port_no;
+        ka_info->dst_port_no = ka_pkt_fmt->dst_port_no;
+        ka_info->mastership_state = ka_pkt_fmt->mastership_state;
+        ka_info->conn_state = ka_pkt_fmt->conn_state;
+        ka_info->hold_time = ka_pkt_fmt->hold_time;
+        ka_info->send_time = 0;
+        return true;
+    }
+
+    ka_pkt_v2 = (const ka_pkt_v2_fmt_t *)pkt;
+    ka_info->src_ip_addr = ka_pkt_v2->src_ip_addr;
+    ka_info->dst_ip_addr = ka_pkt_v2->dst_ip_addr;
+    ka_info->src_port_no = ntohs(ka_pkt_v2->src_port_no);
+    ka_info->dst_port_no = ntohs(ka_pkt_v2->dst_port_no);
+    ka_info->mastership_state = ka_pkt_v2->state >> 4;
+    ka_info->conn_state = ka_pkt_v2->state & 0x0f;
+    ka_info->hold_time = ntohl(ka_pkt_v2->hold_time);
+    ka_info->send_time = be64toh(ka_pkt_v2->send_time);
+    return true;
+}
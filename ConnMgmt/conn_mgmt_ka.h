@@ -0,0 +1,175 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  conn_mgmt_ka.h
+ *
+ *    Description: This file defines the KA msg wire formats and the routines to
+ *                 encode and decode them
+ *
+ *        Version:  1.0
+ *        Created:  10/17/2026 03:10:05 PM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  ABHISHEK SAGAR (), sachinites@gmail.com
+ *   Organization:  Juniper Networks
+ *
+ * =====================================================================================
+ */
+#ifndef __CONN_MGMT_KA__
+#define __CONN_MGMT_KA__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Peers which predate the v1 hdr, their KA msgs carry no version and
+ * are told apart by their size. They get legacy KA msgs back */
+#define CONN_MGMT_KA_VERSION_LEGACY	0
+#define CONN_MGMT_KA_VERSION_1	1
+#define CONN_MGMT_KA_VERSION_2	2
+
+/* v1 hdr flags */
+/* Sender understands v2, its peer may switch to v2 */
+#define CONN_MGMT_KA_F_V2_CAPABLE	(1 << 0)
+/* v2 only : the KA msg is followed by a piggyback block of app data,
+ * a 2 byte length, the data, and the CRC32C of both */
+#define CONN_MGMT_KA_F_PIGGYBACK	(1 << 1)
+#define CONN_MGMT_KA_PIGGYBACK_MAX_SIZE	128
+
+#pragma pack (push,1)
+
+/* Legacy KA pkt format, host byte order. Starts with the src IP as a
+ * string, and has no seq no nor state gen */
+typedef struct ka_pkt_legacy_fmt_ {
+
+    unsigned char src_ip_addr[16];
+    uint32_t src_port_no;
+    unsigned char dst_ip_addr[16];
+    uint32_t dst_port_no;
+    uint8_t  mastership_state;
+    uint8_t conn_state;
+    unsigned char my_mac[8];
+    unsigned char peer_reported_my_mac[8];
+    uint16_t hold_time;     /* sec */
+} ka_pkt_legacy_fmt_t;
+
+/* Leads every v1 KA msg. A receiver runs the connection state machine
+ * only when state_gen differs from the one last seen, KA msgs with an
+ * unchanged state_gen just refresh the liveness of the connection */
+typedef struct ka_hdr_ {
+
+    uint8_t version;
+    uint8_t flags;
+    uint16_t state_gen;
+    uint32_t seq_no;
+} ka_hdr_t;
+
+/* v1 KA pkt format, host byte order */
+typedef struct ka_pkt_fmt_ {
+
+    ka_hdr_t hdr;
+    unsigned char src_ip_addr[16];
+    uint32_t src_port_no;
+    unsigned char dst_ip_addr[16];
+    uint32_t dst_port_no;
+    uint8_t  mastership_state;
+    uint8_t conn_state;
+    unsigned char my_mac[8];
+    unsigned char peer_reported_my_mac[8];
+    uint32_t hold_time;     /* msec */
+} ka_pkt_fmt_t;
+
+/* v2 KA pkt format, network byte order. The low nibble of the first
+ * byte is the version in both formats */
+typedef struct ka_pkt_v2_fmt_ {
+
+    uint8_t version_flags;  /* flags << 4 | version */
+    uint8_t state;          /* mastership state << 4 | conn state */
+    uint16_t state_gen;
+    uint32_t seq_no;
+    uint32_t src_ip_addr;
+    uint32_t dst_ip_addr;
+    uint16_t src_port_no;
+    uint16_t dst_port_no;
+    uint32_t hold_time;     /* msec */
+    uint64_t send_time;     /* usec since the epoch */
+    uint32_t crc;           /* CRC32C of all the bytes above */
+} ka_pkt_v2_fmt_t;
+
+#pragma pack(pop)
+
+/* KA msg of either version, decoded. Addresses are in network byte
+ * order, everything else in host byte order */
+typedef struct conn_mgmt_ka_info_ {
+
+    uint8_t version;
+    uint8_t flags;
+    uint16_t state_gen;
+    uint32_t seq_no;
+    uint32_t src_ip_addr;
+    uint32_t dst_ip_addr;
+    uint16_t src_port_no;
+    uint16_t dst_port_no;
+    uint8_t mastership_state;
+    uint8_t conn_state;
+    uint32_t hold_time;
+    uint64_t send_time;     /* 0 in v1 */
+} conn_mgmt_ka_info_t;
+
+uint32_t
+conn_mgmt_crc32c(uint32_t crc, const unsigned char *buf, uint32_t len);
+
+/* Encodes ka_info in the format of ka_info->version, returns the size
+ * of the KA msg or 0 if buf is too small */
+uint32_t
+conn_mgmt_ka_encode(const conn_mgmt_ka_info_t *ka_info,
+                    unsigned char *buf,
+                    uint32_t buf_size);
+
+/* Patches the seq no and the send time of an encoded KA msg in place,
+ * cheaper than encoding the KA msg again before every send. Legacy KA
+ * msgs have neither */
+void
+conn_mgmt_ka_stamp(unsigned char *pkt,
+                   uint32_t pkt_size,
+                   uint32_t seq_no,
+                   uint64_t send_time);
+
+/* Attaches data (len 0 : none) to an encoded v2 KA msg as its
+ * piggyback block, must be followed by conn_mgmt_ka_stamp() which
+ * checksums the flags. Returns the new size of the KA msg, v1 and
+ * legacy KA msgs are left as they are */
+uint32_t
+conn_mgmt_ka_set_piggyback(unsigned char *pkt,
+                           uint32_t pkt_size,
+                           const unsigned char *data,
+                           uint16_t len);
+
+/* True if pkt is a v2 KA msg flagged as carrying a piggyback block.
+ * Other versions have no flags in their first byte */
+bool
+conn_mgmt_ka_has_piggyback(const unsigned char *pkt,
+                           uint32_t pkt_size);
+
+/* Points data to the piggyback block of a KA msg whose hdr was
+ * decoded, returns false if there is none or it is corrupted */
+bool
+conn_mgmt_ka_get_piggyback(const unsigned char *pkt,
+                           uint32_t pkt_size,
+                           const unsigned char **data,
+                           uint16_t *len);
+
+/* Decodes only the version, flags, state gen and seq no, and verifies
+ * the checksum. Enough to tell whether the peer's state changed. A
+ * legacy KA msg gets a state gen made of its states, and seq no 0 */
+bool
+conn_mgmt_ka_decode_hdr(const unsigned char *pkt,
+                        uint32_t pkt_size,
+                        conn_mgmt_ka_info_t *ka_info);
+
+bool
+conn_mgmt_ka_decode(const unsigned char *pkt,
+                    uint32_t pkt_size,
+                    conn_mgmt_ka_info_t *ka_info);
+
+#endif /* __CONN_MGMT_KA__ */
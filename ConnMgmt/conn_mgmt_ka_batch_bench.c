@@ -0,0 +1,144 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  conn_mgmt_ka_batch_bench.c
+ *
+ *    Description: This file benchmarks the syscalls spent per KA msg and the
+ *                 KA msgs per second on loopback, for the event loop and the
+ *                 batched I/O modes of connection mgmt
+ *
+ *        Version:  1.0
+ *        Created:  10/17/2026 11:20:31 AM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  ABHISHEK SAGAR (), sachinites@gmail.com
+ *   Organization:  Juniper Networks
+ *
+ * =====================================================================================
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include "conn_mgmt.h"
+
+#define BENCH_MASTER_PORT	30000
+#define BENCH_BACKUP_PORT	30001
+#define BENCH_BASE_PORT		32000
+
+static uint32_t conn_counts[] = {100, 1000, 5000, 10000};
+
+/* In batched mode all masters share one src port and all backups
+ * share another, the connections differ by the backup side ip
+ * 127.1.x.y. In event loop mode every connection needs its own port */
+static void
+bench_configure_pair(conn_mgmt_io_mode_t io_mode, uint32_t i) {
+
+	char name[32];
+	char backup_ip[16];
+	uint16_t master_port, backup_port;
+
+	snprintf(backup_ip, sizeof(backup_ip), "127.1.%u.%u",
+		(i >> 8) & 0xff, i & 0xff);
+
+	if (io_mode == CONN_MGMT_IO_BATCHED) {
+		master_port = BENCH_MASTER_PORT;
+		backup_port = BENCH_BACKUP_PORT;
+	}
+	else {
+		master_port = BENCH_BASE_PORT + (2 * i);
+		backup_port = BENCH_BASE_PORT + (2 * i) + 1;
+	}
+
+	snprintf(name, sizeof(name), "m%u", i);
+	conn_mgmt_configure_connection(name,
+		"127.0.0.1", master_port, backup_ip, backup_port, "master");
+
+	snprintf(name, sizeof(name), "b%u", i);
+	conn_mgmt_configure_connection(name,
+		backup_ip, backup_port, "127.0.0.1", master_port, "backup");
+}
+
+static void
+bench_run(conn_mgmt_io_mode_t io_mode, uint32_t n_pairs,
+		  uint32_t duration) {
+
+	uint32_t i;
+	double tx_pkts, rx_pkts;
+	conn_mgmt_io_stats_t start, end;
+
+	conn_mgmt_init();
+	conn_mgmt_set_io_mode(io_mode, 1);
+
+	for (i = 0; i < n_pairs; i++) {
+		bench_configure_pair(io_mode, i);
+	}
+
+	/* Let the connections come up before measuring */
+	sleep(3);
+
+	conn_mgmt_get_io_stats(&start);
+	sleep(duration);
+	conn_mgmt_get_io_stats(&end);
+
+	tx_pkts = end.ka_tx_pkts - start.ka_tx_pkts;
+	rx_pkts = end.ka_rx_pkts - start.ka_rx_pkts;
+
+	printf("%-8s %8u %12.0f %12.0f %14.4f %14.4f %10lu\n",
+		io_mode == CONN_MGMT_IO_BATCHED ? "batched" : "evloop",
+		n_pairs * 2,
+		tx_pkts / duration, rx_pkts / duration,
+		tx_pkts ? (end.ka_tx_syscalls - start.ka_tx_syscalls) / tx_pkts : 0,
+		rx_pkts ? (end.ka_rx_syscalls - start.ka_rx_syscalls) / rx_pkts : 0,
+		end.ka_rx_unknown - start.ka_rx_unknown);
+	fflush(stdout);
+}
+
+int
+main(int argc, char **argv) {
+
+	uint32_t i;
+	pid_t pid;
+	struct rlimit rlim;
+	uint32_t duration = 6;
+	conn_mgmt_io_mode_t io_mode = CONN_MGMT_IO_BATCHED;
+
+	if (argc > 1 && strncmp(argv[1], "evloop", strlen("evloop")) == 0)
+		io_mode = CONN_MGMT_IO_EVENT_LOOP;
+
+	if (argc > 2)
+		duration = atoi(argv[2]);
+
+	/* Event loop mode needs one fd per connection */
+	getrlimit(RLIMIT_NOFILE, &rlim);
+	rlim.rlim_cur = rlim.rlim_max;
+	setrlimit(RLIMIT_NOFILE, &rlim);
+
+	printf("%-8s %8s %12s %12s %14s %14s %10s\n",
+		"mode", "conns", "tx KA/s", "rx KA/s",
+		"tx sysc/KA", "rx sysc/KA", "unknown");
+	fflush(stdout);
+
+	for (i = 0; i < sizeof(conn_counts)/sizeof(conn_counts[0]); i++) {
+
+		if (io_mode == CONN_MGMT_IO_EVENT_LOOP &&
+			(conn_counts[i] * 2) + 64 > rlim.rlim_cur) {
+			printf("%-8s %8u skipped, fd limit %lu\n", "evloop",
+				conn_counts[i] * 2, rlim.rlim_cur);
+			continue;
+		}
+
+		pid = fork();
+
+		if (pid == 0) {
+			bench_run(io_mode, conn_counts[i], duration);
+			exit(0);
+		}
+		waitpid(pid, NULL, 0);
+	}
+	return 0;
+}
@@ -0,0 +1,159 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  conn_mgmt_ka_send_bench.c
+ *
+ *    Description: This file measures the per KA msg send latency when the peer
+ *                 address is resolved on every KA msg (old behavior), when it is
+ *                 cached in the connection, and when the UDP socket is connected
+ *
+ *        Version:  1.0
+ *        Created:  10/17/2026 12:05:48 PM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  ABHISHEK SAGAR (), sachinites@gmail.com
+ *   Organization:  Juniper Networks
+ *
+ * =====================================================================================
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include "conn_mgmt.h"
+
+#define BENCH_N_SENDS		200000
+#define BENCH_SINK_PORT		40000
+
+typedef enum {
+
+	BENCH_SEND_RESOLVE_EVERY_KA,
+	BENCH_SEND_CACHED_ADDR,
+	BENCH_SEND_CONNECTED
+} bench_send_method_t;
+
+static uint64_t samples[BENCH_N_SENDS];
+
+static inline uint64_t
+bench_now_nsec() {
+
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static int
+bench_cmp_u64(const void *a, const void *b) {
+
+	uint64_t x = *(const uint64_t *)a;
+	uint64_t y = *(const uint64_t *)b;
+
+	return x < y ? -1 : x > y ? 1 : 0;
+}
+
+/* What send_udp_msg() did for every KA msg before the peer address
+ * was cached in the connection */
+static int
+bench_send_resolve_every_ka(int sock_fd, char *dest_ip_addr,
+							uint32_t dest_port_no,
+							unsigned char *msg, uint32_t msg_size) {
+
+	struct sockaddr_in dest;
+
+	dest.sin_family = AF_INET;
+	dest.sin_port = dest_port_no;
+	struct hostent *host = (struct hostent *)gethostbyname(dest_ip_addr);
+	dest.sin_addr = *((struct in_addr *)host->h_addr);
+
+	return sendto(sock_fd, msg, msg_size, 0,
+				  (struct sockaddr *)&dest, sizeof(struct sockaddr));
+}
+
+static void
+bench_run(bench_send_method_t method, char *dest_ip) {
+
+	uint32_t i;
+	uint64_t start, sum = 0;
+	int sock_fd;
+	struct sockaddr_in peer_addr;
+	unsigned char ka_msg[sizeof(ka_pkt_fmt_t)];
+	char *method_str[] = {"resolve every KA", "cached sockaddr",
+						  "connected socket"};
+
+	memset(ka_msg, 0, sizeof(ka_msg));
+	sock_fd = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+
+	/* Resolved once, the way conn_mgmt_start_connection() does */
+	memset(&peer_addr, 0, sizeof(peer_addr));
+	peer_addr.sin_family = AF_INET;
+	peer_addr.sin_port = BENCH_SINK_PORT;
+	inet_pton(AF_INET, dest_ip, &peer_addr.sin_addr);
+
+	if (method == BENCH_SEND_CONNECTED) {
+		connect(sock_fd, (struct sockaddr *)&peer_addr, sizeof(peer_addr));
+	}
+
+	for (i = 0; i < BENCH_N_SENDS; i++) {
+
+		start = bench_now_nsec();
+
+		switch(method) {
+			case BENCH_SEND_RESOLVE_EVERY_KA:
+				bench_send_resolve_every_ka(sock_fd, dest_ip,
+					BENCH_SINK_PORT, ka_msg, sizeof(ka_msg));
+				break;
+			case BENCH_SEND_CACHED_ADDR:
+				sendto(sock_fd, ka_msg, sizeof(ka_msg), 0,
+					   (struct sockaddr *)&peer_addr, sizeof(peer_addr));
+				break;
+			case BENCH_SEND_CONNECTED:
+				send(sock_fd, ka_msg, sizeof(ka_msg), 0);
+				break;
+		}
+		samples[i] = bench_now_nsec() - start;
+		sum += samples[i];
+	}
+
+	close(sock_fd);
+	qsort(samples, BENCH_N_SENDS, sizeof(samples[0]), bench_cmp_u64);
+
+	printf("%-18s %10.0f %10lu %10lu %10lu\n", method_str[method],
+		(double)sum / BENCH_N_SENDS,
+		samples[BENCH_N_SENDS / 2],
+		samples[(BENCH_N_SENDS * 99) / 100],
+		samples[(BENCH_N_SENDS * 999) / 1000]);
+}
+
+int
+main(int argc, char **argv) {
+
+	int sink_fd;
+	struct sockaddr_in sink_addr;
+	char *dest_ip = argc > 1 ? argv[1] : "127.0.0.1";
+
+	/* Sink which never reads, the kernel drops msgs once it is full */
+	sink_fd = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+	sink_addr.sin_family = AF_INET;
+	sink_addr.sin_port = BENCH_SINK_PORT;
+	sink_addr.sin_addr.s_addr = INADDR_ANY;
+	if (bind(sink_fd, (struct sockaddr *)&sink_addr, sizeof(sink_addr)) < 0) {
+		printf("Error : sink socket bind failed\n");
+		return -1;
+	}
+
+	printf("%-18s %10s %10s %10s %10s\n",
+		"send method", "mean ns", "p50 ns", "p99 ns", "p99.9 ns");
+
+	bench_run(BENCH_SEND_RESOLVE_EVERY_KA, dest_ip);
+	bench_run(BENCH_SEND_CACHED_ADDR, dest_ip);
+	bench_run(BENCH_SEND_CONNECTED, dest_ip);
+	return 0;
+}
@@ -0,0 +1,355 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  conn_mgmt_notif.c
+ *
+ *    Description: This file implements the per client notification queues and
+ *                 the dispatcher threads which invoke the app notification callbacks
+ *
+ *        Version:  1.0
+ *        Created:  10/17/2026 07:30:12 PM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  ABHISHEK SAGAR (), sachinites@gmail.com
+ *   Organization:  Juniper Networks
+ *
+ * =====================================================================================
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include "conn_mgmt.h"
+
+typedef struct conn_mgmt_notif_client_ {
+
+    conn_mgmt_app_notif_fn_ptr cb;
+    /* MPSC queue : producers push on head, the dispatcher takes the
+     * whole list at once and delivers it oldest first */
+    conn_mgmt_notif_node_t *head;
+    /* Dispatcher sleeps here while the queue is empty */
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    pthread_t dispatcher;
+    /* Odd while the dispatcher delivers a batch */
+    uint64_t n_passes;
+    conn_mgmt_app_notif_stats_t stats;
+} conn_mgmt_notif_client_t;
+
+static conn_mgmt_notif_client_t
+    conn_mgmt_notif_clients[CONN_MGMT_MAX_CLIENTS_SUPPORTED];
+static uint32_t conn_mgmt_notif_n_clients = 0;
+/* Serializes registrations */
+static pthread_mutex_t conn_mgmt_notif_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static uint64_t
+conn_mgmt_notif_get_time_usec() {
+
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (ts.tv_sec * 1000000ULL) + (ts.tv_nsec / 1000);
+}
+
+static void
+conn_mgmt_notif_deliver(conn_mgmt_notif_client_t *client,
+                        conn_mgmt_notif_node_t *node) {
+
+    uint32_t gen;
+    uint64_t state;
+    uint8_t conn_status;
+    uint64_t enqueue_time = node->enqueue_time;
+
+    /* From here on, a state change queues the node again */
+    __atomic_store_n(&node->pending, 0, __ATOMIC_SEQ_CST);
+    __atomic_sub_fetch(&client->stats.queue_depth, 1, __ATOMIC_RELAXED);
+
+    state = __atomic_load_n(&node->state, __ATOMIC_ACQUIRE);
+    gen = state >> 32;
+    conn_status = state & 0xff;
+
+    /* Already delivered with the node's previous trip in the queue */
+    if (gen == node->delivered_gen) return;
+
+    /* Unregistered while queued */
+    if (__atomic_load_n(&node->conn->app_notif_cb[
+            client - conn_mgmt_notif_clients], __ATOMIC_ACQUIRE) !=
+        client->cb) {
+        return;
+    }
+    node->delivered_gen = gen;
+
+    conn_mgmt_hist_add(&client->stats.delivery_latency,
+        conn_mgmt_notif_get_time_usec() - enqueue_time);
+
+    client->cb(conn_status, &node->conn->conn_key, NULL, 0);
+    client->stats.delivered++;
+}
+
+static void *
+conn_mgmt_notif_dispatcher_fn(void *arg) {
+
+    conn_mgmt_notif_client_t *client = (conn_mgmt_notif_client_t *)arg;
+    conn_mgmt_notif_node_t *batch, *node, *next, *fifo;
+
+    while (1) {
+
+        pthread_mutex_lock(&client->mutex);
+        while (!__atomic_load_n(&client->head, __ATOMIC_ACQUIRE)) {
+            pthread_cond_wait(&client->cond, &client->mutex);
+        }
+        pthread_mutex_unlock(&client->mutex);
+
+        __atomic_add_fetch(&client->n_passes, 1, __ATOMIC_SEQ_CST);
+        batch = __atomic_exchange_n(&client->head, NULL, __ATOMIC_ACQUIRE);
+        client->stats.batches++;
+
+        /* Pushed newest first */
+        fifo = NULL;
+        for (node = batch; node; node = next) {
+            next = node->next;
+            node->next = fifo;
+            fifo = node;
+        }
+
+        /* deliver() releases the node, which may then be pushed again
+         * and get a new next : read it first */
+        for (node = fifo; node; node = next) {
+            next = node->next;
+            conn_mgmt_notif_deliver(client, node);
+        }
+        __atomic_add_fetch(&client->n_passes, 1, __ATOMIC_SEQ_CST);
+    }
+    return NULL;
+}
+
+static void
+conn_mgmt_notif_push(conn_mgmt_notif_client_t *client,
+                     conn_mgmt_notif_node_t *node) {
+
+    uint32_t depth, max;
+    conn_mgmt_notif_node_t *old_head =
+        __atomic_load_n(&client->head, __ATOMIC_RELAXED);
+
+    node->enqueue_time = conn_mgmt_notif_get_time_usec();
+
+    do {
+        node->next = old_head;
+    } while (!__atomic_compare_exchange_n(&client->head, &old_head, node,
+                 true, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+
+    depth = __atomic_add_fetch(&client->stats.queue_depth, 1,
+                               __ATOMIC_RELAXED);
+    max = client->stats.max_queue_depth;
+    while (depth > max) {
+        if (__sync_bool_compare_and_swap(&client->stats.max_queue_depth,
+                                         max, depth)) break;
+        max = client->stats.max_queue_depth;
+    }
+
+    /* Queue was empty, the dispatcher may be asleep */
+    if (!old_head) {
+        pthread_mutex_lock(&client->mutex);
+        pthread_cond_signal(&client->cond);
+        pthread_mutex_unlock(&client->mutex);
+    }
+}
+
+void
+conn_mgmt_notif_enqueue(conn_mgmt_conn_state_t *conn) {
+
+    uint32_t i;
+    uint64_t state, new_state;
+    conn_mgmt_notif_node_t *node;
+    conn_mgmt_notif_client_t *client;
+
+    for (i = 0; i < CONN_MGMT_MAX_CLIENTS_SUPPORTED; i++) {
+
+        if (!__atomic_load_n(&conn->app_notif_cb[i], __ATOMIC_ACQUIRE)) {
+            continue;
+        }
+
+        client = &conn_mgmt_notif_clients[i];
+        node = &conn->notif_node[i];
+
+        /* conn_status is read once the current state is loaded : a
+         * newer state change, which set conn_status before getting
+         * here, makes the CAS of an older one fail and retry with it */
+        state = __atomic_load_n(&node->state, __ATOMIC_ACQUIRE);
+        do {
+            new_state = (((state >> 32) + 1) << 32) |
+                __atomic_load_n(&conn->conn_status, __ATOMIC_RELAXED);
+        } while (!__atomic_compare_exchange_n(&node->state, &state,
+                     new_state, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE));
+        __atomic_add_fetch(&client->stats.enqueued, 1, __ATOMIC_RELAXED);
+
+        /* Already queued, the dispatcher will pick up the new state */
+        if (__atomic_exchange_n(&node->pending, 1, __ATOMIC_ACQ_REL)) {
+            __atomic_add_fetch(&client->stats.coalesced, 1, __ATOMIC_RELAXED);
+            continue;
+        }
+        conn_mgmt_notif_push(client, node);
+    }
+}
+
+bool
+conn_mgmt_notif_conn_queued(conn_mgmt_conn_state_t *conn) {
+
+    uint32_t i;
+
+    for (i = 0; i < CONN_MGMT_MAX_CLIENTS_SUPPORTED; i++) {
+        if (__atomic_load_n(&conn->notif_node[i].pending, __ATOMIC_SEQ_CST)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void
+conn_mgmt_notif_snapshot_passes(uint64_t *passes) {
+
+    uint32_t i;
+
+    for (i = 0; i < CONN_MGMT_MAX_CLIENTS_SUPPORTED; i++) {
+        passes[i] = __atomic_load_n(&conn_mgmt_notif_clients[i].n_passes,
+                                    __ATOMIC_SEQ_CST);
+    }
+}
+
+/* Idle at snapshot time, or moved on since */
+bool
+conn_mgmt_notif_passes_done(const uint64_t *passes) {
+
+    uint32_t i;
+
+    for (i = 0; i < CONN_MGMT_MAX_CLIENTS_SUPPORTED; i++) {
+        if ((passes[i] & 1) &&
+            __atomic_load_n(&conn_mgmt_notif_clients[i].n_passes,
+                            __ATOMIC_SEQ_CST) == passes[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static conn_mgmt_notif_client_t *
+conn_mgmt_notif_lookup_client(conn_mgmt_app_notif_fn_ptr cb) {
+
+    uint32_t i;
+
+    for (i = 0; i < conn_mgmt_notif_n_clients; i++) {
+        if (conn_mgmt_notif_clients[i].cb == cb) {
+            return &conn_mgmt_notif_clients[i];
+        }
+    }
+    return NULL;
+}
+
+bool
+conn_mgmt_register_app_notif_cb(conn_mgmt_conn_state_t *conn,
+                                conn_mgmt_app_notif_fn_ptr cb) {
+
+    uint32_t client_index;
+    conn_mgmt_notif_client_t *client;
+
+    pthread_mutex_lock(&conn_mgmt_notif_mutex);
+
+    client = conn_mgmt_notif_lookup_client(cb);
+
+    if (!client) {
+
+        if (conn_mgmt_notif_n_clients == CONN_MGMT_MAX_CLIENTS_SUPPORTED) {
+            pthread_mutex_unlock(&conn_mgmt_notif_mutex);
+            printf("Error : no more than %u app notif clients supported\n",
+                   CONN_MGMT_MAX_CLIENTS_SUPPORTED);
+            return false;
+        }
+
+        client = &conn_mgmt_notif_clients[conn_mgmt_notif_n_clients];
+        memset(client, 0, sizeof(*client));
+        client->cb = cb;
+        pthread_mutex_init(&client->mutex, NULL);
+        pthread_cond_init(&client->cond, NULL);
+
+        if (pthread_create(&client->dispatcher, NULL,
+                           conn_mgmt_notif_dispatcher_fn, client)) {
+            pthread_mutex_unlock(&conn_mgmt_notif_mutex);
+            printf("Error : could not create app notif dispatcher thread\n");
+            return false;
+        }
+        conn_mgmt_notif_n_clients++;
+    }
+
+    client_index = client - conn_mgmt_notif_clients;
+
+    if (conn->app_notif_cb[client_index]) {
+        pthread_mutex_unlock(&conn_mgmt_notif_mutex);
+        return true;
+    }
+
+    /* The node may still be queued from before an unregistration, it
+     * is left as is : the connection is zeroed on creation */
+    conn->notif_node[client_index].conn = conn;
+    __atomic_store_n(&conn->app_notif_cb[client_index], cb, __ATOMIC_RELEASE);
+
+    pthread_mutex_unlock(&conn_mgmt_notif_mutex);
+
+    /* The client starts with the current state of the connection */
+    conn_mgmt_notif_enqueue(conn);
+    return true;
+}
+
+void
+conn_mgmt_unregister_app_notif_cb(conn_mgmt_conn_state_t *conn,
+                                  conn_mgmt_app_notif_fn_ptr cb) {
+
+    conn_mgmt_notif_client_t *client;
+
+    pthread_mutex_lock(&conn_mgmt_notif_mutex);
+
+    client = conn_mgmt_notif_lookup_client(cb);
+    if (client) {
+        __atomic_store_n(&conn->app_notif_cb[client - conn_mgmt_notif_clients],
+                         NULL, __ATOMIC_RELEASE);
+    }
+
+    pthread_mutex_unlock(&conn_mgmt_notif_mutex);
+}
+
+bool
+conn_mgmt_get_app_notif_stats(conn_mgmt_app_notif_fn_ptr cb,
+                              conn_mgmt_app_notif_stats_t *stats) {
+
+    conn_mgmt_notif_client_t *client;
+
+    pthread_mutex_lock(&conn_mgmt_notif_mutex);
+    client = conn_mgmt_notif_lookup_client(cb);
+    if (client) memcpy(stats, &client->stats, sizeof(*stats));
+    pthread_mutex_unlock(&conn_mgmt_notif_mutex);
+    return client != NULL;
+}
+
+void
+conn_mgmt_show_app_notif_stats(void) {
+
+    uint32_t i;
+    conn_mgmt_app_notif_stats_t *stats;
+
+    pthread_mutex_lock(&conn_mgmt_notif_mutex);
+
+    for (i = 0; i < conn_mgmt_notif_n_clients; i++) {
+
+        stats = &conn_mgmt_notif_clients[i].stats;
+
+        printf("app notif client %u : queued %lu  coalesced %lu  "
+               "delivered %lu  batches %lu  queue depth %u (max %u)\n",
+               i, stats->enqueued, stats->coalesced, stats->delivered,
+               stats->batches, stats->queue_depth, stats->max_queue_depth);
+        printf("\tdelivery latency : ");
+        conn_mgmt_hist_print_summary(&stats->delivery_latency, "usec", 1);
+    }
+
+    pthread_mutex_unlock(&conn_mgmt_notif_mutex);
+}
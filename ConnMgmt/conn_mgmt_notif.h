@@ -0,0 +1,88 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  conn_mgmt_notif.h
+ *
+ *    Description: This file defines the queues through which connection state
+ *                 changes are delivered to the app notification callbacks
+ *
+ *        Version:  1.0
+ *        Created:  10/17/2026 07:30:12 PM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  ABHISHEK SAGAR (), sachinites@gmail.com
+ *   Organization:  Juniper Networks
+ *
+ * =====================================================================================
+ */
+#ifndef __CONN_MGMT_NOTIF__
+#define __CONN_MGMT_NOTIF__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "conn_mgmt_hist.h"
+
+/* App callbacks are never invoked from the thread which changes the
+ * connection state (a recv thread, an I/O loop or the wheel timer),
+ * a slow callback would hold up KA processing for every connection.
+ * The state change is queued instead into the MPSC queue of each
+ * client (one per registered callback) and a dispatcher thread per
+ * client delivers the queue in batches.
+ *
+ * A connection has one queue node per client. While the node is
+ * queued and not delivered yet, further state changes of the
+ * connection only overwrite the state in the node : a client which
+ * falls behind gets the latest state of each connection, once */
+
+struct conn_mgmt_conn_state_;
+
+typedef struct conn_mgmt_notif_node_ {
+
+    struct conn_mgmt_conn_state_ *conn;
+    /* gen << 32 | latest conn_mgmt_conn_status_t to deliver. The gen is
+     * bumped on every state change, the two go in one word so that the
+     * newest state change wins when two threads race */
+    volatile uint64_t state;
+    /* Set while the node is in the client's queue */
+    volatile uint8_t pending;
+    /* Gen last delivered */
+    uint32_t delivered_gen;
+    /* Monotonic time in usec when the node was queued */
+    uint64_t enqueue_time;
+    struct conn_mgmt_notif_node_ *next;
+} conn_mgmt_notif_node_t;
+
+typedef struct conn_mgmt_app_notif_stats_ {
+
+    /* State changes queued, and those which found the connection
+     * already queued and were merged into it */
+    uint64_t enqueued;
+    uint64_t coalesced;
+    uint64_t delivered;
+    /* Wake ups of the dispatcher, each delivers a batch */
+    uint64_t batches;
+    /* Connections queued and not delivered yet */
+    uint32_t queue_depth;
+    uint32_t max_queue_depth;
+    /* usecs from the first state change queued to the callback */
+    conn_mgmt_hist_t delivery_latency;
+} conn_mgmt_app_notif_stats_t;
+
+/* Queues the current state of conn to every client registered on it */
+void
+conn_mgmt_notif_enqueue(struct conn_mgmt_conn_state_ *conn);
+
+/* A destroyed connection is freed only once the dispatchers are done
+ * with it : none of its nodes is queued any more, and every dispatcher
+ * which was delivering a batch at snapshot time has finished it */
+bool
+conn_mgmt_notif_conn_queued(struct conn_mgmt_conn_state_ *conn);
+
+void
+conn_mgmt_notif_snapshot_passes(uint64_t *passes);
+
+bool
+conn_mgmt_notif_passes_done(const uint64_t *passes);
+
+#endif /* __CONN_MGMT_NOTIF__ */
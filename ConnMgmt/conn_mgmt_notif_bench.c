@@ -0,0 +1,163 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  conn_mgmt_notif_bench.c
+ *
+ *    Description: This file benchmarks the delivery of connection state changes to
+ *                 a fast and a slow app notification callback while connection
+ *                 pairs flap, and checks that the slow callback holds up neither
+ *                 the fast one nor KA processing
+ *
+ *        Version:  1.0
+ *        Created:  10/17/2026 07:55:41 PM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  ABHISHEK SAGAR (), sachinites@gmail.com
+ *   Organization:  Juniper Networks
+ *
+ * =====================================================================================
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "conn_mgmt.h"
+
+#define BENCH_BASE_PORT	23000
+
+static uint32_t slow_cb_msec = 50;
+static uint64_t fast_cb_calls, slow_cb_calls;
+
+static void *
+fast_cb(conn_mgmt_conn_status_t conn_code, conn_mgmt_conn_key_t *conn_key,
+		void *msg, uint32_t msg_size) {
+
+	fast_cb_calls++;
+	return NULL;
+}
+
+static void *
+slow_cb(conn_mgmt_conn_status_t conn_code, conn_mgmt_conn_key_t *conn_key,
+		void *msg, uint32_t msg_size) {
+
+	slow_cb_calls++;
+	usleep(slow_cb_msec * 1000);
+	return NULL;
+}
+
+static bool
+all_in_state(conn_mgmt_conn_state_t **conns, uint32_t n_conns,
+			 conn_mgmt_conn_status_t conn_status) {
+
+	uint32_t i;
+
+	for (i = 0; i < n_conns; i++) {
+		if (conns[i]->conn_status != conn_status) return false;
+	}
+	return true;
+}
+
+static void
+print_client_stats(const char *name, conn_mgmt_app_notif_fn_ptr cb,
+				   uint64_t calls) {
+
+	conn_mgmt_app_notif_stats_t stats;
+
+	conn_mgmt_get_app_notif_stats(cb, &stats);
+	printf("%-5s cb : calls %lu  queued %lu  coalesced %lu  batches %lu"
+		"  max queue depth %u\n", name, calls, stats.enqueued,
+		stats.coalesced, stats.batches, stats.max_queue_depth);
+	printf("\tdelivery latency : ");
+	conn_mgmt_hist_print_summary(&stats.delivery_latency, "msec", 1000);
+}
+
+int
+main(int argc, char **argv) {
+
+	uint32_t i, flap;
+	uint32_t n_pairs = 50;
+	uint32_t n_flaps = 10;
+	uint32_t ka_interval = 20;
+	uint32_t master_downs = 0;
+	char conn_name[64];
+	conn_mgmt_io_stats_t io_stats;
+	conn_mgmt_conn_state_t **masters, **backups;
+
+	if (argc > 1) n_pairs = atoi(argv[1]);
+	if (argc > 2) n_flaps = atoi(argv[2]);
+	if (argc > 3) slow_cb_msec = atoi(argv[3]);
+
+	printf("%u pairs, %u flaps, KA interval %u msec, slow cb %u msec\n",
+		n_pairs, n_flaps, ka_interval, slow_cb_msec);
+
+	masters = calloc(n_pairs, sizeof(*masters));
+	backups = calloc(n_pairs, sizeof(*backups));
+
+	conn_mgmt_init();
+	/* One I/O loop for all : a callback invoked inline would stall
+	 * KA processing of every connection */
+	conn_mgmt_set_io_mode(CONN_MGMT_IO_EVENT_LOOP, 1);
+
+	for (i = 0; i < n_pairs; i++) {
+
+		snprintf(conn_name, sizeof(conn_name), "m%u", i);
+		conn_mgmt_configure_connection(conn_name,
+			"127.0.0.1", BENCH_BASE_PORT + (2 * i),
+			"127.0.0.1", BENCH_BASE_PORT + (2 * i) + 1, "master");
+		masters[i] = conn_mgmt_lookup_connection_by_name(conn_name);
+
+		snprintf(conn_name, sizeof(conn_name), "b%u", i);
+		conn_mgmt_configure_connection(conn_name,
+			"127.0.0.1", BENCH_BASE_PORT + (2 * i) + 1,
+			"127.0.0.1", BENCH_BASE_PORT + (2 * i), "backup");
+		backups[i] = conn_mgmt_lookup_connection_by_name(conn_name);
+
+		if (!masters[i] || !backups[i]) return -1;
+
+		conn_mgmt_set_conn_ka_interval(masters[i], ka_interval);
+		conn_mgmt_set_conn_ka_interval(backups[i], ka_interval);
+		conn_mgmt_register_app_notif_cb(masters[i], fast_cb);
+		conn_mgmt_register_app_notif_cb(backups[i], fast_cb);
+		conn_mgmt_register_app_notif_cb(masters[i], slow_cb);
+		conn_mgmt_register_app_notif_cb(backups[i], slow_cb);
+	}
+
+	for (flap = 0; flap < n_flaps; flap++) {
+
+		while (!all_in_state(backups, n_pairs, COMM_MGMT_CONN_UP)) {
+			usleep(1000);
+		}
+		for (i = 0; i < n_pairs; i++) {
+			conn_mgmt_pause_sending_kas(masters[i]);
+		}
+		while (!all_in_state(backups, n_pairs, COMM_MGMT_CONN_DOWN)) {
+			usleep(1000);
+		}
+		for (i = 0; i < n_pairs; i++) {
+			conn_mgmt_resume_sending_kas(masters[i]);
+		}
+	}
+
+	while (!all_in_state(backups, n_pairs, COMM_MGMT_CONN_UP)) {
+		usleep(1000);
+	}
+
+	/* Let the slow client drain */
+	sleep(1 + (slow_cb_msec * n_pairs * 2) / 1000);
+
+	/* Masters never stopped hearing from their backups */
+	for (i = 0; i < n_pairs; i++) {
+		master_downs += masters[i]->down_count;
+	}
+
+	print_client_stats("fast", fast_cb, fast_cb_calls);
+	print_client_stats("slow", slow_cb, slow_cb_calls);
+
+	conn_mgmt_get_io_stats(&io_stats);
+	printf("KA rx jitter : ");
+	conn_mgmt_hist_print_summary(&io_stats.ka_rx_jitter, "msec", 1000);
+	printf("masters gone down : %u\n", master_downs);
+	return master_downs ? -1 : 0;
+}
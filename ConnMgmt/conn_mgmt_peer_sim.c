@@ -0,0 +1,454 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  conn_mgmt_peer_sim.c
+ *
+ *    Description: This file implements a stand in peer for a connection : it sends
+ *                 KA msgs to a backup connection of the real conn_mgmt stack over
+ *                 loopback, dropping, delaying, reordering, duplicating or stopping
+ *                 them as a scripted profile says. Once the peer goes silent, the
+ *                 time to detect it and the time to complete the switchover are
+ *                 recorded, over many trials, as latency histograms
+ *
+ *        Version:  1.0
+ *        Created:  10/17/2026 05:30:12 PM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  ABHISHEK SAGAR (), sachinites@gmail.com
+ *   Organization:  Juniper Networks
+ *
+ * =====================================================================================
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include "conn_mgmt.h"
+
+#define SIM_BASE_PORT		41000
+#define SIM_MAX_STEPS		64
+#define SIM_MAX_PENDING		256
+#define SIM_LOOP_USEC		500
+
+typedef enum {
+
+	SIM_NORMAL,		/* send every KA msg on time */
+	SIM_DROP,		/* drop arg % of the KA msgs */
+	SIM_DELAY,		/* delay every KA msg by 0 to arg msec */
+	SIM_REORDER,	/* swap every other pair of KA msgs */
+	SIM_DUP,		/* send every KA msg twice */
+	SIM_STOP		/* go silent, ends the trial */
+} sim_action_t;
+
+static char *sim_action_str[] = {"normal", "drop", "delay", "reorder",
+								 "dup", "stop"};
+
+typedef struct sim_step_ {
+
+	sim_action_t action;
+	uint32_t duration;	/* msec */
+	uint32_t arg;
+} sim_step_t;
+
+typedef struct sim_pkt_ {
+
+	uint64_t due;	/* usec */
+	uint32_t size;
+	unsigned char pkt[CONN_MGMT_KA_PKT_MAX_SIZE];
+} sim_pkt_t;
+
+typedef struct peer_sim_ {
+
+	int sock_fd;
+	struct sockaddr_in conn_addr;
+	conn_mgmt_ka_info_t ka_info;
+	uint32_t ka_interval;
+	/* Delayed KA msgs, unordered */
+	sim_pkt_t pending[SIM_MAX_PENDING];
+	uint32_t n_pending;
+	/* KA msg held back to be sent after the next one */
+	sim_pkt_t held;
+	bool held_valid;
+	/* Last time a KA msg went on the wire, the peer's last sign
+	 * of life */
+	uint64_t last_tx_time;
+	uint32_t seed;
+	/* Counters */
+	uint32_t n_sent;
+	uint32_t n_dropped;
+	uint32_t n_rx;
+	uint32_t n_rx_bad;
+} peer_sim_t;
+
+static sim_step_t sim_steps[SIM_MAX_STEPS];
+static uint32_t sim_n_steps;
+
+/* Exercises every fault, then goes silent */
+static sim_step_t sim_default_steps[] = {
+
+	{SIM_NORMAL,	1000,	0},
+	{SIM_DROP,		1000,	5},
+	{SIM_DELAY,		1000,	10},
+	{SIM_REORDER,	1000,	0},
+	{SIM_DUP,		1000,	0},
+	{SIM_NORMAL,	500,	0},
+	{SIM_STOP,		0,		0}
+};
+
+static uint64_t
+sim_now_usec() {
+
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+static uint64_t
+sim_wall_time_usec() {
+
+	struct timespec ts;
+
+	clock_gettime(CLOCK_REALTIME, &ts);
+	return ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+/* Profile file : one step per line, "<action> <duration msec> [arg]",
+ * lines starting with # are ignored. A profile must end with stop */
+static bool
+sim_load_profile(char *file_name) {
+
+	FILE *fp;
+	char line[128], action[32];
+	uint32_t i, duration, arg;
+	int n;
+
+	fp = fopen(file_name, "r");
+	if (!fp) {
+		printf("Error : could not open %s\n", file_name);
+		return false;
+	}
+
+	sim_n_steps = 0;
+
+	while (fgets(line, sizeof(line), fp) && sim_n_steps < SIM_MAX_STEPS) {
+
+		if (line[0] == '#') continue;
+
+		arg = 0;
+		n = sscanf(line, "%31s %u %u", action, &duration, &arg);
+		if (n < 1) continue;
+		if (n < 2) duration = 0;
+
+		for (i = 0; i <= SIM_STOP; i++) {
+			if (strcmp(action, sim_action_str[i]) == 0) break;
+		}
+		if (i > SIM_STOP) {
+			printf("Error : unknown action %s\n", action);
+			fclose(fp);
+			return false;
+		}
+		sim_steps[sim_n_steps].action = i;
+		sim_steps[sim_n_steps].duration = duration;
+		sim_steps[sim_n_steps].arg = arg;
+		sim_n_steps++;
+	}
+	fclose(fp);
+
+	if (!sim_n_steps || sim_steps[sim_n_steps - 1].action != SIM_STOP) {
+		printf("Error : profile must end with a stop step\n");
+		return false;
+	}
+	return true;
+}
+
+static void
+sim_send(peer_sim_t *sim, sim_pkt_t *sim_pkt) {
+
+	sendto(sim->sock_fd, sim_pkt->pkt, sim_pkt->size, 0,
+		   (struct sockaddr *)&sim->conn_addr, sizeof(sim->conn_addr));
+	sim->last_tx_time = sim_now_usec();
+	sim->n_sent++;
+}
+
+/* A KA msg is due, apply the fault of the current step to it */
+static void
+sim_generate_ka(peer_sim_t *sim, sim_step_t *step) {
+
+	sim_pkt_t sim_pkt;
+
+	sim->ka_info.seq_no++;
+	sim->ka_info.send_time = sim_wall_time_usec();
+	sim_pkt.size = conn_mgmt_ka_encode(&sim->ka_info, sim_pkt.pkt,
+									   sizeof(sim_pkt.pkt));
+	sim_pkt.due = sim_now_usec();
+
+	switch(step->action) {
+
+		case SIM_DROP:
+			if ((rand_r(&sim->seed) % 100) < step->arg) {
+				sim->n_dropped++;
+				return;
+			}
+			break;
+
+		case SIM_DELAY:
+			if (step->arg && sim->n_pending < SIM_MAX_PENDING) {
+				sim_pkt.due += (rand_r(&sim->seed) % (step->arg * 1000));
+				sim->pending[sim->n_pending++] = sim_pkt;
+				return;
+			}
+			break;
+
+		case SIM_REORDER:
+			if (!sim->held_valid) {
+				sim->held = sim_pkt;
+				sim->held_valid = true;
+				return;
+			}
+			sim_send(sim, &sim_pkt);
+			sim_send(sim, &sim->held);
+			sim->held_valid = false;
+			return;
+
+		case SIM_DUP:
+			sim_send(sim, &sim_pkt);
+			break;
+
+		default: ;
+	}
+	sim_send(sim, &sim_pkt);
+}
+
+static void
+sim_flush_pending(peer_sim_t *sim, bool all) {
+
+	uint32_t i = 0;
+	uint64_t now = sim_now_usec();
+
+	while (i < sim->n_pending) {
+
+		if (all || sim->pending[i].due <= now) {
+			sim_send(sim, &sim->pending[i]);
+			sim->pending[i] = sim->pending[--sim->n_pending];
+			continue;
+		}
+		i++;
+	}
+
+	/* A step other than reorder releases the held KA msg */
+	if (all && sim->held_valid) {
+		sim_send(sim, &sim->held);
+		sim->held_valid = false;
+	}
+}
+
+/* KA msgs from the connection under test, decoded to check them */
+static void
+sim_drain(peer_sim_t *sim) {
+
+	int rc;
+	unsigned char buf[CONN_MGMT_KA_PKT_MAX_SIZE];
+	conn_mgmt_ka_info_t ka_info;
+
+	while ((rc = recv(sim->sock_fd, buf, sizeof(buf), MSG_DONTWAIT)) > 0) {
+		sim->n_rx++;
+		if (!conn_mgmt_ka_decode(buf, rc, &ka_info)) sim->n_rx_bad++;
+	}
+}
+
+/* Plays the profile up to its stop step */
+static void
+sim_run_profile(peer_sim_t *sim) {
+
+	uint32_t i;
+	uint64_t step_end, next_ka, now;
+
+	next_ka = sim_now_usec();
+
+	for (i = 0; i < sim_n_steps && sim_steps[i].action != SIM_STOP; i++) {
+
+		step_end = sim_now_usec() + (sim_steps[i].duration * 1000ULL);
+
+		while ((now = sim_now_usec()) < step_end) {
+
+			if (now >= next_ka) {
+				sim_generate_ka(sim, &sim_steps[i]);
+				next_ka += sim->ka_interval * 1000ULL;
+			}
+			sim_flush_pending(sim, false);
+			sim_drain(sim);
+			usleep(SIM_LOOP_USEC);
+		}
+		sim_flush_pending(sim, true);
+	}
+}
+
+static bool
+sim_init(peer_sim_t *sim, uint16_t sim_port, uint16_t conn_port,
+		 uint32_t ka_interval, uint8_t version, uint32_t seed) {
+
+	struct sockaddr_in sim_addr;
+
+	memset(sim, 0, sizeof(*sim));
+
+	sim->sock_fd = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+	memset(&sim_addr, 0, sizeof(sim_addr));
+	sim_addr.sin_family = AF_INET;
+	/* Port nos are used as is, like conn_mgmt does */
+	sim_addr.sin_port = sim_port;
+	inet_pton(AF_INET, "127.0.0.1", &sim_addr.sin_addr);
+
+	if (bind(sim->sock_fd, (struct sockaddr *)&sim_addr,
+			 sizeof(sim_addr)) < 0) {
+		printf("Error : sim socket bind failed\n");
+		close(sim->sock_fd);
+		return false;
+	}
+
+	sim->conn_addr = sim_addr;
+	sim->conn_addr.sin_port = conn_port;
+	sim->ka_interval = ka_interval;
+	sim->seed = seed;
+
+	sim->ka_info.version = version;
+	sim->ka_info.flags = version == CONN_MGMT_KA_VERSION_1 ?
+						 CONN_MGMT_KA_F_V2_CAPABLE : 0;
+	sim->ka_info.state_gen = 1;
+	sim->ka_info.src_ip_addr = sim_addr.sin_addr.s_addr;
+	sim->ka_info.dst_ip_addr = sim_addr.sin_addr.s_addr;
+	sim->ka_info.src_port_no = sim_port;
+	sim->ka_info.dst_port_no = conn_port;
+	sim->ka_info.mastership_state = COMM_MGMT_MASTER;
+	sim->ka_info.conn_state = COMM_MGMT_CONN_UP;
+	sim->ka_info.hold_time = ka_interval * 2;
+	return true;
+}
+
+int
+main(int argc, char **argv) {
+
+	uint32_t i, n_trials = 20, ka_interval = 50;
+	uint32_t n_detected = 0, n_switchovers = 0, false_downs = 0;
+	uint8_t version = CONN_MGMT_KA_VERSION_2;
+	uint64_t deadline, detection, switchover;
+	char conn_name[32];
+	peer_sim_t sim;
+	conn_mgmt_conn_state_t *conn;
+	conn_mgmt_hist_t detect_hist, switchover_hist;
+
+	if (argc > 1) n_trials = atoi(argv[1]);
+	if (argc > 2) ka_interval = atoi(argv[2]);
+	if (argc > 3 && strcmp(argv[3], "-") != 0) {
+		if (!sim_load_profile(argv[3])) return -1;
+	}
+	else {
+		memcpy(sim_steps, sim_default_steps, sizeof(sim_default_steps));
+		sim_n_steps = sizeof(sim_default_steps) / sizeof(sim_steps[0]);
+	}
+	if (argc > 4 && strcmp(argv[4], "v1") == 0)
+		version = CONN_MGMT_KA_VERSION_1;
+	if (argc > 4 && strcmp(argv[4], "legacy") == 0)
+		version = CONN_MGMT_KA_VERSION_LEGACY;
+
+	memset(&detect_hist, 0, sizeof(detect_hist));
+	memset(&switchover_hist, 0, sizeof(switchover_hist));
+
+	printf("usage : %s [trials] [KA interval msec] [profile file|-] [v1|v2|legacy]\n",
+		argv[0]);
+	printf("profile :");
+	for (i = 0; i < sim_n_steps; i++) {
+		printf(" %s %u %u;", sim_action_str[sim_steps[i].action],
+			sim_steps[i].duration, sim_steps[i].arg);
+	}
+	printf("\n");
+
+	conn_mgmt_init();
+	conn_mgmt_set_io_mode(CONN_MGMT_IO_EVENT_LOOP, 1);
+
+	for (i = 0; i < n_trials; i++) {
+
+		/* A fresh backup connection per trial, a connection which
+		 * switched over is master and would not switch over again */
+		if (!sim_init(&sim, SIM_BASE_PORT + (2 * i),
+					  SIM_BASE_PORT + (2 * i) + 1, ka_interval, version,
+					  i + 1)) {
+			return -1;
+		}
+
+		snprintf(conn_name, sizeof(conn_name), "trial%u", i);
+		conn_mgmt_configure_connection(conn_name,
+			"127.0.0.1", SIM_BASE_PORT + (2 * i) + 1,
+			"127.0.0.1", SIM_BASE_PORT + (2 * i), "backup");
+		conn = conn_mgmt_lookup_connection_by_name(conn_name);
+		if (!conn) return -1;
+		conn_mgmt_set_conn_ka_interval(conn, ka_interval);
+
+		sim_run_profile(&sim);
+
+		/* Went down while the peer was still sending */
+		false_downs += conn->down_count;
+
+		if (conn->conn_status != COMM_MGMT_CONN_UP) {
+			printf("trial %3u : connection not up when the peer went silent,"
+				" down count %u\n", i, conn->down_count);
+			close(sim.sock_fd);
+			continue;
+		}
+
+		/* Peer is silent from here on */
+		deadline = sim_now_usec() + (conn->hold_time * 5000ULL);
+		while (conn->conn_status == COMM_MGMT_CONN_UP &&
+			   sim_now_usec() < deadline) {
+			sim_drain(&sim);
+			usleep(100);
+		}
+		close(sim.sock_fd);
+
+		if (conn->conn_status == COMM_MGMT_CONN_UP) {
+			printf("trial %3u : peer silence not detected\n", i);
+			continue;
+		}
+
+		/* Tear down and switchover run back to back in the hold timer
+		 * callback, wait for the switchover to be stamped */
+		while (conn->last_switchover_time < conn->last_down_time &&
+			   sim_now_usec() < deadline) {
+			usleep(100);
+		}
+
+		detection = conn->last_down_time - sim.last_tx_time;
+		conn_mgmt_hist_add(&detect_hist, detection);
+		n_detected++;
+
+		printf("trial %3u : sent %4u dropped %3u rx %4u bad %u : "
+			"detected in %7.2f msec", i, sim.n_sent, sim.n_dropped,
+			sim.n_rx, sim.n_rx_bad, detection / 1000.0);
+
+		if (conn->last_switchover_time >= conn->last_down_time) {
+			switchover = conn->last_switchover_time - conn->last_down_time;
+			conn_mgmt_hist_add(&switchover_hist, switchover);
+			n_switchovers++;
+			printf(", switchover in %6.1f usec\n", (double)switchover);
+		}
+		else {
+			printf(", no switchover\n");
+		}
+	}
+
+	printf("\nhold time %u msec, %u/%u trials detected, %u false downs\n",
+		ka_interval * 2, n_detected, n_trials, false_downs);
+	printf("peer silence to conn down :\n\t");
+	conn_mgmt_hist_print_summary(&detect_hist, "msec", 1000.0);
+	conn_mgmt_hist_print(&detect_hist, "msec", 1000.0);
+	printf("conn down to switchover complete (%u) :\n\t", n_switchovers);
+	conn_mgmt_hist_print_summary(&switchover_hist, "usec", 1.0);
+	conn_mgmt_hist_print(&switchover_hist, "usec", 1.0);
+	return 0;
+}
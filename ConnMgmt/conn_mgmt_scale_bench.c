@@ -0,0 +1,278 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  conn_mgmt_scale_bench.c
+ *
+ *    Description: This file benchmarks connection mgmt at scale on loopback : N
+ *                 master/backup connection pairs are kept alive for a fixed time
+ *                 and the KA throughput, CPU and memory per connection, KA inter
+ *                 arrival jitter and false downs are reported, for N from 1 to 10k
+ *
+ *        Version:  1.0
+ *        Created:  10/17/2026 04:41:09 PM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  ABHISHEK SAGAR (), sachinites@gmail.com
+ *   Organization:  Juniper Networks
+ *
+ * =====================================================================================
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include "conn_mgmt.h"
+
+#define BENCH_MASTER_PORT	30000
+#define BENCH_BACKUP_PORT	30001
+#define BENCH_BASE_PORT		32000
+/* Thread per connection mode stops being sensible well before 10k */
+#define BENCH_MAX_THREADED_CONNS	2000
+#define BENCH_UP_TIMEOUT_SEC	30
+
+static uint32_t pair_counts[] = {1, 10, 100, 1000, 5000, 10000};
+
+static conn_mgmt_conn_state_t **bench_conns;
+
+static long
+bench_get_rss_kb() {
+
+	FILE *fp;
+	char line[128];
+	long rss = -1;
+
+	fp = fopen("/proc/self/status", "r");
+	if (!fp) return -1;
+
+	while (fgets(line, sizeof(line), fp)) {
+		if (strncmp(line, "VmRSS:", strlen("VmRSS:")) == 0) {
+			rss = atol(line + strlen("VmRSS:"));
+			break;
+		}
+	}
+	fclose(fp);
+	return rss;
+}
+
+static double
+bench_get_cpu_time_sec() {
+
+	struct rusage ru;
+
+	getrusage(RUSAGE_SELF, &ru);
+	return ru.ru_utime.tv_sec + ru.ru_stime.tv_sec +
+		   (ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) / 1e6;
+}
+
+static const char *
+bench_io_mode_str(conn_mgmt_io_mode_t io_mode) {
+
+	switch(io_mode) {
+		case CONN_MGMT_IO_THREAD_PER_CONN:
+			return "threads";
+		case CONN_MGMT_IO_EVENT_LOOP:
+			return "evloop";
+		case CONN_MGMT_IO_BATCHED:
+			return "batched";
+		default: ;
+	}
+	return "unknown";
+}
+
+/* Same addressing as conn_mgmt_ka_batch_bench : in batched mode all
+ * masters share one src port and all backups share another, the
+ * connections differ by the backup side ip 127.1.x.y */
+static void
+bench_configure_pair(conn_mgmt_io_mode_t io_mode, uint32_t i,
+					 uint32_t ka_interval) {
+
+	char name[32];
+	char backup_ip[16];
+	uint16_t master_port, backup_port;
+
+	snprintf(backup_ip, sizeof(backup_ip), "127.1.%u.%u",
+		(i >> 8) & 0xff, i & 0xff);
+
+	if (io_mode == CONN_MGMT_IO_BATCHED) {
+		master_port = BENCH_MASTER_PORT;
+		backup_port = BENCH_BACKUP_PORT;
+	}
+	else {
+		master_port = BENCH_BASE_PORT + (2 * i);
+		backup_port = BENCH_BASE_PORT + (2 * i) + 1;
+	}
+
+	snprintf(name, sizeof(name), "m%u", i);
+	conn_mgmt_configure_connection(name,
+		"127.0.0.1", master_port, backup_ip, backup_port, "master");
+	bench_conns[2 * i] = conn_mgmt_lookup_connection_by_name(name);
+
+	snprintf(name, sizeof(name), "b%u", i);
+	conn_mgmt_configure_connection(name,
+		backup_ip, backup_port, "127.0.0.1", master_port, "backup");
+	bench_conns[(2 * i) + 1] = conn_mgmt_lookup_connection_by_name(name);
+
+	conn_mgmt_set_conn_ka_interval(bench_conns[2 * i], ka_interval);
+	conn_mgmt_set_conn_ka_interval(bench_conns[(2 * i) + 1], ka_interval);
+}
+
+static uint32_t
+bench_count_up(uint32_t n_conns) {
+
+	uint32_t i, n_up = 0;
+
+	for (i = 0; i < n_conns; i++) {
+		if (bench_conns[i] &&
+			bench_conns[i]->conn_status == COMM_MGMT_CONN_UP) {
+			n_up++;
+		}
+	}
+	return n_up;
+}
+
+static uint32_t
+bench_count_downs(uint32_t n_conns) {
+
+	uint32_t i, n_downs = 0;
+
+	for (i = 0; i < n_conns; i++) {
+		if (bench_conns[i]) n_downs += bench_conns[i]->down_count;
+	}
+	return n_downs;
+}
+
+static void
+bench_run(conn_mgmt_io_mode_t io_mode, uint32_t n_pairs,
+		  uint32_t duration, uint32_t ka_interval, bool print_hist) {
+
+	uint32_t i, waited;
+	uint32_t n_conns = n_pairs * 2;
+	uint32_t downs_start, false_downs;
+	long rss_start, rss_end;
+	double cpu_start, cpu_end;
+	conn_mgmt_io_stats_t *start, *end;
+
+	start = calloc(1, sizeof(conn_mgmt_io_stats_t));
+	end = calloc(1, sizeof(conn_mgmt_io_stats_t));
+	bench_conns = calloc(n_conns, sizeof(conn_mgmt_conn_state_t *));
+
+	conn_mgmt_init();
+	conn_mgmt_set_io_mode(io_mode, 1);
+
+	rss_start = bench_get_rss_kb();
+
+	for (i = 0; i < n_pairs; i++) {
+		bench_configure_pair(io_mode, i, ka_interval);
+	}
+
+	for (waited = 0; bench_count_up(n_conns) < n_conns &&
+					 waited < BENCH_UP_TIMEOUT_SEC * 10; waited++) {
+		usleep(100000);
+	}
+
+	/* One more hold time for the jitter and the timers to settle */
+	usleep(bench_conns[0]->hold_time * 1000);
+
+	rss_end = bench_get_rss_kb();
+	downs_start = bench_count_downs(n_conns);
+	conn_mgmt_get_io_stats(start);
+	cpu_start = bench_get_cpu_time_sec();
+
+	sleep(duration);
+
+	cpu_end = bench_get_cpu_time_sec();
+	conn_mgmt_get_io_stats(end);
+	false_downs = bench_count_downs(n_conns) - downs_start;
+	conn_mgmt_hist_sub(&end->ka_rx_jitter, &start->ka_rx_jitter);
+
+	printf("%-8s %6u %6u %10.0f %10.0f %9.2f %9.2f %8.2f %8.2f %8.2f %8.2f %6u\n",
+		bench_io_mode_str(io_mode), n_conns, bench_count_up(n_conns),
+		(double)(n_conns * 1000ULL) / ka_interval,
+		(end->ka_rx_pkts - start->ka_rx_pkts) / (double)duration,
+		(cpu_end - cpu_start) * 1e6 / duration / n_conns,
+		(double)(rss_end - rss_start) / n_conns,
+		conn_mgmt_hist_percentile(&end->ka_rx_jitter, 50) / 1000.0,
+		conn_mgmt_hist_percentile(&end->ka_rx_jitter, 99) / 1000.0,
+		conn_mgmt_hist_percentile(&end->ka_rx_jitter, 99.9) / 1000.0,
+		end->ka_rx_jitter.max / 1000.0,
+		false_downs);
+
+	if (print_hist) {
+		printf("\tKA inter arrival jitter, %u conns :\n", n_conns);
+		conn_mgmt_hist_print(&end->ka_rx_jitter, "msec", 1000.0);
+	}
+	fflush(stdout);
+}
+
+int
+main(int argc, char **argv) {
+
+	uint32_t i;
+	pid_t pid;
+	struct rlimit rlim;
+	uint32_t duration = 10;
+	uint32_t ka_interval = 1000;
+	bool print_hist = false;
+	conn_mgmt_io_mode_t io_mode = CONN_MGMT_IO_BATCHED;
+
+	if (argc > 1) {
+		if (strncmp(argv[1], "threads", strlen("threads")) == 0)
+			io_mode = CONN_MGMT_IO_THREAD_PER_CONN;
+		else if (strncmp(argv[1], "evloop", strlen("evloop")) == 0)
+			io_mode = CONN_MGMT_IO_EVENT_LOOP;
+	}
+	if (argc > 2)
+		duration = atoi(argv[2]);
+	if (argc > 3)
+		ka_interval = atoi(argv[3]);
+	if (argc > 4 && strncmp(argv[4], "hist", strlen("hist")) == 0)
+		print_hist = true;
+
+	getrlimit(RLIMIT_NOFILE, &rlim);
+	rlim.rlim_cur = rlim.rlim_max;
+	setrlimit(RLIMIT_NOFILE, &rlim);
+
+	printf("usage : %s [threads|evloop|batched] [duration sec] "
+		"[KA interval msec] [hist]\n", argv[0]);
+	printf("KA interval %u msec, %u sec per data point, jitter in msec\n\n",
+		ka_interval, duration);
+	printf("%-8s %6s %6s %10s %10s %9s %9s %8s %8s %8s %8s %6s\n",
+		"mode", "conns", "up", "exp KA/s", "rx KA/s", "cpu us/c",
+		"rss KB/c", "jit p50", "jit p99", "p99.9", "max", "downs");
+	fflush(stdout);
+
+	/* Every data point runs in its own process so that the
+	 * threads and sockets of the previous run do not leak in */
+	for (i = 0; i < sizeof(pair_counts)/sizeof(pair_counts[0]); i++) {
+
+		if (io_mode == CONN_MGMT_IO_THREAD_PER_CONN &&
+			pair_counts[i] * 2 > BENCH_MAX_THREADED_CONNS) {
+			printf("%-8s %6u skipped, more than %u threads\n", "threads",
+				pair_counts[i] * 2, BENCH_MAX_THREADED_CONNS);
+			continue;
+		}
+
+		if (io_mode != CONN_MGMT_IO_BATCHED &&
+			(pair_counts[i] * 2) + 64 > rlim.rlim_cur) {
+			printf("%-8s %6u skipped, fd limit %lu\n",
+				bench_io_mode_str(io_mode), pair_counts[i] * 2,
+				rlim.rlim_cur);
+			continue;
+		}
+
+		pid = fork();
+
+		if (pid == 0) {
+			bench_run(io_mode, pair_counts[i], duration, ka_interval,
+				print_hist);
+			exit(0);
+		}
+		waitpid(pid, NULL, 0);
+	}
+	return 0;
+}
@@ -40,6 +40,8 @@ connection_config_handler(param_t *param,
 	uint16_t src_port_no;
 	uint16_t dst_port_no;
 	char *mastership = NULL;
+	uint32_t ka_interval = 0;
+	conn_mgmt_conn_state_t *conn;
 	int cmd_code;
 	tlv_struct_t *tlv = NULL;
 	
@@ -59,6 +61,8 @@ connection_config_handler(param_t *param,
 			dst_port_no = atoi(tlv->value);
 		else if (strncmp(tlv->leaf_id, "mastership", strlen("mastership")) ==0)
 			mastership = tlv->value;
+		else if (strncmp(tlv->leaf_id, "interval-val", strlen("interval-val")) ==0)
+			ka_interval = atoi(tlv->value);
 		else
 			assert(0);
 		
@@ -83,6 +87,12 @@ connection_config_handler(param_t *param,
     	case CMD_CODE_CONFIG_CONNECTION_KA_STOP:
     	break;
     	case CMD_CODE_CONFIG_CONNECTION_KA_INTERVAL:
+    	conn = conn_mgmt_lookup_connection_by_name(conn_name);
+    	if (!conn) {
+    		printf("connection %s could not be found\n", conn_name);
+    		break;
+    	}
+    	conn_mgmt_set_conn_ka_interval(conn, ka_interval);
     	break;
     	default:
     	;
@@ -187,12 +197,12 @@ conn_mgmt_build_cli() {
             	{
 	            	/* config connection <conn-name> keep-alive interval */
             		static param_t ka_interval;
-	            	init_param(&ka_interval, CMD, "interval", 0, 0, INVALID, 0, "KA interval in sec");
+	            	init_param(&ka_interval, CMD, "interval", 0, 0, INVALID, 0, "KA interval in msec");
     	        	libcli_register_param(&keep_alive, &ka_interval);
-    	        	/* config connection <conn-name> keep-alive interval <interval-value in sec>*/
+    	        	/* config connection <conn-name> keep-alive interval <interval-value in msec>*/
     	        	{
     	        		static param_t interval_value;
-                        init_param(&interval_value, LEAF, 0, connection_config_handler, 0, INT, "interval-val", "KA interval value in sec");
+                        init_param(&interval_value, LEAF, 0, connection_config_handler, 0, INT, "interval-val", "KA interval value in msec");
                         libcli_register_param(&ka_interval, &interval_value);
                         set_param_cmd_code(&interval_value, CMD_CODE_CONFIG_CONNECTION_KA_INTERVAL);
     	        	}
@@ -0,0 +1,2838 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  mirror.c
+ *
+ *    Description: This file implements the replication log, and the threads which
+ *                 stream it to the peer and apply the peer's records
+ *
+ *        Version:  1.0
+ *        Created:  10/17/2026 08:40:17 PM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  ABHISHEK SAGAR (), sachinites@gmail.com
+ *   Organization:  Juniper Networks
+ *
+ * =====================================================================================
+ */
+
+#define _GNU_SOURCE	/* recvmmsg(), sendmmsg() */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+#include <time.h>
+#include <unistd.h>
+#include <endian.h>
+#include <arpa/inet.h>
+#include <sys/uio.h>
+#include <sys/wait.h>
+#include <signal.h>
+#include <poll.h>
+#include "mirror.h"
+
+static uint64_t
+mirror_get_time_usec() {
+
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (ts.tv_sec * 1000000ULL) + (ts.tv_nsec / 1000);
+}
+
+/* Records are stamped with the wall clock, the backup compares it with
+ * its own */
+static uint64_t
+mirror_get_wall_time_usec() {
+
+    struct timespec ts;
+
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (ts.tv_sec * 1000000ULL) + (ts.tv_nsec / 1000);
+}
+
+/* Ring accessors, of the log and the apply workers' queues. pos wraps
+ * around the end of the ring, size is a power of 2 */
+
+static void
+mirror_ring_write(unsigned char *ring, uint64_t size, uint64_t pos,
+                  const void *data, uint32_t len) {
+
+    uint64_t offset = pos & (size - 1);
+    uint64_t first = size - offset;
+
+    if (first >= len) {
+        memcpy(ring + offset, data, len);
+        return;
+    }
+    memcpy(ring + offset, data, first);
+    memcpy(ring, (const unsigned char *)data + first, len - first);
+}
+
+static void
+mirror_ring_read(const unsigned char *ring, uint64_t size, uint64_t pos,
+                 void *data, uint32_t len) {
+
+    uint64_t offset = pos & (size - 1);
+    uint64_t first = size - offset;
+
+    if (first >= len) {
+        memcpy(data, ring + offset, len);
+        return;
+    }
+    memcpy(data, ring + offset, first);
+    memcpy((unsigned char *)data + first, ring, len - first);
+}
+
+static inline void
+mirror_log_write(mirror_t *mirror, uint64_t pos,
+                 const void *data, uint32_t len) {
+
+    mirror_ring_write(mirror->log, mirror->log_size, pos, data, len);
+}
+
+static inline void
+mirror_log_read(mirror_t *mirror, uint64_t pos,
+                void *data, uint32_t len) {
+
+    mirror_ring_read(mirror->log, mirror->log_size, pos, data, len);
+}
+
+/* Writes one record at the log tail, the caller made room for it */
+static void
+mirror_log_put(mirror_t *mirror, uint64_t obj_id, uint16_t op,
+               const void *payload, uint32_t payload_len,
+               uint64_t timestamp, uint16_t flags) {
+
+    mirror_record_hdr_t rec_hdr;
+
+    rec_hdr.lsn = htobe64(mirror->next_lsn++);
+    rec_hdr.obj_id = htobe64(obj_id);
+    rec_hdr.timestamp = htobe64(timestamp);
+    rec_hdr.payload_len = htonl(payload_len);
+    rec_hdr.op = htons(op);
+    rec_hdr.flags = htons(flags);
+
+    mirror_log_write(mirror, mirror->log_tail, &rec_hdr, sizeof(rec_hdr));
+    mirror_log_write(mirror, mirror->log_tail + sizeof(rec_hdr),
+                     payload, payload_len);
+    mirror->log_tail += sizeof(rec_hdr) + payload_len;
+}
+
+/* Waits until the log has room for len more bytes, returns false if
+ * the mirror is being destroyed. Drops the log mutex while waiting */
+static bool
+mirror_log_wait_room(mirror_t *mirror, uint64_t len) {
+
+    while (mirror->log_tail + len - mirror->log_head > mirror->log_size) {
+        if (mirror->stop) return false;
+        mirror->stats.append_stalls++;
+        pthread_cond_wait(&mirror->log_room_cond, &mirror->log_mutex);
+    }
+    return true;
+}
+
+static inline void
+mirror_wake_sender(mirror_t *mirror) {
+
+    if (mirror->sender_waiting) {
+        pthread_cond_signal(&mirror->log_data_cond);
+    }
+}
+
+/* Coalescing stage, all under the log mutex */
+
+#define MIRROR_STAGED_HASH_SIZE	(2 * MIRROR_COALESCE_MAX_RECORDS)
+
+static inline uint32_t
+mirror_staged_hash_slot(uint64_t obj_id) {
+
+    return (uint32_t)((obj_id * 0x9E3779B97F4A7C15ULL) >> 32) &
+           (MIRROR_STAGED_HASH_SIZE - 1);
+}
+
+/* Index of the staged record of obj_id, or -1 with *hash_slot set to
+ * the free slot where it would go */
+static int32_t
+mirror_staged_lookup(mirror_t *mirror, uint64_t obj_id,
+                     uint32_t *hash_slot) {
+
+    uint32_t slot = mirror_staged_hash_slot(obj_id);
+    uint32_t index;
+
+    while ((index = mirror->staged_hash[slot])) {
+        if (mirror->staged[index - 1].obj_id == obj_id) {
+            return index - 1;
+        }
+        slot = (slot + 1) & (MIRROR_STAGED_HASH_SIZE - 1);
+    }
+    *hash_slot = slot;
+    return -1;
+}
+
+static void
+mirror_staged_unlink(mirror_t *mirror, int32_t index) {
+
+    mirror_staged_rec_t *rec = &mirror->staged[index];
+
+    if (rec->prev >= 0) mirror->staged[rec->prev].next = rec->next;
+    else mirror->staged_head = rec->next;
+    if (rec->next >= 0) mirror->staged[rec->next].prev = rec->prev;
+    else mirror->staged_tail = rec->prev;
+}
+
+static void
+mirror_staged_link_last(mirror_t *mirror, int32_t index) {
+
+    mirror_staged_rec_t *rec = &mirror->staged[index];
+
+    rec->prev = mirror->staged_tail;
+    rec->next = -1;
+    if (mirror->staged_tail >= 0) mirror->staged[mirror->staged_tail].next = index;
+    else mirror->staged_head = index;
+    mirror->staged_tail = index;
+}
+
+/* Moves the whole batch to the log, in order of latest append. The
+ * room is made for the batch as a whole first : the mutex is dropped
+ * only then, and other appenders may grow the batch meanwhile, so the
+ * room is made again for the batch as it is once awake */
+static void
+mirror_staged_flush(mirror_t *mirror, uint64_t *flush_counter) {
+
+    int32_t index;
+    uint64_t now, len;
+    mirror_staged_rec_t *rec;
+
+    while (mirror->n_staged) {
+
+        len = mirror->staged_bytes +
+              (mirror->n_staged * sizeof(mirror_record_hdr_t));
+        if (!mirror_log_wait_room(mirror, len)) return;
+        if (mirror->staged_bytes +
+            (mirror->n_staged * sizeof(mirror_record_hdr_t)) != len) {
+            continue;
+        }
+
+        now = mirror_get_wall_time_usec();
+
+        for (index = mirror->staged_head; index >= 0; index = rec->next) {
+
+            rec = &mirror->staged[index];
+            mirror_log_put(mirror, rec->obj_id, rec->op, rec->payload,
+                           rec->payload_len, rec->append_time, 0);
+            mirror->staged_hash[rec->hash_slot] = 0;
+            conn_mgmt_hist_add(&mirror->stats.coalesce_delay,
+                now > rec->append_time ? now - rec->append_time : 0);
+        }
+
+        mirror->n_staged = 0;
+        mirror->staged_bytes = 0;
+        mirror->staged_head = mirror->staged_tail = -1;
+        if (flush_counter) (*flush_counter)++;
+        mirror_wake_sender(mirror);
+    }
+}
+
+static void
+mirror_stage(mirror_t *mirror, uint64_t obj_id, uint16_t op,
+             const void *payload, uint32_t payload_len) {
+
+    int32_t index;
+    uint32_t hash_slot = 0;
+    mirror_staged_rec_t *rec;
+
+    index = mirror_staged_lookup(mirror, obj_id, &hash_slot);
+
+    /* Must follow the staged record of its obj_id, not replace it */
+    while (index >= 0 && op < MIRROR_MAX_OPS && mirror->op_ordered[op]) {
+        mirror_staged_flush(mirror, NULL);
+        if (mirror->stop) return;
+        index = mirror_staged_lookup(mirror, obj_id, &hash_slot);
+    }
+
+    while (index < 0 && mirror->n_staged == MIRROR_COALESCE_MAX_RECORDS) {
+        mirror_staged_flush(mirror, &mirror->stats.size_flushes);
+        if (mirror->stop) return;
+        index = mirror_staged_lookup(mirror, obj_id, &hash_slot);
+    }
+
+    if (index >= 0) {
+        /* Last writer wins, and moves to the back of the batch */
+        rec = &mirror->staged[index];
+        mirror->staged_bytes -= rec->payload_len;
+        mirror_staged_unlink(mirror, index);
+        mirror->stats.merged_records++;
+    }
+    else {
+        index = mirror->n_staged++;
+        rec = &mirror->staged[index];
+        rec->obj_id = obj_id;
+        rec->hash_slot = hash_slot;
+        mirror->staged_hash[hash_slot] = index + 1;
+
+        if (mirror->n_staged == 1) {
+            /* The latency budget of the batch starts now */
+            mirror->batch_open_time = mirror_get_time_usec();
+            mirror_wake_sender(mirror);
+        }
+    }
+
+    if (rec->payload_capacity < payload_len) {
+        rec->payload = realloc(rec->payload, payload_len);
+        rec->payload_capacity = payload_len;
+    }
+    memcpy(rec->payload, payload, payload_len);
+    rec->payload_len = payload_len;
+    rec->op = op;
+    rec->append_time = mirror_get_wall_time_usec();
+    mirror_staged_link_last(mirror, index);
+    mirror->staged_bytes += payload_len;
+    mirror->stats.staged_records++;
+
+    if (mirror->staged_bytes >= mirror->coalesce_batch_bytes) {
+        mirror_staged_flush(mirror, &mirror->stats.size_flushes);
+    }
+}
+
+/* Waits until the peer acks lsn as far as durability asks for, for up
+ * to the hold time of the connection */
+static bool
+mirror_wait_ack(mirror_t *mirror, mirror_lsn_t lsn,
+                mirror_durability_t durability) {
+
+    bool acked = true;
+    uint64_t deadline;
+    struct timespec ts;
+    mirror_lsn_t *peer_lsn = durability == MIRROR_DURABILITY_RECEIVED ?
+                             &mirror->peer_received_lsn :
+                             &mirror->peer_applied_lsn;
+
+    deadline = mirror_get_time_usec() +
+               (mirror->conn->hold_time ? mirror->conn->hold_time : 1000) *
+               1000ULL;
+    ts.tv_sec = deadline / 1000000;
+    ts.tv_nsec = (deadline % 1000000) * 1000;
+
+    pthread_mutex_lock(&mirror->ack_mutex);
+    mirror->ack_waiters++;
+
+    while (*peer_lsn < lsn) {
+        if (mirror->stop ||
+            pthread_cond_timedwait(&mirror->ack_cond, &mirror->ack_mutex,
+                                   &ts) == ETIMEDOUT) {
+            acked = *peer_lsn >= lsn;
+            break;
+        }
+    }
+
+    mirror->ack_waiters--;
+    if (!acked) mirror->stats.ack_timeouts++;
+    pthread_mutex_unlock(&mirror->ack_mutex);
+    return acked;
+}
+
+/* The peer recvd, and applied, records up to these lsns. Acks arrive
+ * on both the data socket and the KA msgs, in any order */
+static void
+mirror_ack_update(mirror_t *mirror, mirror_lsn_t received_lsn,
+                  mirror_lsn_t applied_lsn) {
+
+    /* Applied implies recvd */
+    if (received_lsn < applied_lsn) received_lsn = applied_lsn;
+
+    pthread_mutex_lock(&mirror->ack_mutex);
+
+    if (received_lsn <= mirror->peer_received_lsn &&
+        applied_lsn <= mirror->peer_applied_lsn) {
+        pthread_mutex_unlock(&mirror->ack_mutex);
+        return;
+    }
+    if (received_lsn > mirror->peer_received_lsn) {
+        mirror->peer_received_lsn = received_lsn;
+    }
+    if (applied_lsn > mirror->peer_applied_lsn) {
+        mirror->peer_applied_lsn = applied_lsn;
+    }
+    if (mirror->ack_waiters) {
+        pthread_cond_broadcast(&mirror->ack_cond);
+    }
+    pthread_mutex_unlock(&mirror->ack_mutex);
+}
+
+/* Flags asking the peer to ack a record as durable as asked */
+static uint16_t
+mirror_durability_flags(mirror_durability_t durability) {
+
+    if (durability == MIRROR_DURABILITY_RECEIVED) {
+        return MIRROR_F_ACK_RECEIVED;
+    }
+    if (durability == MIRROR_DURABILITY_APPLIED) {
+        return MIRROR_F_ACK_APPLIED;
+    }
+    return 0;
+}
+
+bool
+mirror_append_durable(mirror_t *mirror, uint64_t obj_id, uint16_t op,
+                      const void *payload, uint32_t payload_len,
+                      mirror_durability_t durability) {
+
+    bool rc = true;
+    uint16_t flags = 0;
+    uint64_t start;
+    mirror_lsn_t lsn;
+
+    if (payload_len > mirror->max_dgram_size - sizeof(mirror_dgram_hdr_t) -
+                      sizeof(mirror_record_hdr_t)) {
+        printf("Error : mirror record of %u bytes is too large\n",
+               payload_len);
+        return false;
+    }
+
+    assert(durability < MIRROR_DURABILITY_MAX);
+    start = mirror_get_time_usec();
+
+    pthread_mutex_lock(&mirror->log_mutex);
+
+    mirror->stats.appended_records++;
+    mirror->stats.appended_bytes += payload_len;
+
+    if (durability == MIRROR_DURABILITY_ASYNC &&
+        mirror->coalesce_window_usec) {
+        mirror_stage(mirror, obj_id, op, payload, payload_len);
+        pthread_mutex_unlock(&mirror->log_mutex);
+        goto done;
+    }
+
+    flags = mirror_durability_flags(durability);
+
+    /* A durable record must not overtake the staged ones, the peer
+     * acks lsns and they get theirs first */
+    if (flags && mirror->n_staged) {
+        mirror_staged_flush(mirror, NULL);
+    }
+
+    if (!mirror_log_wait_room(mirror,
+            sizeof(mirror_record_hdr_t) + payload_len)) {
+        pthread_mutex_unlock(&mirror->log_mutex);
+        return false;
+    }
+
+    mirror_log_put(mirror, obj_id, op, payload, payload_len,
+                   mirror_get_wall_time_usec(), flags);
+    lsn = mirror->next_lsn - 1;
+    mirror_wake_sender(mirror);
+    pthread_mutex_unlock(&mirror->log_mutex);
+
+    if (flags) {
+        rc = mirror_wait_ack(mirror, lsn, durability);
+    }
+
+done:
+    conn_mgmt_hist_add(&mirror->stats.commit_latency[durability],
+                       mirror_get_time_usec() - start);
+    return rc;
+}
+
+bool
+mirror_append_txn(mirror_t *mirror, const mirror_txn_rec_t *recs,
+                  uint32_t n_recs, mirror_durability_t durability) {
+
+    bool rc = true;
+    uint32_t i;
+    uint16_t flags;
+    uint64_t start, timestamp, len = 0;
+    mirror_lsn_t lsn;
+
+    assert(durability < MIRROR_DURABILITY_MAX);
+    if (!n_recs) return true;
+
+    for (i = 0; i < n_recs; i++) {
+        if (recs[i].payload_len > mirror->max_dgram_size -
+                sizeof(mirror_dgram_hdr_t) - sizeof(mirror_record_hdr_t)) {
+            printf("Error : mirror record of %u bytes is too large\n",
+                   recs[i].payload_len);
+            return false;
+        }
+        len += sizeof(mirror_record_hdr_t) + recs[i].payload_len;
+    }
+    /* Room for it must not depend on the held back records of a sync */
+    if (len > mirror->log_size / 2) {
+        printf("Error : mirror transaction of %lu bytes is too large\n",
+               len);
+        return false;
+    }
+
+    start = mirror_get_time_usec();
+
+    pthread_mutex_lock(&mirror->log_mutex);
+
+    mirror->stats.appended_records += n_recs;
+    for (i = 0; i < n_recs; i++) {
+        mirror->stats.appended_bytes += recs[i].payload_len;
+    }
+
+    /* Staged records were appended before the transaction, they get
+     * their lsns first */
+    if (mirror->n_staged) {
+        mirror_staged_flush(mirror, NULL);
+    }
+
+    if (!mirror_log_wait_room(mirror, len)) {
+        pthread_mutex_unlock(&mirror->log_mutex);
+        return false;
+    }
+
+    timestamp = mirror_get_wall_time_usec();
+    for (i = 0; i < n_recs; i++) {
+        flags = MIRROR_F_TXN;
+        if (i == n_recs - 1) {
+            flags |= MIRROR_F_TXN_END | mirror_durability_flags(durability);
+        }
+        mirror_log_put(mirror, recs[i].obj_id, recs[i].op, recs[i].payload,
+                       recs[i].payload_len, timestamp, flags);
+    }
+    lsn = mirror->next_lsn - 1;
+    mirror_wake_sender(mirror);
+    pthread_mutex_unlock(&mirror->log_mutex);
+
+    if (durability != MIRROR_DURABILITY_ASYNC) {
+        rc = mirror_wait_ack(mirror, lsn, durability);
+    }
+
+    conn_mgmt_hist_add(&mirror->stats.commit_latency[durability],
+                       mirror_get_time_usec() - start);
+    return rc;
+}
+
+bool
+mirror_append(mirror_t *mirror, uint64_t obj_id, uint16_t op,
+              const void *payload, uint32_t payload_len) {
+
+    return mirror_append_durable(mirror, obj_id, op, payload, payload_len,
+               op < MIRROR_MAX_OPS ? mirror->op_durability[op] :
+                                     MIRROR_DURABILITY_ASYNC);
+}
+
+void
+mirror_set_op_durability(mirror_t *mirror, uint16_t op,
+                         mirror_durability_t durability) {
+
+    assert(op < MIRROR_MAX_OPS);
+    assert(durability < MIRROR_DURABILITY_MAX);
+    mirror->op_durability[op] = durability;
+}
+
+void
+mirror_set_op_ordered(mirror_t *mirror, uint16_t op, bool ordered) {
+
+    assert(op < MIRROR_MAX_OPS);
+    mirror->op_ordered[op] = ordered;
+}
+
+void
+mirror_set_coalescing(mirror_t *mirror, uint32_t window_usec,
+                      uint32_t batch_bytes) {
+
+    if (!batch_bytes) batch_bytes = MIRROR_COALESCE_DEFAULT_BYTES;
+    /* A batch must fit in the log with room to spare */
+    if (batch_bytes > mirror->log_size / 4) {
+        batch_bytes = mirror->log_size / 4;
+    }
+
+    pthread_mutex_lock(&mirror->log_mutex);
+
+    if (window_usec && !mirror->staged) {
+        mirror->staged = calloc(MIRROR_COALESCE_MAX_RECORDS,
+                                sizeof(mirror_staged_rec_t));
+        mirror->staged_hash = calloc(MIRROR_STAGED_HASH_SIZE,
+                                     sizeof(uint32_t));
+        mirror->staged_head = mirror->staged_tail = -1;
+    }
+    if (!window_usec) {
+        mirror_staged_flush(mirror, NULL);
+    }
+
+    mirror->coalesce_window_usec = window_usec;
+    mirror->coalesce_batch_bytes = batch_bytes;
+    /* The sender may be asleep on the old window */
+    mirror_wake_sender(mirror);
+    pthread_mutex_unlock(&mirror->log_mutex);
+}
+
+void
+mirror_flush(mirror_t *mirror) {
+
+    pthread_mutex_lock(&mirror->log_mutex);
+    if (mirror->staged) {
+        mirror_staged_flush(mirror, NULL);
+    }
+    pthread_mutex_unlock(&mirror->log_mutex);
+}
+
+/* Packs as many whole records from pos as fit into one datagram,
+ * returns the position past the last one packed */
+static uint64_t
+mirror_pack_dgram(mirror_t *mirror, uint64_t pos, uint64_t tail,
+                  unsigned char *dgram, uint32_t *dgram_len) {
+
+    uint32_t rec_len;
+    uint16_t n_records = 0;
+    uint16_t flags = 0;
+    mirror_record_hdr_t rec_hdr;
+    mirror_dgram_hdr_t *dgram_hdr = (mirror_dgram_hdr_t *)dgram;
+    uint32_t offset = sizeof(mirror_dgram_hdr_t);
+
+    while (pos < tail) {
+
+        mirror_log_read(mirror, pos, &rec_hdr, sizeof(rec_hdr));
+        rec_len = sizeof(rec_hdr) + ntohl(rec_hdr.payload_len);
+
+        if (offset + rec_len > mirror->max_dgram_size) break;
+
+        mirror_log_read(mirror, pos, dgram + offset, rec_len);
+        offset += rec_len;
+        pos += rec_len;
+        n_records++;
+        flags |= ntohs(rec_hdr.flags);
+        mirror->stats.sent_bytes += rec_len - sizeof(rec_hdr);
+    }
+
+    dgram_hdr->msg_type = MIRROR_MSG_DATA;
+    dgram_hdr->flags = flags;
+    dgram_hdr->n_records = htons(n_records);
+    dgram_hdr->reserved = 0;
+    *dgram_len = offset;
+    mirror->stats.sent_records += n_records;
+    return pos;
+}
+
+/* Sends the datagrams of msgs, each with its single iov, returns the
+ * no sent */
+static uint32_t
+mirror_send_dgrams(mirror_t *mirror, struct mmsghdr *msgs,
+                   uint32_t n_dgrams) {
+
+    int rc;
+    uint32_t n_sent;
+
+    /* A transport takes the datagrams one at a time, and batches the
+     * syscalls, if any, itself */
+    for (n_sent = 0; mirror->xport && n_sent < n_dgrams; n_sent++) {
+        if (!xport_sendv(mirror->xport, msgs[n_sent].msg_hdr.msg_iov, 1)) {
+            break;
+        }
+    }
+
+    for (n_sent = mirror->xport ? n_sent : 0;
+         !mirror->xport && n_sent < n_dgrams; ) {
+        rc = sendmmsg(mirror->sock_fd, msgs + n_sent,
+                      n_dgrams - n_sent, 0);
+        mirror->stats.tx_syscalls++;
+        if (rc < 0) {
+            if (errno == EINTR || errno == ENOBUFS) continue;
+            break;
+        }
+        n_sent += rc;
+    }
+    mirror->stats.tx_dgrams += n_sent;
+    return n_sent;
+}
+
+/* Control msgs, acks and sync msgs */
+static bool
+mirror_send_msg(mirror_t *mirror, const void *msg, uint32_t msg_len) {
+
+    if (mirror->xport) {
+        return xport_send(mirror->xport, msg, msg_len);
+    }
+    return send(mirror->sock_fd, msg, msg_len, 0) == msg_len;
+}
+
+static void
+mirror_send_sync_msg(mirror_t *mirror, uint8_t msg_type,
+                     uint64_t n_records) {
+
+    mirror_sync_msg_t sync_msg;
+
+    memset(&sync_msg, 0, sizeof(sync_msg));
+    sync_msg.msg_type = msg_type;
+    sync_msg.start_lsn = htobe64(mirror->sync_start_lsn);
+    sync_msg.ready_lsn = htobe64(mirror->sync_ready_lsn);
+    sync_msg.n_records = htobe64(n_records);
+    sync_msg.log_id = htobe64(mirror->log_id);
+    mirror_send_msg(mirror, &sync_msg, sizeof(sync_msg));
+}
+
+static void
+mirror_sync_set_state(mirror_t *mirror, mirror_sync_state_t state) {
+
+    if (mirror->sync_state == state) return;
+    mirror->sync_state = state;
+    if (mirror->sync_event_cb) {
+        mirror->sync_event_cb(mirror, mirror->sync_cb_arg, state);
+    }
+}
+
+/* Packs as many snapshot objects as fit into one datagram. An object
+ * read from the app which did not fit waits in obj for the next one.
+ * Returns false once the app has no more objects, or with *failed set
+ * if the app broke the snapshot_cb contract */
+static bool
+mirror_pack_snapshot_dgram(mirror_t *mirror, uint64_t *cursor,
+                           mirror_record_hdr_t *obj, unsigned char *payload,
+                           bool *obj_pending, unsigned char *dgram,
+                           uint32_t *dgram_len, uint64_t *n_records,
+                           bool *failed) {
+
+    bool more = true;
+    uint16_t op, n = 0;
+    uint32_t payload_len;
+    uint64_t obj_id;
+    uint32_t offset = sizeof(mirror_dgram_hdr_t);
+    uint32_t max_len = mirror->max_dgram_size - sizeof(mirror_dgram_hdr_t) -
+                       sizeof(mirror_record_hdr_t);
+    mirror_dgram_hdr_t *dgram_hdr = (mirror_dgram_hdr_t *)dgram;
+
+    while (1) {
+
+        if (!*obj_pending) {
+            more = mirror->snapshot_cb(mirror, mirror->sync_cb_arg, cursor,
+                                       &obj_id, &op, payload, &payload_len,
+                                       max_len);
+            if (!more) break;
+            if (payload_len > max_len) {
+                printf("Error : mirror %s : snapshot object %lu of %u bytes, "
+                       "max %u, giving up the sync\n",
+                       mirror->conn->conn_name, obj_id, payload_len, max_len);
+                *failed = true;
+                more = false;
+                break;
+            }
+            memset(obj, 0, sizeof(*obj));
+            obj->obj_id = htobe64(obj_id);
+            obj->timestamp = htobe64(mirror_get_wall_time_usec());
+            obj->payload_len = htonl(payload_len);
+            obj->op = htons(op);
+            *obj_pending = true;
+        }
+
+        payload_len = ntohl(obj->payload_len);
+        if (offset + sizeof(*obj) + payload_len > mirror->max_dgram_size) {
+            break;
+        }
+
+        memcpy(dgram + offset, obj, sizeof(*obj));
+        memcpy(dgram + offset + sizeof(*obj), payload, payload_len);
+        offset += sizeof(*obj) + payload_len;
+        *obj_pending = false;
+        n++;
+        mirror->stats.snapshot_bytes += payload_len;
+    }
+
+    dgram_hdr->msg_type = MIRROR_MSG_SNAPSHOT;
+    dgram_hdr->flags = 0;
+    dgram_hdr->n_records = htons(n);
+    dgram_hdr->reserved = 0;
+    *dgram_len = offset;
+    *n_records += n;
+    return more || *obj_pending;
+}
+
+/* Checks the records held back from hold_pos on against the limit, and
+ * moves to the log staged batches whose latency budget ran out.
+ * Returns false if the sync must be given up */
+static bool
+mirror_sync_check_held(mirror_t *mirror, uint64_t hold_pos) {
+
+    uint64_t held, now;
+
+    pthread_mutex_lock(&mirror->log_mutex);
+
+    held = mirror->log_tail - hold_pos;
+    if (held > mirror->stats.sync_peak_held_bytes) {
+        mirror->stats.sync_peak_held_bytes = held;
+    }
+    if (held > mirror->sync_max_held_bytes || mirror->sync_abort ||
+        mirror->stop) {
+        pthread_mutex_unlock(&mirror->log_mutex);
+        return false;
+    }
+
+    /* Staged batches whose latency budget ran out still make it to the
+     * log, if it has room without the sender */
+    now = mirror_get_time_usec();
+    if (mirror->n_staged &&
+        now >= mirror->batch_open_time + mirror->coalesce_window_usec &&
+        mirror->log_tail + mirror->staged_bytes +
+            (mirror->n_staged * sizeof(mirror_record_hdr_t)) -
+            mirror->log_head <= mirror->log_size) {
+        mirror_staged_flush(mirror, &mirror->stats.time_flushes);
+    }
+    pthread_mutex_unlock(&mirror->log_mutex);
+    return true;
+}
+
+/* Live snapshot, read from the app's objects on the sender thread.
+ * Returns false if given up */
+static bool
+mirror_sync_stream_live(mirror_t *mirror, uint64_t hold_pos,
+                        struct iovec *iovs, struct mmsghdr *msgs,
+                        unsigned char *payload, uint64_t *n_records) {
+
+    bool more = true, obj_pending = false, failed = false;
+    uint32_t n_dgrams, dgram_len;
+    uint64_t cursor = 0;
+    mirror_record_hdr_t obj;
+
+    while (more) {
+
+        for (n_dgrams = 0; more && n_dgrams < MIRROR_IO_BATCH_SIZE; ) {
+            more = mirror_pack_snapshot_dgram(mirror, &cursor, &obj, payload,
+                       &obj_pending, iovs[n_dgrams].iov_base, &dgram_len,
+                       n_records, &failed);
+            if (dgram_len == sizeof(mirror_dgram_hdr_t)) continue;
+            iovs[n_dgrams++].iov_len = dgram_len;
+        }
+        if (failed) return false;
+        if (n_dgrams) mirror_send_dgrams(mirror, msgs, n_dgrams);
+
+        if (!mirror_sync_check_held(mirror, hold_pos)) return false;
+    }
+    return true;
+}
+
+/* Forked child : packs the objects as they were at the fork into
+ * snapshot datagrams, and writes them to the parent on fd. Touches no
+ * lock and no thread of the parent's */
+static void
+mirror_sync_child_run(mirror_t *mirror, int fd, struct iovec *iovs,
+                      struct mmsghdr *msgs, unsigned char *payload) {
+
+    bool more = true, obj_pending = false, failed = false;
+    int rc;
+    uint32_t n_dgrams, n_sent, dgram_len;
+    uint64_t cursor = 0, n_records = 0;
+    mirror_record_hdr_t obj;
+
+    while (more) {
+
+        for (n_dgrams = 0; more && n_dgrams < MIRROR_IO_BATCH_SIZE; ) {
+            more = mirror_pack_snapshot_dgram(mirror, &cursor, &obj, payload,
+                       &obj_pending, iovs[n_dgrams].iov_base, &dgram_len,
+                       &n_records, &failed);
+            if (dgram_len == sizeof(mirror_dgram_hdr_t)) continue;
+            iovs[n_dgrams++].iov_len = dgram_len;
+        }
+        /* The parent sees the child fail, and gives up the sync */
+        if (failed) {
+            fflush(stdout);
+            _exit(1);
+        }
+
+        for (n_sent = 0; n_sent < n_dgrams; ) {
+            rc = sendmmsg(fd, msgs + n_sent, n_dgrams - n_sent, 0);
+            if (rc < 0) {
+                if (errno == EINTR) continue;
+                /* The parent gave up on us */
+                _exit(1);
+            }
+            n_sent += rc;
+        }
+    }
+    _exit(0);
+}
+
+/* Forks the child of a snapshot, with the log locked : the objects the
+ * child sees are those of the records before sync_start_lsn. Returns
+ * the child's pid with our end of its socketpair in *fd, or -1 */
+static pid_t
+mirror_sync_fork(mirror_t *mirror, struct iovec *iovs,
+                 struct mmsghdr *msgs, unsigned char *payload, int *fd) {
+
+    int fds[2];
+    pid_t child;
+    uint64_t start;
+
+    /* Keeps the datagrams whole */
+    if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, fds) < 0) {
+        printf("Error : mirror %s : snapshot socketpair failed, errno = %d\n",
+               mirror->conn->conn_name, errno);
+        return -1;
+    }
+
+    start = mirror_get_time_usec();
+    child = fork();
+    if (child == 0) {
+        close(fds[0]);
+        mirror_sync_child_run(mirror, fds[1], iovs, msgs, payload);
+    }
+    mirror->stats.last_fork_usec = mirror_get_time_usec() - start;
+    if (mirror->stats.last_fork_usec > mirror->stats.max_fork_usec) {
+        mirror->stats.max_fork_usec = mirror->stats.last_fork_usec;
+    }
+    close(fds[1]);
+
+    if (child < 0) {
+        printf("Error : mirror %s : snapshot fork failed, errno = %d\n",
+               mirror->conn->conn_name, errno);
+        close(fds[0]);
+        return -1;
+    }
+    *fd = fds[0];
+    return child;
+}
+
+/* Forked snapshot : sends what the child writes to fd until it is done,
+ * and reaps it. Returns false if given up, or if the child failed */
+static bool
+mirror_sync_stream_forked(mirror_t *mirror, uint64_t hold_pos, pid_t child,
+                          int fd, struct iovec *iovs, struct mmsghdr *msgs,
+                          uint64_t *n_records) {
+
+    int rc, status = 0;
+    uint32_t i, n;
+    bool done = false, given_up = false;
+    struct pollfd pfd;
+    mirror_dgram_hdr_t *dgram_hdr;
+
+    pfd.fd = fd;
+    pfd.events = POLLIN;
+
+    while (!done) {
+
+        /* Wakes up now and then to check on the held back records */
+        if (poll(&pfd, 1, CONN_MGMT_TIMER_TIC_MSEC) > 0) {
+
+            for (i = 0; i < MIRROR_IO_BATCH_SIZE; i++) {
+                iovs[i].iov_len = mirror->max_dgram_size;
+            }
+            rc = recvmmsg(fd, msgs, MIRROR_IO_BATCH_SIZE, MSG_DONTWAIT, NULL);
+            if (rc < 0 && errno != EAGAIN && errno != EINTR) done = true;
+
+            for (i = 0; i < (uint32_t)(rc > 0 ? rc : 0); i++) {
+                /* The child is done, and closed its end */
+                if (!msgs[i].msg_len) {
+                    done = true;
+                    break;
+                }
+                iovs[i].iov_len = msgs[i].msg_len;
+                dgram_hdr = (mirror_dgram_hdr_t *)iovs[i].iov_base;
+                n = ntohs(dgram_hdr->n_records);
+                *n_records += n;
+                mirror->stats.snapshot_bytes += msgs[i].msg_len -
+                    sizeof(mirror_dgram_hdr_t) -
+                    (n * sizeof(mirror_record_hdr_t));
+            }
+            if (i) mirror_send_dgrams(mirror, msgs, i);
+            if (rc == 0) done = true;
+        }
+
+        if (!mirror_sync_check_held(mirror, hold_pos)) {
+            given_up = true;
+            kill(child, SIGKILL);
+            break;
+        }
+    }
+
+    close(fd);
+    while (waitpid(child, &status, 0) < 0 && errno == EINTR);
+
+    return !given_up && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+/* Streams the snapshot to the peer, on the sender thread. Records
+ * appended meanwhile stay in the log from hold_pos on, and go out once
+ * the snapshot is done (or given up) */
+static void
+mirror_sync_run(mirror_t *mirror, struct iovec *iovs,
+                struct mmsghdr *msgs) {
+
+    bool aborted;
+    int fd = -1;
+    pid_t child = -1;
+    uint64_t n_records = 0, hold_pos;
+    unsigned char *payload;
+
+    while (mirror->xport && !xport_is_ready(mirror->xport) &&
+           !mirror->stop) {
+        usleep(1000);
+    }
+
+    payload = malloc(mirror->max_dgram_size);
+
+    pthread_mutex_lock(&mirror->log_mutex);
+
+    /* Whatever was appended so far is in the app's objects already,
+     * the snapshot covers it : unsent records and staged ones go */
+    mirror->log_head = mirror->log_tail;
+    mirror_staged_flush(mirror, NULL);
+    mirror->log_head = mirror->log_tail;
+    pthread_cond_broadcast(&mirror->log_room_cond);
+
+    hold_pos = mirror->log_tail;
+    mirror->sync_requested = false;
+    mirror->sync_abort = false;
+    mirror->sync_start_lsn = mirror->next_lsn;
+    mirror->sync_ready_lsn = 0;
+    mirror->sync_start_time = mirror_get_time_usec();
+    mirror->stats.syncs++;
+    mirror->resume_deadline = 0;
+
+    /* The journal's records are in the snapshot too */
+    if (mirror->journal) {
+        mirror_journal_reset(mirror->journal, mirror->log_id,
+                             mirror->next_lsn);
+        mirror->journal_pos = mirror_journal_tail(mirror->journal);
+    }
+
+    /* No append between the start lsn and the fork. A fork which
+     * failed leaves the snapshot to be read live */
+    if (mirror->snapshot_mode == MIRROR_SNAPSHOT_FORK) {
+        child = mirror_sync_fork(mirror, iovs, msgs, payload, &fd);
+    }
+    pthread_mutex_unlock(&mirror->log_mutex);
+
+    mirror_sync_set_state(mirror, MIRROR_SYNC_SNAPSHOT);
+
+    mirror->sync_start_bytes = mirror->stats.snapshot_bytes;
+    mirror_send_sync_msg(mirror, MIRROR_MSG_SYNC_BEGIN, 0);
+
+    if (child > 0) {
+        aborted = !mirror_sync_stream_forked(mirror, hold_pos, child, fd,
+                                             iovs, msgs, &n_records);
+    } else {
+        aborted = !mirror_sync_stream_live(mirror, hold_pos, iovs, msgs,
+                                           payload, &n_records);
+    }
+
+    free(payload);
+    mirror->stats.snapshot_records += n_records;
+
+    if (!aborted) {
+        pthread_mutex_lock(&mirror->log_mutex);
+        mirror->sync_ready_lsn = mirror->next_lsn - 1;
+        pthread_mutex_unlock(&mirror->log_mutex);
+        mirror->stats.last_snapshot_usec =
+            mirror_get_time_usec() - mirror->sync_start_time;
+        mirror->stats.last_snapshot_bytes =
+            mirror->stats.snapshot_bytes - mirror->sync_start_bytes;
+        mirror_sync_set_state(mirror, MIRROR_SYNC_CATCHUP);
+    } else {
+        mirror->stats.sync_aborts++;
+        mirror_sync_set_state(mirror, MIRROR_SYNC_NONE);
+        if (!mirror->stop && !mirror->sync_abort) {
+            printf("Error : mirror %s : sync aborted, %lu bytes of records"
+                   " held back (limit %lu)\n", mirror->conn->conn_name,
+                   mirror->log_tail - hold_pos, mirror->sync_max_held_bytes);
+        }
+    }
+    mirror_send_sync_msg(mirror,
+        aborted ? MIRROR_MSG_SYNC_ABORT : MIRROR_MSG_SYNC_END, n_records);
+}
+
+/* Journal of the master, on the sender thread. Records sent from the
+ * log are written to the journal once sent, records the peer cannot
+ * take now are moved to it and sent from there : the journal always
+ * holds a run of lsns, up to the last record which left the log */
+
+/* The journal is full : its records go, and with them those not sent
+ * yet if unsent, the peer must be synced to get them */
+static void
+mirror_journal_overflow(mirror_t *mirror, mirror_lsn_t lsn, bool unsent) {
+
+    mirror->stats.journal_overflows++;
+    mirror_journal_reset(mirror->journal, mirror->log_id, lsn);
+    mirror->journal_pos = mirror_journal_tail(mirror->journal);
+
+    if (!unsent) return;
+
+    printf("Error : mirror %s : journal full, records from lsn %lu on"
+           " dropped\n", mirror->conn->conn_name, lsn);
+    /* Read by none but us, the log mutex may be held */
+    if (mirror->snapshot_cb && mirror->conn_status == COMM_MGMT_CONN_UP &&
+        !mirror->resume_deadline) {
+        mirror->sync_requested = true;
+    }
+}
+
+/* Writes the records of [pos, tail) of the log to the journal, those
+ * not sent yet if unsent. [pos, tail) is ours */
+static void
+mirror_journal_spill(mirror_t *mirror, uint64_t pos, uint64_t tail,
+                     bool unsent) {
+
+    uint32_t rec_len;
+    unsigned char *dst;
+    mirror_lsn_t lsn;
+    mirror_record_hdr_t rec_hdr;
+    mirror_journal_t *journal = mirror->journal;
+
+    while (pos < tail) {
+
+        mirror_log_read(mirror, pos, &rec_hdr, sizeof(rec_hdr));
+        rec_len = sizeof(rec_hdr) + ntohl(rec_hdr.payload_len);
+        lsn = be64toh(rec_hdr.lsn);
+
+        /* Records which left the log some other way, a sync dropped
+         * them say : the run starts over */
+        if (lsn != journal->next_lsn) {
+            mirror_journal_reset(journal, mirror->log_id, lsn);
+            mirror->journal_pos = mirror_journal_tail(journal);
+        }
+
+        dst = mirror_journal_reserve(journal, rec_len);
+        if (!dst) {
+            mirror_journal_overflow(mirror, lsn, unsent);
+            dst = mirror_journal_reserve(journal, rec_len);
+        }
+        if (dst) {
+            mirror_log_read(mirror, pos, dst, rec_len);
+            mirror_journal_commit(journal, lsn);
+            mirror->stats.journal_records++;
+            mirror->stats.journal_bytes += rec_len;
+        }
+        pos += rec_len;
+    }
+    if (!unsent) mirror->journal_pos = mirror_journal_tail(journal);
+}
+
+/* The master sends from its journal, the backup's journal only keeps
+ * what came in for a restart */
+static bool
+mirror_journal_sends(mirror_t *mirror) {
+
+    return mirror->journal &&
+           mirror->conn->mastership_state == COMM_MGMT_MASTER;
+}
+
+/* Under the log mutex : records wait in the journal already, or the
+ * peer cannot take those of the log now, or they are too many */
+static bool
+mirror_journal_spill_now(mirror_t *mirror) {
+
+    return mirror->journal_pos != mirror_journal_tail(mirror->journal) ||
+           mirror->conn_status != COMM_MGMT_CONN_UP ||
+           mirror->resume_deadline ||
+           mirror->log_tail - mirror->log_head > mirror->journal_high_water;
+}
+
+/* Under the log mutex : the journal has records for the peer, which
+ * can take them */
+static bool
+mirror_journal_pending(mirror_t *mirror) {
+
+    return mirror_journal_sends(mirror) &&
+           mirror->journal_pos != mirror_journal_tail(mirror->journal) &&
+           mirror->conn_status == COMM_MGMT_CONN_UP &&
+           !mirror->resume_deadline;
+}
+
+/* Packs as many whole records of the journal from journal_pos as fit
+ * into one datagram */
+static void
+mirror_pack_journal_dgram(mirror_t *mirror, unsigned char *dgram,
+                          uint32_t *dgram_len) {
+
+    uint32_t rec_len;
+    uint16_t n_records = 0;
+    uint16_t flags = 0;
+    uint64_t pos, lsn;
+    const unsigned char *rec;
+    mirror_dgram_hdr_t *dgram_hdr = (mirror_dgram_hdr_t *)dgram;
+    uint32_t offset = sizeof(mirror_dgram_hdr_t);
+
+    while (1) {
+
+        pos = mirror->journal_pos;
+        rec = mirror_journal_read(mirror->journal, &pos, &lsn, &rec_len);
+        if (!rec || offset + rec_len > mirror->max_dgram_size) break;
+
+        memcpy(dgram + offset, rec, rec_len);
+        mirror->journal_pos = pos;
+        offset += rec_len;
+        n_records++;
+        flags |= ntohs(((mirror_record_hdr_t *)rec)->flags);
+        mirror->stats.sent_bytes += rec_len - sizeof(mirror_record_hdr_t);
+    }
+
+    dgram_hdr->msg_type = MIRROR_MSG_DATA;
+    dgram_hdr->flags = flags;
+    dgram_hdr->n_records = htons(n_records);
+    dgram_hdr->reserved = 0;
+    *dgram_len = offset;
+    mirror->stats.sent_records += n_records;
+    mirror->stats.journal_sent_records += n_records;
+}
+
+/* Sends a batch of the journal's records if the peer can take them,
+ * and drops the segments it applied */
+static void
+mirror_journal_send(mirror_t *mirror, struct iovec *iovs,
+                    struct mmsghdr *msgs) {
+
+    uint32_t n_dgrams, dgram_len;
+    uint64_t tail = mirror_journal_tail(mirror->journal);
+
+    if (mirror->conn_status == COMM_MGMT_CONN_UP && !mirror->resume_deadline &&
+        mirror->journal_pos != tail) {
+
+        if (mirror->xport && !xport_is_ready(mirror->xport)) {
+            usleep(1000);
+            return;
+        }
+        for (n_dgrams = 0; mirror->journal_pos != tail &&
+             n_dgrams < MIRROR_IO_BATCH_SIZE; n_dgrams++) {
+            mirror_pack_journal_dgram(mirror, iovs[n_dgrams].iov_base,
+                                      &dgram_len);
+            iovs[n_dgrams].iov_len = dgram_len;
+        }
+        mirror_send_dgrams(mirror, msgs, n_dgrams);
+    }
+
+    mirror_journal_trim(mirror->journal, mirror->peer_applied_lsn,
+                        mirror->journal_pos);
+}
+
+/* Resume msgs are sent once the transport is up, the peer just came up */
+static void
+mirror_send_resume_msg(mirror_t *mirror, mirror_lsn_t start_lsn,
+                       uint64_t log_id) {
+
+    mirror_sync_msg_t sync_msg;
+
+    while (mirror->xport && !xport_is_ready(mirror->xport) &&
+           !mirror->stop) {
+        usleep(1000);
+    }
+
+    memset(&sync_msg, 0, sizeof(sync_msg));
+    sync_msg.msg_type = MIRROR_MSG_SYNC_RESUME;
+    sync_msg.start_lsn = htobe64(start_lsn);
+    sync_msg.log_id = htobe64(log_id);
+    mirror_send_msg(mirror, &sync_msg, sizeof(sync_msg));
+}
+
+/* Master : the peer which came up asks for the records from start_lsn
+ * on. It resumes from the journal if the journal has them all, and is
+ * synced if not */
+static void
+mirror_resume_run(mirror_t *mirror) {
+
+    bool covered;
+    mirror_journal_t *journal = mirror->journal;
+
+    pthread_mutex_lock(&mirror->log_mutex);
+
+    /* Synced since, or being synced */
+    if (mirror->sync_state != MIRROR_SYNC_NONE || mirror->sync_requested) {
+        pthread_mutex_unlock(&mirror->log_mutex);
+        return;
+    }
+
+    /* Every record appended so far in the journal */
+    mirror_journal_spill(mirror, mirror->log_head, mirror->log_tail, true);
+    mirror->log_head = mirror->log_tail;
+    pthread_cond_broadcast(&mirror->log_room_cond);
+
+    covered = mirror->resume_log_id == mirror->log_id &&
+              mirror->resume_lsn >= journal->first_lsn &&
+              mirror->resume_lsn <= journal->next_lsn &&
+              journal->next_lsn == mirror->next_lsn;
+    mirror->resume_deadline = 0;
+
+    if (!covered) {
+        mirror->sync_requested = mirror->snapshot_cb != NULL;
+        mirror->stats.resumes_refused++;
+        pthread_mutex_unlock(&mirror->log_mutex);
+        return;
+    }
+    mirror->journal_pos = mirror_journal_seek(journal, mirror->resume_lsn);
+    mirror->stats.resumes++;
+    pthread_mutex_unlock(&mirror->log_mutex);
+
+    mirror_send_resume_msg(mirror, mirror->resume_lsn, mirror->log_id);
+    mirror_sync_set_state(mirror, MIRROR_SYNC_READY);
+}
+
+/* Backup : asks the master to resume from the records we miss, of the
+ * log our state is of. The master syncs us if it cannot */
+static void
+mirror_resume_ask(mirror_t *mirror) {
+
+    mirror_send_resume_msg(mirror, mirror->rx_next_lsn, mirror->peer_log_id);
+}
+
+/* Under the log mutex : the peer which came up did not ask to resume in
+ * time, and is synced */
+static bool
+mirror_resume_expired(mirror_t *mirror) {
+
+    if (!mirror->resume_deadline ||
+        mirror_get_time_usec() < mirror->resume_deadline) {
+        return false;
+    }
+    mirror->resume_deadline = 0;
+    mirror->sync_requested = mirror->snapshot_cb != NULL;
+    return true;
+}
+
+static void *
+mirror_sender_fn(void *arg) {
+
+    uint32_t i, n_dgrams, dgram_len;
+    uint64_t pos, tail, sent_pos, deadline, flush_deadline;
+    struct timespec ts;
+    mirror_t *mirror = (mirror_t *)arg;
+    unsigned char *dgrams;
+    struct iovec iovs[MIRROR_IO_BATCH_SIZE];
+    struct mmsghdr msgs[MIRROR_IO_BATCH_SIZE];
+
+    dgrams = malloc(MIRROR_IO_BATCH_SIZE * MIRROR_MAX_DGRAM_SIZE);
+    memset(msgs, 0, sizeof(msgs));
+
+    for (i = 0; i < MIRROR_IO_BATCH_SIZE; i++) {
+        iovs[i].iov_base = dgrams + (i * MIRROR_MAX_DGRAM_SIZE);
+        msgs[i].msg_hdr.msg_iov = &iovs[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    while (1) {
+
+        pthread_mutex_lock(&mirror->log_mutex);
+        mirror_resume_expired(mirror);
+        while (mirror->log_head == mirror->log_tail && !mirror->stop &&
+               !mirror->sync_requested && !mirror->resume_requested &&
+               !mirror->resume_probe && !mirror_journal_pending(mirror)) {
+
+            mirror->sender_waiting = true;
+
+            if (mirror_resume_expired(mirror)) continue;
+
+            if (!mirror->n_staged && !mirror->resume_deadline) {
+                pthread_cond_wait(&mirror->log_data_cond, &mirror->log_mutex);
+                continue;
+            }
+
+            /* Nothing to send but a staged batch : sleep until its
+             * latency budget runs out, then flush it ourselves. Or
+             * until the peer which came up had its time to resume */
+            deadline = mirror->resume_deadline ? mirror->resume_deadline :
+                                                 UINT64_MAX;
+            if (mirror->n_staged) {
+                flush_deadline = mirror->batch_open_time +
+                                 mirror->coalesce_window_usec;
+                if (mirror_get_time_usec() >= flush_deadline) {
+                    mirror_staged_flush(mirror, &mirror->stats.time_flushes);
+                    continue;
+                }
+                if (flush_deadline < deadline) deadline = flush_deadline;
+            }
+            ts.tv_sec = deadline / 1000000;
+            ts.tv_nsec = (deadline % 1000000) * 1000;
+            pthread_cond_timedwait(&mirror->log_data_cond,
+                                   &mirror->log_mutex, &ts);
+        }
+        mirror->sender_waiting = false;
+        if (mirror->stop) {
+            pthread_mutex_unlock(&mirror->log_mutex);
+            break;
+        }
+        if (mirror->sync_requested) {
+            pthread_mutex_unlock(&mirror->log_mutex);
+            mirror_sync_run(mirror, iovs, msgs);
+            continue;
+        }
+        if (mirror->resume_requested) {
+            mirror->resume_requested = false;
+            pthread_mutex_unlock(&mirror->log_mutex);
+            if (mirror->conn->mastership_state == COMM_MGMT_MASTER) {
+                mirror_resume_run(mirror);
+            } else {
+                mirror_resume_ask(mirror);
+            }
+            continue;
+        }
+        if (mirror->resume_probe) {
+            mirror->resume_probe = false;
+            pthread_mutex_unlock(&mirror->log_mutex);
+            mirror_send_resume_msg(mirror, 0, mirror->log_id);
+            continue;
+        }
+        /* Records the peer cannot take now go to the journal, and the
+         * journal's records out once it can */
+        if (mirror_journal_sends(mirror) && mirror_journal_spill_now(mirror)) {
+            pos = mirror->log_head;
+            tail = mirror->log_tail;
+            pthread_mutex_unlock(&mirror->log_mutex);
+
+            mirror_journal_spill(mirror, pos, tail, true);
+
+            pthread_mutex_lock(&mirror->log_mutex);
+            mirror->log_head = tail;
+            pthread_cond_broadcast(&mirror->log_room_cond);
+            pthread_mutex_unlock(&mirror->log_mutex);
+
+            mirror_journal_send(mirror, iovs, msgs);
+            continue;
+        }
+        /* No backup to send to, and the sync it gets when it comes up
+         * covers these records : the log must not fill up meanwhile */
+        if (mirror->snapshot_cb &&
+            mirror->conn_status != COMM_MGMT_CONN_UP) {
+            mirror->stats.sync_skipped_bytes +=
+                mirror->log_tail - mirror->log_head;
+            mirror->log_head = mirror->log_tail;
+            pthread_cond_broadcast(&mirror->log_room_cond);
+            pthread_mutex_unlock(&mirror->log_mutex);
+            continue;
+        }
+        pos = mirror->log_head;
+        tail = mirror->log_tail;
+        pthread_mutex_unlock(&mirror->log_mutex);
+
+        /* Records stay in the log until the transport is up, a sender
+         * blocked in the transport would hold up mirror_destroy() */
+        while (mirror->xport && !xport_is_ready(mirror->xport) &&
+               !mirror->stop) {
+            if (mirror->snapshot_cb &&
+                mirror->conn_status != COMM_MGMT_CONN_UP) {
+                break;
+            }
+            usleep(1000);
+        }
+        if (mirror->xport && !xport_is_ready(mirror->xport)) continue;
+
+        /* [head, tail) is ours, appenders only write past tail */
+        for (n_dgrams = 0, sent_pos = pos;
+             pos < tail && n_dgrams < MIRROR_IO_BATCH_SIZE; n_dgrams++) {
+            pos = mirror_pack_dgram(mirror, pos, tail,
+                                    iovs[n_dgrams].iov_base, &dgram_len);
+            iovs[n_dgrams].iov_len = dgram_len;
+        }
+
+        mirror_send_dgrams(mirror, msgs, n_dgrams);
+
+        /* Kept for a peer which comes back without them */
+        if (mirror->journal) {
+            mirror_journal_spill(mirror, sent_pos, pos, false);
+            mirror_journal_trim(mirror->journal, mirror->peer_applied_lsn,
+                                mirror->journal_pos);
+        }
+
+        pthread_mutex_lock(&mirror->log_mutex);
+        mirror->log_head = pos;
+        pthread_cond_broadcast(&mirror->log_room_cond);
+        pthread_mutex_unlock(&mirror->log_mutex);
+    }
+
+    free(dgrams);
+    return NULL;
+}
+
+/* Apply workers. The recv thread hashes every record by obj_id onto a
+ * worker's ring (mirror_apply_dispatch) and hands the records over at
+ * the end of each batch of msgs (mirror_apply_publish). Transactions
+ * and sync msgs wait for all the workers to be done first
+ * (mirror_apply_drain) and are handled on the recv thread.
+ *
+ * applied_lsn is the lsn all records up to are applied : the last one
+ * handed over if the workers are idle, else no more than the last one
+ * a busy worker applied, as its next one is higher */
+
+static void
+mirror_send_ack(mirror_t *mirror);
+
+static void
+mirror_sync_check_ready(mirror_t *mirror);
+
+static inline mirror_apply_worker_t *
+mirror_apply_worker_of(mirror_t *mirror, uint64_t obj_id) {
+
+    return &mirror->apply_workers[((obj_id * 0x9E3779B97F4A7C15ULL) >> 32) %
+                                  mirror->n_apply_workers];
+}
+
+static mirror_lsn_t
+mirror_apply_watermark(mirror_t *mirror) {
+
+    uint32_t i;
+    mirror_lsn_t lsn, done_lsn;
+    mirror_apply_worker_t *worker;
+
+    /* The tails read next cover every record up to it */
+    lsn = __atomic_load_n(&mirror->dispatched_lsn, __ATOMIC_ACQUIRE);
+
+    for (i = 0; i < mirror->n_apply_workers; i++) {
+        worker = &mirror->apply_workers[i];
+        if (__atomic_load_n(&worker->head, __ATOMIC_ACQUIRE) ==
+            __atomic_load_n(&worker->tail, __ATOMIC_ACQUIRE)) {
+            continue;
+        }
+        done_lsn = __atomic_load_n(&worker->done_lsn, __ATOMIC_ACQUIRE);
+        if (done_lsn < lsn) lsn = done_lsn;
+    }
+    return lsn;
+}
+
+/* Moves applied_lsn up to what the workers applied, acks the peer if
+ * it waits for it, and completes a sync on its way */
+static void
+mirror_apply_progress(mirror_t *mirror) {
+
+    bool ack = false;
+    mirror_lsn_t lsn;
+
+    pthread_mutex_lock(&mirror->applied_mutex);
+
+    lsn = mirror_apply_watermark(mirror);
+    if (lsn > mirror->stats.applied_lsn) {
+        mirror->stats.applied_lsn = lsn;
+    }
+    if (mirror->ack_applied_lsn &&
+        mirror->stats.applied_lsn >= mirror->ack_applied_lsn) {
+        mirror->ack_applied_lsn = 0;
+        ack = true;
+    }
+    mirror_sync_check_ready(mirror);
+
+    pthread_mutex_unlock(&mirror->applied_mutex);
+
+    if (ack) mirror_send_ack(mirror);
+}
+
+/* Recv thread : hands the records queued so far over to the workers */
+static void
+mirror_apply_publish(mirror_t *mirror) {
+
+    uint32_t i;
+    mirror_apply_worker_t *worker;
+
+    for (i = 0; i < mirror->n_apply_workers; i++) {
+
+        worker = &mirror->apply_workers[i];
+        if (worker->pending_tail == worker->tail) continue;
+
+        __atomic_store_n(&worker->tail, worker->pending_tail,
+                         __ATOMIC_SEQ_CST);
+        /* Pairs with the worker setting data_waiting before it checks
+         * tail one last time */
+        if (__atomic_load_n(&worker->data_waiting, __ATOMIC_SEQ_CST)) {
+            pthread_mutex_lock(&worker->mutex);
+            pthread_cond_signal(&worker->data_cond);
+            pthread_mutex_unlock(&worker->mutex);
+        }
+    }
+    __atomic_store_n(&mirror->dispatched_lsn, mirror->pending_lsn,
+                     __ATOMIC_RELEASE);
+}
+
+/* Recv thread : waits for the worker's ring to have len bytes free, a
+ * whole ring for the worker to be idle. Returns false if it had to */
+static bool
+mirror_apply_wait_room(mirror_t *mirror, mirror_apply_worker_t *worker,
+                       uint64_t len) {
+
+    if (worker->pending_tail + len -
+        __atomic_load_n(&worker->head, __ATOMIC_ACQUIRE) <=
+        MIRROR_APPLY_RING_SIZE) {
+        return true;
+    }
+
+    mirror_apply_publish(mirror);
+
+    pthread_mutex_lock(&worker->mutex);
+    __atomic_store_n(&worker->room_waiting, true, __ATOMIC_SEQ_CST);
+    while (worker->pending_tail + len -
+           __atomic_load_n(&worker->head, __ATOMIC_SEQ_CST) >
+           MIRROR_APPLY_RING_SIZE) {
+        pthread_cond_wait(&worker->room_cond, &worker->mutex);
+    }
+    worker->room_waiting = false;
+    pthread_mutex_unlock(&worker->mutex);
+    return false;
+}
+
+/* Recv thread : waits for the workers to apply all they were handed */
+static void
+mirror_apply_drain(mirror_t *mirror) {
+
+    uint32_t i;
+    bool idle = true;
+
+    if (!mirror->n_apply_workers) return;
+
+    mirror_apply_publish(mirror);
+    for (i = 0; i < mirror->n_apply_workers; i++) {
+        idle &= mirror_apply_wait_room(mirror, &mirror->apply_workers[i],
+                                       MIRROR_APPLY_RING_SIZE);
+    }
+    if (!idle) mirror->stats.apply_barriers++;
+    mirror_apply_progress(mirror);
+}
+
+/* Recv thread : queues the record on the worker of its obj_id */
+static void
+mirror_apply_dispatch(mirror_t *mirror, mirror_record_hdr_t *rec_hdr,
+                      uint32_t payload_len) {
+
+    uint32_t rec_len = sizeof(mirror_record_hdr_t) + payload_len;
+    mirror_apply_worker_t *worker =
+        mirror_apply_worker_of(mirror, be64toh(rec_hdr->obj_id));
+
+    if (!mirror_apply_wait_room(mirror, worker, rec_len)) {
+        mirror->stats.apply_queue_stalls++;
+    }
+    mirror_ring_write(worker->ring, MIRROR_APPLY_RING_SIZE,
+                      worker->pending_tail, rec_hdr, rec_len);
+    worker->pending_tail += rec_len;
+}
+
+static void *
+mirror_apply_worker_fn(void *arg) {
+
+    uint16_t op, flags;
+    uint32_t payload_len, n_applied = 0;
+    uint64_t head, tail, offset, now, timestamp;
+    mirror_lsn_t lsn;
+    mirror_apply_fn cb;
+    unsigned char *payload;
+    mirror_record_hdr_t rec_hdr;
+    mirror_apply_worker_t *worker = (mirror_apply_worker_t *)arg;
+    mirror_t *mirror = worker->mirror;
+
+    head = worker->head;
+
+    while (true) {
+
+        tail = __atomic_load_n(&worker->tail, __ATOMIC_ACQUIRE);
+
+        if (head == tail) {
+
+            /* Idle, what we applied may complete an ack or a sync */
+            mirror_apply_progress(mirror);
+
+            pthread_mutex_lock(&worker->mutex);
+            __atomic_store_n(&worker->data_waiting, true, __ATOMIC_SEQ_CST);
+            while (__atomic_load_n(&worker->tail, __ATOMIC_SEQ_CST) == head &&
+                   !worker->stop) {
+                pthread_cond_wait(&worker->data_cond, &worker->mutex);
+            }
+            worker->data_waiting = false;
+            if (worker->stop && worker->tail == head) {
+                pthread_mutex_unlock(&worker->mutex);
+                break;
+            }
+            pthread_mutex_unlock(&worker->mutex);
+            continue;
+        }
+
+        now = mirror_get_wall_time_usec();
+
+        while (head != tail) {
+
+            mirror_ring_read(worker->ring, MIRROR_APPLY_RING_SIZE, head,
+                             &rec_hdr, sizeof(rec_hdr));
+            lsn = be64toh(rec_hdr.lsn);
+            op = ntohs(rec_hdr.op);
+            flags = ntohs(rec_hdr.flags);
+            payload_len = ntohl(rec_hdr.payload_len);
+
+            offset = (head + sizeof(rec_hdr)) & (MIRROR_APPLY_RING_SIZE - 1);
+            if (offset + payload_len <= MIRROR_APPLY_RING_SIZE) {
+                payload = worker->ring + offset;
+            } else {
+                mirror_ring_read(worker->ring, MIRROR_APPLY_RING_SIZE,
+                                 head + sizeof(rec_hdr), worker->scratch,
+                                 payload_len);
+                payload = worker->scratch;
+            }
+
+            cb = mirror->apply_cb[op];
+            if (cb) {
+                cb(mirror, be64toh(rec_hdr.obj_id), op, payload,
+                   payload_len, lsn);
+            }
+
+            /* Snapshot records have no lsn, nor a lag */
+            if (lsn) {
+                timestamp = be64toh(rec_hdr.timestamp);
+                conn_mgmt_hist_add(&worker->apply_lag,
+                                   now > timestamp ? now - timestamp : 0);
+                worker->applied_records++;
+                worker->applied_bytes += payload_len;
+                __atomic_store_n(&worker->done_lsn, lsn, __ATOMIC_RELEASE);
+            }
+
+            head += sizeof(rec_hdr) + payload_len;
+            __atomic_store_n(&worker->head, head, __ATOMIC_SEQ_CST);
+
+            if (__atomic_load_n(&worker->room_waiting, __ATOMIC_SEQ_CST)) {
+                pthread_mutex_lock(&worker->mutex);
+                pthread_cond_signal(&worker->room_cond);
+                pthread_mutex_unlock(&worker->mutex);
+            }
+
+            /* A busy worker moves applied_lsn up now and then too, the
+             * peer may wait on it */
+            if ((flags & MIRROR_F_ACK_APPLIED) ||
+                ++n_applied % MIRROR_IO_BATCH_SIZE == 0) {
+                mirror_apply_progress(mirror);
+            }
+        }
+    }
+    return NULL;
+}
+
+static void
+mirror_apply_fold_stats(mirror_stats_t *stats,
+                        const mirror_apply_worker_t *worker) {
+
+    stats->applied_records += worker->applied_records;
+    stats->applied_bytes += worker->applied_bytes;
+    conn_mgmt_hist_merge(&stats->apply_lag, &worker->apply_lag);
+}
+
+/* Drains and joins the workers, their stats go to the mirror's. Under
+ * apply_mutex */
+static void
+mirror_apply_workers_stop(mirror_t *mirror) {
+
+    uint32_t i;
+    mirror_apply_worker_t *worker;
+
+    if (!mirror->n_apply_workers) return;
+
+    mirror_apply_drain(mirror);
+
+    for (i = 0; i < mirror->n_apply_workers; i++) {
+        worker = &mirror->apply_workers[i];
+        pthread_mutex_lock(&worker->mutex);
+        worker->stop = true;
+        pthread_cond_signal(&worker->data_cond);
+        pthread_mutex_unlock(&worker->mutex);
+    }
+
+    /* Not under applied_mutex, the workers take it on their way out */
+    for (i = 0; i < mirror->n_apply_workers; i++) {
+        pthread_join(mirror->apply_workers[i].thread, NULL);
+    }
+
+    pthread_mutex_lock(&mirror->applied_mutex);
+    for (i = 0; i < mirror->n_apply_workers; i++) {
+        worker = &mirror->apply_workers[i];
+        mirror_apply_fold_stats(&mirror->stats, worker);
+        pthread_mutex_destroy(&worker->mutex);
+        pthread_cond_destroy(&worker->data_cond);
+        pthread_cond_destroy(&worker->room_cond);
+        free(worker->ring);
+        free(worker->scratch);
+    }
+    free(mirror->apply_workers);
+    mirror->apply_workers = NULL;
+    mirror->n_apply_workers = 0;
+    pthread_mutex_unlock(&mirror->applied_mutex);
+}
+
+static void
+mirror_apply_workers_start(mirror_t *mirror, uint32_t n_workers) {
+
+    uint32_t i;
+    mirror_apply_worker_t *worker;
+
+    mirror->apply_workers = calloc(n_workers, sizeof(mirror_apply_worker_t));
+
+    for (i = 0; i < n_workers; i++) {
+        worker = &mirror->apply_workers[i];
+        worker->mirror = mirror;
+        worker->ring = malloc(MIRROR_APPLY_RING_SIZE);
+        worker->scratch = malloc(MIRROR_MAX_DGRAM_SIZE);
+        worker->done_lsn = mirror->stats.applied_lsn;
+        pthread_mutex_init(&worker->mutex, NULL);
+        pthread_cond_init(&worker->data_cond, NULL);
+        pthread_cond_init(&worker->room_cond, NULL);
+    }
+
+    mirror->pending_lsn = mirror->stats.applied_lsn;
+    mirror->dispatched_lsn = mirror->stats.applied_lsn;
+    /* Workers are looked up once n_apply_workers is set */
+    mirror->n_apply_workers = n_workers;
+
+    for (i = 0; i < n_workers; i++) {
+        pthread_create(&mirror->apply_workers[i].thread, NULL,
+                       mirror_apply_worker_fn, &mirror->apply_workers[i]);
+    }
+}
+
+void
+mirror_set_apply_workers(mirror_t *mirror, uint32_t n_workers) {
+
+    if (n_workers > MIRROR_MAX_APPLY_WORKERS) {
+        n_workers = MIRROR_MAX_APPLY_WORKERS;
+    }
+
+    pthread_mutex_lock(&mirror->apply_mutex);
+    mirror_apply_workers_stop(mirror);
+    if (n_workers) mirror_apply_workers_start(mirror, n_workers);
+    pthread_mutex_unlock(&mirror->apply_mutex);
+}
+
+/* Recv thread : records up to lsn are applied, or handed over */
+static inline void
+mirror_apply_set_lsn(mirror_t *mirror, mirror_lsn_t lsn) {
+
+    if (mirror->n_apply_workers) {
+        mirror->pending_lsn = lsn;
+    } else {
+        mirror->stats.applied_lsn = lsn;
+    }
+}
+
+/* Backup : the journal has the records recvd, before they are applied.
+ * Once full, it has none until the next sync */
+static void
+mirror_journal_keep(mirror_t *mirror, mirror_record_hdr_t *rec_hdr,
+                    uint32_t payload_len, mirror_lsn_t lsn) {
+
+    if (!mirror->journal || mirror->journal_off) return;
+
+    if (mirror_journal_append(mirror->journal, lsn, rec_hdr,
+                              sizeof(*rec_hdr) + payload_len)) {
+        mirror->stats.journal_records++;
+        mirror->stats.journal_bytes += sizeof(*rec_hdr) + payload_len;
+        return;
+    }
+    printf("Error : mirror %s : journal full, the next restart needs a"
+           " sync\n", mirror->conn->conn_name);
+    mirror->stats.journal_overflows++;
+    mirror->journal_off = true;
+    mirror_journal_reset(mirror->journal, 0, 1);
+}
+
+static void
+mirror_apply_dgram(mirror_t *mirror, unsigned char *dgram,
+                   uint32_t dgram_len, uint64_t now) {
+
+    uint16_t i, n_records, op, flags;
+    uint32_t payload_len;
+    uint32_t offset = sizeof(mirror_dgram_hdr_t);
+    uint64_t timestamp;
+    mirror_lsn_t lsn;
+    mirror_apply_fn cb;
+    mirror_record_hdr_t *rec_hdr;
+    mirror_dgram_hdr_t *dgram_hdr = (mirror_dgram_hdr_t *)dgram;
+
+    if (dgram_len < sizeof(mirror_dgram_hdr_t) ||
+        (dgram_hdr->msg_type != MIRROR_MSG_DATA &&
+         dgram_hdr->msg_type != MIRROR_MSG_SNAPSHOT)) {
+        return;
+    }
+
+    n_records = ntohs(dgram_hdr->n_records);
+
+    for (i = 0; i < n_records; i++) {
+
+        if (offset + sizeof(mirror_record_hdr_t) > dgram_len) return;
+
+        rec_hdr = (mirror_record_hdr_t *)(dgram + offset);
+        payload_len = ntohl(rec_hdr->payload_len);
+        offset += sizeof(mirror_record_hdr_t);
+
+        if (offset + payload_len > dgram_len) return;
+        offset += payload_len;
+
+        op = ntohs(rec_hdr->op);
+        cb = op < MIRROR_MAX_OPS ? mirror->apply_cb[op] : NULL;
+
+        /* Snapshot records have no lsn, they come in before any record
+         * the sync held back */
+        if (dgram_hdr->msg_type == MIRROR_MSG_SNAPSHOT) {
+            mirror_journal_keep(mirror, rec_hdr, payload_len, 0);
+            if (cb && mirror->n_apply_workers) {
+                mirror_apply_dispatch(mirror, rec_hdr, payload_len);
+            } else if (cb) {
+                cb(mirror, be64toh(rec_hdr->obj_id), op,
+                   (unsigned char *)(rec_hdr + 1), payload_len, 0);
+            }
+            mirror->stats.snapshot_records++;
+            mirror->stats.snapshot_bytes += payload_len;
+            continue;
+        }
+
+        lsn = be64toh(rec_hdr->lsn);
+
+        /* Duplicate or late */
+        if (lsn < mirror->rx_next_lsn) continue;
+
+        mirror->stats.lost_records += lsn - mirror->rx_next_lsn;
+        mirror->rx_next_lsn = lsn + 1;
+        mirror_journal_keep(mirror, rec_hdr, payload_len, lsn);
+
+        if (!cb) {
+            mirror->stats.unhandled_records++;
+            mirror_apply_set_lsn(mirror, lsn);
+            continue;
+        }
+
+        flags = ntohs(rec_hdr->flags);
+
+        if (mirror->n_apply_workers && !(flags & MIRROR_F_TXN)) {
+            mirror_apply_dispatch(mirror, rec_hdr, payload_len);
+            mirror->pending_lsn = lsn;
+            continue;
+        }
+
+        /* A transaction's records are applied here, after all records
+         * before them and before any record after them */
+        mirror_apply_drain(mirror);
+
+        cb(mirror, be64toh(rec_hdr->obj_id), op,
+           (unsigned char *)(rec_hdr + 1), payload_len, lsn);
+
+        timestamp = be64toh(rec_hdr->timestamp);
+        conn_mgmt_hist_add(&mirror->stats.apply_lag,
+                           now > timestamp ? now - timestamp : 0);
+        mirror->stats.applied_records++;
+        mirror->stats.applied_bytes += payload_len;
+        if (flags & MIRROR_F_TXN_END) mirror->stats.applied_txns++;
+        mirror_apply_set_lsn(mirror, lsn);
+    }
+}
+
+/* Highest lsn in a data msg, 0 if none */
+static mirror_lsn_t
+mirror_dgram_last_lsn(unsigned char *dgram, uint32_t dgram_len) {
+
+    uint16_t i, n_records;
+    uint32_t offset = sizeof(mirror_dgram_hdr_t);
+    mirror_lsn_t lsn = 0;
+    mirror_record_hdr_t *rec_hdr;
+
+    n_records = ntohs(((mirror_dgram_hdr_t *)dgram)->n_records);
+
+    for (i = 0; i < n_records; i++) {
+        if (offset + sizeof(mirror_record_hdr_t) > dgram_len) break;
+        rec_hdr = (mirror_record_hdr_t *)(dgram + offset);
+        lsn = be64toh(rec_hdr->lsn);
+        offset += sizeof(mirror_record_hdr_t) + ntohl(rec_hdr->payload_len);
+    }
+    return lsn;
+}
+
+static void
+mirror_send_ack(mirror_t *mirror) {
+
+    mirror_ack_msg_t ack_msg;
+
+    memset(&ack_msg, 0, sizeof(ack_msg));
+    ack_msg.msg_type = MIRROR_MSG_ACK;
+    if (mirror->conn->mastership_state == COMM_MGMT_BACKUP &&
+        mirror->sync_state == MIRROR_SYNC_READY) {
+        ack_msg.flags = MIRROR_ACK_F_SYNC_READY;
+    }
+    ack_msg.received_lsn = htobe64(mirror->rx_received_lsn);
+    ack_msg.applied_lsn = htobe64(mirror->stats.applied_lsn);
+
+    if (mirror_send_msg(mirror, &ack_msg, sizeof(ack_msg))) {
+        mirror->stats.acks_tx++;
+    }
+}
+
+/* Acks the peer wants right away are sent from the recv thread, the
+ * rest go out on the connection's KA msgs */
+
+static uint16_t
+mirror_ka_piggyback_fill(conn_mgmt_conn_state_t *conn, void *arg,
+                         unsigned char *buf, uint16_t buf_size) {
+
+    uint64_t lsns[2];
+    mirror_t *mirror = (mirror_t *)arg;
+
+    if (!mirror->rx_received_lsn || buf_size < sizeof(lsns)) return 0;
+
+    lsns[0] = htobe64(mirror->rx_received_lsn);
+    lsns[1] = htobe64(mirror->stats.applied_lsn);
+    memcpy(buf, lsns, sizeof(lsns));
+    mirror->stats.ka_acks_tx++;
+    return sizeof(lsns);
+}
+
+static void
+mirror_ka_piggyback_recv(conn_mgmt_conn_state_t *conn, void *arg,
+                         const unsigned char *data, uint16_t len) {
+
+    uint64_t lsns[2];
+    mirror_t *mirror = (mirror_t *)arg;
+
+    if (len != sizeof(lsns)) return;
+
+    memcpy(lsns, data, sizeof(lsns));
+    mirror->stats.ka_acks_rx++;
+    mirror_ack_update(mirror, be64toh(lsns[0]), be64toh(lsns[1]));
+}
+
+/* Backup : done with the sync once every record held back by the
+ * master is applied, the master learns it from our next ack */
+static void
+mirror_sync_check_ready(mirror_t *mirror) {
+
+    if (mirror->sync_state != MIRROR_SYNC_CATCHUP ||
+        mirror->stats.applied_lsn < mirror->sync_ready_lsn) {
+        return;
+    }
+    mirror->stats.syncs_ready++;
+    mirror->stats.last_ready_usec =
+        mirror_get_time_usec() - mirror->sync_start_time;
+    /* Our state, and the journal, are of the master's log now */
+    mirror->peer_log_id = mirror->sync_log_id;
+    if (mirror->journal && !mirror->journal_off) {
+        mirror_journal_set_log_id(mirror->journal, mirror->sync_log_id);
+    }
+    mirror_sync_set_state(mirror, MIRROR_SYNC_READY);
+    mirror_send_ack(mirror);
+}
+
+/* Apply workers : the lsns start over from lsn + 1, the workers are
+ * idle */
+static void
+mirror_apply_reset_lsn(mirror_t *mirror, mirror_lsn_t lsn) {
+
+    uint32_t i;
+
+    for (i = 0; i < mirror->n_apply_workers; i++) {
+        mirror->apply_workers[i].done_lsn = lsn;
+    }
+    mirror->pending_lsn = lsn;
+    mirror->dispatched_lsn = lsn;
+    mirror->ack_applied_lsn = 0;
+}
+
+/* Master : the peer which came up asks to resume, unless it is synced
+ * already */
+static void
+mirror_resume_request(mirror_t *mirror, uint64_t log_id,
+                      mirror_lsn_t start_lsn) {
+
+    if (!mirror->journal) return;
+
+    pthread_mutex_lock(&mirror->log_mutex);
+    if (mirror->sync_state == MIRROR_SYNC_NONE) {
+        mirror->resume_requested = true;
+        mirror->resume_log_id = log_id;
+        mirror->resume_lsn = start_lsn;
+        mirror_wake_sender(mirror);
+    }
+    pthread_mutex_unlock(&mirror->log_mutex);
+}
+
+/* Backup : sync begin, end, abort and resume, and the resume asked
+ * for on the master. With apply workers, under applied_mutex once they
+ * are idle */
+static void
+mirror_recv_sync_msg(mirror_t *mirror, unsigned char *msg,
+                     uint32_t msg_len) {
+
+    mirror_sync_msg_t *sync_msg = (mirror_sync_msg_t *)msg;
+
+    if (msg_len != sizeof(mirror_sync_msg_t)) return;
+
+    switch (sync_msg->msg_type) {
+
+        case MIRROR_MSG_SYNC_BEGIN:
+            /* Records before the snapshot are in it */
+            mirror->sync_start_lsn = be64toh(sync_msg->start_lsn);
+            mirror->sync_ready_lsn = 0;
+            mirror->sync_start_time = mirror_get_time_usec();
+            mirror->rx_next_lsn = mirror->sync_start_lsn;
+            mirror->stats.applied_lsn = mirror->sync_start_lsn - 1;
+            mirror_apply_reset_lsn(mirror, mirror->stats.applied_lsn);
+            if (mirror->rx_received_lsn < mirror->stats.applied_lsn) {
+                mirror->rx_received_lsn = mirror->stats.applied_lsn;
+            }
+            mirror->sync_start_bytes = mirror->stats.snapshot_bytes;
+            mirror->stats.syncs++;
+            /* Of no log until the sync is done */
+            mirror->sync_log_id = be64toh(sync_msg->log_id);
+            mirror->peer_log_id = 0;
+            if (mirror->journal) {
+                mirror_journal_reset(mirror->journal, 0,
+                                     mirror->sync_start_lsn);
+                mirror->journal_off = false;
+            }
+            mirror_sync_set_state(mirror, MIRROR_SYNC_SNAPSHOT);
+            break;
+        case MIRROR_MSG_SYNC_END:
+            if (mirror->sync_state != MIRROR_SYNC_SNAPSHOT) break;
+            mirror->sync_ready_lsn = be64toh(sync_msg->ready_lsn);
+            mirror->stats.last_snapshot_usec =
+                mirror_get_time_usec() - mirror->sync_start_time;
+            mirror->stats.last_snapshot_bytes =
+                mirror->stats.snapshot_bytes - mirror->sync_start_bytes;
+            mirror_sync_set_state(mirror, MIRROR_SYNC_CATCHUP);
+            mirror_sync_check_ready(mirror);
+            break;
+        case MIRROR_MSG_SYNC_ABORT:
+            mirror->stats.sync_aborts++;
+            mirror_sync_set_state(mirror, MIRROR_SYNC_NONE);
+            break;
+        case MIRROR_MSG_SYNC_RESUME:
+            if (mirror->conn->mastership_state == COMM_MGMT_MASTER) {
+                mirror_resume_request(mirror, be64toh(sync_msg->log_id),
+                                      be64toh(sync_msg->start_lsn));
+                break;
+            }
+            /* Asked to ask, the connection went down on the master's
+             * end only say */
+            if (!sync_msg->start_lsn) {
+                pthread_mutex_lock(&mirror->log_mutex);
+                mirror->resume_requested = true;
+                mirror_wake_sender(mirror);
+                pthread_mutex_unlock(&mirror->log_mutex);
+                break;
+            }
+            /* The master has the records we miss, they follow */
+            if (be64toh(sync_msg->log_id) != mirror->peer_log_id) break;
+            mirror->stats.resumes++;
+            mirror_sync_set_state(mirror, MIRROR_SYNC_READY);
+            break;
+        default:
+            break;
+    }
+}
+
+/* Master : the peer says it is done with the sync */
+static void
+mirror_sync_peer_ready(mirror_t *mirror, mirror_lsn_t applied_lsn) {
+
+    if (mirror->sync_state != MIRROR_SYNC_CATCHUP ||
+        applied_lsn < mirror->sync_ready_lsn) {
+        return;
+    }
+    mirror->stats.syncs_ready++;
+    mirror->stats.last_ready_usec =
+        mirror_get_time_usec() - mirror->sync_start_time;
+    mirror_sync_set_state(mirror, MIRROR_SYNC_READY);
+}
+
+/* Handles a batch of msgs from the peer, each iov one msg */
+static void
+mirror_recv_msgs(mirror_t *mirror, struct iovec *msgs, int n_msgs) {
+
+    int i;
+    uint8_t ack_flags = 0, msg_type;
+    uint64_t now;
+    mirror_lsn_t lsn;
+    mirror_ack_msg_t *ack_msg;
+    mirror_dgram_hdr_t *dgram_hdr;
+
+    mirror->stats.rx_dgrams += n_msgs;
+
+    /* What the batch brings in first, and acks from the peer */
+    for (i = 0; i < n_msgs; i++) {
+
+        dgram_hdr = (mirror_dgram_hdr_t *)msgs[i].iov_base;
+
+        if (msgs[i].iov_len == sizeof(mirror_ack_msg_t) &&
+            dgram_hdr->msg_type == MIRROR_MSG_ACK) {
+            ack_msg = (mirror_ack_msg_t *)dgram_hdr;
+            mirror->stats.acks_rx++;
+            mirror_ack_update(mirror, be64toh(ack_msg->received_lsn),
+                              be64toh(ack_msg->applied_lsn));
+            if (ack_msg->flags & MIRROR_ACK_F_SYNC_READY) {
+                mirror_sync_peer_ready(mirror, be64toh(ack_msg->applied_lsn));
+            }
+            continue;
+        }
+        if (msgs[i].iov_len < sizeof(mirror_dgram_hdr_t) ||
+            dgram_hdr->msg_type != MIRROR_MSG_DATA) {
+            continue;
+        }
+        ack_flags |= dgram_hdr->flags;
+        lsn = mirror_dgram_last_lsn((unsigned char *)dgram_hdr,
+                                    msgs[i].iov_len);
+        if (lsn > mirror->rx_received_lsn) mirror->rx_received_lsn = lsn;
+    }
+
+    if (ack_flags & MIRROR_F_ACK_RECEIVED) {
+        mirror_send_ack(mirror);
+    }
+
+    /* In order, sync msgs are where they are in the stream */
+    now = mirror_get_wall_time_usec();
+    pthread_mutex_lock(&mirror->apply_mutex);
+
+    for (i = 0; i < n_msgs; i++) {
+        msg_type = msgs[i].iov_len ? *(uint8_t *)msgs[i].iov_base : 0;
+        if (msg_type == MIRROR_MSG_SYNC_BEGIN ||
+            msg_type == MIRROR_MSG_SYNC_END ||
+            msg_type == MIRROR_MSG_SYNC_ABORT ||
+            msg_type == MIRROR_MSG_SYNC_RESUME) {
+            mirror_apply_drain(mirror);
+            pthread_mutex_lock(&mirror->applied_mutex);
+            mirror_recv_sync_msg(mirror, msgs[i].iov_base, msgs[i].iov_len);
+            pthread_mutex_unlock(&mirror->applied_mutex);
+            continue;
+        }
+        mirror_apply_dgram(mirror, msgs[i].iov_base, msgs[i].iov_len, now);
+    }
+
+    if (mirror->n_apply_workers) {
+        /* Acked once the workers applied all records up to here */
+        if (ack_flags & MIRROR_F_ACK_APPLIED) {
+            pthread_mutex_lock(&mirror->applied_mutex);
+            mirror->ack_applied_lsn = mirror->pending_lsn;
+            pthread_mutex_unlock(&mirror->applied_mutex);
+        }
+        mirror_apply_publish(mirror);
+        mirror_apply_progress(mirror);
+        pthread_mutex_unlock(&mirror->apply_mutex);
+        return;
+    }
+    pthread_mutex_unlock(&mirror->apply_mutex);
+
+    mirror_sync_check_ready(mirror);
+
+    if (ack_flags & MIRROR_F_ACK_APPLIED) {
+        mirror_send_ack(mirror);
+    }
+}
+
+static void *
+mirror_recv_fn(void *arg) {
+
+    int i, n_msgs;
+    mirror_t *mirror = (mirror_t *)arg;
+    unsigned char *dgrams;
+    struct iovec iovs[MIRROR_IO_BATCH_SIZE];
+    struct iovec rx_msgs[MIRROR_IO_BATCH_SIZE];
+    struct mmsghdr msgs[MIRROR_IO_BATCH_SIZE];
+
+    dgrams = malloc(MIRROR_IO_BATCH_SIZE * MIRROR_MAX_DGRAM_SIZE);
+    memset(msgs, 0, sizeof(msgs));
+
+    for (i = 0; i < MIRROR_IO_BATCH_SIZE; i++) {
+        iovs[i].iov_base = dgrams + (i * MIRROR_MAX_DGRAM_SIZE);
+        iovs[i].iov_len = MIRROR_MAX_DGRAM_SIZE;
+        msgs[i].msg_hdr.msg_iov = &iovs[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    while (!mirror->stop) {
+
+        n_msgs = recvmmsg(mirror->sock_fd, msgs, MIRROR_IO_BATCH_SIZE,
+                          MSG_WAITFORONE, NULL);
+        mirror->stats.rx_syscalls++;
+
+        if (n_msgs < 0) {
+            /* ECONNREFUSED : the peer's socket is not there yet, an
+             * ICMP error for one of our datagrams */
+            if (errno == EINTR || errno == ECONNREFUSED) continue;
+            break;
+        }
+        /* Socket shut down by mirror_destroy() */
+        if (mirror->stop) break;
+
+        for (i = 0; i < n_msgs; i++) {
+            rx_msgs[i].iov_base = iovs[i].iov_base;
+            rx_msgs[i].iov_len = msgs[i].msg_len;
+        }
+        mirror_recv_msgs(mirror, rx_msgs, n_msgs);
+    }
+
+    free(dgrams);
+    return NULL;
+}
+
+/* On the transport's recv thread, which takes the place of ours */
+static void
+mirror_xport_recv(xport_t *xport, void *arg, unsigned char *msg,
+                  uint32_t msg_len) {
+
+    struct iovec rx_msg;
+
+    rx_msg.iov_base = msg;
+    rx_msg.iov_len = msg_len;
+    mirror_recv_msgs((mirror_t *)arg, &rx_msg, 1);
+}
+
+static int
+mirror_open_sock(mirror_t *mirror, uint16_t data_src_port,
+                 uint16_t data_dst_port) {
+
+    int sock_fd, buf_size = MIRROR_SOCK_BUF_SIZE;
+    struct sockaddr_in src_addr;
+
+    sock_fd = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (sock_fd < 0) {
+        printf("Error : mirror socket creation failed, errno = %d\n", errno);
+        return -1;
+    }
+
+    /* Bursts of a whole log's worth of datagrams */
+    if (setsockopt(sock_fd, SOL_SOCKET, SO_RCVBUFFORCE,
+                   &buf_size, sizeof(buf_size)) < 0) {
+        setsockopt(sock_fd, SOL_SOCKET, SO_RCVBUF,
+                   &buf_size, sizeof(buf_size));
+    }
+    if (setsockopt(sock_fd, SOL_SOCKET, SO_SNDBUFFORCE,
+                   &buf_size, sizeof(buf_size)) < 0) {
+        setsockopt(sock_fd, SOL_SOCKET, SO_SNDBUF,
+                   &buf_size, sizeof(buf_size));
+    }
+
+    memset(&src_addr, 0, sizeof(src_addr));
+    src_addr.sin_family      = AF_INET;
+    src_addr.sin_port        = data_src_port;
+    src_addr.sin_addr.s_addr = INADDR_ANY;
+
+    if (bind(sock_fd, (struct sockaddr *)&src_addr, sizeof(src_addr)) < 0) {
+        printf("Error : mirror socket bind failed, errno = %d\n", errno);
+        close(sock_fd);
+        return -1;
+    }
+
+    mirror->peer_addr = mirror->conn->peer_addr;
+    mirror->peer_addr.sin_port = data_dst_port;
+
+    /* Only the peer's datagrams are recvd, and send() needs no addr */
+    if (connect(sock_fd, (struct sockaddr *)&mirror->peer_addr,
+                sizeof(mirror->peer_addr)) < 0) {
+        printf("Error : mirror socket connect failed, errno = %d\n", errno);
+        close(sock_fd);
+        return -1;
+    }
+    return sock_fd;
+}
+
+/* Master : a peer which came up is synced, or with a journal, waits
+ * for it to ask to resume for a while first. Wakes up the sender for
+ * the journal's records too */
+static void
+mirror_peer_came_up(mirror_t *mirror) {
+
+    if (!mirror->journal) {
+        mirror_start_sync(mirror);
+        return;
+    }
+
+    pthread_mutex_lock(&mirror->log_mutex);
+    if (mirror->sync_state == MIRROR_SYNC_NONE &&
+        !mirror->resume_requested && !mirror->sync_requested) {
+        mirror->resume_deadline = mirror_get_time_usec() +
+                                  (MIRROR_RESUME_WAIT_MSEC * 1000ULL);
+        mirror->resume_probe = true;
+    }
+    mirror_wake_sender(mirror);
+    pthread_mutex_unlock(&mirror->log_mutex);
+}
+
+/* Mirrors by connection, for the connection state notifications */
+static mirror_t *mirror_registry[MIRROR_MAX_MIRRORS];
+static pthread_mutex_t mirror_registry_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static void
+mirror_conn_status_changed(mirror_t *mirror,
+                           conn_mgmt_conn_status_t conn_status) {
+
+    bool came_up = conn_status == COMM_MGMT_CONN_UP &&
+                   mirror->conn_status != COMM_MGMT_CONN_UP;
+
+    mirror->conn_status = conn_status;
+
+    if (conn_status != COMM_MGMT_CONN_UP) {
+        /* A snapshot in progress goes nowhere */
+        mirror->sync_abort = true;
+        mirror->resume_deadline = 0;
+        mirror_sync_set_state(mirror, MIRROR_SYNC_NONE);
+        return;
+    }
+    if (!came_up) return;
+
+    if (mirror->conn->mastership_state == COMM_MGMT_MASTER) {
+        mirror_peer_came_up(mirror);
+        return;
+    }
+    /* Backup : asks to resume, from the sender thread */
+    pthread_mutex_lock(&mirror->log_mutex);
+    mirror->resume_requested = true;
+    mirror_wake_sender(mirror);
+    pthread_mutex_unlock(&mirror->log_mutex);
+}
+
+static void *
+mirror_conn_notif_cb(conn_mgmt_conn_status_t conn_code,
+                     conn_mgmt_conn_key_t *conn_key,
+                     void *msg, uint32_t msg_size) {
+
+    uint32_t i;
+    conn_mgmt_conn_state_t *conn;
+
+    conn = conn_mgmt_lookup_connection_by_key(conn_key);
+    if (!conn) return NULL;
+
+    pthread_mutex_lock(&mirror_registry_mutex);
+    for (i = 0; i < MIRROR_MAX_MIRRORS; i++) {
+        if (mirror_registry[i] && mirror_registry[i]->conn == conn) {
+            mirror_conn_status_changed(mirror_registry[i], conn_code);
+        }
+    }
+    pthread_mutex_unlock(&mirror_registry_mutex);
+    return NULL;
+}
+
+/* Takes a free slot for mirror, false if there is none */
+static bool
+mirror_registry_add(mirror_t *mirror) {
+
+    uint32_t i;
+
+    pthread_mutex_lock(&mirror_registry_mutex);
+    for (i = 0; i < MIRROR_MAX_MIRRORS; i++) {
+        if (!mirror_registry[i]) {
+            mirror_registry[i] = mirror;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&mirror_registry_mutex);
+    return i < MIRROR_MAX_MIRRORS;
+}
+
+/* The last mirror of a connection takes the connection's state
+ * notifications away with it */
+static void
+mirror_registry_remove(mirror_t *mirror) {
+
+    uint32_t i;
+    bool conn_in_use = false;
+
+    pthread_mutex_lock(&mirror_registry_mutex);
+    for (i = 0; i < MIRROR_MAX_MIRRORS; i++) {
+        if (mirror_registry[i] == mirror) {
+            mirror_registry[i] = NULL;
+        } else if (mirror_registry[i] &&
+                   mirror_registry[i]->conn == mirror->conn) {
+            conn_in_use = true;
+        }
+    }
+    if (!conn_in_use) {
+        conn_mgmt_unregister_app_notif_cb(mirror->conn, mirror_conn_notif_cb);
+    }
+    pthread_mutex_unlock(&mirror_registry_mutex);
+}
+
+static void
+mirror_free(mirror_t *mirror) {
+
+    pthread_mutex_destroy(&mirror->log_mutex);
+    pthread_cond_destroy(&mirror->log_data_cond);
+    pthread_cond_destroy(&mirror->ack_cond);
+    pthread_cond_destroy(&mirror->log_room_cond);
+    pthread_mutex_destroy(&mirror->ack_mutex);
+    pthread_mutex_destroy(&mirror->apply_mutex);
+    pthread_mutex_destroy(&mirror->applied_mutex);
+    free(mirror->log);
+    free(mirror);
+}
+
+/* Over the data socket, or over a transport of xport_type if on_xport */
+static mirror_t *
+mirror_create_internal(conn_mgmt_conn_state_t *conn, bool on_xport,
+                       xport_type_t xport_type, uint16_t data_src_port,
+                       uint16_t data_dst_port, uint64_t log_size) {
+
+    mirror_t *mirror;
+    pthread_condattr_t cond_attr;
+
+    if (!log_size) log_size = MIRROR_DEFAULT_LOG_SIZE;
+
+    if (log_size & (log_size - 1)) {
+        printf("Error : mirror log size must be a power of 2\n");
+        return NULL;
+    }
+
+    mirror = calloc(1, sizeof(mirror_t));
+    mirror->conn = conn;
+    mirror->log_size = log_size;
+    mirror->log = malloc(log_size);
+    mirror->next_lsn = 1;
+    mirror->rx_next_lsn = 1;
+    mirror->start_time = mirror_get_time_usec();
+    /* Tells this run of the master from those before it */
+    mirror->log_id = (mirror_get_wall_time_usec() ^
+                      ((uint64_t)getpid() << 40)) | 1;
+    mirror->sock_fd = -1;
+    mirror->max_dgram_size = MIRROR_MAX_DGRAM_SIZE;
+    mirror->sync_max_held_bytes = log_size / 4;
+    mirror->conn_status = COMM_MGMT_CONN_DOWN;
+    pthread_mutex_init(&mirror->log_mutex, NULL);
+    /* Sender's waits for the latency budget are on the monotonic clock */
+    pthread_condattr_init(&cond_attr);
+    pthread_condattr_setclock(&cond_attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&mirror->log_data_cond, &cond_attr);
+    pthread_cond_init(&mirror->ack_cond, &cond_attr);
+    pthread_condattr_destroy(&cond_attr);
+    pthread_cond_init(&mirror->log_room_cond, NULL);
+    pthread_mutex_init(&mirror->ack_mutex, NULL);
+    pthread_mutex_init(&mirror->apply_mutex, NULL);
+    pthread_mutex_init(&mirror->applied_mutex, NULL);
+
+    if (!mirror_registry_add(mirror)) {
+        printf("Error : no more than %u mirrors supported\n",
+               MIRROR_MAX_MIRRORS);
+        mirror_free(mirror);
+        return NULL;
+    }
+
+    if (on_xport) {
+        mirror->xport = xport_create(conn, xport_type, data_src_port,
+                                     data_dst_port, mirror_xport_recv,
+                                     mirror);
+        if (mirror->xport &&
+            mirror->xport->max_msg_size < mirror->max_dgram_size) {
+            mirror->max_dgram_size = mirror->xport->max_msg_size;
+        }
+    } else {
+        mirror->sock_fd = mirror_open_sock(mirror, data_src_port,
+                                           data_dst_port);
+    }
+
+    if (!mirror->log || (mirror->sock_fd < 0 && !mirror->xport)) {
+        if (mirror->xport) xport_destroy(mirror->xport);
+        if (mirror->sock_fd >= 0) close(mirror->sock_fd);
+        mirror_registry_remove(mirror);
+        mirror_free(mirror);
+        return NULL;
+    }
+
+    pthread_create(&mirror->sender_thread, NULL, mirror_sender_fn, mirror);
+    if (!mirror->xport) {
+        pthread_create(&mirror->recv_thread, NULL, mirror_recv_fn, mirror);
+    }
+    conn_mgmt_set_ka_piggyback(conn, mirror_ka_piggyback_fill,
+                               mirror_ka_piggyback_recv, mirror);
+
+    /* Comes back with the current state of conn too */
+    conn_mgmt_register_app_notif_cb(conn, mirror_conn_notif_cb);
+    return mirror;
+}
+
+mirror_t *
+mirror_create(conn_mgmt_conn_state_t *conn, uint16_t data_src_port,
+              uint16_t data_dst_port, uint64_t log_size) {
+
+    return mirror_create_internal(conn, false, 0, data_src_port,
+                                  data_dst_port, log_size);
+}
+
+mirror_t *
+mirror_create_on_xport(conn_mgmt_conn_state_t *conn,
+                       xport_type_t xport_type, uint16_t data_src_port,
+                       uint16_t data_dst_port, uint64_t log_size) {
+
+    return mirror_create_internal(conn, true, xport_type, data_src_port,
+                                  data_dst_port, log_size);
+}
+
+void
+mirror_destroy(mirror_t *mirror) {
+
+    uint32_t i;
+
+    conn_mgmt_set_ka_piggyback(mirror->conn, NULL, NULL, NULL);
+    mirror_registry_remove(mirror);
+
+    pthread_mutex_lock(&mirror->log_mutex);
+    mirror->stop = true;
+    pthread_cond_broadcast(&mirror->log_data_cond);
+    pthread_cond_broadcast(&mirror->log_room_cond);
+    pthread_mutex_unlock(&mirror->log_mutex);
+
+    pthread_mutex_lock(&mirror->ack_mutex);
+    pthread_cond_broadcast(&mirror->ack_cond);
+    pthread_mutex_unlock(&mirror->ack_mutex);
+
+    if (mirror->xport) {
+        /* Sender first, it may be blocked on the transport */
+        pthread_join(mirror->sender_thread, NULL);
+        xport_destroy(mirror->xport);
+    } else {
+        /* Wakes up the recv thread */
+        shutdown(mirror->sock_fd, SHUT_RDWR);
+
+        pthread_join(mirror->sender_thread, NULL);
+        pthread_join(mirror->recv_thread, NULL);
+
+        close(mirror->sock_fd);
+    }
+
+    /* No more records come in */
+    mirror_set_apply_workers(mirror, 0);
+
+    if (mirror->staged) {
+        for (i = 0; i < MIRROR_COALESCE_MAX_RECORDS; i++) {
+            free(mirror->staged[i].payload);
+        }
+        free(mirror->staged);
+        free(mirror->staged_hash);
+    }
+    mirror_free(mirror);
+}
+
+void
+mirror_register_apply_cb(mirror_t *mirror, uint16_t op,
+                         mirror_apply_fn cb) {
+
+    assert(op < MIRROR_MAX_OPS);
+    mirror->apply_cb[op] = cb;
+}
+
+void
+mirror_set_sync_cbs(mirror_t *mirror, mirror_snapshot_fn snapshot_cb,
+                    mirror_sync_event_fn event_cb, void *arg) {
+
+    pthread_mutex_lock(&mirror_registry_mutex);
+    mirror->snapshot_cb = snapshot_cb;
+    mirror->sync_event_cb = event_cb;
+    mirror->sync_cb_arg = arg;
+
+    /* The backup came up before we knew how to sync it */
+    if (snapshot_cb && mirror->conn_status == COMM_MGMT_CONN_UP &&
+        mirror->sync_state == MIRROR_SYNC_NONE &&
+        mirror->conn->mastership_state == COMM_MGMT_MASTER) {
+        mirror_peer_came_up(mirror);
+    }
+    pthread_mutex_unlock(&mirror_registry_mutex);
+}
+
+void
+mirror_set_sync_limit(mirror_t *mirror, uint64_t max_held_bytes) {
+
+    if (!max_held_bytes) max_held_bytes = mirror->log_size / 4;
+    /* Appenders must never wait on the held back records for room */
+    if (max_held_bytes > mirror->log_size / 2) {
+        max_held_bytes = mirror->log_size / 2;
+    }
+    mirror->sync_max_held_bytes = max_held_bytes;
+}
+
+void
+mirror_set_snapshot_mode(mirror_t *mirror, mirror_snapshot_mode_t mode) {
+
+    assert(mode < MIRROR_SNAPSHOT_MODE_MAX);
+    /* Read by the sender thread as a sync starts */
+    mirror->snapshot_mode = mode;
+}
+
+/* Backup : applies the journal's records, on the app's thread */
+static void
+mirror_journal_replay(mirror_t *mirror) {
+
+    uint16_t op;
+    uint32_t rec_len, payload_len;
+    uint64_t pos, lsn, start;
+    const unsigned char *rec;
+    mirror_apply_fn cb;
+    mirror_record_hdr_t *rec_hdr;
+
+    start = mirror_get_time_usec();
+    pos = mirror_journal_head(mirror->journal);
+
+    while ((rec = mirror_journal_read(mirror->journal, &pos, &lsn,
+                                      &rec_len))) {
+
+        rec_hdr = (mirror_record_hdr_t *)rec;
+        if (rec_len < sizeof(*rec_hdr)) continue;
+        payload_len = ntohl(rec_hdr->payload_len);
+        if (payload_len > rec_len - sizeof(*rec_hdr)) continue;
+
+        op = ntohs(rec_hdr->op);
+        cb = op < MIRROR_MAX_OPS ? mirror->apply_cb[op] : NULL;
+        if (cb) {
+            cb(mirror, be64toh(rec_hdr->obj_id), op,
+               (unsigned char *)(rec_hdr + 1), payload_len, lsn);
+        }
+        mirror->stats.replayed_records++;
+        mirror->stats.replayed_bytes += payload_len;
+    }
+    mirror->stats.replay_usec = mirror_get_time_usec() - start;
+}
+
+uint64_t
+mirror_set_journal(mirror_t *mirror, mirror_journal_t *journal,
+                   uint64_t high_water_bytes) {
+
+    if (mirror->conn->mastership_state == COMM_MGMT_MASTER) {
+
+        pthread_mutex_lock(&mirror->log_mutex);
+        /* A restart of the master : its log goes on, if nothing was
+         * appended yet */
+        if (journal->log_id && mirror->next_lsn == 1) {
+            mirror->log_id = journal->log_id;
+            mirror->next_lsn = journal->next_lsn;
+        } else {
+            mirror_journal_reset(journal, mirror->log_id, mirror->next_lsn);
+        }
+        mirror->journal = journal;
+        mirror->journal_high_water = high_water_bytes;
+        mirror->journal_pos = mirror_journal_tail(journal);
+        pthread_mutex_unlock(&mirror->log_mutex);
+        return 0;
+    }
+
+    pthread_mutex_lock(&mirror->apply_mutex);
+    pthread_mutex_lock(&mirror->applied_mutex);
+
+    mirror->journal = journal;
+    /* Records of a sync which was not done are of no use, and none are
+     * written until the next one */
+    mirror->journal_off = !journal->log_id;
+
+    if (journal->log_id) {
+        mirror_journal_replay(mirror);
+        mirror->peer_log_id = journal->log_id;
+        mirror->rx_next_lsn = journal->next_lsn;
+        mirror->rx_received_lsn = journal->next_lsn - 1;
+        mirror->stats.applied_lsn = journal->next_lsn - 1;
+        mirror_apply_reset_lsn(mirror, mirror->stats.applied_lsn);
+    }
+
+    pthread_mutex_unlock(&mirror->applied_mutex);
+    pthread_mutex_unlock(&mirror->apply_mutex);
+    return mirror->stats.replayed_records;
+}
+
+void
+mirror_start_sync(mirror_t *mirror) {
+
+    if (!mirror->snapshot_cb) return;
+
+    pthread_mutex_lock(&mirror->log_mutex);
+    mirror->sync_requested = true;
+    mirror_wake_sender(mirror);
+    pthread_mutex_unlock(&mirror->log_mutex);
+}
+
+const char *
+mirror_sync_state_str(mirror_sync_state_t state) {
+
+    static const char *names[MIRROR_SYNC_STATE_MAX] =
+        {"none", "snapshot", "catchup", "ready"};
+
+    return state < MIRROR_SYNC_STATE_MAX ? names[state] : "unknown";
+}
+
+void
+mirror_get_stats(mirror_t *mirror, mirror_stats_t *stats) {
+
+    uint32_t i;
+
+    memcpy(stats, &mirror->stats, sizeof(*stats));
+
+    /* Apply workers count what they applied on their own */
+    pthread_mutex_lock(&mirror->apply_mutex);
+    for (i = 0; i < mirror->n_apply_workers; i++) {
+        mirror_apply_fold_stats(stats, &mirror->apply_workers[i]);
+    }
+    pthread_mutex_unlock(&mirror->apply_mutex);
+}
+
+void
+mirror_print_stats(mirror_t *mirror) {
+
+    uint32_t i;
+    static const char *durability_names[MIRROR_DURABILITY_MAX] =
+        {"async", "received", "applied"};
+    mirror_stats_t mirror_stats, *stats = &mirror_stats;
+    double secs = (mirror_get_time_usec() - mirror->start_time) / 1e6;
+
+    mirror_get_stats(mirror, stats);
+
+    printf("mirror %s : uptime %.2f sec\n", mirror->conn->conn_name, secs);
+    printf("\tappended : %lu records (%.0f/s)  %.2f MB/s  stalls %lu"
+           "  last lsn %lu\n",
+           stats->appended_records, stats->appended_records / secs,
+           stats->appended_bytes / secs / 1e6, stats->append_stalls,
+           mirror->next_lsn - 1);
+    if (mirror->xport) {
+        printf("\tsent : %lu records  %lu dgrams over %s\n",
+               stats->sent_records, stats->tx_dgrams,
+               xport_type_str(mirror->xport->type));
+    } else {
+        printf("\tsent : %lu records  %lu dgrams  %lu syscalls\n",
+               stats->sent_records, stats->tx_dgrams, stats->tx_syscalls);
+    }
+    printf("\tapplied : %lu records (%.0f/s)  %.2f MB/s  lost %lu"
+           "  unhandled %lu  applied lsn %lu\n",
+           stats->applied_records, stats->applied_records / secs,
+           stats->applied_bytes / secs / 1e6, stats->lost_records,
+           stats->unhandled_records, stats->applied_lsn);
+    printf("\tapply lag : ");
+    conn_mgmt_hist_print_summary(&stats->apply_lag, "usec", 1);
+    if (mirror->n_apply_workers || stats->applied_txns) {
+        printf("\tapply workers : %u  queue stalls %lu  barriers %lu"
+               "  transactions %lu\n", mirror->n_apply_workers,
+               stats->apply_queue_stalls, stats->apply_barriers,
+               stats->applied_txns);
+    }
+    printf("\tacks : tx %lu rx %lu  on KA msgs tx %lu rx %lu  timeouts %lu"
+           "  peer recvd lsn %lu  applied lsn %lu\n",
+           stats->acks_tx, stats->acks_rx, stats->ka_acks_tx,
+           stats->ka_acks_rx, stats->ack_timeouts,
+           mirror->peer_received_lsn, mirror->peer_applied_lsn);
+    for (i = 0; i < MIRROR_DURABILITY_MAX; i++) {
+        if (!stats->commit_latency[i].count) continue;
+        printf("\tcommit latency %s : ", durability_names[i]);
+        conn_mgmt_hist_print_summary(&stats->commit_latency[i], "usec", 1);
+    }
+
+    if (stats->syncs) {
+        printf("\tsync : %s  started %lu  aborted %lu  ready %lu"
+               "  snapshot records %lu  %.2f MB  peak held %lu bytes"
+               " (limit %lu)  skipped while down %lu bytes\n",
+               mirror_sync_state_str(mirror->sync_state),
+               stats->syncs, stats->sync_aborts, stats->syncs_ready,
+               stats->snapshot_records, stats->snapshot_bytes / 1e6,
+               stats->sync_peak_held_bytes, mirror->sync_max_held_bytes,
+               stats->sync_skipped_bytes);
+        printf("\tlast sync : snapshot %lu usec (%.1f MB/s)  ready after"
+               " %lu usec\n", stats->last_snapshot_usec,
+               stats->last_snapshot_usec ?
+                   (double)stats->last_snapshot_bytes /
+                   stats->last_snapshot_usec : 0,
+               stats->last_ready_usec);
+        if (mirror->snapshot_mode == MIRROR_SNAPSHOT_FORK) {
+            printf("\tsnapshot fork : appends stalled %lu usec last,"
+                   " %lu usec most\n", stats->last_fork_usec,
+                   stats->max_fork_usec);
+        }
+    }
+
+    if (mirror->journal) {
+        printf("\tjournal : %lu records  %.2f MB  sent from it %lu"
+               "  overflows %lu  resumes %lu  refused %lu\n",
+               stats->journal_records, stats->journal_bytes / 1e6,
+               stats->journal_sent_records, stats->journal_overflows,
+               stats->resumes, stats->resumes_refused);
+    }
+    if (stats->replayed_records) {
+        printf("\twarm restart : replayed %lu records  %.2f MB in %lu usec"
+               " (%.1f MB/s)\n", stats->replayed_records,
+               stats->replayed_bytes / 1e6, stats->replay_usec,
+               stats->replay_usec ?
+                   (double)stats->replayed_bytes / stats->replay_usec : 0);
+    }
+
+    if (!stats->staged_records) return;
+
+    printf("\tcoalescing : window %u usec  batch %u bytes  merged %lu of"
+           " %lu (%.1f%%)  flushes by size %lu by time %lu\n",
+           mirror->coalesce_window_usec, mirror->coalesce_batch_bytes,
+           stats->merged_records, stats->staged_records,
+           (100.0 * stats->merged_records) / stats->staged_records,
+           stats->size_flushes, stats->time_flushes);
+    printf("\tcoalescing delay : ");
+    conn_mgmt_hist_print_summary(&stats->coalesce_delay, "usec", 1);
+}
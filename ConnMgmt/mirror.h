@@ -0,0 +1,646 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  mirror.h
+ *
+ *    Description: This file defines the interfaces to mirror the application state
+ *                 from the master to the backup over a connection
+ *
+ *        Version:  1.0
+ *        Created:  10/17/2026 08:40:17 PM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  ABHISHEK SAGAR (), sachinites@gmail.com
+ *   Organization:  Juniper Networks
+ *
+ * =====================================================================================
+ */
+#ifndef __MIRROR__
+#define __MIRROR__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include "conn_mgmt.h"
+#include "xport.h"
+#include "mirror_journal.h"
+
+/* The app on the master appends typed records (obj id, op, payload) to
+ * an in-memory replication log. A sender thread streams the log to the
+ * peer in batches of records per datagram, the peer's recv thread hands
+ * every record to the apply callback registered for its op.
+ *
+ * A mirror rides on a connection : it mirrors between the two ends of
+ * the connection, over a data socket of its own (KA msgs stay small
+ * and their recv buffers with them), or over a transport of the app's
+ * choice, see mirror_create_on_xport(). Both ends run both halves, the
+ * end which is master appends and the other one applies */
+
+/* Records are numbered from 1 in the order they are appended */
+typedef uint64_t mirror_lsn_t;
+
+#define MIRROR_DEFAULT_LOG_SIZE		(64 * 1024 * 1024)
+/* Datagrams are sent up to this size, a record never spans two */
+#define MIRROR_MAX_DGRAM_SIZE		8192
+/* Datagrams moved by one sendmmsg()/recvmmsg() */
+#define MIRROR_IO_BATCH_SIZE		64
+#define MIRROR_SOCK_BUF_SIZE		(16 * 1024 * 1024)
+#define MIRROR_MAX_OPS			64
+/* Coalescing stage defaults, see mirror_set_coalescing() */
+#define MIRROR_COALESCE_MAX_RECORDS	4096
+#define MIRROR_COALESCE_DEFAULT_BYTES	(64 * 1024)
+
+/* First byte of every msg on the data socket */
+#define MIRROR_MSG_DATA			1
+#define MIRROR_MSG_ACK			2
+/* Bulk sync : begin, snapshot records packed like data msgs, and end
+ * or abort of the snapshot */
+#define MIRROR_MSG_SYNC_BEGIN		3
+#define MIRROR_MSG_SNAPSHOT		4
+#define MIRROR_MSG_SYNC_END		5
+#define MIRROR_MSG_SYNC_ABORT		6
+/* Backup which came up : asks the master for the records from start_lsn
+ * on, of the log it was synced with. Master : the records follow, no
+ * sync needed, or with start_lsn 0, the backup is to ask */
+#define MIRROR_MSG_SYNC_RESUME		7
+/* Ack flags : the sender of the ack is a backup done with its sync */
+#define MIRROR_ACK_F_SYNC_READY		(1 << 0)
+/* Master with a journal : how long a backup which came up has to ask to
+ * resume, before it is synced */
+#define MIRROR_RESUME_WAIT_MSEC		1000
+/* Most mirrors in a process, for the connection state notifications */
+#define MIRROR_MAX_MIRRORS		16
+
+/* Record flags, and data msg flags (OR of its records' flags) : the
+ * sender waits for the record to be recvd, or applied, by the peer.
+ * The peer acks such msgs right away, other records are acked on the
+ * KA msgs of the connection */
+#define MIRROR_F_ACK_RECEIVED		(1 << 0)
+#define MIRROR_F_ACK_APPLIED		(1 << 1)
+/* Record flags : the record is one of a transaction's, see
+ * mirror_append_txn(), and the last one of it */
+#define MIRROR_F_TXN			(1 << 2)
+#define MIRROR_F_TXN_END		(1 << 3)
+
+/* Apply workers of the backup, see mirror_set_apply_workers() */
+#define MIRROR_MAX_APPLY_WORKERS	16
+/* Bytes of records queued per worker, a power of 2 */
+#define MIRROR_APPLY_RING_SIZE		(1024 * 1024)
+
+/* Bulk sync of a backup which came up : the master streams a snapshot
+ * of the app's objects while the log holds back, in order, the records
+ * appended meanwhile. The records are sent after the snapshot, and the
+ * backup is ready once it applied them all.
+ *
+ * The snapshot is read while the app keeps updating its objects, an
+ * object may be read with updates newer than the snapshot's start :
+ * replaying the held back records over it converges the backup, as
+ * long as every record carries the whole state of its object */
+typedef enum {
+
+    /* Nothing synced since the peer came up */
+    MIRROR_SYNC_NONE,
+    MIRROR_SYNC_SNAPSHOT,
+    /* Snapshot done, records appended during it on their way */
+    MIRROR_SYNC_CATCHUP,
+    MIRROR_SYNC_READY,
+    MIRROR_SYNC_STATE_MAX
+} mirror_sync_state_t;
+
+/* Where the snapshot of a sync is read from */
+typedef enum {
+
+    /* The app's objects as they are, on the sender thread, while the
+     * app keeps updating them */
+    MIRROR_SNAPSHOT_LIVE,
+    /* A child forked at the sync's start lsn : the app's objects as
+     * they were at that instant, copy on write. The child walks them
+     * and hands the snapshot datagrams to the sender thread over a
+     * socketpair, the parent keeps running */
+    MIRROR_SNAPSHOT_FORK,
+    MIRROR_SNAPSHOT_MODE_MAX
+} mirror_snapshot_mode_t;
+
+/* How far a record must have made it when mirror_append() returns */
+typedef enum {
+
+    /* Fire and forget, once in the log */
+    MIRROR_DURABILITY_ASYNC,
+    /* Recvd by the peer */
+    MIRROR_DURABILITY_RECEIVED,
+    /* Applied by the peer */
+    MIRROR_DURABILITY_APPLIED,
+    MIRROR_DURABILITY_MAX
+} mirror_durability_t;
+
+#pragma pack (push,1)
+
+/* All fields in network byte order */
+typedef struct mirror_dgram_hdr_ {
+
+    uint8_t msg_type;
+    uint8_t flags;
+    uint16_t n_records;
+    uint32_t reserved;
+} mirror_dgram_hdr_t;
+
+typedef struct mirror_record_hdr_ {
+
+    uint64_t lsn;
+    uint64_t obj_id;
+    /* Wall clock time in usec of the append */
+    uint64_t timestamp;
+    uint32_t payload_len;
+    uint16_t op;
+    uint16_t flags;
+} mirror_record_hdr_t;
+
+/* Highest lsn recvd and applied by the sender of the ack. Also the
+ * payload of the ack piggybacked on KA msgs, without the hdr */
+typedef struct mirror_ack_msg_ {
+
+    uint8_t msg_type;
+    uint8_t flags;
+    uint8_t reserved[6];
+    uint64_t received_lsn;
+    uint64_t applied_lsn;
+} mirror_ack_msg_t;
+
+/* Sync begin, end, abort and resume */
+typedef struct mirror_sync_msg_ {
+
+    uint8_t msg_type;
+    uint8_t reserved[7];
+    /* First lsn not in the snapshot, or to resume from */
+    uint64_t start_lsn;
+    /* End : last lsn appended during the snapshot, and the no of
+     * snapshot records */
+    uint64_t ready_lsn;
+    uint64_t n_records;
+    /* Log of the master the lsns are of */
+    uint64_t log_id;
+} mirror_sync_msg_t;
+
+#pragma pack(pop)
+
+#define MIRROR_MAX_PAYLOAD_SIZE	\
+    (MIRROR_MAX_DGRAM_SIZE - sizeof(mirror_dgram_hdr_t) - \
+     sizeof(mirror_record_hdr_t))
+
+/* One record of a transaction, see mirror_append_txn() */
+typedef struct mirror_txn_rec_ {
+
+    uint64_t obj_id;
+    uint16_t op;
+    const void *payload;
+    uint32_t payload_len;
+} mirror_txn_rec_t;
+
+typedef struct mirror_ mirror_t;
+
+/* Backup : applies a record. Called on the recv thread, or with apply
+ * workers on the worker of obj_id : records of the same obj_id come in
+ * lsn order, those of other obj_ids may be applied at the same time */
+typedef void (*mirror_apply_fn)(mirror_t *mirror,
+                                uint64_t obj_id,
+                                uint16_t op,
+                                unsigned char *payload,
+                                uint32_t payload_len,
+                                mirror_lsn_t lsn);
+
+/* Master : copies the object at *cursor or the next one (*cursor is 0
+ * the first time) into payload, up to max_len bytes, and moves *cursor
+ * past it. Returns false once there are no more objects. A payload_len
+ * above max_len gives up the sync. Called on the sender thread while
+ * the app updates its objects.
+ *
+ * With MIRROR_SNAPSHOT_FORK, called in the forked child instead. It
+ * must not take the app's locks there : the threads which held them at
+ * the fork do not exist in the child, and nothing updates the objects */
+typedef bool (*mirror_snapshot_fn)(mirror_t *mirror,
+                                   void *arg,
+                                   uint64_t *cursor,
+                                   uint64_t *obj_id,
+                                   uint16_t *op,
+                                   unsigned char *payload,
+                                   uint32_t *payload_len,
+                                   uint32_t max_len);
+
+/* Both ends : the peer's (on the master) or our own (on the backup)
+ * sync state changed. A backup entering MIRROR_SYNC_SNAPSHOT is about
+ * to get every object anew, and may drop those it has */
+typedef void (*mirror_sync_event_fn)(mirror_t *mirror,
+                                     void *arg,
+                                     mirror_sync_state_t state);
+
+typedef struct mirror_stats_ {
+
+    /* Master side */
+    uint64_t appended_records;
+    uint64_t appended_bytes;
+    /* Appends which waited for the log to drain */
+    uint64_t append_stalls;
+    uint64_t sent_records;
+    uint64_t sent_bytes;
+    uint64_t tx_dgrams;
+    uint64_t tx_syscalls;
+    /* Backup side */
+    uint64_t rx_dgrams;
+    uint64_t rx_syscalls;
+    uint64_t applied_records;
+    uint64_t applied_bytes;
+    /* Records missing from the stream, and records with no apply cb */
+    uint64_t lost_records;
+    uint64_t unhandled_records;
+    mirror_lsn_t applied_lsn;
+    /* usecs from the append on the master to the apply on the backup */
+    conn_mgmt_hist_t apply_lag;
+    /* Transactions applied. Apply workers : times the recv thread
+     * waited for room in a worker's queue, and for all the workers to
+     * be done, ahead of a transaction or a sync msg */
+    uint64_t applied_txns;
+    uint64_t apply_queue_stalls;
+    uint64_t apply_barriers;
+    /* Coalescing stage : records staged, and those which replaced a
+     * staged record of the same obj */
+    uint64_t staged_records;
+    uint64_t merged_records;
+    /* Batches flushed to the log on reaching the size threshold, and
+     * on expiry of the latency budget */
+    uint64_t size_flushes;
+    uint64_t time_flushes;
+    /* usecs records spent staged before entering the log */
+    conn_mgmt_hist_t coalesce_delay;
+    /* Acks sent and recvd, on the data socket and on KA msgs */
+    uint64_t acks_tx;
+    uint64_t acks_rx;
+    uint64_t ka_acks_tx;
+    uint64_t ka_acks_rx;
+    /* Appends which gave up waiting for the peer's ack */
+    uint64_t ack_timeouts;
+    /* usecs mirror_append() took, per durability mode */
+    conn_mgmt_hist_t commit_latency[MIRROR_DURABILITY_MAX];
+    /* Bulk syncs started, aborted as the records held back went past
+     * the limit (or the connection went down), and done */
+    uint64_t syncs;
+    uint64_t sync_aborts;
+    uint64_t syncs_ready;
+    /* Snapshot records sent (master) or applied (backup) */
+    uint64_t snapshot_records;
+    uint64_t snapshot_bytes;
+    /* Bytes of records not sent as the connection was down, the next
+     * sync covers them */
+    uint64_t sync_skipped_bytes;
+    /* Most bytes of records held back by a sync */
+    uint64_t sync_peak_held_bytes;
+    /* Last sync : usecs spent streaming the snapshot, and from its
+     * start until the peer (or this backup) was ready */
+    uint64_t last_snapshot_usec;
+    uint64_t last_snapshot_bytes;
+    uint64_t last_ready_usec;
+    /* Forked snapshots : usecs the parent's appenders were held up by
+     * the fork, last and most */
+    uint64_t last_fork_usec;
+    uint64_t max_fork_usec;
+    /* Journal : records written to it (master : spilled, or kept once
+     * sent, backup : recvd), records sent from it, and times it filled
+     * up and dropped its records */
+    uint64_t journal_records;
+    uint64_t journal_bytes;
+    uint64_t journal_sent_records;
+    uint64_t journal_overflows;
+    /* Peers resumed from the journal and peers synced as it did not
+     * have their records (master), resumes of ours (backup) */
+    uint64_t resumes;
+    uint64_t resumes_refused;
+    /* Warm restart : records replayed from the journal, in usecs */
+    uint64_t replayed_records;
+    uint64_t replayed_bytes;
+    uint64_t replay_usec;
+} mirror_stats_t;
+
+/* A record held back by the coalescing stage */
+typedef struct mirror_staged_rec_ {
+
+    uint64_t obj_id;
+    uint16_t op;
+    uint32_t payload_len;
+    uint32_t payload_capacity;
+    unsigned char *payload;
+    /* Wall clock time in usec of the latest append */
+    uint64_t append_time;
+    /* Slot in the staging hash table */
+    uint32_t hash_slot;
+    /* Staged records in order of their latest append, as indexes */
+    int32_t prev;
+    int32_t next;
+} mirror_staged_rec_t;
+
+/* Applies, in lsn order, the records of the obj_ids hashed to it */
+typedef struct mirror_apply_worker_ {
+
+    mirror_t *mirror;
+    pthread_t thread;
+    /* Records in wire format, positions only ever grow. The recv
+     * thread fills up to pending_tail and hands them over by moving
+     * tail, the worker moves head past those it applied */
+    unsigned char *ring;
+    uint64_t head;
+    uint64_t tail;
+    uint64_t pending_tail;
+    /* lsn of the last record applied */
+    mirror_lsn_t done_lsn;
+    /* A record which wraps around the end of the ring, copied whole */
+    unsigned char *scratch;
+    pthread_mutex_t mutex;
+    pthread_cond_t data_cond;
+    pthread_cond_t room_cond;
+    bool data_waiting;
+    bool room_waiting;
+    bool stop;
+    /* Folded into the mirror's stats */
+    uint64_t applied_records;
+    uint64_t applied_bytes;
+    conn_mgmt_hist_t apply_lag;
+} mirror_apply_worker_t;
+
+struct mirror_ {
+
+    conn_mgmt_conn_state_t *conn;
+    /* Data msgs go over the data socket, or over xport if not NULL */
+    int sock_fd;
+    struct sockaddr_in peer_addr;
+    xport_t *xport;
+    /* Largest data msg, MIRROR_MAX_DGRAM_SIZE or less if the transport
+     * asks for it */
+    uint32_t max_dgram_size;
+    /* Replication log, a ring of records in wire format. Positions
+     * are byte offsets which only ever grow, size is a power of 2 */
+    unsigned char *log;
+    uint64_t log_size;
+    /* Oldest byte not sent yet, and end of the last record */
+    uint64_t log_head;
+    uint64_t log_tail;
+    mirror_lsn_t next_lsn;
+    pthread_mutex_t log_mutex;
+    /* Sender waits for records, appenders wait for room */
+    pthread_cond_t log_data_cond;
+    pthread_cond_t log_room_cond;
+    bool sender_waiting;
+    bool stop;
+    pthread_t sender_thread;
+    pthread_t recv_thread;
+    /* Coalescing stage, disabled while coalesce_window_usec is 0 */
+    uint32_t coalesce_window_usec;
+    uint32_t coalesce_batch_bytes;
+    mirror_staged_rec_t *staged;
+    uint32_t n_staged;
+    uint32_t staged_bytes;
+    int32_t staged_head;
+    int32_t staged_tail;
+    /* Open addressing on obj_id, staged index + 1, 0 when free */
+    uint32_t *staged_hash;
+    /* Monotonic time in usec of the first append of the batch */
+    uint64_t batch_open_time;
+    /* Durability of the records of each op */
+    mirror_durability_t op_durability[MIRROR_MAX_OPS];
+    /* Records of the op build on the earlier ones of their obj_id, the
+     * coalescing stage must not replace them */
+    bool op_ordered[MIRROR_MAX_OPS];
+    /* What the peer acked so far, appenders waiting for it sleep on
+     * ack_cond */
+    mirror_lsn_t peer_received_lsn;
+    mirror_lsn_t peer_applied_lsn;
+    pthread_mutex_t ack_mutex;
+    pthread_cond_t ack_cond;
+    uint32_t ack_waiters;
+    /* Next lsn expected from the peer, highest recvd */
+    mirror_lsn_t rx_next_lsn;
+    mirror_lsn_t rx_received_lsn;
+    mirror_apply_fn apply_cb[MIRROR_MAX_OPS];
+    /* Apply workers, none : records are applied on the recv thread.
+     * apply_mutex is held by the recv thread over a batch of msgs */
+    uint32_t n_apply_workers;
+    mirror_apply_worker_t *apply_workers;
+    pthread_mutex_t apply_mutex;
+    /* Last lsn handed to the workers, and the one they see. All lsns
+     * up to it are applied once the workers are idle */
+    mirror_lsn_t pending_lsn;
+    mirror_lsn_t dispatched_lsn;
+    /* applied_lsn moves up, and the peer is acked, under it. Lsn the
+     * peer waits to be acked as applied, 0 if none */
+    pthread_mutex_t applied_mutex;
+    mirror_lsn_t ack_applied_lsn;
+    /* Bulk sync, of the peer on the master and of ourselves on the
+     * backup */
+    mirror_snapshot_fn snapshot_cb;
+    mirror_sync_event_fn sync_event_cb;
+    void *sync_cb_arg;
+    mirror_snapshot_mode_t snapshot_mode;
+    mirror_sync_state_t sync_state;
+    bool sync_requested;
+    bool sync_abort;
+    /* Most bytes of records the log may hold back during a snapshot */
+    uint64_t sync_max_held_bytes;
+    mirror_lsn_t sync_start_lsn;
+    mirror_lsn_t sync_ready_lsn;
+    /* Monotonic time in usec the sync started */
+    uint64_t sync_start_time;
+    uint64_t sync_start_bytes;
+    /* Our log (master), and the master's log our state is of (backup,
+     * 0 : none whole), and the one of the sync in progress */
+    uint64_t log_id;
+    uint64_t peer_log_id;
+    uint64_t sync_log_id;
+    /* On-disk journal, NULL if none. Master : the records sent, and
+     * those spilled past journal_high_water bytes waiting in the log
+     * or while the peer is down. journal_pos is where the peer is at
+     * in it. Backup : the records recvd, journal_off once it was full
+     * until the next sync */
+    mirror_journal_t *journal;
+    uint64_t journal_high_water;
+    uint64_t journal_pos;
+    bool journal_off;
+    /* Resume asked for, by the peer (master) or of the peer (backup).
+     * Master : the peer which came up is to be told to ask, it may not
+     * have seen the connection go down, and the monotonic time in usec
+     * it is synced at if it did not ask by then, 0 if not waiting */
+    bool resume_requested;
+    bool resume_probe;
+    uint64_t resume_log_id;
+    mirror_lsn_t resume_lsn;
+    uint64_t resume_deadline;
+    conn_mgmt_conn_status_t conn_status;
+    /* Monotonic time in usec when the mirror was created */
+    uint64_t start_time;
+    mirror_stats_t stats;
+};
+
+/* Mirrors between the two ends of conn, with data msgs sent from
+ * data_src_port to data_dst_port at the connection's addresses.
+ * log_size 0 picks MIRROR_DEFAULT_LOG_SIZE. The mirror takes over the
+ * KA piggyback of conn, for its acks. NULL once MIRROR_MAX_MIRRORS
+ * mirrors exist */
+mirror_t *
+mirror_create(conn_mgmt_conn_state_t *conn,
+              uint16_t data_src_port,
+              uint16_t data_dst_port,
+              uint64_t log_size);
+
+/* mirror_create() with the data msgs carried, one per transport msg,
+ * by a transport of the given type between the same ports. Records
+ * must then fit the transport's msgs as well */
+mirror_t *
+mirror_create_on_xport(conn_mgmt_conn_state_t *conn,
+                       xport_type_t xport_type,
+                       uint16_t data_src_port,
+                       uint16_t data_dst_port,
+                       uint64_t log_size);
+
+void
+mirror_destroy(mirror_t *mirror);
+
+void
+mirror_register_apply_cb(mirror_t *mirror,
+                         uint16_t op,
+                         mirror_apply_fn cb);
+
+/* Appends a record to the log, blocks while the log is full, and then
+ * until the peer acks the record if op's durability asks for it.
+ * Returns false if the payload is too large or the peer did not ack
+ * within the connection's hold time.
+ *
+ * With coalescing enabled, async records are staged : the record gets
+ * its lsn when its batch enters the log, and a later append to the
+ * same obj_id before that replaces it (last writer wins). Other
+ * records flush the staged ones and go straight to the log */
+bool
+mirror_append(mirror_t *mirror,
+              uint64_t obj_id,
+              uint16_t op,
+              const void *payload,
+              uint32_t payload_len);
+
+/* mirror_append() with the durability given per call */
+bool
+mirror_append_durable(mirror_t *mirror,
+                      uint64_t obj_id,
+                      uint16_t op,
+                      const void *payload,
+                      uint32_t payload_len,
+                      mirror_durability_t durability);
+
+/* Durability of the records of op appended with mirror_append(),
+ * MIRROR_DURABILITY_ASYNC until set */
+void
+mirror_set_op_durability(mirror_t *mirror,
+                         uint16_t op,
+                         mirror_durability_t durability);
+
+/* Records of op patch the earlier records of their obj_id rather than
+ * replace them : with coalescing, one of them flushes the batch if its
+ * obj_id is staged already, rather than replace the staged record */
+void
+mirror_set_op_ordered(mirror_t *mirror,
+                      uint16_t op,
+                      bool ordered);
+
+/* Holds back appended records for up to window_usec, merging repeated
+ * updates of the same obj_id, and moves them to the log once the
+ * batch reaches batch_bytes of payload or window_usec expires.
+ * window_usec 0 disables coalescing, batch_bytes 0 picks
+ * MIRROR_COALESCE_DEFAULT_BYTES */
+void
+mirror_set_coalescing(mirror_t *mirror,
+                      uint32_t window_usec,
+                      uint32_t batch_bytes);
+
+/* Moves the staged records to the log right away */
+void
+mirror_flush(mirror_t *mirror);
+
+/* Appends the records of a transaction, with lsns in a row, and
+ * returns once the last one is as durable as asked. The backup applies
+ * a transaction's records in order after all records before them, and
+ * those after them only once it is done. Returns false if a payload
+ * is too large, they do not fit in half the log, or the peer did not
+ * ack in time */
+bool
+mirror_append_txn(mirror_t *mirror,
+                  const mirror_txn_rec_t *recs,
+                  uint32_t n_recs,
+                  mirror_durability_t durability);
+
+/* Backup : applies records on n_workers threads, each with the
+ * records of the obj_ids hashed to it (at most
+ * MIRROR_MAX_APPLY_WORKERS). 0, the default, applies them on the recv
+ * thread. Records already handed to the workers are applied first */
+void
+mirror_set_apply_workers(mirror_t *mirror,
+                         uint32_t n_workers);
+
+/* Syncs the backup whenever the connection comes up, with the objects
+ * snapshot_cb walks (on the master, NULL : no syncs), and tells the app
+ * about the progress of syncs with event_cb (optional) */
+void
+mirror_set_sync_cbs(mirror_t *mirror,
+                    mirror_snapshot_fn snapshot_cb,
+                    mirror_sync_event_fn event_cb,
+                    void *arg);
+
+/* Bytes of records the log may hold back while a snapshot is being
+ * sent, the sync is aborted past it. The master never allocates for a
+ * sync : held back records stay in the log, so at most half of it.
+ * 0 picks a quarter of the log */
+void
+mirror_set_sync_limit(mirror_t *mirror,
+                      uint64_t max_held_bytes);
+
+/* Reads the snapshots of later syncs live (the default) or in a forked
+ * child, see mirror_snapshot_mode_t */
+void
+mirror_set_snapshot_mode(mirror_t *mirror,
+                         mirror_snapshot_mode_t mode);
+
+/* Master : every record sent is also written to journal, and records
+ * past high_water_bytes waiting in the log, or appended while the peer
+ * is down, are moved to the journal instead, to be sent from there in
+ * order. The journal keeps records until the peer applied them. A
+ * backup which comes back (or up again, with a journal of its own)
+ * resumes from the journal instead of being synced, if it has the
+ * records the backup misses. The master carries on with the log of
+ * the journal, if it has records : its lsns, and its log id.
+ *
+ * Backup : every record recvd is written to journal before it is
+ * applied, and the journal's records, if they are of a whole sync, are
+ * applied right away : a warm restart, the backup then asks the master
+ * to resume from there. The apply cbs must be registered, and the
+ * connection not up yet.
+ *
+ * The app closes journal after mirror_destroy(). Returns the no of
+ * records replayed */
+uint64_t
+mirror_set_journal(mirror_t *mirror,
+                   mirror_journal_t *journal,
+                   uint64_t high_water_bytes);
+
+/* Syncs the peer now, on the master, rather than when it comes up */
+void
+mirror_start_sync(mirror_t *mirror);
+
+const char *
+mirror_sync_state_str(mirror_sync_state_t state);
+
+/* Not from an apply cb, with apply workers it waits for the batch of
+ * msgs being applied */
+void
+mirror_get_stats(mirror_t *mirror, mirror_stats_t *stats);
+
+/* Counters, with rates averaged since the mirror was created */
+void
+mirror_print_stats(mirror_t *mirror);
+
+#endif /* __MIRROR__ */
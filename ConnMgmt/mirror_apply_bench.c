@@ -0,0 +1,269 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  mirror_apply_bench.c
+ *
+ *    Description: This file benchmarks the apply of records on the backup with 0 to 16
+ *                 apply workers, and checks that the records of an object and the
+ *                 transactions are applied in order
+ *
+ *        Version:  1.0
+ *        Created:  10/18/2026 07:02:15 AM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  ABHISHEK SAGAR (), sachinites@gmail.com
+ *   Organization:  Juniper Networks
+ *
+ * =====================================================================================
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "mirror.h"
+
+#define BENCH_CONN_PORT		25500
+#define BENCH_DATA_PORT		25600
+#define BENCH_OP_UPDATE		1
+#define BENCH_OP_TXN		2
+#define BENCH_N_OBJS		65536
+#define BENCH_TXN_OBJS		4
+#define BENCH_LOG_SIZE		(64 * 1024 * 1024)
+
+typedef struct bench_rec_ {
+
+	/* Per object, from 1 */
+	uint64_t seq;
+	unsigned char data[56];
+} bench_rec_t;
+
+static uint32_t n_records = 200000;
+static uint32_t apply_usec = 5;
+/* Apply spins on the CPU, or sleeps as if waiting on a disk */
+static bool apply_sleeps;
+/* 1 in txn_every appends is a transaction, 0 : none */
+static uint32_t txn_every = 1000;
+
+static uint64_t master_seq[BENCH_N_OBJS];
+static uint64_t backup_seq[BENCH_N_OBJS];
+/* Records applied this run, and those applied with lsn base_lsn + 1 on */
+static uint64_t n_applied;
+static mirror_lsn_t base_lsn;
+static uint64_t order_errors;
+static uint64_t txn_errors;
+
+static uint64_t
+bench_now_usec() {
+
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (ts.tv_sec * 1000000ULL) + (ts.tv_nsec / 1000);
+}
+
+/* What the app does with a record besides storing it */
+static void
+bench_apply_work() {
+
+	uint64_t end;
+	struct timespec ts;
+
+	if (!apply_usec) return;
+
+	if (apply_sleeps) {
+		ts.tv_sec = 0;
+		ts.tv_nsec = apply_usec * 1000;
+		nanosleep(&ts, NULL);
+		return;
+	}
+	end = bench_now_usec() + apply_usec;
+	while (bench_now_usec() < end);
+}
+
+static void
+bench_apply(mirror_t *mirror, uint64_t obj_id, uint16_t op,
+			unsigned char *payload, uint32_t payload_len, mirror_lsn_t lsn) {
+
+	bench_rec_t rec;
+
+	if (obj_id >= BENCH_N_OBJS || payload_len != sizeof(rec)) return;
+	memcpy(&rec, payload, sizeof(rec));
+
+	/* An object's records come in the order they were appended */
+	if (rec.seq <= backup_seq[obj_id]) {
+		__sync_fetch_and_add(&order_errors, 1);
+	}
+	backup_seq[obj_id] = rec.seq;
+
+	/* A transaction's record : all records before it are applied, and
+	 * none after it */
+	if (op == BENCH_OP_TXN &&
+		__atomic_load_n(&n_applied, __ATOMIC_ACQUIRE) != lsn - 1 - base_lsn) {
+		__sync_fetch_and_add(&txn_errors, 1);
+	}
+
+	bench_apply_work();
+	__atomic_add_fetch(&n_applied, 1, __ATOMIC_RELEASE);
+}
+
+static void
+bench_fill(bench_rec_t *rec, uint64_t obj_id) {
+
+	rec->seq = ++master_seq[obj_id];
+	memset(rec->data, (int)rec->seq, sizeof(rec->data));
+}
+
+/* Appends a transaction of BENCH_TXN_OBJS objects in a row */
+static bool
+bench_append_txn(mirror_t *master, mirror_durability_t durability) {
+
+	uint32_t i;
+	bench_rec_t recs[BENCH_TXN_OBJS];
+	mirror_txn_rec_t txn[BENCH_TXN_OBJS];
+
+	for (i = 0; i < BENCH_TXN_OBJS; i++) {
+		txn[i].obj_id = (BENCH_N_OBJS / BENCH_TXN_OBJS) * i +
+						rand() % (BENCH_N_OBJS / BENCH_TXN_OBJS);
+		txn[i].op = BENCH_OP_TXN;
+		txn[i].payload = &recs[i];
+		txn[i].payload_len = sizeof(recs[i]);
+		bench_fill(&recs[i], txn[i].obj_id);
+	}
+	return mirror_append_txn(master, txn, BENCH_TXN_OBJS, durability);
+}
+
+/* Appends n_records as fast as the master can, then a transaction
+ * acked once applied : the backup is done when it returns */
+static void
+bench_run(mirror_t *master, mirror_t *backup, uint32_t n_workers,
+		  double *base_rate) {
+
+	uint32_t i;
+	uint64_t start, elapsed, obj_id;
+	double rate;
+	bool done;
+	bench_rec_t rec;
+	mirror_stats_t s0, s1;
+
+	mirror_set_apply_workers(backup, n_workers);
+	mirror_get_stats(backup, &s0);
+
+	n_applied = 0;
+	base_lsn = master->next_lsn - 1;
+	order_errors = txn_errors = 0;
+	srand(n_workers + 1);
+
+	start = bench_now_usec();
+
+	for (i = 0; i < n_records; i++) {
+		if (txn_every && i % txn_every == txn_every - 1) {
+			bench_append_txn(master, MIRROR_DURABILITY_ASYNC);
+			continue;
+		}
+		obj_id = (((uint64_t)rand() << 16) ^ rand()) % BENCH_N_OBJS;
+		bench_fill(&rec, obj_id);
+		mirror_append(master, obj_id, BENCH_OP_UPDATE, &rec, sizeof(rec));
+	}
+	/* The ack may give up before a slow backup is done */
+	if (!bench_append_txn(master, MIRROR_DURABILITY_APPLIED)) {
+		while (backup->stats.applied_lsn < master->next_lsn - 1 &&
+			   bench_now_usec() - start < 120000000) {
+			usleep(1000);
+		}
+	}
+	done = backup->stats.applied_lsn >= master->next_lsn - 1;
+
+	elapsed = bench_now_usec() - start;
+	mirror_get_stats(backup, &s1);
+
+	rate = n_applied / (elapsed / 1e6);
+	if (!*base_rate) *base_rate = rate;
+
+	printf("%7u %12.0f %8.2f %10.1f %8lu %9lu %7lu %7lu  %s\n",
+		n_workers, rate, rate / *base_rate, elapsed / 1e3,
+		s1.apply_queue_stalls - s0.apply_queue_stalls,
+		s1.apply_barriers - s0.apply_barriers,
+		order_errors, txn_errors,
+		!done ? "TIMEOUT" : (order_errors || txn_errors) ? "FAIL" : "ok");
+	fflush(stdout);
+}
+
+int
+main(int argc, char **argv) {
+
+	uint32_t i, mismatches = 0;
+	uint64_t start;
+	double base_rate = 0;
+	xport_type_t xport_type = XPORT_SHM;
+	mirror_t *master, *backup;
+	conn_mgmt_conn_state_t *master_conn, *backup_conn;
+	static const uint32_t workers[] = {0, 1, 2, 4, 8, 16};
+
+	if (argc > 1) n_records = atoi(argv[1]);
+	if (argc > 2) apply_usec = atoi(argv[2]);
+	if (argc > 3) apply_sleeps = !strcmp(argv[3], "sleep");
+	if (argc > 4) txn_every = atoi(argv[4]);
+	if (argc > 5) {
+		for (i = 0; i < XPORT_TYPE_MAX; i++) {
+			if (!strcmp(argv[5], xport_type_str(i))) xport_type = i;
+		}
+	}
+
+	conn_mgmt_init();
+	conn_mgmt_set_io_mode(CONN_MGMT_IO_EVENT_LOOP, 1);
+
+	conn_mgmt_configure_connection("master", "127.0.0.1", BENCH_CONN_PORT,
+		"127.0.0.1", BENCH_CONN_PORT + 1, "master");
+	conn_mgmt_configure_connection("backup", "127.0.0.1", BENCH_CONN_PORT + 1,
+		"127.0.0.1", BENCH_CONN_PORT, "backup");
+	master_conn = conn_mgmt_lookup_connection_by_name("master");
+	backup_conn = conn_mgmt_lookup_connection_by_name("backup");
+	if (!master_conn || !backup_conn) return -1;
+
+	master = mirror_create_on_xport(master_conn, xport_type,
+		BENCH_DATA_PORT, BENCH_DATA_PORT + 1, BENCH_LOG_SIZE);
+	backup = mirror_create_on_xport(backup_conn, xport_type,
+		BENCH_DATA_PORT + 1, BENCH_DATA_PORT, BENCH_LOG_SIZE);
+	if (!master || !backup) return -1;
+
+	mirror_register_apply_cb(backup, BENCH_OP_UPDATE, bench_apply);
+	mirror_register_apply_cb(backup, BENCH_OP_TXN, bench_apply);
+
+	/* Records appended while the connection is down are not sent */
+	start = bench_now_usec();
+	while (master_conn->conn_status != COMM_MGMT_CONN_UP &&
+		   bench_now_usec() - start < 5000000) {
+		usleep(1000);
+	}
+
+	printf("%u records of %lu bytes over %s, apply %s %u usec per record,"
+		" 1 in %u appends a %u object transaction\n", n_records,
+		sizeof(bench_rec_t), xport_type_str(xport_type),
+		apply_sleeps ? "sleeps" : "spins", apply_usec, txn_every,
+		BENCH_TXN_OBJS);
+	printf("workers 0 : applied on the recv thread, %ld CPUs online\n",
+		sysconf(_SC_NPROCESSORS_ONLN));
+	printf("%7s %12s %8s %10s %8s %9s %7s %7s  %s\n", "workers",
+		"applied/s", "speedup", "msec", "stalls", "barriers",
+		"order", "txn", "check");
+
+	for (i = 0; i < sizeof(workers) / sizeof(workers[0]); i++) {
+		bench_run(master, backup, workers[i], &base_rate);
+	}
+
+	for (i = 0; i < BENCH_N_OBJS; i++) {
+		if (backup_seq[i] != master_seq[i]) mismatches++;
+	}
+	printf("%s : %u objects of the backup differ from the master's\n",
+		mismatches ? "FAIL" : "PASS", mismatches);
+
+	printf("\n");
+	mirror_print_stats(backup);
+
+	mirror_destroy(master);
+	mirror_destroy(backup);
+	return 0;
+}
@@ -0,0 +1,169 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  mirror_bench.c
+ *
+ *    Description: This file benchmarks state mirroring over a loopback master/backup
+ *                 pair : records/s and MB/s appended and applied, records lost,
+ *                 and the lag from append on the master to apply on the backup
+ *
+ *        Version:  1.0
+ *        Created:  10/17/2026 09:05:52 PM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  ABHISHEK SAGAR (), sachinites@gmail.com
+ *   Organization:  Juniper Networks
+ *
+ * =====================================================================================
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "mirror.h"
+
+#define BENCH_CONN_PORT		24000
+#define BENCH_DATA_PORT		24100
+#define BENCH_N_OBJS		4096
+#define BENCH_OP_UPDATE		1
+
+static uint32_t payload_sizes[] = {16, 64, 256, 1024, 4096};
+/* Backup's copy of the app state */
+static unsigned char backup_objs[BENCH_N_OBJS][MIRROR_MAX_PAYLOAD_SIZE];
+
+static uint64_t
+bench_now_usec() {
+
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (ts.tv_sec * 1000000ULL) + (ts.tv_nsec / 1000);
+}
+
+static void
+bench_apply(mirror_t *mirror, uint64_t obj_id, uint16_t op,
+			unsigned char *payload, uint32_t payload_len, mirror_lsn_t lsn) {
+
+	memcpy(backup_objs[obj_id % BENCH_N_OBJS], payload, payload_len);
+}
+
+/* Appends payload_size records for duration_usec, at rate records/s
+ * (0 : as fast as possible), and waits for the backup to settle */
+static void
+bench_run(mirror_t *master, mirror_t *backup, uint32_t payload_size,
+		  uint64_t duration_usec, uint32_t rate) {
+
+	uint64_t i = 0, start, now, elapsed, due;
+	unsigned char payload[MIRROR_MAX_PAYLOAD_SIZE];
+	mirror_stats_t m0, m1, b0, b1;
+	mirror_lsn_t last_lsn;
+	double secs;
+
+	memset(payload, 0xab, sizeof(payload));
+	mirror_get_stats(master, &m0);
+	mirror_get_stats(backup, &b0);
+
+	start = bench_now_usec();
+
+	do {
+		mirror_append(master, i % BENCH_N_OBJS, BENCH_OP_UPDATE,
+					  payload, payload_size);
+		i++;
+		now = bench_now_usec();
+		/* Sleep off being ahead of schedule, in chunks : the
+		 * mirror threads may well share the CPU with us */
+		if (rate) {
+			due = start + (i * 1000000ULL) / rate;
+			if (due > now + 50) {
+				usleep(due - now);
+				now = bench_now_usec();
+			}
+		}
+	} while (now - start < duration_usec);
+
+	elapsed = now - start;
+	last_lsn = master->next_lsn - 1;
+
+	/* Until the last record is applied, or clearly lost */
+	while (backup->stats.applied_lsn < last_lsn &&
+		   bench_now_usec() - now < 1000000) {
+		usleep(1000);
+	}
+	usleep(10000);
+
+	mirror_get_stats(master, &m1);
+	mirror_get_stats(backup, &b1);
+	conn_mgmt_hist_sub(&b1.apply_lag, &b0.apply_lag);
+
+	secs = elapsed / 1e6;
+	printf("%7u %8u %10.0f %9.1f %10.0f %9.1f %8lu %8lu %8lu %8lu %8lu\n",
+		payload_size, rate,
+		(m1.appended_records - m0.appended_records) / secs,
+		(m1.appended_bytes - m0.appended_bytes) / secs / 1e6,
+		(b1.applied_records - b0.applied_records) / secs,
+		(b1.applied_bytes - b0.applied_bytes) / secs / 1e6,
+		b1.lost_records - b0.lost_records,
+		conn_mgmt_hist_percentile(&b1.apply_lag, 50),
+		conn_mgmt_hist_percentile(&b1.apply_lag, 99),
+		conn_mgmt_hist_percentile(&b1.apply_lag, 99.9),
+		conn_mgmt_hist_percentile(&b1.apply_lag, 100));
+	fflush(stdout);
+}
+
+int
+main(int argc, char **argv) {
+
+	uint32_t i;
+	uint32_t duration_msec = 1000;
+	uint32_t paced_rate = 100000;
+	mirror_t *master, *backup;
+	conn_mgmt_conn_state_t *master_conn, *backup_conn;
+
+	if (argc > 1) duration_msec = atoi(argv[1]);
+	if (argc > 2) paced_rate = atoi(argv[2]);
+
+	conn_mgmt_init();
+	conn_mgmt_set_io_mode(CONN_MGMT_IO_EVENT_LOOP, 1);
+
+	conn_mgmt_configure_connection("master", "127.0.0.1", BENCH_CONN_PORT,
+		"127.0.0.1", BENCH_CONN_PORT + 1, "master");
+	conn_mgmt_configure_connection("backup", "127.0.0.1", BENCH_CONN_PORT + 1,
+		"127.0.0.1", BENCH_CONN_PORT, "backup");
+	master_conn = conn_mgmt_lookup_connection_by_name("master");
+	backup_conn = conn_mgmt_lookup_connection_by_name("backup");
+	if (!master_conn || !backup_conn) return -1;
+
+	master = mirror_create(master_conn, BENCH_DATA_PORT,
+						   BENCH_DATA_PORT + 1, 0);
+	backup = mirror_create(backup_conn, BENCH_DATA_PORT + 1,
+						   BENCH_DATA_PORT, 0);
+	if (!master || !backup) return -1;
+
+	mirror_register_apply_cb(backup, BENCH_OP_UPDATE, bench_apply);
+
+	printf("%u msec per run, lag in usec, rate 0 : as fast as possible\n",
+		duration_msec);
+	printf("%7s %8s %10s %9s %10s %9s %8s %8s %8s %8s %8s\n",
+		"payload", "rate", "append/s", "app MB/s", "applied/s", "apl MB/s",
+		"lost", "lag p50", "p99", "p99.9", "max");
+
+	for (i = 0; i < sizeof(payload_sizes)/sizeof(payload_sizes[0]); i++) {
+		bench_run(master, backup, payload_sizes[i],
+				  duration_msec * 1000ULL, 0);
+	}
+	for (i = 0; i < sizeof(payload_sizes)/sizeof(payload_sizes[0]); i++) {
+		bench_run(master, backup, payload_sizes[i],
+				  duration_msec * 1000ULL, paced_rate);
+	}
+
+	printf("\n");
+	mirror_print_stats(master);
+	mirror_print_stats(backup);
+
+	mirror_destroy(master);
+	mirror_destroy(backup);
+	return 0;
+}
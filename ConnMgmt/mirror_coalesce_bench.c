@@ -0,0 +1,181 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  mirror_coalesce_bench.c
+ *
+ *    Description: This file benchmarks the coalescing stage of the mirror sender on
+ *                 a high churn workload, sweeping the latency budget : records and
+ *                 bytes put on the wire, syscalls, and the delay added
+ *
+ *        Version:  1.0
+ *        Created:  10/17/2026 09:48:03 PM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  ABHISHEK SAGAR (), sachinites@gmail.com
+ *   Organization:  Juniper Networks
+ *
+ * =====================================================================================
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "mirror.h"
+
+#define BENCH_CONN_PORT		24200
+#define BENCH_DATA_PORT		24300
+#define BENCH_OP_UPDATE		1
+#define BENCH_PAYLOAD_SIZE	128
+/* 90% of the updates hit the few hot objs */
+#define BENCH_N_OBJS		100000
+#define BENCH_N_HOT_OBJS	64
+#define BENCH_HOT_PCT		90
+
+static uint32_t windows_usec[] = {0, 50, 200, 1000, 5000};
+
+static uint64_t
+bench_now_usec() {
+
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (ts.tv_sec * 1000000ULL) + (ts.tv_nsec / 1000);
+}
+
+static inline uint64_t
+bench_rand(uint64_t *state) {
+
+	*state ^= *state << 13;
+	*state ^= *state >> 7;
+	*state ^= *state << 17;
+	return *state;
+}
+
+static void
+bench_apply(mirror_t *mirror, uint64_t obj_id, uint16_t op,
+			unsigned char *payload, uint32_t payload_len, mirror_lsn_t lsn) {
+}
+
+static void
+bench_run(mirror_t *master, mirror_t *backup, uint32_t window_usec,
+		  uint64_t duration_usec, uint32_t rate) {
+
+	uint64_t i = 0, start, now, elapsed, due, r;
+	uint64_t rand_state = 0x2545F4914F6CDD1DULL;
+	uint64_t obj_id;
+	unsigned char payload[BENCH_PAYLOAD_SIZE];
+	mirror_stats_t m0, m1, b0, b1;
+	mirror_lsn_t last_lsn;
+	double secs;
+
+	memset(payload, 0x5a, sizeof(payload));
+	mirror_set_coalescing(master, window_usec, 0);
+	mirror_get_stats(master, &m0);
+	mirror_get_stats(backup, &b0);
+
+	start = bench_now_usec();
+
+	do {
+		r = bench_rand(&rand_state);
+		obj_id = (r % 100) < BENCH_HOT_PCT ?
+				 (r >> 8) % BENCH_N_HOT_OBJS : (r >> 8) % BENCH_N_OBJS;
+		memcpy(payload, &i, sizeof(i));
+		mirror_append(master, obj_id, BENCH_OP_UPDATE, payload,
+					  sizeof(payload));
+		i++;
+		now = bench_now_usec();
+		if (rate) {
+			due = start + (i * 1000000ULL) / rate;
+			if (due > now + 50) {
+				usleep(due - now);
+				now = bench_now_usec();
+			}
+		}
+	} while (now - start < duration_usec);
+
+	elapsed = now - start;
+	mirror_flush(master);
+	last_lsn = master->next_lsn - 1;
+
+	while (backup->stats.applied_lsn < last_lsn &&
+		   bench_now_usec() - now < 1000000) {
+		usleep(1000);
+	}
+	usleep(10000);
+
+	mirror_get_stats(master, &m1);
+	mirror_get_stats(backup, &b1);
+	conn_mgmt_hist_sub(&m1.coalesce_delay, &m0.coalesce_delay);
+	conn_mgmt_hist_sub(&b1.apply_lag, &b0.apply_lag);
+
+	secs = elapsed / 1e6;
+	printf("%6u %7u %9.0f %9.0f %6.1f %8.0f %8.0f %7.2f %7lu %7lu %7lu %7lu\n",
+		window_usec, rate,
+		(m1.appended_records - m0.appended_records) / secs,
+		(m1.sent_records - m0.sent_records) / secs,
+		m1.staged_records - m0.staged_records ?
+			(100.0 * (m1.merged_records - m0.merged_records)) /
+			(m1.staged_records - m0.staged_records) : 0,
+		(m1.tx_dgrams - m0.tx_dgrams) / secs,
+		(m1.tx_syscalls - m0.tx_syscalls) / secs,
+		(m1.sent_bytes - m0.sent_bytes) / secs / 1e6,
+		conn_mgmt_hist_percentile(&m1.coalesce_delay, 50),
+		conn_mgmt_hist_percentile(&m1.coalesce_delay, 99),
+		conn_mgmt_hist_percentile(&b1.apply_lag, 50),
+		conn_mgmt_hist_percentile(&b1.apply_lag, 99));
+	fflush(stdout);
+}
+
+int
+main(int argc, char **argv) {
+
+	uint32_t i, j;
+	uint32_t duration_msec = 1000;
+	uint32_t rates[] = {200000, 0};
+	mirror_t *master, *backup;
+	conn_mgmt_conn_state_t *master_conn, *backup_conn;
+
+	if (argc > 1) duration_msec = atoi(argv[1]);
+	if (argc > 2) rates[0] = atoi(argv[2]);
+
+	conn_mgmt_init();
+	conn_mgmt_set_io_mode(CONN_MGMT_IO_EVENT_LOOP, 1);
+
+	conn_mgmt_configure_connection("master", "127.0.0.1", BENCH_CONN_PORT,
+		"127.0.0.1", BENCH_CONN_PORT + 1, "master");
+	conn_mgmt_configure_connection("backup", "127.0.0.1", BENCH_CONN_PORT + 1,
+		"127.0.0.1", BENCH_CONN_PORT, "backup");
+	master_conn = conn_mgmt_lookup_connection_by_name("master");
+	backup_conn = conn_mgmt_lookup_connection_by_name("backup");
+	if (!master_conn || !backup_conn) return -1;
+
+	master = mirror_create(master_conn, BENCH_DATA_PORT,
+						   BENCH_DATA_PORT + 1, 0);
+	backup = mirror_create(backup_conn, BENCH_DATA_PORT + 1,
+						   BENCH_DATA_PORT, 0);
+	if (!master || !backup) return -1;
+
+	mirror_register_apply_cb(backup, BENCH_OP_UPDATE, bench_apply);
+
+	printf("%u byte updates, %u%% of them to %u hot objs out of %u, "
+		"%u msec per run\n", BENCH_PAYLOAD_SIZE, BENCH_HOT_PCT,
+		BENCH_N_HOT_OBJS, BENCH_N_OBJS, duration_msec);
+	printf("window and delays in usec, rate 0 : as fast as possible\n");
+	printf("%6s %7s %9s %9s %6s %8s %8s %7s %7s %7s %7s %7s\n",
+		"window", "rate", "append/s", "wire r/s", "merge%", "dgrams/s",
+		"sysc/s", "MB/s", "dly p50", "dly p99", "lag p50", "lag p99");
+
+	for (j = 0; j < sizeof(rates)/sizeof(rates[0]); j++) {
+		for (i = 0; i < sizeof(windows_usec)/sizeof(windows_usec[0]); i++) {
+			bench_run(master, backup, windows_usec[i],
+					  duration_msec * 1000ULL, rates[j]);
+		}
+	}
+
+	mirror_destroy(master);
+	mirror_destroy(backup);
+	return 0;
+}
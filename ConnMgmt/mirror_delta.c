@@ -0,0 +1,290 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  mirror_delta.c
+ *
+ *    Description: This file implements the delta encoder : block compare routines per
+ *                 instruction set, and the encoding and application of patches
+ *
+ *        Version:  1.0
+ *        Created:  10/18/2026 05:26:09 AM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  ABHISHEK SAGAR (), sachinites@gmail.com
+ *   Organization:  Juniper Networks
+ *
+ * =====================================================================================
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <arpa/inet.h>
+#include "mirror_delta.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define MIRROR_DELTA_X86
+#include <immintrin.h>
+#endif
+
+/* Bit i of the result is set if block i of a and b differ, n_blocks is
+ * MIRROR_DELTA_CHUNK_BLOCKS at most */
+typedef uint64_t (*mirror_delta_diff_fn)(const unsigned char *a,
+                                         const unsigned char *b,
+                                         uint32_t n_blocks);
+
+static uint64_t
+mirror_delta_diff_scalar(const unsigned char *a, const unsigned char *b,
+                         uint32_t n_blocks) {
+
+    uint32_t i, j;
+    uint64_t mask = 0, x[8], y[8], d;
+
+    for (i = 0; i < n_blocks; i++, a += MIRROR_DELTA_BLOCK_SIZE,
+                                   b += MIRROR_DELTA_BLOCK_SIZE) {
+        memcpy(x, a, MIRROR_DELTA_BLOCK_SIZE);
+        memcpy(y, b, MIRROR_DELTA_BLOCK_SIZE);
+        d = 0;
+        for (j = 0; j < 8; j++) d |= x[j] ^ y[j];
+        if (d) mask |= 1ULL << i;
+    }
+    return mask;
+}
+
+#ifdef MIRROR_DELTA_X86
+
+static uint64_t
+mirror_delta_diff_sse2(const unsigned char *a, const unsigned char *b,
+                       uint32_t n_blocks) {
+
+    uint32_t i;
+    uint64_t mask = 0;
+    __m128i eq0, eq1;
+
+    for (i = 0; i < n_blocks; i++, a += MIRROR_DELTA_BLOCK_SIZE,
+                                   b += MIRROR_DELTA_BLOCK_SIZE) {
+        eq0 = _mm_and_si128(
+            _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)a),
+                           _mm_loadu_si128((const __m128i *)b)),
+            _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(a + 16)),
+                           _mm_loadu_si128((const __m128i *)(b + 16))));
+        eq1 = _mm_and_si128(
+            _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(a + 32)),
+                           _mm_loadu_si128((const __m128i *)(b + 32))),
+            _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(a + 48)),
+                           _mm_loadu_si128((const __m128i *)(b + 48))));
+        if (_mm_movemask_epi8(_mm_and_si128(eq0, eq1)) != 0xffff) {
+            mask |= 1ULL << i;
+        }
+    }
+    return mask;
+}
+
+/* Built for AVX2 whatever the compiler flags, run only if the CPU has
+ * it */
+__attribute__((target("avx2"))) static uint64_t
+mirror_delta_diff_avx2(const unsigned char *a, const unsigned char *b,
+                       uint32_t n_blocks) {
+
+    uint32_t i;
+    uint64_t mask = 0;
+    __m256i d;
+
+    for (i = 0; i < n_blocks; i++, a += MIRROR_DELTA_BLOCK_SIZE,
+                                   b += MIRROR_DELTA_BLOCK_SIZE) {
+        d = _mm256_or_si256(
+            _mm256_xor_si256(_mm256_loadu_si256((const __m256i *)a),
+                             _mm256_loadu_si256((const __m256i *)b)),
+            _mm256_xor_si256(_mm256_loadu_si256((const __m256i *)(a + 32)),
+                             _mm256_loadu_si256((const __m256i *)(b + 32))));
+        if (!_mm256_testz_si256(d, d)) mask |= 1ULL << i;
+    }
+    return mask;
+}
+
+#endif /* MIRROR_DELTA_X86 */
+
+static const mirror_delta_diff_fn mirror_delta_diff_fns[MIRROR_DELTA_ISA_MAX] = {
+    mirror_delta_diff_scalar,
+#ifdef MIRROR_DELTA_X86
+    mirror_delta_diff_sse2,
+    mirror_delta_diff_avx2
+#endif
+};
+
+/* MIRROR_DELTA_ISA_MAX until picked */
+static mirror_delta_isa_t mirror_delta_isa = MIRROR_DELTA_ISA_MAX;
+
+static bool
+mirror_delta_isa_supported(mirror_delta_isa_t isa) {
+
+    switch (isa) {
+        case MIRROR_DELTA_ISA_SCALAR:
+            return true;
+#ifdef MIRROR_DELTA_X86
+        case MIRROR_DELTA_ISA_SSE2:
+            return __builtin_cpu_supports("sse2");
+        case MIRROR_DELTA_ISA_AVX2:
+            return __builtin_cpu_supports("avx2");
+#endif
+        default:
+            return false;
+    }
+}
+
+mirror_delta_isa_t
+mirror_delta_get_isa(void) {
+
+    int isa;
+
+    if (mirror_delta_isa != MIRROR_DELTA_ISA_MAX) return mirror_delta_isa;
+
+    for (isa = MIRROR_DELTA_ISA_MAX - 1; isa > MIRROR_DELTA_ISA_SCALAR;
+         isa--) {
+        if (mirror_delta_isa_supported(isa)) break;
+    }
+    mirror_delta_isa = isa;
+    return mirror_delta_isa;
+}
+
+bool
+mirror_delta_set_isa(mirror_delta_isa_t isa) {
+
+    if (!mirror_delta_isa_supported(isa)) return false;
+    mirror_delta_isa = isa;
+    return true;
+}
+
+const char *
+mirror_delta_isa_str(mirror_delta_isa_t isa) {
+
+    static const char *names[MIRROR_DELTA_ISA_MAX] =
+        {"scalar", "sse2", "avx2"};
+
+    return isa < MIRROR_DELTA_ISA_MAX ? names[isa] : "unknown";
+}
+
+/* Patches being encoded */
+typedef struct mirror_delta_enc_ {
+
+    const unsigned char *cur;
+    unsigned char *shadow;
+    unsigned char *out;
+    uint32_t out_max;
+    uint32_t used;
+    /* Last patch, its hdr in out and its end in the buffer */
+    mirror_delta_patch_hdr_t *last;
+    uint32_t last_end;
+} mirror_delta_enc_t;
+
+/* Emits the changed bytes of cur from start to end. A patch closer to
+ * the last one than a patch hdr grows the last one instead */
+static bool
+mirror_delta_emit(mirror_delta_enc_t *enc, uint32_t start, uint32_t end) {
+
+    uint32_t from;
+
+    while (start < end && enc->cur[start] == enc->shadow[start]) start++;
+    while (end > start && enc->cur[end - 1] == enc->shadow[end - 1]) end--;
+    /* Changed back since it was compared */
+    if (start == end) return true;
+
+    if (enc->last &&
+        start - enc->last_end < sizeof(mirror_delta_patch_hdr_t)) {
+        from = enc->last_end;
+    } else {
+        if (enc->used + sizeof(mirror_delta_patch_hdr_t) > enc->out_max) {
+            return false;
+        }
+        enc->last = (mirror_delta_patch_hdr_t *)(enc->out + enc->used);
+        enc->last->offset = htonl(start);
+        enc->last->len = 0;
+        enc->used += sizeof(mirror_delta_patch_hdr_t);
+        from = start;
+    }
+
+    if (enc->used + (end - from) > enc->out_max) return false;
+
+    /* The shadow gets the very bytes the patch carries */
+    memcpy(enc->out + enc->used, enc->cur + from, end - from);
+    memcpy(enc->shadow + from, enc->out + enc->used, end - from);
+    enc->used += end - from;
+    enc->last->len = htonl(ntohl(enc->last->len) + (end - from));
+    enc->last_end = end;
+    return true;
+}
+
+bool
+mirror_delta_encode(const unsigned char *cur, unsigned char *shadow,
+                    uint32_t len, unsigned char *out, uint32_t out_max,
+                    uint32_t *out_len) {
+
+    uint32_t n_blocks = len / MIRROR_DELTA_BLOCK_SIZE;
+    uint32_t block, n, bit, run;
+    uint64_t mask;
+    mirror_delta_diff_fn diff = mirror_delta_diff_fns[mirror_delta_get_isa()];
+    mirror_delta_enc_t enc;
+
+    memset(&enc, 0, sizeof(enc));
+    enc.cur = cur;
+    enc.shadow = shadow;
+    enc.out = out;
+    enc.out_max = out_max;
+    *out_len = 0;
+
+    for (block = 0; block < n_blocks; block += n) {
+
+        n = n_blocks - block;
+        if (n > MIRROR_DELTA_CHUNK_BLOCKS) n = MIRROR_DELTA_CHUNK_BLOCKS;
+
+        mask = diff(cur + (block * MIRROR_DELTA_BLOCK_SIZE),
+                    shadow + (block * MIRROR_DELTA_BLOCK_SIZE), n);
+
+        /* Runs of changed blocks */
+        while (mask) {
+            bit = __builtin_ctzll(mask);
+            run = (mask >> bit) == ~0ULL >> bit ?
+                  64 - bit : (uint32_t)__builtin_ctzll(~(mask >> bit));
+            if (!mirror_delta_emit(&enc,
+                    (block + bit) * MIRROR_DELTA_BLOCK_SIZE,
+                    (block + bit + run) * MIRROR_DELTA_BLOCK_SIZE)) {
+                return false;
+            }
+            mask &= run == 64 ? 0 : ~(((1ULL << run) - 1) << bit);
+        }
+    }
+
+    /* Partial block at the end */
+    block = n_blocks * MIRROR_DELTA_BLOCK_SIZE;
+    if (block < len && memcmp(cur + block, shadow + block, len - block)) {
+        if (!mirror_delta_emit(&enc, block, len)) return false;
+    }
+
+    *out_len = enc.used;
+    return true;
+}
+
+bool
+mirror_delta_apply(unsigned char *dst, uint32_t dst_len,
+                   const unsigned char *patches, uint32_t patches_len) {
+
+    uint32_t pos = 0, offset, len;
+    mirror_delta_patch_hdr_t hdr;
+
+    while (pos < patches_len) {
+
+        if (patches_len - pos < sizeof(hdr)) return false;
+        memcpy(&hdr, patches + pos, sizeof(hdr));
+        pos += sizeof(hdr);
+        offset = ntohl(hdr.offset);
+        len = ntohl(hdr.len);
+
+        if (len > patches_len - pos || offset > dst_len ||
+            len > dst_len - offset) {
+            return false;
+        }
+        memcpy(dst + offset, patches + pos, len);
+        pos += len;
+    }
+    return true;
+}
@@ -0,0 +1,91 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  mirror_delta.h
+ *
+ *    Description: This file defines the interfaces of the delta encoder, which turns
+ *                 the bytes of a buffer changed since it was last mirrored into
+ *                 patches for the backup
+ *
+ *        Version:  1.0
+ *        Created:  10/18/2026 05:26:09 AM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  ABHISHEK SAGAR (), sachinites@gmail.com
+ *   Organization:  Juniper Networks
+ *
+ * =====================================================================================
+ */
+#ifndef __MIRROR_DELTA__
+#define __MIRROR_DELTA__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* The master keeps a shadow copy of the bytes the backup has, a page of
+ * a mirrored region or a large object. The encoder compares the buffer
+ * with its shadow 64 bytes at a time, with AVX2 or SSE2 where the CPU
+ * has them, trims each run of changed blocks down to the changed bytes,
+ * and emits it as a patch : offset, len, and the bytes. The shadow gets
+ * the bytes of the patches, the backup applies the patches in place.
+ *
+ * The buffer may change while it is encoded : the patches carry the
+ * bytes as they were read, which is what the shadow gets too */
+
+#define MIRROR_DELTA_BLOCK_SIZE		64
+/* Blocks compared per call of the compare routine, a bit each */
+#define MIRROR_DELTA_CHUNK_BLOCKS	64
+
+typedef enum {
+
+    MIRROR_DELTA_ISA_SCALAR,
+    MIRROR_DELTA_ISA_SSE2,
+    MIRROR_DELTA_ISA_AVX2,
+    MIRROR_DELTA_ISA_MAX
+} mirror_delta_isa_t;
+
+#pragma pack (push,1)
+
+/* All fields in network byte order, followed by len bytes */
+typedef struct mirror_delta_patch_hdr_ {
+
+    uint32_t offset;
+    uint32_t len;
+} mirror_delta_patch_hdr_t;
+
+#pragma pack(pop)
+
+/* Encodes the bytes of cur which differ from shadow into out as
+ * patches, and copies them into shadow. *out_len is 0 if nothing
+ * differs. Returns false if the patches need more than out_max bytes :
+ * shadow is then partly updated, the caller sends cur whole and
+ * copies it into shadow */
+bool
+mirror_delta_encode(const unsigned char *cur,
+                    unsigned char *shadow,
+                    uint32_t len,
+                    unsigned char *out,
+                    uint32_t out_max,
+                    uint32_t *out_len);
+
+/* Applies the patches to dst, false if they go past dst_len or are cut
+ * short */
+bool
+mirror_delta_apply(unsigned char *dst,
+                   uint32_t dst_len,
+                   const unsigned char *patches,
+                   uint32_t patches_len);
+
+/* Compare routine in use, the best the CPU runs until set */
+mirror_delta_isa_t
+mirror_delta_get_isa(void);
+
+/* Uses isa from now on, false if the CPU does not run it */
+bool
+mirror_delta_set_isa(mirror_delta_isa_t isa);
+
+const char *
+mirror_delta_isa_str(mirror_delta_isa_t isa);
+
+#endif /* __MIRROR_DELTA__ */
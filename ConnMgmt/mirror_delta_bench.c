@@ -0,0 +1,201 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  mirror_delta_bench.c
+ *
+ *    Description: This file benchmarks the delta encoder page by page over a buffer
+ *                 and its shadow : diff throughput per compare routine, and bytes
+ *                 saved over whole pages, for several update patterns
+ *
+ *        Version:  1.0
+ *        Created:  10/18/2026 05:26:09 AM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  ABHISHEK SAGAR (), sachinites@gmail.com
+ *   Organization:  Juniper Networks
+ *
+ * =====================================================================================
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include "mirror_delta.h"
+
+#define BENCH_PAGE_SIZE		4096
+#define BENCH_RECORD_SIZE	64
+#define BENCH_MIN_USEC		300000
+
+typedef enum {
+
+	/* Written back with the same bytes */
+	BENCH_UNCHANGED,
+	/* An 8 byte counter bumped in every page */
+	BENCH_COUNTERS,
+	/* 1 in 10 64 byte records gets its 24 byte hdr rewritten */
+	BENCH_RECORDS,
+	/* 1 in 20 pages gets a 100 byte text field rewritten */
+	BENCH_STRINGS,
+	/* Every byte rewritten */
+	BENCH_REWRITE,
+	BENCH_PATTERN_MAX
+} bench_pattern_t;
+
+static const char *pattern_names[BENCH_PATTERN_MAX] =
+	{"unchanged", "counters", "records", "strings", "rewrite"};
+
+static uint64_t
+bench_now_usec() {
+
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (ts.tv_sec * 1000000ULL) + (ts.tv_nsec / 1000);
+}
+
+static void
+bench_fill_random(unsigned char *buf, uint64_t len) {
+
+	uint64_t i;
+
+	for (i = 0; i < len; i++) buf[i] = rand();
+}
+
+static void
+bench_apply_pattern(bench_pattern_t pattern, unsigned char *cur,
+					uint64_t len) {
+
+	uint64_t page, rec, off;
+	uint64_t n_pages = len / BENCH_PAGE_SIZE;
+
+	switch (pattern) {
+		case BENCH_UNCHANGED:
+			break;
+		case BENCH_COUNTERS:
+			for (page = 0; page < n_pages; page++) {
+				off = page * BENCH_PAGE_SIZE +
+					  (rand() % (BENCH_PAGE_SIZE / 8)) * 8;
+				(*(uint64_t *)(cur + off))++;
+			}
+			break;
+		case BENCH_RECORDS:
+			for (rec = 0; rec < len / BENCH_RECORD_SIZE; rec++) {
+				if (rand() % 10) continue;
+				bench_fill_random(cur + rec * BENCH_RECORD_SIZE, 24);
+			}
+			break;
+		case BENCH_STRINGS:
+			for (page = 0; page < n_pages; page++) {
+				if (rand() % 20) continue;
+				off = page * BENCH_PAGE_SIZE +
+					  rand() % (BENCH_PAGE_SIZE - 100);
+				bench_fill_random(cur + off, 100);
+			}
+			break;
+		case BENCH_REWRITE:
+			bench_fill_random(cur, len);
+			break;
+		default:
+			break;
+	}
+}
+
+/* Encodes every page of cur against shadow, once to check the patches
+ * rebuild cur from base, then as many times as BENCH_MIN_USEC allows */
+static void
+bench_run(bench_pattern_t pattern, mirror_delta_isa_t isa,
+		  const unsigned char *base, const unsigned char *cur,
+		  unsigned char *shadow, unsigned char *check, uint64_t len) {
+
+	uint64_t page, start, elapsed = 0, iters = 0;
+	uint64_t changed = 0, payload = 0;
+	uint32_t out_len;
+	unsigned char out[BENCH_PAGE_SIZE];
+	bool encoded, ok = true;
+
+	mirror_delta_set_isa(isa);
+
+	memcpy(shadow, base, len);
+	memcpy(check, base, len);
+	for (page = 0; page < len; page += BENCH_PAGE_SIZE) {
+		encoded = mirror_delta_encode(cur + page, shadow + page,
+			BENCH_PAGE_SIZE, out, BENCH_PAGE_SIZE - 1, &out_len);
+		if (encoded && !out_len) continue;
+		changed++;
+		if (encoded) {
+			payload += out_len;
+			ok &= mirror_delta_apply(check + page, BENCH_PAGE_SIZE,
+									 out, out_len);
+		}
+		else {
+			payload += BENCH_PAGE_SIZE;
+			memcpy(shadow + page, cur + page, BENCH_PAGE_SIZE);
+			memcpy(check + page, cur + page, BENCH_PAGE_SIZE);
+		}
+	}
+	ok &= !memcmp(check, cur, len) && !memcmp(shadow, cur, len);
+
+	while (elapsed < BENCH_MIN_USEC) {
+		memcpy(shadow, base, len);
+		start = bench_now_usec();
+		for (page = 0; page < len; page += BENCH_PAGE_SIZE) {
+			mirror_delta_encode(cur + page, shadow + page, BENCH_PAGE_SIZE,
+				out, BENCH_PAGE_SIZE - 1, &out_len);
+		}
+		elapsed += bench_now_usec() - start;
+		iters++;
+	}
+
+	printf("%-10s %-7s %8.2f %9lu %9lu %11.3f %7.2f  %s\n",
+		pattern_names[pattern], mirror_delta_isa_str(isa),
+		(double)len * iters / elapsed / 1e3, len / BENCH_PAGE_SIZE,
+		changed, payload / 1e6,
+		changed ? 100.0 - (100.0 * payload) / (changed * BENCH_PAGE_SIZE) : 0,
+		ok ? "ok" : "MISMATCH");
+	fflush(stdout);
+}
+
+int
+main(int argc, char **argv) {
+
+	uint32_t buf_mb = 64;
+	uint64_t len;
+	int pattern, isa;
+	mirror_delta_isa_t best;
+	unsigned char *base, *cur, *shadow, *check;
+
+	if (argc > 1) buf_mb = atoi(argv[1]);
+	len = (uint64_t)buf_mb << 20;
+
+	base = malloc(len);
+	cur = malloc(len);
+	shadow = malloc(len);
+	check = malloc(len);
+	if (!base || !cur || !shadow || !check) return -1;
+
+	srand(1);
+	bench_fill_random(base, len);
+	best = mirror_delta_get_isa();
+
+	printf("%u MB buffer of %u byte pages, best compare routine %s,"
+		" saved : over the changed pages whole\n", buf_mb, BENCH_PAGE_SIZE,
+		mirror_delta_isa_str(best));
+	printf("%-10s %-7s %8s %9s %9s %11s %7s  %s\n", "pattern", "isa",
+		"GB/s", "pages", "changed", "payload MB", "saved%", "check");
+
+	for (pattern = 0; pattern < BENCH_PATTERN_MAX; pattern++) {
+
+		memcpy(cur, base, len);
+		bench_apply_pattern(pattern, cur, len);
+
+		for (isa = 0; isa < MIRROR_DELTA_ISA_MAX; isa++) {
+			if (!mirror_delta_set_isa(isa)) continue;
+			bench_run(pattern, isa, base, cur, shadow, check, len);
+		}
+	}
+	mirror_delta_set_isa(best);
+	return 0;
+}
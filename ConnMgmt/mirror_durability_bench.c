@@ -0,0 +1,179 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  mirror_durability_bench.c
+ *
+ *    Description: This file benchmarks the commit latency of the mirror durability
+ *                 modes over a loopback master/backup pair, and the acks which ride
+ *                 on the KA msgs of the connection
+ *
+ *        Version:  1.0
+ *        Created:  10/17/2026 10:31:26 PM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  ABHISHEK SAGAR (), sachinites@gmail.com
+ *   Organization:  Juniper Networks
+ *
+ * =====================================================================================
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "mirror.h"
+
+#define BENCH_CONN_PORT		24400
+#define BENCH_DATA_PORT		24500
+#define BENCH_N_OBJS		4096
+#define BENCH_OP_UPDATE		1
+#define BENCH_OP_CRITICAL	2
+#define BENCH_PAYLOAD_SIZE	128
+#define BENCH_KA_INTERVAL	20
+
+static const char *mode_names[MIRROR_DURABILITY_MAX] =
+	{"async", "received", "applied"};
+
+static uint64_t
+bench_now_usec() {
+
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (ts.tv_sec * 1000000ULL) + (ts.tv_nsec / 1000);
+}
+
+static void
+bench_apply(mirror_t *mirror, uint64_t obj_id, uint16_t op,
+			unsigned char *payload, uint32_t payload_len, mirror_lsn_t lsn) {
+}
+
+/* Commits one record at a time in the given mode for duration_usec,
+ * one in every critical_every (0 : none) as a durable op instead */
+static void
+bench_run(mirror_t *master, mirror_durability_t mode,
+		  uint32_t critical_every, uint64_t duration_usec) {
+
+	uint64_t i = 0, start, now, elapsed;
+	unsigned char payload[BENCH_PAYLOAD_SIZE];
+	mirror_stats_t m0, m1;
+	mirror_durability_t shown = mode;
+	double secs;
+
+	memset(payload, 0xcd, sizeof(payload));
+	mirror_get_stats(master, &m0);
+	start = bench_now_usec();
+
+	do {
+		if (critical_every && (i % critical_every) == 0) {
+			mirror_append(master, i % BENCH_N_OBJS, BENCH_OP_CRITICAL,
+						  payload, sizeof(payload));
+		}
+		else {
+			mirror_append_durable(master, i % BENCH_N_OBJS,
+				BENCH_OP_UPDATE, payload, sizeof(payload), mode);
+		}
+		i++;
+		now = bench_now_usec();
+	} while (now - start < duration_usec);
+
+	elapsed = now - start;
+	mirror_get_stats(master, &m1);
+	secs = elapsed / 1e6;
+
+	/* In the mixed run, the latency of the durable op is what counts */
+	if (critical_every) shown = master->op_durability[BENCH_OP_CRITICAL];
+	conn_mgmt_hist_sub(&m1.commit_latency[shown],
+					   &m0.commit_latency[shown]);
+
+	printf("%-9s %6u %10.0f %8lu %8lu %8lu %8lu %8lu %8lu\n",
+		mode_names[mode], critical_every,
+		(m1.appended_records - m0.appended_records) / secs,
+		conn_mgmt_hist_percentile(&m1.commit_latency[shown], 50),
+		conn_mgmt_hist_percentile(&m1.commit_latency[shown], 99),
+		conn_mgmt_hist_percentile(&m1.commit_latency[shown], 99.9),
+		m1.acks_rx - m0.acks_rx,
+		m1.ka_acks_rx - m0.ka_acks_rx,
+		m1.ack_timeouts - m0.ack_timeouts);
+	fflush(stdout);
+}
+
+int
+main(int argc, char **argv) {
+
+	uint32_t i;
+	uint32_t duration_msec = 1000;
+	uint64_t start;
+	mirror_lsn_t last_lsn;
+	mirror_t *master, *backup;
+	conn_mgmt_conn_state_t *master_conn, *backup_conn;
+
+	if (argc > 1) duration_msec = atoi(argv[1]);
+
+	conn_mgmt_init();
+	conn_mgmt_set_io_mode(CONN_MGMT_IO_EVENT_LOOP, 1);
+
+	conn_mgmt_configure_connection("master", "127.0.0.1", BENCH_CONN_PORT,
+		"127.0.0.1", BENCH_CONN_PORT + 1, "master");
+	conn_mgmt_configure_connection("backup", "127.0.0.1", BENCH_CONN_PORT + 1,
+		"127.0.0.1", BENCH_CONN_PORT, "backup");
+	master_conn = conn_mgmt_lookup_connection_by_name("master");
+	backup_conn = conn_mgmt_lookup_connection_by_name("backup");
+	if (!master_conn || !backup_conn) return -1;
+
+	conn_mgmt_set_conn_ka_interval(master_conn, BENCH_KA_INTERVAL);
+	conn_mgmt_set_conn_ka_interval(backup_conn, BENCH_KA_INTERVAL);
+
+	master = mirror_create(master_conn, BENCH_DATA_PORT,
+						   BENCH_DATA_PORT + 1, 0);
+	backup = mirror_create(backup_conn, BENCH_DATA_PORT + 1,
+						   BENCH_DATA_PORT, 0);
+	if (!master || !backup) return -1;
+
+	mirror_register_apply_cb(backup, BENCH_OP_UPDATE, bench_apply);
+	mirror_register_apply_cb(backup, BENCH_OP_CRITICAL, bench_apply);
+	mirror_set_op_durability(master, BENCH_OP_CRITICAL,
+							 MIRROR_DURABILITY_APPLIED);
+
+	/* Acks ride on v2 KA msgs only */
+	start = bench_now_usec();
+	while ((master_conn->conn_status != COMM_MGMT_CONN_UP ||
+			backup_conn->ka_tx_version != CONN_MGMT_KA_VERSION_2) &&
+		   bench_now_usec() - start < 5000000) {
+		usleep(1000);
+	}
+
+	printf("%u byte records committed one at a time, %u msec per run,"
+		" KA interval %u msec\n", BENCH_PAYLOAD_SIZE, duration_msec,
+		BENCH_KA_INTERVAL);
+	printf("latency in usec, mixed : 1 in every N records is an applied op,"
+		" its latency shown\n");
+	printf("%-9s %6s %10s %8s %8s %8s %8s %8s %8s\n",
+		"mode", "mixed", "commits/s", "p50", "p99", "p99.9",
+		"acks", "KA acks", "timeouts");
+
+	for (i = 0; i < MIRROR_DURABILITY_MAX; i++) {
+		bench_run(master, i, 0, duration_msec * 1000ULL);
+	}
+	bench_run(master, MIRROR_DURABILITY_ASYNC, 100, duration_msec * 1000ULL);
+
+	/* Async records get acked too, a KA interval or so later */
+	last_lsn = master->next_lsn - 1;
+	start = bench_now_usec();
+	while (master->peer_applied_lsn < last_lsn &&
+		   bench_now_usec() - start < 1000000) {
+		usleep(1000);
+	}
+	printf("\nlast async record acked on a KA msg after %lu usec\n",
+		bench_now_usec() - start);
+
+	printf("\n");
+	mirror_print_stats(master);
+	mirror_print_stats(backup);
+
+	mirror_destroy(master);
+	mirror_destroy(backup);
+	return 0;
+}
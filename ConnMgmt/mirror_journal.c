@@ -0,0 +1,712 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  mirror_journal.c
+ *
+ *    Description: This file implements the on-disk replication journal : segment files
+ *                 mapped in memory, the framing of records, and their recovery
+ *
+ *        Version:  1.0
+ *        Created:  10/18/2026 08:21:44 AM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  ABHISHEK SAGAR (), sachinites@gmail.com
+ *   Organization:  Juniper Networks
+ *
+ * =====================================================================================
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "mirror_journal.h"
+#include "conn_mgmt_ka.h"
+
+#define MIRROR_JOURNAL_SPARE_NAME	"mirror-spare.jnl"
+#define MIRROR_JOURNAL_HDR_SIZE		sizeof(mirror_journal_seg_hdr_t)
+
+#define MIRROR_JOURNAL_FRAME_SIZE(len)	\
+    ((sizeof(mirror_journal_frame_t) + (len) + MIRROR_JOURNAL_ALIGN - 1) & \
+     ~(uint64_t)(MIRROR_JOURNAL_ALIGN - 1))
+
+/* Of the frame's len and lsn and of the record, seeded with the seq of
+ * the segment : frames left over from a recycled segment's past do not
+ * check out */
+static uint32_t
+mirror_journal_crc(uint64_t seq, const mirror_journal_frame_t *frame,
+                   const unsigned char *rec) {
+
+    uint32_t crc = (uint32_t)(seq * 0x9e3779b97f4a7c15ULL);
+
+    crc = conn_mgmt_crc32c(crc, (const unsigned char *)&frame->len,
+                           sizeof(frame->len));
+    crc = conn_mgmt_crc32c(crc, (const unsigned char *)&frame->lsn,
+                           sizeof(frame->lsn));
+    return conn_mgmt_crc32c(crc, rec, frame->len);
+}
+
+static void
+mirror_journal_seg_path(mirror_journal_t *journal, uint64_t seq,
+                        char *path, size_t path_size) {
+
+    snprintf(path, path_size, "%s/mirror-%016lx.jnl", journal->dir, seq);
+}
+
+static void
+mirror_journal_spare_path(mirror_journal_t *journal, char *path,
+                          size_t path_size) {
+
+    snprintf(path, path_size, "%s/" MIRROR_JOURNAL_SPARE_NAME, journal->dir);
+}
+
+/* Maps the segment file open on fd whole, false if it is not of the
+ * journal's segment size */
+static bool
+mirror_journal_seg_map(mirror_journal_t *journal, mirror_journal_seg_t *seg,
+                       int fd) {
+
+    struct stat st;
+
+    if (fstat(fd, &st) < 0 || (uint64_t)st.st_size != journal->segment_size) {
+        return false;
+    }
+    seg->base = mmap(NULL, journal->segment_size, PROT_READ | PROT_WRITE,
+                     MAP_SHARED, fd, 0);
+    if (seg->base == MAP_FAILED) {
+        printf("Error : mirror journal %s : mmap failed, errno = %d\n",
+               journal->dir, errno);
+        seg->base = NULL;
+        return false;
+    }
+    seg->fd = fd;
+    return true;
+}
+
+static void
+mirror_journal_seg_unmap(mirror_journal_t *journal,
+                         mirror_journal_seg_t *seg) {
+
+    munmap(seg->base, journal->segment_size);
+    close(seg->fd);
+    seg->fd = -1;
+    seg->base = NULL;
+}
+
+/* The segment starts out empty, at the journal's next lsn */
+static void
+mirror_journal_seg_init(mirror_journal_t *journal, mirror_journal_seg_t *seg,
+                        uint64_t seq, uint32_t flags) {
+
+    mirror_journal_seg_hdr_t *hdr = (mirror_journal_seg_hdr_t *)seg->base;
+
+    seg->seq = seq;
+    seg->used = MIRROR_JOURNAL_HDR_SIZE;
+    seg->last_lsn = 0;
+
+    memset(hdr, 0, sizeof(*hdr));
+    hdr->magic = MIRROR_JOURNAL_MAGIC;
+    hdr->version = MIRROR_JOURNAL_VERSION;
+    hdr->log_id = journal->log_id;
+    hdr->seq = seq;
+    hdr->segment_size = journal->segment_size;
+    hdr->first_lsn = journal->next_lsn;
+    hdr->flags = flags;
+}
+
+/* A new segment file, the spare one renamed if there is one. Its
+ * blocks are allocated up front : a write through the map past the
+ * room left on the disk would be a SIGBUS */
+static bool
+mirror_journal_seg_create(mirror_journal_t *journal, uint64_t seq,
+                          uint32_t flags, mirror_journal_seg_t *seg) {
+
+    int fd;
+    char path[512], spare_path[512];
+
+    mirror_journal_seg_path(journal, seq, path, sizeof(path));
+
+    if (journal->spare.fd >= 0) {
+        mirror_journal_spare_path(journal, spare_path, sizeof(spare_path));
+        if (rename(spare_path, path) == 0) {
+            *seg = journal->spare;
+            journal->spare.fd = -1;
+            journal->spare.base = NULL;
+            journal->stats.segments_recycled++;
+            goto init;
+        }
+        mirror_journal_seg_unmap(journal, &journal->spare);
+    }
+
+    fd = open(path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        printf("Error : mirror journal %s : segment creation failed,"
+               " errno = %d\n", journal->dir, errno);
+        return false;
+    }
+    if (ftruncate(fd, journal->segment_size) < 0 ||
+        posix_fallocate(fd, 0, journal->segment_size) != 0 ||
+        !mirror_journal_seg_map(journal, seg, fd)) {
+        printf("Error : mirror journal %s : no room for a segment of %lu"
+               " bytes\n", journal->dir, journal->segment_size);
+        close(fd);
+        unlink(path);
+        return false;
+    }
+    journal->stats.segments_created++;
+
+init:
+    mirror_journal_seg_init(journal, seg, seq, flags);
+    return true;
+}
+
+/* The segment is done with : kept as the spare if there is none */
+static void
+mirror_journal_seg_drop(mirror_journal_t *journal,
+                        mirror_journal_seg_t *seg) {
+
+    char path[512], spare_path[512];
+
+    mirror_journal_seg_path(journal, seg->seq, path, sizeof(path));
+
+    if (journal->spare.fd < 0) {
+        mirror_journal_spare_path(journal, spare_path, sizeof(spare_path));
+        if (rename(path, spare_path) == 0) {
+            journal->spare = *seg;
+            return;
+        }
+    }
+    mirror_journal_seg_unmap(journal, seg);
+    unlink(path);
+}
+
+/* Appends a new segment after the last one, false if every segment is
+ * in use */
+static bool
+mirror_journal_roll(mirror_journal_t *journal) {
+
+    uint64_t seq;
+    mirror_journal_seg_t *last;
+
+    if (journal->n_segs == journal->max_segments) return false;
+
+    /* A recycled segment has the frames of its past after its last
+     * one : recovery stops at a frame of len 0 instead */
+    if (journal->n_segs) {
+        last = &journal->segs[journal->n_segs - 1];
+        if (last->used + sizeof(mirror_journal_frame_t) <=
+            journal->segment_size) {
+            memset(last->base + last->used, 0,
+                   sizeof(mirror_journal_frame_t));
+        }
+    }
+
+    seq = journal->n_segs ? journal->segs[journal->n_segs - 1].seq + 1 : 0;
+    if (!mirror_journal_seg_create(journal, seq,
+            journal->n_segs ? 0 : MIRROR_JOURNAL_SEG_F_FIRST,
+            &journal->segs[journal->n_segs])) {
+        return false;
+    }
+    journal->n_segs++;
+    return true;
+}
+
+/* Recovery : checks the frames of the segment, from the start. Zeroes
+ * from the first one which does not check out, returns false if there
+ * was one */
+static bool
+mirror_journal_seg_recover(mirror_journal_t *journal,
+                           mirror_journal_seg_t *seg) {
+
+    uint64_t off = MIRROR_JOURNAL_HDR_SIZE;
+    mirror_journal_frame_t *frame;
+
+    seg->last_lsn = 0;
+
+    while (off + sizeof(*frame) <= journal->segment_size) {
+
+        frame = (mirror_journal_frame_t *)(seg->base + off);
+        if (!frame->len) break;
+
+        if (frame->len > journal->segment_size - off - sizeof(*frame) ||
+            frame->crc != mirror_journal_crc(seg->seq, frame,
+                              (const unsigned char *)(frame + 1))) {
+            journal->stats.dropped_bytes += journal->segment_size - off;
+            memset(seg->base + off, 0, journal->segment_size - off);
+            seg->used = off;
+            return false;
+        }
+        if (frame->lsn > seg->last_lsn) seg->last_lsn = frame->lsn;
+        journal->stats.recovered_records++;
+        off += MIRROR_JOURNAL_FRAME_SIZE(frame->len);
+    }
+    seg->used = off;
+    return true;
+}
+
+static int
+mirror_journal_seq_cmp(const void *a, const void *b) {
+
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+
+    return x < y ? -1 : x > y;
+}
+
+/* Seqs of the segment files in the journal's dir, in order */
+static uint32_t
+mirror_journal_list(mirror_journal_t *journal, uint64_t **seqs) {
+
+    DIR *dir;
+    struct dirent *entry;
+    uint64_t seq;
+    uint32_t n = 0, size = 16;
+    char tail[8];
+
+    *seqs = malloc(size * sizeof(uint64_t));
+    dir = opendir(journal->dir);
+    if (!dir) return 0;
+
+    while ((entry = readdir(dir))) {
+        if (sscanf(entry->d_name, "mirror-%16lx%7s", &seq, tail) != 2 ||
+            strcmp(tail, ".jnl")) {
+            continue;
+        }
+        if (n == size) {
+            size *= 2;
+            *seqs = realloc(*seqs, size * sizeof(uint64_t));
+        }
+        (*seqs)[n++] = seq;
+    }
+    closedir(dir);
+
+    qsort(*seqs, n, sizeof(uint64_t), mirror_journal_seq_cmp);
+    return n;
+}
+
+/* Maps the segments of the dir. The journal is made of the newest run
+ * of segments in a row of the same log, from the last one it was
+ * started or reset with, up to the first frame which does not check
+ * out. Other segments are removed */
+static void
+mirror_journal_recover(mirror_journal_t *journal) {
+
+    int fd;
+    uint32_t i, j, n, first;
+    uint64_t *seqs, next_lsn;
+    char path[512];
+    mirror_journal_seg_t *seg;
+    mirror_journal_seg_hdr_t *hdrs;
+
+    n = mirror_journal_list(journal, &seqs);
+    hdrs = calloc(n + 1, sizeof(mirror_journal_seg_hdr_t));
+
+    for (i = 0; i < n; i++) {
+        mirror_journal_seg_path(journal, seqs[i], path, sizeof(path));
+        fd = open(path, O_RDONLY | O_CLOEXEC);
+        if (fd < 0) continue;
+        if (pread(fd, &hdrs[i], sizeof(hdrs[i]), 0) != sizeof(hdrs[i]) ||
+            hdrs[i].magic != MIRROR_JOURNAL_MAGIC ||
+            hdrs[i].version != MIRROR_JOURNAL_VERSION ||
+            hdrs[i].seq != seqs[i] ||
+            hdrs[i].segment_size != journal->segment_size) {
+            hdrs[i].magic = 0;
+        }
+        close(fd);
+    }
+
+    /* A reset which did not finish leaves the segments before it */
+    first = n;
+    while (first && hdrs[first - 1].magic &&
+           (first == n || (seqs[first - 1] + 1 == seqs[first] &&
+                           hdrs[first - 1].log_id == hdrs[n - 1].log_id))) {
+        first--;
+        if (hdrs[first].flags & MIRROR_JOURNAL_SEG_F_FIRST) break;
+    }
+    if (first == n && n) {
+        printf("Error : mirror journal %s : no segment of %lu bytes found\n",
+               journal->dir, journal->segment_size);
+    }
+    if (n - first > journal->max_segments) {
+        journal->max_segments = n - first;
+        journal->segs = realloc(journal->segs, journal->max_segments *
+                                sizeof(mirror_journal_seg_t));
+    }
+
+    for (i = first; i < n; i++) {
+        mirror_journal_seg_path(journal, seqs[i], path, sizeof(path));
+        fd = open(path, O_RDWR | O_CLOEXEC);
+        if (fd < 0) break;
+        if (!mirror_journal_seg_map(journal,
+                                    &journal->segs[journal->n_segs], fd)) {
+            close(fd);
+            break;
+        }
+        seg = &journal->segs[journal->n_segs];
+        seg->seq = seqs[i];
+        journal->n_segs++;
+        if (mirror_journal_seg_recover(journal, seg) || i == n - 1) continue;
+
+        /* The segment ends early, the stale frames of a recycled one
+         * written by an older version, or a torn write. Only if its
+         * records lead up to the next segment's do the next ones go on
+         * from it */
+        next_lsn = seg->last_lsn >= hdrs[i].first_lsn ?
+                   seg->last_lsn + 1 : hdrs[i].first_lsn;
+        if (next_lsn != hdrs[i + 1].first_lsn) {
+            i++;
+            break;
+        }
+    }
+
+    /* What is not part of the journal goes */
+    for (j = 0; j < n; j++) {
+        if (j >= first && j < i) continue;
+        mirror_journal_seg_path(journal, seqs[j], path, sizeof(path));
+        unlink(path);
+    }
+
+    free(seqs);
+    free(hdrs);
+}
+
+mirror_journal_t *
+mirror_journal_open(const char *dir, uint64_t segment_size,
+                    uint64_t max_bytes) {
+
+    int fd;
+    uint32_t i;
+    uint64_t page_size = sysconf(_SC_PAGESIZE);
+    char path[512];
+    mirror_journal_t *journal;
+    mirror_journal_seg_hdr_t *hdr;
+
+    if (!segment_size) segment_size = MIRROR_JOURNAL_DEFAULT_SEGMENT_SIZE;
+    segment_size = (segment_size + page_size - 1) & ~(page_size - 1);
+
+    if (strlen(dir) >= sizeof(journal->dir) ||
+        (mkdir(dir, 0755) < 0 && errno != EEXIST)) {
+        printf("Error : mirror journal %s : bad dir, errno = %d\n", dir,
+               errno);
+        return NULL;
+    }
+
+    journal = calloc(1, sizeof(mirror_journal_t));
+    strcpy(journal->dir, dir);
+    journal->segment_size = segment_size;
+    journal->max_segments = max_bytes / segment_size;
+    if (journal->max_segments < 2) journal->max_segments = 2;
+    if (journal->max_segments > MIRROR_JOURNAL_MAX_SEGMENTS) {
+        journal->max_segments = MIRROR_JOURNAL_MAX_SEGMENTS;
+    }
+    journal->segs = calloc(journal->max_segments,
+                           sizeof(mirror_journal_seg_t));
+    journal->spare.fd = -1;
+    journal->next_lsn = 1;
+    pthread_mutex_init(&journal->mutex, NULL);
+
+    mirror_journal_recover(journal);
+
+    /* The spare of the last run stays the spare */
+    mirror_journal_spare_path(journal, path, sizeof(path));
+    fd = open(path, O_RDWR | O_CLOEXEC);
+    if (fd >= 0 && !mirror_journal_seg_map(journal, &journal->spare, fd)) {
+        close(fd);
+        unlink(path);
+    }
+
+    if (!journal->n_segs) {
+        if (!mirror_journal_roll(journal)) {
+            mirror_journal_close(journal);
+            return NULL;
+        }
+    }
+
+    hdr = (mirror_journal_seg_hdr_t *)journal->segs[0].base;
+    journal->log_id = hdr->log_id;
+    journal->first_lsn = hdr->first_lsn;
+    hdr = (mirror_journal_seg_hdr_t *)
+          journal->segs[journal->n_segs - 1].base;
+    journal->next_lsn = hdr->first_lsn;
+    for (i = 0; i < journal->n_segs; i++) {
+        if (journal->segs[i].last_lsn >= journal->next_lsn) {
+            journal->next_lsn = journal->segs[i].last_lsn + 1;
+        }
+    }
+    journal->synced_pos = mirror_journal_tail(journal);
+    return journal;
+}
+
+void
+mirror_journal_close(mirror_journal_t *journal) {
+
+    uint32_t i;
+
+    for (i = 0; i < journal->n_segs; i++) {
+        mirror_journal_seg_unmap(journal, &journal->segs[i]);
+    }
+    if (journal->spare.fd >= 0) {
+        mirror_journal_seg_unmap(journal, &journal->spare);
+    }
+    pthread_mutex_destroy(&journal->mutex);
+    free(journal->segs);
+    free(journal);
+}
+
+unsigned char *
+mirror_journal_reserve(mirror_journal_t *journal, uint32_t len) {
+
+    uint64_t frame_size = MIRROR_JOURNAL_FRAME_SIZE(len);
+    mirror_journal_seg_t *seg;
+
+    if (!len ||
+        frame_size > journal->segment_size - MIRROR_JOURNAL_HDR_SIZE) {
+        return NULL;
+    }
+
+    seg = &journal->segs[journal->n_segs - 1];
+
+    if (seg->used + frame_size > journal->segment_size) {
+        pthread_mutex_lock(&journal->mutex);
+        if (!mirror_journal_roll(journal)) {
+            journal->stats.full++;
+            pthread_mutex_unlock(&journal->mutex);
+            return NULL;
+        }
+        pthread_mutex_unlock(&journal->mutex);
+        seg = &journal->segs[journal->n_segs - 1];
+    }
+
+    journal->reserved_len = len;
+    return seg->base + seg->used + sizeof(mirror_journal_frame_t);
+}
+
+void
+mirror_journal_commit(mirror_journal_t *journal, uint64_t lsn) {
+
+    mirror_journal_seg_t *seg = &journal->segs[journal->n_segs - 1];
+    mirror_journal_frame_t *frame =
+        (mirror_journal_frame_t *)(seg->base + seg->used);
+
+    frame->lsn = lsn;
+    frame->len = journal->reserved_len;
+    frame->crc = mirror_journal_crc(seg->seq, frame,
+                                    (const unsigned char *)(frame + 1));
+    seg->used += MIRROR_JOURNAL_FRAME_SIZE(frame->len);
+
+    if (lsn > seg->last_lsn) seg->last_lsn = lsn;
+    if (lsn >= journal->next_lsn) journal->next_lsn = lsn + 1;
+    journal->stats.appended_records++;
+    journal->stats.appended_bytes += frame->len;
+}
+
+bool
+mirror_journal_append(mirror_journal_t *journal, uint64_t lsn,
+                      const void *rec, uint32_t len) {
+
+    unsigned char *dst = mirror_journal_reserve(journal, len);
+
+    if (!dst) return false;
+    memcpy(dst, rec, len);
+    mirror_journal_commit(journal, lsn);
+    return true;
+}
+
+const unsigned char *
+mirror_journal_read(mirror_journal_t *journal, uint64_t *pos,
+                    uint64_t *lsn, uint32_t *len) {
+
+    uint64_t seq = *pos / journal->segment_size;
+    uint64_t off = *pos % journal->segment_size;
+    uint32_t i;
+    mirror_journal_seg_t *seg;
+    mirror_journal_frame_t *frame;
+
+    /* Trimmed from under pos */
+    if (seq < journal->segs[0].seq) {
+        seq = journal->segs[0].seq;
+        off = 0;
+    }
+
+    for (i = seq - journal->segs[0].seq; i < journal->n_segs;
+         i++, seq++, off = 0) {
+
+        seg = &journal->segs[i];
+        if (off < MIRROR_JOURNAL_HDR_SIZE) off = MIRROR_JOURNAL_HDR_SIZE;
+
+        if (off < seg->used) {
+            frame = (mirror_journal_frame_t *)(seg->base + off);
+            *lsn = frame->lsn;
+            *len = frame->len;
+            *pos = (seq * journal->segment_size) + off +
+                   MIRROR_JOURNAL_FRAME_SIZE(frame->len);
+            return (const unsigned char *)(frame + 1);
+        }
+        if (i == journal->n_segs - 1) break;
+    }
+    *pos = mirror_journal_tail(journal);
+    return NULL;
+}
+
+uint64_t
+mirror_journal_head(mirror_journal_t *journal) {
+
+    return (journal->segs[0].seq * journal->segment_size) +
+           MIRROR_JOURNAL_HDR_SIZE;
+}
+
+uint64_t
+mirror_journal_tail(mirror_journal_t *journal) {
+
+    mirror_journal_seg_t *seg = &journal->segs[journal->n_segs - 1];
+
+    return (seg->seq * journal->segment_size) + seg->used;
+}
+
+uint64_t
+mirror_journal_seek(mirror_journal_t *journal, uint64_t lsn) {
+
+    uint32_t i = 0, len;
+    uint64_t pos, rec_pos, rec_lsn;
+
+    /* Whole segments of lower lsns */
+    while (i < journal->n_segs - 1 && journal->segs[i].last_lsn < lsn) i++;
+
+    pos = (journal->segs[i].seq * journal->segment_size) +
+          MIRROR_JOURNAL_HDR_SIZE;
+    while (1) {
+        rec_pos = pos;
+        if (!mirror_journal_read(journal, &pos, &rec_lsn, &len)) break;
+        if (rec_lsn >= lsn) return rec_pos;
+    }
+    return pos;
+}
+
+void
+mirror_journal_trim(mirror_journal_t *journal, uint64_t upto_lsn,
+                    uint64_t keep_pos) {
+
+    uint32_t n = 0;
+
+    pthread_mutex_lock(&journal->mutex);
+
+    while (n < journal->n_segs - 1 &&
+           journal->segs[n].last_lsn <= upto_lsn &&
+           (journal->segs[n].seq + 1) * journal->segment_size <= keep_pos) {
+        mirror_journal_seg_drop(journal, &journal->segs[n]);
+        n++;
+    }
+    if (n) {
+        memmove(journal->segs, journal->segs + n,
+                (journal->n_segs - n) * sizeof(mirror_journal_seg_t));
+        journal->n_segs -= n;
+        journal->first_lsn =
+            ((mirror_journal_seg_hdr_t *)journal->segs[0].base)->first_lsn;
+        journal->stats.segments_trimmed += n;
+    }
+    pthread_mutex_unlock(&journal->mutex);
+}
+
+void
+mirror_journal_reset(mirror_journal_t *journal, uint64_t log_id,
+                     uint64_t next_lsn) {
+
+    uint32_t i;
+    mirror_journal_seg_t last, seg;
+
+    pthread_mutex_lock(&journal->mutex);
+
+    last = journal->segs[journal->n_segs - 1];
+    for (i = 0; i < journal->n_segs - 1; i++) {
+        mirror_journal_seg_drop(journal, &journal->segs[i]);
+    }
+    journal->log_id = log_id;
+    journal->first_lsn = next_lsn;
+    journal->next_lsn = next_lsn;
+
+    /* Carries on from the seq of the dropped ones, positions only ever
+     * grow. The last one goes once the new one is there */
+    if (mirror_journal_seg_create(journal, last.seq + 1,
+                                  MIRROR_JOURNAL_SEG_F_FIRST, &seg)) {
+        mirror_journal_seg_drop(journal, &last);
+    } else {
+        /* Out of room on the disk : the last one starts over, its
+         * old frames would check out */
+        memset(last.base, 0, last.used);
+        seg = last;
+        mirror_journal_seg_init(journal, &seg, seg.seq,
+                                MIRROR_JOURNAL_SEG_F_FIRST);
+    }
+    journal->segs[0] = seg;
+    journal->n_segs = 1;
+    journal->synced_pos = mirror_journal_head(journal);
+    journal->stats.resets++;
+    pthread_mutex_unlock(&journal->mutex);
+}
+
+void
+mirror_journal_set_log_id(mirror_journal_t *journal, uint64_t log_id) {
+
+    uint32_t i;
+
+    pthread_mutex_lock(&journal->mutex);
+    journal->log_id = log_id;
+    for (i = 0; i < journal->n_segs; i++) {
+        ((mirror_journal_seg_hdr_t *)journal->segs[i].base)->log_id = log_id;
+    }
+    pthread_mutex_unlock(&journal->mutex);
+}
+
+void
+mirror_journal_sync(mirror_journal_t *journal) {
+
+    uint32_t i;
+    uint64_t start, end, seg_start, page_size = sysconf(_SC_PAGESIZE);
+    uint64_t tail = mirror_journal_tail(journal);
+    mirror_journal_seg_t *seg;
+
+    if (journal->synced_pos >= tail) return;
+
+    for (i = 0; i < journal->n_segs; i++) {
+        seg = &journal->segs[i];
+        seg_start = seg->seq * journal->segment_size;
+        if (seg_start + seg->used <= journal->synced_pos) continue;
+
+        start = journal->synced_pos > seg_start ?
+                journal->synced_pos - seg_start : 0;
+        start &= ~(page_size - 1);
+        end = seg->used;
+        msync(seg->base + start, end - start, MS_SYNC);
+    }
+    journal->synced_pos = tail;
+    journal->stats.syncs++;
+}
+
+void
+mirror_journal_print_stats(mirror_journal_t *journal) {
+
+    mirror_journal_stats_t *stats = &journal->stats;
+
+    pthread_mutex_lock(&journal->mutex);
+    printf("mirror journal %s : %u of %u segments of %lu KB  lsns %lu to"
+           " %lu  log id %016lx\n", journal->dir, journal->n_segs,
+           journal->max_segments, journal->segment_size >> 10,
+           journal->first_lsn, journal->next_lsn - 1, journal->log_id);
+    printf("\tappended : %lu records  %.2f MB  full %lu  syncs %lu"
+           "  resets %lu\n", stats->appended_records,
+           stats->appended_bytes / 1e6, stats->full, stats->syncs,
+           stats->resets);
+    printf("\tsegments : created %lu  recycled %lu  trimmed %lu"
+           "  recovered %lu records, dropped %lu bytes\n",
+           stats->segments_created, stats->segments_recycled,
+           stats->segments_trimmed, stats->recovered_records,
+           stats->dropped_bytes);
+    pthread_mutex_unlock(&journal->mutex);
+}
@@ -0,0 +1,211 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  mirror_journal.h
+ *
+ *    Description: This file defines the interfaces of the on-disk replication journal,
+ *                 an append-only log of records in memory-mapped segment files
+ *
+ *        Version:  1.0
+ *        Created:  10/18/2026 08:21:44 AM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  ABHISHEK SAGAR (), sachinites@gmail.com
+ *   Organization:  Juniper Networks
+ *
+ * =====================================================================================
+ */
+#ifndef __MIRROR_JOURNAL__
+#define __MIRROR_JOURNAL__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+/* Records are appended to fixed size segment files in a directory,
+ * each mapped whole with MAP_SHARED : an append is a copy into the
+ * page cache, and survives the process as it is. Only power loss needs
+ * mirror_journal_sync().
+ *
+ * Every record is framed by its len, its lsn and a CRC32C of both and
+ * of the record, seeded with the segment's seq. Opening a directory
+ * which holds segments recovers them : a segment ends at a frame of len
+ * 0, or at the first frame which does not check out, a torn write or
+ * the stale frames of a recycled segment. The journal goes on past it
+ * only if the next segment's lsns follow. Segments are dropped from the
+ * oldest once their records are no longer needed, and the last one
+ * dropped is kept mapped to be recycled as the next new one.
+ *
+ * Positions in the journal are byte offsets which only ever grow,
+ * segment seq * segment size + offset in the segment.
+ *
+ * One thread appends, and reads, at a time : records read stay where
+ * they are until their segment is trimmed, or the journal reset */
+
+#define MIRROR_JOURNAL_MAGIC		0x4d4a4e4c
+#define MIRROR_JOURNAL_VERSION		1
+#define MIRROR_JOURNAL_DEFAULT_SEGMENT_SIZE	(64 * 1024 * 1024)
+#define MIRROR_JOURNAL_MAX_SEGMENTS	1024
+/* Frames start on this boundary */
+#define MIRROR_JOURNAL_ALIGN		8
+/* Segment flags : the journal was started, or reset, with this one */
+#define MIRROR_JOURNAL_SEG_F_FIRST	(1 << 0)
+
+#pragma pack (push,1)
+
+/* Start of every segment file, in host byte order */
+typedef struct mirror_journal_seg_hdr_ {
+
+    uint32_t magic;
+    uint32_t version;
+    /* Whose lsns the records carry, 0 : none worth resuming from */
+    uint64_t log_id;
+    uint64_t seq;
+    uint64_t segment_size;
+    /* Lsn the journal was at when the segment was started */
+    uint64_t first_lsn;
+    uint32_t flags;
+    uint8_t reserved[20];
+} mirror_journal_seg_hdr_t;
+
+/* Ahead of every record, in host byte order. len 0 : the segment has
+ * no more records */
+typedef struct mirror_journal_frame_ {
+
+    uint32_t len;
+    uint32_t crc;
+    uint64_t lsn;
+} mirror_journal_frame_t;
+
+#pragma pack(pop)
+
+typedef struct mirror_journal_seg_ {
+
+    int fd;
+    unsigned char *base;
+    uint64_t seq;
+    /* Bytes in use from the start of the segment, hdr included */
+    uint64_t used;
+    /* Highest lsn of the segment's records, 0 if none */
+    uint64_t last_lsn;
+} mirror_journal_seg_t;
+
+typedef struct mirror_journal_stats_ {
+
+    uint64_t appended_records;
+    uint64_t appended_bytes;
+    /* Appends refused as every segment was in use */
+    uint64_t full;
+    uint64_t segments_created;
+    uint64_t segments_recycled;
+    uint64_t segments_trimmed;
+    uint64_t resets;
+    uint64_t syncs;
+    /* Open : records recovered, and bytes past the last good frame */
+    uint64_t recovered_records;
+    uint64_t dropped_bytes;
+} mirror_journal_stats_t;
+
+typedef struct mirror_journal_ {
+
+    char dir[256];
+    uint64_t segment_size;
+    uint32_t max_segments;
+    /* Oldest first, the last one is appended to */
+    mirror_journal_seg_t *segs;
+    uint32_t n_segs;
+    /* A trimmed segment, still mapped, fd -1 if none */
+    mirror_journal_seg_t spare;
+    uint64_t log_id;
+    /* Lsns the journal covers : first_lsn up to next_lsn - 1. Records
+     * with lsn 0 are kept, and not counted */
+    uint64_t first_lsn;
+    uint64_t next_lsn;
+    /* Written to the disk up to here */
+    uint64_t synced_pos;
+    /* Record reserved, not committed yet */
+    uint32_t reserved_len;
+    pthread_mutex_t mutex;
+    mirror_journal_stats_t stats;
+} mirror_journal_t;
+
+/* Opens the journal in dir, recovering the segments found there.
+ * segment_size 0 picks MIRROR_JOURNAL_DEFAULT_SEGMENT_SIZE, and is
+ * rounded up to a multiple of the page size. The journal takes up to
+ * max_bytes of segments, 2 segments at least */
+mirror_journal_t *
+mirror_journal_open(const char *dir,
+                    uint64_t segment_size,
+                    uint64_t max_bytes);
+
+/* Unmaps the segments and leaves them on the disk */
+void
+mirror_journal_close(mirror_journal_t *journal);
+
+/* Room for a record of len bytes (1 at least) at the tail, for the
+ * caller to copy the record into. NULL if the journal is full, or the
+ * record would not fit in a segment */
+unsigned char *
+mirror_journal_reserve(mirror_journal_t *journal,
+                       uint32_t len);
+
+/* The record reserved last is in place, with lsn */
+void
+mirror_journal_commit(mirror_journal_t *journal,
+                      uint64_t lsn);
+
+bool
+mirror_journal_append(mirror_journal_t *journal,
+                      uint64_t lsn,
+                      const void *rec,
+                      uint32_t len);
+
+/* Record at *pos, NULL at the tail. Moves *pos past it */
+const unsigned char *
+mirror_journal_read(mirror_journal_t *journal,
+                    uint64_t *pos,
+                    uint64_t *lsn,
+                    uint32_t *len);
+
+/* Position of the oldest record, and the one past the newest */
+uint64_t
+mirror_journal_head(mirror_journal_t *journal);
+
+uint64_t
+mirror_journal_tail(mirror_journal_t *journal);
+
+/* Position of the first record with an lsn of lsn or more, the tail
+ * if none */
+uint64_t
+mirror_journal_seek(mirror_journal_t *journal,
+                    uint64_t lsn);
+
+/* Drops the oldest segments whose records are all up to upto_lsn, and
+ * which end at keep_pos or before. The last segment stays */
+void
+mirror_journal_trim(mirror_journal_t *journal,
+                    uint64_t upto_lsn,
+                    uint64_t keep_pos);
+
+/* Drops every record, the journal starts over at next_lsn with the
+ * records of log_id */
+void
+mirror_journal_reset(mirror_journal_t *journal,
+                     uint64_t log_id,
+                     uint64_t next_lsn);
+
+/* The records are of log_id after all, a sync of the backup which
+ * was written to the journal as it came in is done say */
+void
+mirror_journal_set_log_id(mirror_journal_t *journal,
+                          uint64_t log_id);
+
+/* Writes what was appended since the last call to the disk */
+void
+mirror_journal_sync(mirror_journal_t *journal);
+
+void
+mirror_journal_print_stats(mirror_journal_t *journal);
+
+#endif /* __MIRROR_JOURNAL__ */
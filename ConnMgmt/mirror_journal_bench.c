@@ -0,0 +1,523 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  mirror_journal_bench.c
+ *
+ *    Description: This file benchmarks the on-disk replication journal : appends and
+ *                 replay from the disk, records spilled while the backup is away and
+ *                 sent from the journal when it is back, and a warm restart of the
+ *                 backup from its own journal instead of a sync
+ *
+ *        Version:  1.0
+ *        Created:  10/18/2026 10:12:37 AM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  ABHISHEK SAGAR (), sachinites@gmail.com
+ *   Organization:  Juniper Networks
+ *
+ * =====================================================================================
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include "mirror.h"
+
+#define BENCH_CONN_PORT		25700
+#define BENCH_DATA_PORT		25800
+#define BENCH_OP_UPDATE		1
+#define BENCH_LOCK_STRIPES	1024
+#define BENCH_LOG_SIZE		(64 * 1024 * 1024)
+#define BENCH_KA_INTERVAL	100
+#define BENCH_JOURNAL_MAX	(1024ULL * 1024 * 1024)
+/* Raw journal runs write this much */
+#define BENCH_RAW_BYTES		(256ULL * 1024 * 1024)
+
+static uint32_t n_objs = 65536;
+static uint32_t obj_size = 256;
+static uint32_t update_rate = 20000;
+static uint64_t high_water = 4 * 1024 * 1024;
+static const char *journal_dir = "/tmp/mirror_journal_bench";
+
+/* The app's objects on both ends, as in mirror_sync_bench */
+static unsigned char *master_objs;
+static unsigned char *backup_objs;
+static pthread_mutex_t stripes[BENCH_LOCK_STRIPES];
+
+static volatile bool updater_stop;
+static volatile uint64_t n_updates;
+
+static uint64_t
+bench_now_usec() {
+
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (ts.tv_sec * 1000000ULL) + (ts.tv_nsec / 1000);
+}
+
+/* Opens the journal of dir/name, empty */
+static mirror_journal_t *
+bench_journal_open(const char *name, uint64_t max_bytes) {
+
+	char dir[256];
+	mirror_journal_t *journal;
+
+	snprintf(dir, sizeof(dir), "%s/%s", journal_dir, name);
+	journal = mirror_journal_open(dir, 0, max_bytes);
+	if (journal) mirror_journal_reset(journal, 0, 1);
+	return journal;
+}
+
+/* Appends BENCH_RAW_BYTES of records of rec_size, written to the disk
+ * every sync_every bytes (0 : never), then reopens the journal and
+ * reads them all back */
+static bool
+bench_raw(uint32_t rec_size, uint64_t sync_every) {
+
+	char dir[256];
+	unsigned char *rec;
+	uint32_t len;
+	uint64_t i, n_recs, lsn, pos, start, append_usec, open_usec, read_usec;
+	uint64_t since_sync = 0, sum = 0, n_read = 0;
+	const unsigned char *data;
+	mirror_journal_t *journal;
+
+	journal = bench_journal_open("raw", BENCH_RAW_BYTES * 2);
+	if (!journal) return false;
+
+	rec = calloc(1, rec_size);
+	n_recs = BENCH_RAW_BYTES / rec_size;
+
+	start = bench_now_usec();
+	for (i = 0; i < n_recs; i++) {
+		memcpy(rec, &i, sizeof(i));
+		if (!mirror_journal_append(journal, i + 1, rec, rec_size)) break;
+		since_sync += rec_size;
+		if (sync_every && since_sync >= sync_every) {
+			mirror_journal_sync(journal);
+			since_sync = 0;
+		}
+	}
+	if (sync_every) mirror_journal_sync(journal);
+	append_usec = bench_now_usec() - start;
+	n_recs = i;
+	mirror_journal_close(journal);
+
+	/* As after a restart : recovery checks every frame, then the
+	 * records are read back in order */
+	snprintf(dir, sizeof(dir), "%s/raw", journal_dir);
+	start = bench_now_usec();
+	journal = mirror_journal_open(dir, 0, BENCH_RAW_BYTES * 2);
+	open_usec = bench_now_usec() - start;
+	if (!journal) return false;
+
+	start = bench_now_usec();
+	pos = mirror_journal_head(journal);
+	while ((data = mirror_journal_read(journal, &pos, &lsn, &len))) {
+		if (len != rec_size || lsn != n_read + 1 ||
+			memcmp(data, &n_read, sizeof(n_read))) {
+			break;
+		}
+		sum += data[len - 1];
+		n_read++;
+	}
+	read_usec = bench_now_usec() - start;
+
+	printf("%8u %9s %10.0f %10.1f %10.1f %10.1f %9lu  %s\n", rec_size,
+		!sync_every ? "never" : sync_every >= 1024 * 1024 ? "1 MB" : "64 KB",
+		n_recs / (append_usec / 1e6),
+		(double)n_recs * rec_size / append_usec,
+		(double)n_recs * rec_size / open_usec,
+		(double)n_read * rec_size / read_usec, n_read,
+		n_read == n_recs && sum == 0 ? "ok" : "FAIL");
+	fflush(stdout);
+
+	mirror_journal_reset(journal, 0, 1);
+	mirror_journal_close(journal);
+	free(rec);
+	return n_read == n_recs;
+}
+
+/* Segments recycled from the spare keep the frames of their past after
+ * the new ones. Trims as a master does while appending, then reopens :
+ * every record after the trim point must come back */
+static bool
+bench_recycle() {
+
+	char dir[256];
+	unsigned char rec[1000];
+	uint32_t len, n_segs;
+	uint64_t lsn = 1, next_lsn, pos, rec_lsn, n_read = 0, first_lsn = 0;
+	uint64_t recycled;
+	bool ok;
+	mirror_journal_t *journal;
+
+	memset(rec, 0xab, sizeof(rec));
+
+	/* Small segments, filled and trimmed a few times over */
+	snprintf(dir, sizeof(dir), "%s/recycle", journal_dir);
+	journal = mirror_journal_open(dir, 64 * 1024, 16 * 64 * 1024);
+	if (!journal) return false;
+	mirror_journal_reset(journal, 1, 1);
+
+	/* Records get shorter as the segments go round : a recycled one
+	 * ends where its past frames go on */
+	while (journal->stats.segments_recycled < 8) {
+		if (!mirror_journal_append(journal, lsn, rec,
+				sizeof(rec) - (journal->stats.segments_recycled * 100))) {
+			break;
+		}
+		lsn++;
+		if (lsn % 50 == 0) {
+			mirror_journal_trim(journal, lsn - 200,
+				mirror_journal_tail(journal));
+		}
+	}
+	mirror_journal_sync(journal);
+	n_segs = journal->n_segs;
+	next_lsn = journal->next_lsn;
+	recycled = journal->stats.segments_recycled;
+	mirror_journal_close(journal);
+
+	journal = mirror_journal_open(dir, 64 * 1024, 16 * 64 * 1024);
+	if (!journal) return false;
+	pos = mirror_journal_head(journal);
+	while (mirror_journal_read(journal, &pos, &rec_lsn, &len)) {
+		if (n_read++ == 0) first_lsn = rec_lsn;
+	}
+	ok = journal->n_segs == n_segs && journal->next_lsn == next_lsn &&
+		 n_read && first_lsn + n_read == next_lsn;
+	printf("reopen after %lu recycled segments : %u of %u segments, next"
+		" lsn %lu of %lu, %lu records from lsn %lu : %s\n", recycled,
+		journal->n_segs, n_segs, journal->next_lsn, next_lsn, n_read,
+		first_lsn, ok ? "ok" : "FAIL");
+
+	mirror_journal_reset(journal, 0, 1);
+	mirror_journal_close(journal);
+	return ok;
+}
+
+static bool
+bench_snapshot(mirror_t *mirror, void *arg, uint64_t *cursor,
+			   uint64_t *obj_id, uint16_t *op, unsigned char *payload,
+			   uint32_t *payload_len, uint32_t max_len) {
+
+	uint64_t i = *cursor;
+
+	if (i >= n_objs) return false;
+
+	pthread_mutex_lock(&stripes[i % BENCH_LOCK_STRIPES]);
+	memcpy(payload, master_objs + (i * obj_size), obj_size);
+	pthread_mutex_unlock(&stripes[i % BENCH_LOCK_STRIPES]);
+
+	*obj_id = i;
+	*op = BENCH_OP_UPDATE;
+	*payload_len = obj_size;
+	*cursor = i + 1;
+	return true;
+}
+
+static void
+bench_apply(mirror_t *mirror, uint64_t obj_id, uint16_t op,
+			unsigned char *payload, uint32_t payload_len, mirror_lsn_t lsn) {
+
+	if (obj_id < n_objs && payload_len == obj_size) {
+		memcpy(backup_objs + (obj_id * obj_size), payload, obj_size);
+	}
+}
+
+static void
+bench_sync_event(mirror_t *mirror, void *arg, mirror_sync_state_t state) {
+
+	if (state == MIRROR_SYNC_SNAPSHOT &&
+		mirror->conn->mastership_state == COMM_MGMT_BACKUP) {
+		memset(backup_objs, 0, (uint64_t)n_objs * obj_size);
+	}
+}
+
+static void *
+bench_updater_fn(void *arg) {
+
+	mirror_t *master = (mirror_t *)arg;
+	uint64_t obj_id, seq = 0, start, now, due;
+	unsigned char *obj;
+
+	start = bench_now_usec();
+	srand(1);
+
+	while (!updater_stop) {
+
+		obj_id = ((uint64_t)rand() * 65536 + rand()) % n_objs;
+		obj = master_objs + (obj_id * obj_size);
+
+		pthread_mutex_lock(&stripes[obj_id % BENCH_LOCK_STRIPES]);
+		seq++;
+		memcpy(obj, &seq, sizeof(seq));
+		memset(obj + sizeof(seq), (int)seq, obj_size - sizeof(seq));
+		mirror_append(master, obj_id, BENCH_OP_UPDATE, obj, obj_size);
+		pthread_mutex_unlock(&stripes[obj_id % BENCH_LOCK_STRIPES]);
+		n_updates++;
+
+		due = start + (seq * 1000000ULL) / update_rate;
+		now = bench_now_usec();
+		if (due > now + 50) usleep(due - now);
+	}
+	return NULL;
+}
+
+static bool
+bench_wait_conn(conn_mgmt_conn_state_t *conn, conn_mgmt_conn_status_t status,
+				uint64_t timeout_usec) {
+
+	uint64_t start = bench_now_usec();
+
+	while (conn->conn_status != status &&
+		   bench_now_usec() - start < timeout_usec) {
+		usleep(1000);
+	}
+	return conn->conn_status == status;
+}
+
+static bool
+bench_wait_ready(mirror_t *mirror, uint64_t timeout_usec) {
+
+	uint64_t start = bench_now_usec();
+
+	while (mirror->sync_state != MIRROR_SYNC_READY &&
+		   bench_now_usec() - start < timeout_usec) {
+		usleep(1000);
+	}
+	return mirror->sync_state == MIRROR_SYNC_READY;
+}
+
+/* Backup applied all the master appended so far */
+static uint64_t
+bench_wait_caught_up(mirror_t *master, mirror_t *backup,
+					 uint64_t timeout_usec) {
+
+	uint64_t start = bench_now_usec();
+	mirror_lsn_t lsn = master->next_lsn - 1;
+
+	while (backup->stats.applied_lsn < lsn &&
+		   bench_now_usec() - start < timeout_usec) {
+		usleep(1000);
+	}
+	return bench_now_usec() - start;
+}
+
+/* The master no longer hears the backup's KAs : the connection goes
+ * down on the master's end. Not on the backup's, a backup which lost
+ * the master takes over */
+static void
+bench_link(conn_mgmt_conn_state_t *master_conn,
+		   conn_mgmt_conn_state_t *backup_conn, bool up) {
+
+	if (up) {
+		conn_mgmt_resume_sending_kas(backup_conn);
+		bench_wait_conn(master_conn, COMM_MGMT_CONN_UP, 5000000);
+		return;
+	}
+	conn_mgmt_pause_sending_kas(backup_conn);
+	bench_wait_conn(master_conn, COMM_MGMT_CONN_DOWN, 5000000);
+}
+
+static mirror_t *
+bench_create_backup(conn_mgmt_conn_state_t *backup_conn,
+					mirror_journal_t *journal, xport_type_t xport_type) {
+
+	mirror_t *backup;
+
+	backup = mirror_create_on_xport(backup_conn, xport_type,
+		BENCH_DATA_PORT + 1, BENCH_DATA_PORT, BENCH_LOG_SIZE);
+	if (!backup) return NULL;
+	mirror_register_apply_cb(backup, BENCH_OP_UPDATE, bench_apply);
+	mirror_set_sync_cbs(backup, NULL, bench_sync_event, NULL);
+	mirror_set_journal(backup, journal, 0);
+	return backup;
+}
+
+static bool
+bench_check(const char *what, mirror_t *master, mirror_t *backup,
+			uint64_t syncs, uint64_t resumes) {
+
+	bool ok;
+	mirror_stats_t ms;
+
+	mirror_get_stats(master, &ms);
+	ok = ms.syncs == syncs && ms.resumes == resumes &&
+		 backup->sync_state == MIRROR_SYNC_READY;
+	printf("\t%s : %lu syncs, %lu resumes, %lu resumes refused : %s\n",
+		what, ms.syncs, ms.resumes, ms.resumes_refused,
+		ok ? "resumed" : "FAIL");
+	return ok;
+}
+
+int
+main(int argc, char **argv) {
+
+	uint32_t i;
+	uint64_t start, usecs, updates, spilled, replayed;
+	bool ok = true;
+	xport_type_t xport_type = XPORT_TCP;
+	pthread_t updater;
+	mirror_t *master, *backup;
+	mirror_journal_t *master_journal, *backup_journal;
+	mirror_stats_t ms, bs;
+	conn_mgmt_conn_state_t *master_conn, *backup_conn;
+	char dir[256];
+	static const uint32_t rec_sizes[] = {64, 256, 4096};
+
+	if (argc > 1) n_objs = atoi(argv[1]);
+	if (argc > 2) obj_size = atoi(argv[2]);
+	if (argc > 3) update_rate = atoi(argv[3]);
+	if (argc > 4) high_water = strtoull(argv[4], NULL, 0);
+	if (argc > 5) journal_dir = argv[5];
+	if (obj_size < sizeof(uint64_t)) obj_size = sizeof(uint64_t);
+
+	/* The journals are in sub dirs of journal_dir */
+	mkdir(journal_dir, 0755);
+
+	/* Journal alone : appends, and replay from the disk */
+	printf("journal in %s, %.0f MB per run, segments of %u MB\n",
+		journal_dir, BENCH_RAW_BYTES / 1e6,
+		MIRROR_JOURNAL_DEFAULT_SEGMENT_SIZE / (1024 * 1024));
+	printf("%8s %9s %10s %10s %10s %10s %9s  %s\n", "rec size", "msync",
+		"appends/s", "MB/s", "open MB/s", "read MB/s", "read", "check");
+	for (i = 0; i < sizeof(rec_sizes) / sizeof(rec_sizes[0]); i++) {
+		ok &= bench_raw(rec_sizes[i], 0);
+	}
+	ok &= bench_raw(256, 1024 * 1024);
+	ok &= bench_raw(256, 64 * 1024);
+	ok &= bench_recycle();
+
+	for (i = 0; i < BENCH_LOCK_STRIPES; i++) {
+		pthread_mutex_init(&stripes[i], NULL);
+	}
+	master_objs = calloc(n_objs, obj_size);
+	backup_objs = calloc(n_objs, obj_size);
+	for (i = 0; i < n_objs; i++) {
+		memset(master_objs + ((uint64_t)i * obj_size), i, obj_size);
+	}
+
+	printf("\n%u objects of %u bytes (%.1f MB), %u updates/s on the master,"
+		" over %s, master spills past %.1f MB unsent\n", n_objs, obj_size,
+		(double)n_objs * obj_size / 1e6, update_rate,
+		xport_type_str(xport_type), high_water / 1e6);
+
+	master_journal = bench_journal_open("master", BENCH_JOURNAL_MAX);
+	backup_journal = bench_journal_open("backup", BENCH_JOURNAL_MAX);
+	if (!master_journal || !backup_journal) return -1;
+
+	conn_mgmt_init();
+	conn_mgmt_set_io_mode(CONN_MGMT_IO_EVENT_LOOP, 1);
+
+	conn_mgmt_configure_connection("master", "127.0.0.1", BENCH_CONN_PORT,
+		"127.0.0.1", BENCH_CONN_PORT + 1, "master");
+	conn_mgmt_configure_connection("backup", "127.0.0.1", BENCH_CONN_PORT + 1,
+		"127.0.0.1", BENCH_CONN_PORT, "backup");
+	master_conn = conn_mgmt_lookup_connection_by_name("master");
+	backup_conn = conn_mgmt_lookup_connection_by_name("backup");
+	if (!master_conn || !backup_conn) return -1;
+	conn_mgmt_set_conn_ka_interval(master_conn, BENCH_KA_INTERVAL);
+	conn_mgmt_set_conn_ka_interval(backup_conn, BENCH_KA_INTERVAL);
+
+	master = mirror_create_on_xport(master_conn, xport_type,
+		BENCH_DATA_PORT, BENCH_DATA_PORT + 1, BENCH_LOG_SIZE);
+	if (!master) return -1;
+	mirror_set_sync_cbs(master, bench_snapshot, bench_sync_event, NULL);
+	mirror_set_journal(master, master_journal, high_water);
+
+	backup = bench_create_backup(backup_conn, backup_journal, xport_type);
+	if (!backup) return -1;
+
+	pthread_create(&updater, NULL, bench_updater_fn, master);
+
+	/* First time up : a sync, which the backup's journal keeps */
+	if (!bench_wait_ready(master, 30000000) ||
+		!bench_wait_ready(backup, 30000000)) {
+		printf("FAIL : backup not ready\n");
+		return -1;
+	}
+	bench_wait_caught_up(master, backup, 10000000);
+	mirror_get_stats(master, &ms);
+	printf("backup came up : synced, %.1f MB snapshot in %.1f msec\n",
+		ms.last_snapshot_bytes / 1e6, ms.last_snapshot_usec / 1e3);
+
+	/* Master without the backup for 2 secs : what it appends meanwhile
+	 * goes to its journal, and is sent from there when the backup is
+	 * back */
+	mirror_get_stats(master, &ms);
+	spilled = ms.journal_sent_records;
+	bench_link(master_conn, backup_conn, false);
+	usleep(2000000);
+	start = bench_now_usec();
+	bench_link(master_conn, backup_conn, true);
+	bench_wait_ready(master, 10000000);
+	bench_wait_caught_up(master, backup, 30000000);
+	mirror_get_stats(master, &ms);
+	printf("backup gone 2 secs : %lu records sent from the master's"
+		" journal, caught up %.1f msec after the link came back, %lu"
+		" journal overflows\n", ms.journal_sent_records - spilled,
+		(bench_now_usec() - start) / 1e3, ms.journal_overflows);
+	ok &= bench_check("link flap", master, backup, 1, 1);
+
+	/* Warm restart of the backup : it goes away with all it had in
+	 * memory, and comes back from its own journal */
+	bench_link(master_conn, backup_conn, false);
+	mirror_destroy(backup);
+	mirror_journal_close(backup_journal);
+	memset(backup_objs, 0, (uint64_t)n_objs * obj_size);
+	usleep(500000);
+
+	snprintf(dir, sizeof(dir), "%s/backup", journal_dir);
+	start = bench_now_usec();
+	backup_journal = mirror_journal_open(dir, 0, BENCH_JOURNAL_MAX);
+	usecs = bench_now_usec() - start;
+	if (!backup_journal) return -1;
+	backup = bench_create_backup(backup_conn, backup_journal, xport_type);
+	if (!backup) return -1;
+	mirror_get_stats(backup, &bs);
+	replayed = bs.replayed_records;
+	printf("backup restarted : journal of %lu records recovered in %.1f"
+		" msec, %lu records replayed (%.1f MB) in %.1f msec, %.1f MB/s\n",
+		backup_journal->stats.recovered_records, usecs / 1e3, replayed,
+		bs.replayed_bytes / 1e6, bs.replay_usec / 1e3,
+		bs.replay_usec ? (double)bs.replayed_bytes / bs.replay_usec : 0);
+
+	start = bench_now_usec();
+	updates = n_updates;
+	bench_link(master_conn, backup_conn, true);
+	bench_wait_ready(master, 10000000);
+	bench_wait_caught_up(master, backup, 30000000);
+	printf("\tcaught up %.1f msec after the link came back, %lu updates"
+		" meanwhile\n", (bench_now_usec() - start) / 1e3,
+		n_updates - updates);
+	ok &= replayed && bench_check("warm restart", master, backup, 1, 2);
+
+	/* Quiesce, the backup must then hold the master's objects */
+	updater_stop = true;
+	pthread_join(updater, NULL);
+	bench_wait_caught_up(master, backup, 10000000);
+	if (memcmp(master_objs, backup_objs, (uint64_t)n_objs * obj_size)) {
+		ok = false;
+	}
+	printf("%s : backup %s the master's objects\n", ok ? "PASS" : "FAIL",
+		memcmp(master_objs, backup_objs, (uint64_t)n_objs * obj_size) ?
+			"differs from" : "matches");
+
+	printf("\n");
+	mirror_print_stats(master);
+	mirror_print_stats(backup);
+
+	mirror_destroy(master);
+	mirror_destroy(backup);
+	mirror_journal_close(master_journal);
+	mirror_journal_close(backup_journal);
+	return 0;
+}
@@ -0,0 +1,314 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  mirror_sync_bench.c
+ *
+ *    Description: This file benchmarks the bulk sync of a backup which comes up
+ *                 while the master keeps updating its objects, and checks that the
+ *                 backup ends up with the master's objects
+ *
+ *        Version:  1.0
+ *        Created:  10/18/2026 02:37:44 AM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  ABHISHEK SAGAR (), sachinites@gmail.com
+ *   Organization:  Juniper Networks
+ *
+ * =====================================================================================
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "mirror.h"
+
+#define BENCH_CONN_PORT		25100
+#define BENCH_DATA_PORT		25200
+#define BENCH_OP_UPDATE		1
+#define BENCH_LOCK_STRIPES	1024
+#define BENCH_LOG_SIZE		(64 * 1024 * 1024)
+
+static uint32_t n_objs = 262144;
+static uint32_t obj_size = 256;
+static uint32_t update_rate = 100000;
+
+/* The app's objects on both ends. An update writes the object and
+ * appends it under the object's stripe lock, which the snapshot takes
+ * to read the object whole */
+static unsigned char *master_objs;
+static unsigned char *backup_objs;
+static pthread_mutex_t stripes[BENCH_LOCK_STRIPES];
+
+static volatile bool updater_stop;
+static volatile uint64_t n_updates;
+static conn_mgmt_hist_t update_latency;
+
+static uint64_t
+bench_now_usec() {
+
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (ts.tv_sec * 1000000ULL) + (ts.tv_nsec / 1000);
+}
+
+static bool
+bench_snapshot(mirror_t *mirror, void *arg, uint64_t *cursor,
+			   uint64_t *obj_id, uint16_t *op, unsigned char *payload,
+			   uint32_t *payload_len, uint32_t max_len) {
+
+	uint64_t i = *cursor;
+
+	if (i >= n_objs) return false;
+
+	/* In the forked child nothing updates the objects, and a stripe
+	 * lock held by the updater at the fork stays held for good. An
+	 * object it was halfway through has its record after the start
+	 * lsn, which the catch up applies over it */
+	if (mirror->snapshot_mode == MIRROR_SNAPSHOT_FORK) {
+		memcpy(payload, master_objs + (i * obj_size), obj_size);
+	}
+	else {
+		pthread_mutex_lock(&stripes[i % BENCH_LOCK_STRIPES]);
+		memcpy(payload, master_objs + (i * obj_size), obj_size);
+		pthread_mutex_unlock(&stripes[i % BENCH_LOCK_STRIPES]);
+	}
+
+	*obj_id = i;
+	*op = BENCH_OP_UPDATE;
+	*payload_len = obj_size;
+	*cursor = i + 1;
+	return true;
+}
+
+static void
+bench_apply(mirror_t *mirror, uint64_t obj_id, uint16_t op,
+			unsigned char *payload, uint32_t payload_len, mirror_lsn_t lsn) {
+
+	if (obj_id < n_objs && payload_len == obj_size) {
+		memcpy(backup_objs + (obj_id * obj_size), payload, obj_size);
+	}
+}
+
+static void
+bench_sync_event(mirror_t *mirror, void *arg, mirror_sync_state_t state) {
+
+	printf("\t%s : sync %s\n", mirror->conn->conn_name,
+		mirror_sync_state_str(state));
+	/* A backup being synced gets every object anew */
+	if (state == MIRROR_SYNC_SNAPSHOT &&
+		mirror->conn->mastership_state == COMM_MGMT_BACKUP) {
+		memset(backup_objs, 0, (uint64_t)n_objs * obj_size);
+	}
+}
+
+/* Updates random objects at update_rate, the master's app at work */
+static void *
+bench_updater_fn(void *arg) {
+
+	mirror_t *master = (mirror_t *)arg;
+	uint64_t obj_id, seq = 0, start, now, due;
+	unsigned char *obj;
+
+	start = bench_now_usec();
+	srand(1);
+
+	while (!updater_stop) {
+
+		obj_id = ((uint64_t)rand() * 65536 + rand()) % n_objs;
+		obj = master_objs + (obj_id * obj_size);
+		now = bench_now_usec();
+
+		pthread_mutex_lock(&stripes[obj_id % BENCH_LOCK_STRIPES]);
+		seq++;
+		memcpy(obj, &seq, sizeof(seq));
+		memset(obj + sizeof(seq), (int)seq, obj_size - sizeof(seq));
+		mirror_append(master, obj_id, BENCH_OP_UPDATE, obj, obj_size);
+		pthread_mutex_unlock(&stripes[obj_id % BENCH_LOCK_STRIPES]);
+
+		conn_mgmt_hist_add(&update_latency, bench_now_usec() - now);
+		n_updates++;
+
+		due = start + (seq * 1000000ULL) / update_rate;
+		now = bench_now_usec();
+		if (due > now + 50) usleep(due - now);
+	}
+	return NULL;
+}
+
+static bool
+bench_wait_ready(mirror_t *mirror, uint64_t timeout_usec) {
+
+	uint64_t start = bench_now_usec();
+
+	while (mirror->sync_state != MIRROR_SYNC_READY &&
+		   bench_now_usec() - start < timeout_usec) {
+		usleep(1000);
+	}
+	return mirror->sync_state == MIRROR_SYNC_READY;
+}
+
+static void
+bench_report(const char *what, mirror_t *master, mirror_t *backup,
+			 uint64_t updates, uint64_t usecs) {
+
+	mirror_stats_t ms, bs;
+
+	mirror_get_stats(master, &ms);
+	mirror_get_stats(backup, &bs);
+
+	printf("%s : snapshot %.1f MB in %.1f msec (%.1f MB/s), ready after"
+		" %.1f msec on the master, %.1f msec on the backup\n", what,
+		ms.last_snapshot_bytes / 1e6, ms.last_snapshot_usec / 1e3,
+		ms.last_snapshot_usec ?
+			(double)ms.last_snapshot_bytes / ms.last_snapshot_usec : 0,
+		ms.last_ready_usec / 1e3, bs.last_ready_usec / 1e3);
+	if (master->snapshot_mode == MIRROR_SNAPSHOT_FORK) {
+		printf("\tsnapshot fork stalled appends %lu usec (most %lu usec)\n",
+			ms.last_fork_usec, ms.max_fork_usec);
+	}
+	printf("\tmaster kept updating : %.0f updates/s, update p50 %lu p99 %lu"
+		" max %lu usec, records held back peak %.1f MB of %.1f MB allowed\n",
+		updates / (usecs / 1e6),
+		conn_mgmt_hist_percentile(&update_latency, 50),
+		conn_mgmt_hist_percentile(&update_latency, 99),
+		conn_mgmt_hist_percentile(&update_latency, 100),
+		ms.sync_peak_held_bytes / 1e6, master->sync_max_held_bytes / 1e6);
+	fflush(stdout);
+}
+
+int
+main(int argc, char **argv) {
+
+	uint32_t i;
+	uint64_t start, updates;
+	xport_type_t xport_type = XPORT_TCP;
+	mirror_snapshot_mode_t snapshot_mode = MIRROR_SNAPSHOT_LIVE;
+	uint32_t apply_workers = 0;
+	pthread_t updater;
+	mirror_t *master, *backup;
+	conn_mgmt_conn_state_t *master_conn, *backup_conn;
+
+	if (argc > 1) n_objs = atoi(argv[1]);
+	if (argc > 2) obj_size = atoi(argv[2]);
+	if (argc > 3) update_rate = atoi(argv[3]);
+	if (argc > 4) {
+		for (i = 0; i < XPORT_TYPE_MAX; i++) {
+			if (!strcmp(argv[4], xport_type_str(i))) xport_type = i;
+		}
+	}
+	if (argc > 5 && !strcmp(argv[5], "fork")) {
+		snapshot_mode = MIRROR_SNAPSHOT_FORK;
+	}
+	if (argc > 6) apply_workers = atoi(argv[6]);
+	if (obj_size < sizeof(uint64_t)) obj_size = sizeof(uint64_t);
+
+	for (i = 0; i < BENCH_LOCK_STRIPES; i++) {
+		pthread_mutex_init(&stripes[i], NULL);
+	}
+	master_objs = calloc(n_objs, obj_size);
+	backup_objs = calloc(n_objs, obj_size);
+	for (i = 0; i < n_objs; i++) {
+		memset(master_objs + ((uint64_t)i * obj_size), i, obj_size);
+	}
+
+	printf("%u objects of %u bytes (%.1f MB), %u updates/s on the master,"
+		" over %s, %s snapshot\n", n_objs, obj_size,
+		(double)n_objs * obj_size / 1e6, update_rate,
+		xport_type_str(xport_type),
+		snapshot_mode == MIRROR_SNAPSHOT_FORK ? "forked" : "live");
+
+	conn_mgmt_init();
+	conn_mgmt_set_io_mode(CONN_MGMT_IO_EVENT_LOOP, 1);
+
+	/* The master is up and busy before the backup shows up */
+	conn_mgmt_configure_connection("master", "127.0.0.1", BENCH_CONN_PORT,
+		"127.0.0.1", BENCH_CONN_PORT + 1, "master");
+	master_conn = conn_mgmt_lookup_connection_by_name("master");
+	if (!master_conn) return -1;
+
+	master = mirror_create_on_xport(master_conn, xport_type,
+		BENCH_DATA_PORT, BENCH_DATA_PORT + 1, BENCH_LOG_SIZE);
+	if (!master) return -1;
+	mirror_set_snapshot_mode(master, snapshot_mode);
+	mirror_set_sync_cbs(master, bench_snapshot, bench_sync_event, NULL);
+
+	pthread_create(&updater, NULL, bench_updater_fn, master);
+	usleep(200000);
+
+	/* Backup comes up : DOWN -> INIT -> UP starts the sync */
+	start = bench_now_usec();
+	updates = n_updates;
+	memset(&update_latency, 0, sizeof(update_latency));
+
+	conn_mgmt_configure_connection("backup", "127.0.0.1", BENCH_CONN_PORT + 1,
+		"127.0.0.1", BENCH_CONN_PORT, "backup");
+	backup_conn = conn_mgmt_lookup_connection_by_name("backup");
+	if (!backup_conn) return -1;
+
+	backup = mirror_create_on_xport(backup_conn, xport_type,
+		BENCH_DATA_PORT + 1, BENCH_DATA_PORT, BENCH_LOG_SIZE);
+	if (!backup) return -1;
+	mirror_register_apply_cb(backup, BENCH_OP_UPDATE, bench_apply);
+	mirror_set_apply_workers(backup, apply_workers);
+	mirror_set_sync_cbs(backup, NULL, bench_sync_event, NULL);
+
+	if (!bench_wait_ready(master, 30000000)) {
+		printf("FAIL : backup not ready\n");
+		return -1;
+	}
+	bench_report("backup came up", master, backup, n_updates - updates,
+		bench_now_usec() - start);
+
+	/* Resync with too little room for the records held back : the
+	 * sync gives up, the master never stalls */
+	mirror_set_sync_limit(master, 64 * 1024);
+	mirror_start_sync(master);
+	start = bench_now_usec();
+	while (master->stats.sync_aborts == 0 &&
+		   bench_now_usec() - start < 10000000) {
+		usleep(1000);
+	}
+	printf("resync limited to 64 KB held back : %s after %.1f msec\n",
+		master->stats.sync_aborts ? "aborted" : "not aborted",
+		(bench_now_usec() - start) / 1e3);
+
+	mirror_set_sync_limit(master, 0);
+	start = bench_now_usec();
+	updates = n_updates;
+	memset(&update_latency, 0, sizeof(update_latency));
+	mirror_start_sync(master);
+	usleep(1000);
+	if (!bench_wait_ready(master, 30000000)) {
+		printf("FAIL : backup not ready after resync\n");
+		return -1;
+	}
+	bench_report("resync", master, backup, n_updates - updates,
+		bench_now_usec() - start);
+
+	/* Quiesce, the backup must then hold the master's objects */
+	updater_stop = true;
+	pthread_join(updater, NULL);
+	start = bench_now_usec();
+	while (backup->stats.applied_lsn < master->next_lsn - 1 &&
+		   bench_now_usec() - start < 10000000) {
+		usleep(1000);
+	}
+	printf("%s : backup %s the master's objects\n",
+		memcmp(master_objs, backup_objs, (uint64_t)n_objs * obj_size) ?
+			"FAIL" : "PASS",
+		memcmp(master_objs, backup_objs, (uint64_t)n_objs * obj_size) ?
+			"differs from" : "matches");
+
+	printf("\n");
+	mirror_print_stats(master);
+	mirror_print_stats(backup);
+
+	mirror_destroy(master);
+	mirror_destroy(backup);
+	return 0;
+}
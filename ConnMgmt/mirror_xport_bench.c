@@ -0,0 +1,163 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  mirror_xport_bench.c
+ *
+ *    Description: This file benchmarks the mirror over its data socket and over each
+ *                 transport : async records streamed flat out, and records committed
+ *                 one at a time once applied by the backup
+ *
+ *        Version:  1.0
+ *        Created:  10/18/2026 01:48:06 AM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  ABHISHEK SAGAR (), sachinites@gmail.com
+ *   Organization:  Juniper Networks
+ *
+ * =====================================================================================
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "mirror.h"
+
+#define BENCH_CONN_PORT		24900
+#define BENCH_DATA_PORT		25000
+#define BENCH_N_OBJS		4096
+#define BENCH_OP_UPDATE		1
+#define BENCH_PAYLOAD_SIZE	128
+
+static uint64_t
+bench_now_usec() {
+
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (ts.tv_sec * 1000000ULL) + (ts.tv_nsec / 1000);
+}
+
+static void
+bench_apply(mirror_t *mirror, uint64_t obj_id, uint16_t op,
+			unsigned char *payload, uint32_t payload_len, mirror_lsn_t lsn) {
+}
+
+/* Appends records in the given mode for duration_usec, then waits for
+ * the backup to apply them all */
+static void
+bench_run(const char *path, mirror_t *master, mirror_t *backup,
+		  mirror_durability_t mode, uint64_t duration_usec) {
+
+	uint64_t i = 0, start, now, elapsed;
+	unsigned char payload[BENCH_PAYLOAD_SIZE];
+	mirror_stats_t m0, m1, b0, b1;
+	double secs;
+
+	memset(payload, 0xcd, sizeof(payload));
+	mirror_get_stats(master, &m0);
+	mirror_get_stats(backup, &b0);
+	start = bench_now_usec();
+
+	do {
+		mirror_append_durable(master, i % BENCH_N_OBJS, BENCH_OP_UPDATE,
+							  payload, sizeof(payload), mode);
+		i++;
+		now = bench_now_usec();
+	} while (now - start < duration_usec);
+
+	/* Until the backup caught up, or gave up on what was lost */
+	while (backup->rx_next_lsn < master->next_lsn &&
+		   bench_now_usec() - now < 2000000) {
+		usleep(100);
+	}
+	elapsed = bench_now_usec() - start;
+
+	mirror_get_stats(master, &m1);
+	mirror_get_stats(backup, &b1);
+	conn_mgmt_hist_sub(&m1.commit_latency[mode], &m0.commit_latency[mode]);
+	conn_mgmt_hist_sub(&b1.apply_lag, &b0.apply_lag);
+	secs = elapsed / 1e6;
+
+	printf("%-12s %-8s %10.0f %10.0f %8lu %8lu %8lu %8lu %8lu\n",
+		path, mode == MIRROR_DURABILITY_ASYNC ? "async" : "applied",
+		(m1.appended_records - m0.appended_records) / secs,
+		(b1.applied_records - b0.applied_records) / secs,
+		conn_mgmt_hist_percentile(&m1.commit_latency[mode], 50),
+		conn_mgmt_hist_percentile(&m1.commit_latency[mode], 99),
+		conn_mgmt_hist_percentile(&b1.apply_lag, 50),
+		conn_mgmt_hist_percentile(&b1.apply_lag, 99),
+		b1.lost_records - b0.lost_records);
+	fflush(stdout);
+}
+
+int
+main(int argc, char **argv) {
+
+	int path;
+	uint32_t duration_msec = 1000;
+	uint64_t start;
+	mirror_t *master, *backup;
+	conn_mgmt_conn_state_t *master_conn, *backup_conn;
+	const char *path_name;
+
+	if (argc > 1) duration_msec = atoi(argv[1]);
+
+	conn_mgmt_init();
+	conn_mgmt_set_io_mode(CONN_MGMT_IO_EVENT_LOOP, 1);
+
+	conn_mgmt_configure_connection("master", "127.0.0.1", BENCH_CONN_PORT,
+		"127.0.0.1", BENCH_CONN_PORT + 1, "master");
+	conn_mgmt_configure_connection("backup", "127.0.0.1", BENCH_CONN_PORT + 1,
+		"127.0.0.1", BENCH_CONN_PORT, "backup");
+	master_conn = conn_mgmt_lookup_connection_by_name("master");
+	backup_conn = conn_mgmt_lookup_connection_by_name("backup");
+	if (!master_conn || !backup_conn) return -1;
+
+	start = bench_now_usec();
+	while (master_conn->conn_status != COMM_MGMT_CONN_UP &&
+		   bench_now_usec() - start < 5000000) {
+		usleep(1000);
+	}
+
+	printf("%u byte records, %u msec per run, latency in usec\n",
+		BENCH_PAYLOAD_SIZE, duration_msec);
+	printf("%-12s %-8s %10s %10s %8s %8s %8s %8s %8s\n",
+		"data path", "mode", "appends/s", "applies/s", "commit50",
+		"commit99", "lag50", "lag99", "lost");
+
+	/* -1 : the mirror's own data socket */
+	for (path = -1; path < XPORT_TYPE_MAX; path++) {
+
+		if (path < 0) {
+			path_name = "udp";
+			master = mirror_create(master_conn, BENCH_DATA_PORT,
+								   BENCH_DATA_PORT + 1, 0);
+			backup = mirror_create(backup_conn, BENCH_DATA_PORT + 1,
+								   BENCH_DATA_PORT, 0);
+		}
+		else {
+			path_name = xport_type_str(path);
+			master = mirror_create_on_xport(master_conn, path,
+				BENCH_DATA_PORT + 2 + (2 * path),
+				BENCH_DATA_PORT + 3 + (2 * path), 0);
+			backup = mirror_create_on_xport(backup_conn, path,
+				BENCH_DATA_PORT + 3 + (2 * path),
+				BENCH_DATA_PORT + 2 + (2 * path), 0);
+		}
+		if (!master || !backup) return -1;
+
+		mirror_register_apply_cb(backup, BENCH_OP_UPDATE, bench_apply);
+
+		bench_run(path_name, master, backup, MIRROR_DURABILITY_ASYNC,
+				  duration_msec * 1000ULL);
+		bench_run(path_name, master, backup, MIRROR_DURABILITY_APPLIED,
+				  duration_msec * 1000ULL);
+
+		mirror_destroy(master);
+		mirror_destroy(backup);
+	}
+	return 0;
+}
@@ -0,0 +1,705 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  page_mirror.c
+ *
+ *    Description: This file implements the tracking of the pages the application
+ *                 writes in its registered memory regions, and their mirroring
+ *
+ *        Version:  1.0
+ *        Created:  10/18/2026 04:12:31 AM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  ABHISHEK SAGAR (), sachinites@gmail.com
+ *   Organization:  Juniper Networks
+ *
+ * =====================================================================================
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/fs.h>
+#include <linux/userfaultfd.h>
+#include "page_mirror.h"
+
+/* Async write-protect and PAGEMAP_SCAN came with Linux 6.7, older uapi
+ * headers lack them */
+#ifndef UFFD_FEATURE_WP_UNPOPULATED
+#define UFFD_FEATURE_WP_UNPOPULATED	(1 << 13)
+#endif
+#ifndef UFFD_FEATURE_WP_ASYNC
+#define UFFD_FEATURE_WP_ASYNC		(1 << 15)
+#endif
+
+#ifndef PAGEMAP_SCAN
+struct pm_scan_arg {
+
+    uint64_t size;
+    uint64_t flags;
+    uint64_t start;
+    uint64_t end;
+    uint64_t walk_end;
+    uint64_t vec;
+    uint64_t vec_len;
+    uint64_t max_pages;
+    uint64_t category_inverted;
+    uint64_t category_mask;
+    uint64_t category_anyof_mask;
+    uint64_t return_mask;
+};
+
+#define PAGEMAP_SCAN			_IOWR('f', 16, struct pm_scan_arg)
+#define PAGE_IS_WRITTEN			(1 << 1)
+#define PM_SCAN_WP_MATCHING		(1 << 0)
+#define PM_SCAN_CHECK_WPASYNC		(1 << 1)
+#endif
+
+static uint64_t
+page_mirror_get_time_usec() {
+
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (ts.tv_sec * 1000000ULL) + (ts.tv_nsec / 1000);
+}
+
+/* Pages are diffed in well under a usec */
+static uint64_t
+page_mirror_get_time_nsec() {
+
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (ts.tv_sec * 1000000000ULL) + ts.tv_nsec;
+}
+
+/* Room for n more runs past the first n_runs */
+static void
+page_mirror_runs_reserve(page_mirror_t *page_mirror, uint32_t n_runs,
+                         uint32_t n) {
+
+    if (n_runs + n <= page_mirror->runs_capacity) return;
+
+    while (page_mirror->runs_capacity < n_runs + n) {
+        page_mirror->runs_capacity = page_mirror->runs_capacity ?
+            page_mirror->runs_capacity * 2 : PAGE_MIRROR_SCAN_BATCH;
+    }
+    page_mirror->runs = realloc(page_mirror->runs,
+        page_mirror->runs_capacity * sizeof(page_mirror_run_t));
+}
+
+/* Written pages of the region, protected again by the same ioctl : a
+ * write after it shows up in the next scan */
+static bool
+page_mirror_scan_uffd_wp(page_mirror_t *page_mirror,
+                         page_mirror_region_t *region, uint32_t *n_runs) {
+
+    long n;
+    struct pm_scan_arg arg;
+    uint64_t start = (uintptr_t)region->addr;
+    uint64_t end = start + region->len;
+
+    while (start < end) {
+
+        page_mirror_runs_reserve(page_mirror, *n_runs,
+                                 PAGE_MIRROR_SCAN_BATCH);
+
+        memset(&arg, 0, sizeof(arg));
+        arg.size = sizeof(arg);
+        arg.flags = PM_SCAN_WP_MATCHING | PM_SCAN_CHECK_WPASYNC;
+        arg.start = start;
+        arg.end = end;
+        arg.vec = (uintptr_t)(page_mirror->runs + *n_runs);
+        arg.vec_len = PAGE_MIRROR_SCAN_BATCH;
+        arg.category_mask = PAGE_IS_WRITTEN;
+        arg.return_mask = PAGE_IS_WRITTEN;
+
+        n = ioctl(page_mirror->pagemap_fd, PAGEMAP_SCAN, &arg);
+        if (n < 0) {
+            printf("Error : page mirror PAGEMAP_SCAN failed, errno = %d\n",
+                   errno);
+            return false;
+        }
+        *n_runs += n;
+        if (arg.walk_end <= start) break;
+        start = arg.walk_end;
+    }
+    return true;
+}
+
+static bool
+page_mirror_open_uffd(page_mirror_t *page_mirror) {
+
+    struct uffdio_api api;
+
+    page_mirror->uffd = syscall(SYS_userfaultfd, O_CLOEXEC | O_NONBLOCK);
+    if (page_mirror->uffd < 0) {
+        printf("Error : page mirror userfaultfd failed, errno = %d\n",
+               errno);
+        return false;
+    }
+
+    /* Async : the kernel resolves the write faults itself, and only
+     * notes the page written. No fault handling thread */
+    memset(&api, 0, sizeof(api));
+    api.api = UFFD_API;
+    api.features = UFFD_FEATURE_WP_ASYNC | UFFD_FEATURE_WP_UNPOPULATED;
+    if (ioctl(page_mirror->uffd, UFFDIO_API, &api) < 0) {
+        printf("Error : page mirror userfaultfd async write-protect not"
+               " supported, errno = %d\n", errno);
+        return false;
+    }
+    return true;
+}
+
+/* Ships the page at addr whole, or its bytes which differ from the
+ * shadow. Returns false if the page turned out unchanged */
+static bool
+page_mirror_ship_page(page_mirror_t *page_mirror, uint32_t region_id,
+                      page_mirror_region_t *region, unsigned char *addr,
+                      bool whole) {
+
+    uint32_t len;
+    uint64_t start, offset = addr - region->addr;
+    uint64_t obj_id = PAGE_MIRROR_OBJ_ID(region_id,
+                                         offset / page_mirror->page_size);
+    unsigned char *shadow = region->shadow ? region->shadow + offset : NULL;
+    page_mirror_stats_t *stats = &page_mirror->stats;
+    bool encoded;
+
+    if (shadow && !whole) {
+
+        start = page_mirror_get_time_nsec();
+        /* Patches as large as the page are no better than the page */
+        encoded = mirror_delta_encode(addr, shadow, page_mirror->page_size,
+                                      page_mirror->delta_buf,
+                                      page_mirror->page_size - 1, &len);
+        stats->diff_nsec += page_mirror_get_time_nsec() - start;
+
+        if (encoded && !len) {
+            stats->pages_unchanged++;
+            return false;
+        }
+        if (encoded) {
+            mirror_append(page_mirror->mirror, obj_id, PAGE_MIRROR_OP_DELTA,
+                          page_mirror->delta_buf, len);
+            stats->pages_delta++;
+            stats->pages_shipped++;
+            stats->payload_bytes += len;
+            return true;
+        }
+    }
+
+    /* The shadow gets the very bytes the record carries */
+    if (shadow) {
+        memcpy(shadow, addr, page_mirror->page_size);
+        addr = shadow;
+    }
+    mirror_append(page_mirror->mirror, obj_id, PAGE_MIRROR_OP_PAGE, addr,
+                  page_mirror->page_size);
+    stats->pages_whole++;
+    stats->pages_shipped++;
+    stats->payload_bytes += page_mirror->page_size;
+    return true;
+}
+
+/* Ships every page of the runs, the written ones or those of new
+ * regions */
+static uint64_t
+page_mirror_ship_runs(page_mirror_t *page_mirror, uint32_t n_runs) {
+
+    uint32_t i, region_id;
+    uint64_t addr, n_pages = 0;
+    page_mirror_run_t *run;
+
+    for (i = 0; i < n_runs; i++) {
+
+        run = &page_mirror->runs[i];
+        region_id = (uint32_t)run->categories;
+
+        for (addr = run->start; addr < run->end;
+             addr += page_mirror->page_size) {
+            if (page_mirror_ship_page(page_mirror, region_id,
+                    &page_mirror->regions[region_id],
+                    (unsigned char *)(uintptr_t)addr,
+                    (run->categories & PAGE_MIRROR_RUN_WHOLE) != 0)) {
+                n_pages++;
+            }
+        }
+    }
+    return n_pages;
+}
+
+void
+page_mirror_run_epoch(page_mirror_t *page_mirror) {
+
+    uint32_t region_id, n_runs = 0, first_run;
+    uint64_t start, scanned = 0, shipped, flags;
+    bool ok = true, whole;
+    page_mirror_region_t *region;
+    page_mirror_stats_t *stats = &page_mirror->stats;
+
+    pthread_mutex_lock(&page_mirror->epoch_mutex);
+    pthread_rwlock_rdlock(&page_mirror->regions_lock);
+
+    whole = stats->epochs < page_mirror->whole_until_epoch;
+
+    start = page_mirror_get_time_usec();
+
+    for (region_id = 0; ok && region_id < PAGE_MIRROR_MAX_REGIONS;
+         region_id++) {
+
+        region = &page_mirror->regions[region_id];
+        if (!region->addr) continue;
+
+        first_run = n_runs;
+        ok = page_mirror_scan_uffd_wp(page_mirror, region, &n_runs);
+
+        /* The scan protected the region again all the same */
+        flags = whole ? PAGE_MIRROR_RUN_WHOLE : 0;
+        if (region->ship_all) {
+            flags = PAGE_MIRROR_RUN_WHOLE;
+            n_runs = first_run;
+            page_mirror_runs_reserve(page_mirror, n_runs, 1);
+            page_mirror->runs[n_runs].start = (uintptr_t)region->addr;
+            page_mirror->runs[n_runs].end =
+                (uintptr_t)region->addr + region->len;
+            n_runs++;
+            region->ship_all = false;
+        }
+        for (; first_run < n_runs; first_run++) {
+            page_mirror->runs[first_run].categories = region_id | flags;
+        }
+        scanned += region->n_pages;
+    }
+
+    stats->last_scan_usec = page_mirror_get_time_usec() - start;
+    start += stats->last_scan_usec;
+
+    shipped = page_mirror_ship_runs(page_mirror, n_runs);
+
+    stats->last_ship_usec = page_mirror_get_time_usec() - start;
+    stats->epochs++;
+    stats->pages_scanned += scanned;
+    stats->last_pages_scanned = scanned;
+    stats->last_pages_shipped = shipped;
+    stats->scan_usec += stats->last_scan_usec;
+    stats->ship_usec += stats->last_ship_usec;
+    conn_mgmt_hist_add(&stats->scan_latency, stats->last_scan_usec);
+
+    pthread_rwlock_unlock(&page_mirror->regions_lock);
+    pthread_mutex_unlock(&page_mirror->epoch_mutex);
+}
+
+/* An epoch every epoch_msec, while there is a backup to ship pages to */
+static void *
+page_mirror_scan_fn(void *arg) {
+
+    struct timespec ts;
+    page_mirror_t *page_mirror = (page_mirror_t *)arg;
+    mirror_t *mirror = page_mirror->mirror;
+
+    pthread_mutex_lock(&page_mirror->thread_mutex);
+
+    while (!page_mirror->stop) {
+
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        ts.tv_nsec += (page_mirror->epoch_msec % 1000) * 1000000L;
+        ts.tv_sec += page_mirror->epoch_msec / 1000 +
+                     ts.tv_nsec / 1000000000L;
+        ts.tv_nsec %= 1000000000L;
+        pthread_cond_timedwait(&page_mirror->thread_cond,
+                               &page_mirror->thread_mutex, &ts);
+        if (page_mirror->stop) break;
+
+        /* A backup which comes up is synced with all the pages */
+        if (mirror->conn->mastership_state != COMM_MGMT_MASTER ||
+            mirror->conn_status != COMM_MGMT_CONN_UP) {
+            continue;
+        }
+
+        pthread_mutex_unlock(&page_mirror->thread_mutex);
+        page_mirror_run_epoch(page_mirror);
+        if (page_mirror->resync && mirror->sync_state == MIRROR_SYNC_NONE &&
+            !mirror->sync_requested) {
+            page_mirror->resync = false;
+            mirror_start_sync(mirror);
+        }
+        pthread_mutex_lock(&page_mirror->thread_mutex);
+    }
+    pthread_mutex_unlock(&page_mirror->thread_mutex);
+    return NULL;
+}
+
+/* Master : the sync walks the pages of all regions, *cursor is the obj
+ * id of the next page */
+static bool
+page_mirror_snapshot(mirror_t *mirror, void *arg, uint64_t *cursor,
+                     uint64_t *obj_id, uint16_t *op, unsigned char *payload,
+                     uint32_t *payload_len, uint32_t max_len) {
+
+    page_mirror_t *page_mirror = (page_mirror_t *)arg;
+    uint64_t region_id = *cursor >> 32;
+    uint32_t page = (uint32_t)*cursor;
+    page_mirror_region_t *region = NULL;
+
+    assert(max_len >= page_mirror->page_size);
+
+    pthread_rwlock_rdlock(&page_mirror->regions_lock);
+
+    for (; region_id < PAGE_MIRROR_MAX_REGIONS; region_id++, page = 0) {
+        region = &page_mirror->regions[region_id];
+        if (region->addr && page < region->n_pages) break;
+    }
+    if (region_id == PAGE_MIRROR_MAX_REGIONS) {
+        pthread_rwlock_unlock(&page_mirror->regions_lock);
+        return false;
+    }
+
+    memcpy(payload, region->addr + ((uint64_t)page * page_mirror->page_size),
+           page_mirror->page_size);
+    *obj_id = PAGE_MIRROR_OBJ_ID(region_id, page);
+    *op = PAGE_MIRROR_OP_PAGE;
+    *payload_len = page_mirror->page_size;
+    *cursor = PAGE_MIRROR_OBJ_ID(region_id, page + 1);
+
+    pthread_rwlock_unlock(&page_mirror->regions_lock);
+    return true;
+}
+
+/* Master : a sync ended short of the backup being ready while the
+ * connection is up, it was aborted.
+ *
+ * Pages read by the snapshot may differ from their shadow. Every page
+ * written meanwhile goes out whole, until an epoch which scanned after
+ * the snapshot was done : the epoch under way may have scanned before */
+static void
+page_mirror_sync_event(mirror_t *mirror, void *arg,
+                       mirror_sync_state_t state) {
+
+    page_mirror_t *page_mirror = (page_mirror_t *)arg;
+
+    if (state == MIRROR_SYNC_SNAPSHOT) {
+        page_mirror->whole_until_epoch = UINT64_MAX;
+    } else if (state == MIRROR_SYNC_CATCHUP) {
+        page_mirror->whole_until_epoch = page_mirror->stats.epochs + 2;
+    }
+
+    if (state == MIRROR_SYNC_NONE &&
+        mirror->conn_status == COMM_MGMT_CONN_UP &&
+        mirror->conn->mastership_state == COMM_MGMT_MASTER) {
+        page_mirror->resync = true;
+    }
+}
+
+/* Backup : copies the page into the region of the same id. Apply
+ * workers may run it for several pages at once */
+static void
+page_mirror_apply(mirror_t *mirror, uint64_t obj_id, uint16_t op,
+                  unsigned char *payload, uint32_t payload_len,
+                  mirror_lsn_t lsn) {
+
+    page_mirror_t *page_mirror = (page_mirror_t *)mirror->sync_cb_arg;
+    uint64_t region_id = obj_id >> 32;
+    uint32_t page = (uint32_t)obj_id;
+    page_mirror_region_t *region;
+
+    if (!page_mirror) return;
+
+    pthread_rwlock_rdlock(&page_mirror->regions_lock);
+
+    region = region_id < PAGE_MIRROR_MAX_REGIONS ?
+             &page_mirror->regions[region_id] : NULL;
+
+    if (!region || !region->addr || page >= region->n_pages) {
+        __sync_fetch_and_add(&page_mirror->stats.pages_dropped, 1);
+    } else if (op == PAGE_MIRROR_OP_PAGE &&
+               payload_len == page_mirror->page_size) {
+        memcpy(region->addr + ((uint64_t)page * page_mirror->page_size),
+               payload, payload_len);
+        __sync_fetch_and_add(&page_mirror->stats.pages_applied, 1);
+    } else if (op == PAGE_MIRROR_OP_DELTA &&
+               mirror_delta_apply(region->addr +
+                   ((uint64_t)page * page_mirror->page_size),
+                   page_mirror->page_size, payload, payload_len)) {
+        __sync_fetch_and_add(&page_mirror->stats.pages_applied, 1);
+    } else {
+        __sync_fetch_and_add(&page_mirror->stats.pages_dropped, 1);
+    }
+    pthread_rwlock_unlock(&page_mirror->regions_lock);
+}
+
+page_mirror_t *
+page_mirror_create(mirror_t *mirror, uint32_t epoch_msec) {
+
+    page_mirror_t *page_mirror;
+    pthread_condattr_t cond_attr;
+
+    page_mirror = calloc(1, sizeof(page_mirror_t));
+    page_mirror->mirror = mirror;
+    page_mirror->epoch_msec = epoch_msec ? epoch_msec :
+                              PAGE_MIRROR_DEFAULT_EPOCH_MSEC;
+    page_mirror->page_size = sysconf(_SC_PAGESIZE);
+    page_mirror->uffd = -1;
+    page_mirror->start_time = page_mirror_get_time_usec();
+    /* Until the backup's first sync */
+    page_mirror->whole_until_epoch = UINT64_MAX;
+
+    page_mirror->pagemap_fd = open("/proc/self/pagemap", O_RDONLY);
+    if (page_mirror->pagemap_fd < 0) {
+        printf("Error : page mirror pagemap open failed, errno = %d\n",
+               errno);
+        free(page_mirror);
+        return NULL;
+    }
+
+    if (!page_mirror_open_uffd(page_mirror)) goto fail;
+
+    pthread_rwlock_init(&page_mirror->regions_lock, NULL);
+    pthread_mutex_init(&page_mirror->epoch_mutex, NULL);
+    pthread_mutex_init(&page_mirror->thread_mutex, NULL);
+    pthread_condattr_init(&cond_attr);
+    pthread_condattr_setclock(&cond_attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&page_mirror->thread_cond, &cond_attr);
+    pthread_condattr_destroy(&cond_attr);
+
+    mirror_register_apply_cb(mirror, PAGE_MIRROR_OP_PAGE, page_mirror_apply);
+    mirror_register_apply_cb(mirror, PAGE_MIRROR_OP_DELTA, page_mirror_apply);
+    /* A patch applies on top of the earlier ones of its page */
+    mirror_set_op_ordered(mirror, PAGE_MIRROR_OP_DELTA, true);
+    mirror_set_sync_cbs(mirror, page_mirror_snapshot, page_mirror_sync_event,
+                        page_mirror);
+
+    pthread_create(&page_mirror->scan_thread, NULL, page_mirror_scan_fn,
+                   page_mirror);
+    return page_mirror;
+
+fail:
+    if (page_mirror->uffd >= 0) close(page_mirror->uffd);
+    close(page_mirror->pagemap_fd);
+    free(page_mirror);
+    return NULL;
+}
+
+void
+page_mirror_destroy(page_mirror_t *page_mirror) {
+
+    uint32_t region_id;
+
+    pthread_mutex_lock(&page_mirror->thread_mutex);
+    page_mirror->stop = true;
+    pthread_cond_signal(&page_mirror->thread_cond);
+    pthread_mutex_unlock(&page_mirror->thread_mutex);
+    pthread_join(page_mirror->scan_thread, NULL);
+
+    mirror_set_sync_cbs(page_mirror->mirror, NULL, NULL, NULL);
+    mirror_register_apply_cb(page_mirror->mirror, PAGE_MIRROR_OP_PAGE, NULL);
+    mirror_register_apply_cb(page_mirror->mirror, PAGE_MIRROR_OP_DELTA, NULL);
+    mirror_set_op_ordered(page_mirror->mirror, PAGE_MIRROR_OP_DELTA, false);
+
+    for (region_id = 0; region_id < PAGE_MIRROR_MAX_REGIONS; region_id++) {
+        page_mirror_unregister_region(page_mirror, region_id);
+    }
+
+    if (page_mirror->uffd >= 0) close(page_mirror->uffd);
+    close(page_mirror->pagemap_fd);
+    free(page_mirror->runs);
+    free(page_mirror->delta_buf);
+    free(page_mirror);
+}
+
+bool
+page_mirror_register_region(page_mirror_t *page_mirror, uint32_t region_id,
+                            void *addr, uint64_t len) {
+
+    struct uffdio_register reg;
+    struct uffdio_writeprotect wp;
+    page_mirror_region_t *region;
+
+    if (region_id >= PAGE_MIRROR_MAX_REGIONS || !len ||
+        ((uintptr_t)addr | len) & (page_mirror->page_size - 1) ||
+        len / page_mirror->page_size > UINT32_MAX) {
+        printf("Error : page mirror region %u must be page aligned\n",
+               region_id);
+        return false;
+    }
+
+    pthread_rwlock_wrlock(&page_mirror->regions_lock);
+
+    region = &page_mirror->regions[region_id];
+    if (region->addr) {
+        pthread_rwlock_unlock(&page_mirror->regions_lock);
+        printf("Error : page mirror region %u already registered\n",
+               region_id);
+        return false;
+    }
+
+    memset(&reg, 0, sizeof(reg));
+    reg.range.start = (uintptr_t)addr;
+    reg.range.len = len;
+    reg.mode = UFFDIO_REGISTER_MODE_WP;
+    if (ioctl(page_mirror->uffd, UFFDIO_REGISTER, &reg) < 0) {
+        pthread_rwlock_unlock(&page_mirror->regions_lock);
+        printf("Error : page mirror region %u userfaultfd register"
+               " failed, errno = %d\n", region_id, errno);
+        return false;
+    }
+
+    memset(&wp, 0, sizeof(wp));
+    wp.range = reg.range;
+    wp.mode = UFFDIO_WRITEPROTECT_MODE_WP;
+    if (ioctl(page_mirror->uffd, UFFDIO_WRITEPROTECT, &wp) < 0) {
+        ioctl(page_mirror->uffd, UFFDIO_UNREGISTER, &reg.range);
+        pthread_rwlock_unlock(&page_mirror->regions_lock);
+        printf("Error : page mirror region %u write-protect failed,"
+               " errno = %d\n", region_id, errno);
+        return false;
+    }
+
+    region->addr = addr;
+    region->len = len;
+    region->n_pages = len / page_mirror->page_size;
+    /* Copied once writes are tracked : a page written meanwhile gets
+     * diffed with whatever the copy got */
+    if (page_mirror->delta) {
+        region->shadow = malloc(len);
+        memcpy(region->shadow, addr, len);
+    }
+    /* Else the next sync walks the region : the backup is not up yet.
+     * A sync under way may have walked past the region already */
+    region->ship_all =
+        page_mirror->mirror->sync_state != MIRROR_SYNC_NONE;
+    page_mirror->tracked_bytes += len;
+
+    pthread_rwlock_unlock(&page_mirror->regions_lock);
+    return true;
+}
+
+bool
+page_mirror_set_delta(page_mirror_t *page_mirror, bool enable) {
+
+    uint32_t region_id;
+
+    /* A patch lost leaves the backup's page wrong for good, the
+     * data socket drops records */
+    if (enable && !page_mirror->mirror->xport) {
+        printf("Error : page mirror deltas need a reliable transport\n");
+        return false;
+    }
+
+    pthread_rwlock_wrlock(&page_mirror->regions_lock);
+
+    for (region_id = 0; region_id < PAGE_MIRROR_MAX_REGIONS; region_id++) {
+        if (page_mirror->regions[region_id].addr) {
+            pthread_rwlock_unlock(&page_mirror->regions_lock);
+            printf("Error : page mirror deltas set with regions"
+                   " registered\n");
+            return false;
+        }
+    }
+    page_mirror->delta = enable;
+    if (enable && !page_mirror->delta_buf) {
+        page_mirror->delta_buf = malloc(page_mirror->page_size);
+    }
+    pthread_rwlock_unlock(&page_mirror->regions_lock);
+    return true;
+}
+
+void
+page_mirror_unregister_region(page_mirror_t *page_mirror,
+                              uint32_t region_id) {
+
+    struct uffdio_range range;
+    page_mirror_region_t *region;
+
+    if (region_id >= PAGE_MIRROR_MAX_REGIONS) return;
+
+    pthread_rwlock_wrlock(&page_mirror->regions_lock);
+
+    region = &page_mirror->regions[region_id];
+    if (!region->addr) {
+        pthread_rwlock_unlock(&page_mirror->regions_lock);
+        return;
+    }
+
+    /* Write-protect goes with the registration */
+    range.start = (uintptr_t)region->addr;
+    range.len = region->len;
+    ioctl(page_mirror->uffd, UFFDIO_UNREGISTER, &range);
+
+    page_mirror->tracked_bytes -= region->len;
+    free(region->shadow);
+    memset(region, 0, sizeof(*region));
+
+    pthread_rwlock_unlock(&page_mirror->regions_lock);
+}
+
+void
+page_mirror_get_stats(page_mirror_t *page_mirror,
+                      page_mirror_stats_t *stats) {
+
+    memcpy(stats, &page_mirror->stats, sizeof(*stats));
+}
+
+void
+page_mirror_print_stats(page_mirror_t *page_mirror) {
+
+    page_mirror_stats_t *stats = &page_mirror->stats;
+    double secs = (page_mirror_get_time_usec() -
+                   page_mirror->start_time) / 1e6;
+    double tracked_gb = page_mirror->tracked_bytes / 1e9;
+
+    printf("page mirror %s : %.1f MB tracked  epoch %u msec  uptime"
+           " %.2f sec\n", page_mirror->mirror->conn->conn_name,
+           page_mirror->tracked_bytes / 1e6, page_mirror->epoch_msec, secs);
+
+    if (stats->epochs) {
+        printf("\tepochs %lu : pages scanned %lu  shipped %lu (%.3f%%)"
+               "  last epoch scanned %lu shipped %lu\n",
+               stats->epochs, stats->pages_scanned, stats->pages_shipped,
+               stats->pages_scanned ?
+                   (100.0 * stats->pages_shipped) / stats->pages_scanned : 0,
+               stats->last_pages_scanned, stats->last_pages_shipped);
+        printf("\tscan : %.1f usec per epoch  %.1f usec per GB tracked"
+               "  ship %.1f usec per epoch (%.1f MB/s)\n",
+               (double)stats->scan_usec / stats->epochs,
+               tracked_gb ?
+                   (double)stats->scan_usec / stats->epochs / tracked_gb : 0,
+               (double)stats->ship_usec / stats->epochs,
+               stats->ship_usec ?
+                   (double)stats->pages_shipped * page_mirror->page_size /
+                   stats->ship_usec : 0);
+        printf("\tscan latency : ");
+        conn_mgmt_hist_print_summary(&stats->scan_latency, "usec", 1);
+    }
+    if (stats->pages_delta || stats->pages_unchanged) {
+        printf("\tdeltas (%s) : pages whole %lu  patched %lu  unchanged %lu"
+               "  payload %.2f MB of %.2f MB in pages (%.1f%% saved)"
+               "  diff %.0f nsec per page\n",
+               mirror_delta_isa_str(mirror_delta_get_isa()),
+               stats->pages_whole, stats->pages_delta,
+               stats->pages_unchanged, stats->payload_bytes / 1e6,
+               (double)stats->pages_shipped * page_mirror->page_size / 1e6,
+               stats->pages_shipped ?
+                   100.0 - (100.0 * stats->payload_bytes) /
+                   (stats->pages_shipped * page_mirror->page_size) : 0,
+               (stats->pages_delta + stats->pages_unchanged) ?
+                   (double)stats->diff_nsec /
+                   (stats->pages_delta + stats->pages_unchanged) : 0);
+    }
+    if (stats->pages_applied || stats->pages_dropped) {
+        printf("\tapplied : %lu pages  dropped %lu\n",
+               stats->pages_applied, stats->pages_dropped);
+    }
+}
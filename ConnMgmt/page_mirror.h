@@ -0,0 +1,207 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  page_mirror.h
+ *
+ *    Description: This file defines the interfaces to mirror memory regions of the
+ *                 application, page by page, without the application appending
+ *                 records for its updates
+ *
+ *        Version:  1.0
+ *        Created:  10/18/2026 04:12:31 AM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  ABHISHEK SAGAR (), sachinites@gmail.com
+ *   Organization:  Juniper Networks
+ *
+ * =====================================================================================
+ */
+#ifndef __PAGE_MIRROR__
+#define __PAGE_MIRROR__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include "mirror.h"
+#include "mirror_delta.h"
+#include "conn_mgmt_hist.h"
+
+/* The app registers memory regions, its state arena say, and writes to
+ * them as it always did. Every epoch a scan thread asks the kernel for
+ * the pages of the regions written since the last scan, and appends
+ * each of them to a mirror as a record of its own. The page mirror on
+ * the backup copies the records into the same regions of its own.
+ *
+ * A page is copied while the app may be writing it : the write marks
+ * the page written again, and the next epoch ships it once more. Once
+ * the app stops writing, an epoch leaves the backup with the master's
+ * pages.
+ *
+ * Written pages are tracked with userfaultfd write-protect in async
+ * mode, and PAGEMAP_SCAN which reports the written pages and protects
+ * them again at once : Linux 6.7 and up. Soft-dirty bits are no
+ * alternative, they are read and cleared apart and a write landing in
+ * between is lost.
+ *
+ * With deltas on, the master keeps a shadow copy of the regions as the
+ * backup has them, and ships only the bytes of a written page which
+ * changed, see mirror_delta.h. Pages go out whole until the backup
+ * has the shadow's bytes : while it is being synced, and for a region
+ * new to it.
+ *
+ * The page mirror owns the sync cbs of its mirror : a backup which
+ * comes up is synced with every page of the regions, and a sync which
+ * was aborted is started again the next epoch */
+
+#define PAGE_MIRROR_MAX_REGIONS		64
+#define PAGE_MIRROR_DEFAULT_EPOCH_MSEC	10
+/* Ops of the page records, whole pages and patches of pages. The app
+ * must leave them to the page mirror */
+#define PAGE_MIRROR_OP_PAGE		(MIRROR_MAX_OPS - 1)
+#define PAGE_MIRROR_OP_DELTA		(MIRROR_MAX_OPS - 2)
+/* Written pages asked of PAGEMAP_SCAN at once, as ranges */
+#define PAGE_MIRROR_SCAN_BATCH		1024
+
+/* Obj id of a page record : region id, and page index in the region */
+#define PAGE_MIRROR_OBJ_ID(region_id, page)	\
+    (((uint64_t)(region_id) << 32) | (page))
+
+typedef struct page_mirror_region_ {
+
+    unsigned char *addr;
+    uint64_t len;
+    uint32_t n_pages;
+    /* Every page goes out next epoch, the region is new to a backup
+     * synced already */
+    bool ship_all;
+    /* The region as the backup has it, with deltas on */
+    unsigned char *shadow;
+} page_mirror_region_t;
+
+/* Pages start to end of a region written since the last scan. Laid
+ * out as the kernel's struct page_region, PAGEMAP_SCAN fills them in */
+typedef struct page_mirror_run_ {
+
+    uint64_t start;
+    uint64_t end;
+    /* Region id, once the scan is done, and PAGE_MIRROR_RUN_WHOLE */
+    uint64_t categories;
+} page_mirror_run_t;
+
+/* The pages of the run go out whole, the backup lacks them */
+#define PAGE_MIRROR_RUN_WHOLE		(1ULL << 63)
+
+typedef struct page_mirror_stats_ {
+
+    /* Master side */
+    uint64_t epochs;
+    /* Pages of the regions the scans covered, and written pages found
+     * and shipped */
+    uint64_t pages_scanned;
+    uint64_t pages_shipped;
+    uint64_t last_pages_scanned;
+    uint64_t last_pages_shipped;
+    /* Pages shipped whole and as patches, and written pages which
+     * turned out unchanged. Bytes of the records' payloads */
+    uint64_t pages_whole;
+    uint64_t pages_delta;
+    uint64_t pages_unchanged;
+    uint64_t payload_bytes;
+    /* usecs spent finding the written pages, and appending them */
+    uint64_t scan_usec;
+    uint64_t ship_usec;
+    uint64_t last_scan_usec;
+    uint64_t last_ship_usec;
+    /* nsecs of ship_usec spent diffing pages with their shadow */
+    uint64_t diff_nsec;
+    /* usecs per scan, of all the regions */
+    conn_mgmt_hist_t scan_latency;
+    /* Backup side : pages copied in, and pages of no region we know */
+    uint64_t pages_applied;
+    uint64_t pages_dropped;
+} page_mirror_stats_t;
+
+typedef struct page_mirror_ {
+
+    mirror_t *mirror;
+    uint32_t epoch_msec;
+    uint32_t page_size;
+    /* Userfaultfd and pagemap of the process */
+    int uffd;
+    int pagemap_fd;
+    /* Indexed by region id, unused while addr is NULL. Epochs, the
+     * snapshot and the apply cb read them, register/unregister write
+     * them */
+    page_mirror_region_t regions[PAGE_MIRROR_MAX_REGIONS];
+    pthread_rwlock_t regions_lock;
+    uint64_t tracked_bytes;
+    /* Written page ranges found by the scan of an epoch */
+    page_mirror_run_t *runs;
+    uint32_t runs_capacity;
+    /* Deltas on. Epochs ship whole pages until epochs reaches
+     * whole_until_epoch, the backup's sync is done then. Patches of a
+     * page are encoded in delta_buf */
+    bool delta;
+    uint64_t whole_until_epoch;
+    unsigned char *delta_buf;
+    /* One epoch at a time, the scan thread's or the app's */
+    pthread_mutex_t epoch_mutex;
+    pthread_mutex_t thread_mutex;
+    pthread_cond_t thread_cond;
+    bool stop;
+    /* The sync of the backup was aborted, the scan thread starts it
+     * again */
+    bool resync;
+    pthread_t scan_thread;
+    uint64_t start_time;
+    page_mirror_stats_t stats;
+} page_mirror_t;
+
+/* Page mirror over mirror, scanning the regions every epoch_msec (0
+ * picks PAGE_MIRROR_DEFAULT_EPOCH_MSEC) while mirror's connection is
+ * master. Returns NULL if the kernel can't track the written pages */
+page_mirror_t *
+page_mirror_create(mirror_t *mirror,
+                   uint32_t epoch_msec);
+
+/* Stops the scans, the mirror is left to the app to destroy */
+void
+page_mirror_destroy(page_mirror_t *page_mirror);
+
+/* Tracks len bytes at addr, both page aligned, as region_id. The
+ * memory must be private anonymous or shared memory, with a region
+ * of the same id and len registered on the backup. Every page of the
+ * region goes out with the next sync, or the next epoch if the backup
+ * is synced already */
+bool
+page_mirror_register_region(page_mirror_t *page_mirror,
+                            uint32_t region_id,
+                            void *addr,
+                            uint64_t len);
+
+/* Ships patches of the written pages rather than whole pages, on the
+ * master. Before any region is registered, and only over a mirror on
+ * a reliable transport : false if not */
+bool
+page_mirror_set_delta(page_mirror_t *page_mirror,
+                      bool enable);
+
+void
+page_mirror_unregister_region(page_mirror_t *page_mirror,
+                              uint32_t region_id);
+
+/* Ships the pages written since the last epoch now, rather than when
+ * the scan thread gets to them */
+void
+page_mirror_run_epoch(page_mirror_t *page_mirror);
+
+void
+page_mirror_get_stats(page_mirror_t *page_mirror,
+                      page_mirror_stats_t *stats);
+
+/* Counters, with the scan cost per GB of the regions tracked */
+void
+page_mirror_print_stats(page_mirror_t *page_mirror);
+
+#endif /* __PAGE_MIRROR__ */
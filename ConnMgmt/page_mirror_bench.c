@@ -0,0 +1,212 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  page_mirror_bench.c
+ *
+ *    Description: This file benchmarks the mirroring of a memory region the app
+ *                 writes without calling the mirror : pages scanned and shipped
+ *                 per epoch and the scan cost per GB, at several write rates
+ *
+ *        Version:  1.0
+ *        Created:  10/18/2026 04:12:31 AM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  ABHISHEK SAGAR (), sachinites@gmail.com
+ *   Organization:  Juniper Networks
+ *
+ * =====================================================================================
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "page_mirror.h"
+
+#define BENCH_CONN_PORT		25300
+#define BENCH_DATA_PORT		25400
+#define BENCH_REGION_ID		0
+#define BENCH_LOG_SIZE		(128 * 1024 * 1024)
+
+static uint32_t region_mb = 256;
+static uint32_t epoch_msec = 10;
+static uint32_t run_msec = 1000;
+static bool delta;
+static uint32_t coalesce_usec;
+
+static uint64_t
+bench_now_usec() {
+
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (ts.tv_sec * 1000000ULL) + (ts.tv_nsec / 1000);
+}
+
+/* Writes 8 bytes at random in the region, write_rate times a sec, for
+ * run_msec, and reports what the epochs meanwhile scanned and shipped */
+static void
+bench_run(page_mirror_t *page_mirror, unsigned char *region,
+		  uint32_t write_rate) {
+
+	uint64_t i = 0, start, now, due, off, elapsed;
+	uint64_t region_len = (uint64_t)region_mb << 20;
+	page_mirror_stats_t s0, s1;
+	conn_mgmt_hist_t write_latency;
+	uint64_t epochs, shipped, payload;
+	double tracked_gb = region_len / 1e9;
+
+	memset(&write_latency, 0, sizeof(write_latency));
+	page_mirror_get_stats(page_mirror, &s0);
+	start = bench_now_usec();
+
+	do {
+		now = bench_now_usec();
+		if (write_rate) {
+			off = (((uint64_t)rand() << 16) ^ rand()) % (region_len / 8);
+			((uint64_t *)region)[off] = i;
+			conn_mgmt_hist_add(&write_latency, bench_now_usec() - now);
+			i++;
+			due = start + (i * 1000000ULL) / write_rate;
+			now = bench_now_usec();
+			if (due > now + 50) usleep(due - now);
+		}
+		else {
+			usleep(10000);
+		}
+	} while (now - start < run_msec * 1000ULL);
+
+	elapsed = bench_now_usec() - start;
+	page_mirror_get_stats(page_mirror, &s1);
+	epochs = s1.epochs - s0.epochs;
+	if (!epochs) epochs = 1;
+	conn_mgmt_hist_sub(&s1.scan_latency, &s0.scan_latency);
+
+	shipped = s1.pages_shipped - s0.pages_shipped;
+	payload = s1.payload_bytes - s0.payload_bytes;
+
+	printf("%9u %7lu %10.0f %10.0f %9.1f %9lu %11.0f %9.1f %7.1f %7lu %7lu\n",
+		write_rate, s1.epochs - s0.epochs,
+		(double)(s1.pages_scanned - s0.pages_scanned) / epochs,
+		(double)shipped / epochs,
+		(double)(s1.scan_usec - s0.scan_usec) / epochs,
+		conn_mgmt_hist_percentile(&s1.scan_latency, 99),
+		(double)(s1.scan_usec - s0.scan_usec) / epochs / tracked_gb,
+		payload / (elapsed / 1e6) / 1e6,
+		shipped ? 100.0 - (100.0 * payload) /
+			(shipped * page_mirror->page_size) : 0,
+		conn_mgmt_hist_percentile(&write_latency, 50),
+		conn_mgmt_hist_percentile(&write_latency, 99));
+	fflush(stdout);
+}
+
+int
+main(int argc, char **argv) {
+
+	uint32_t i;
+	uint64_t start, region_len;
+	unsigned char *master_region, *backup_region;
+	mirror_t *master, *backup;
+	page_mirror_t *master_pm, *backup_pm;
+	conn_mgmt_conn_state_t *master_conn, *backup_conn;
+	static const uint32_t write_rates[] =
+		{0, 1000, 10000, 100000, 1000000};
+
+	if (argc > 1) region_mb = atoi(argv[1]);
+	if (argc > 2) epoch_msec = atoi(argv[2]);
+	if (argc > 3) run_msec = atoi(argv[3]);
+	if (argc > 4) delta = atoi(argv[4]) != 0;
+	if (argc > 5) coalesce_usec = atoi(argv[5]);
+	region_len = (uint64_t)region_mb << 20;
+
+	/* The app's state arena on both ends */
+	master_region = mmap(NULL, region_len, PROT_READ | PROT_WRITE,
+						 MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	backup_region = mmap(NULL, region_len, PROT_READ | PROT_WRITE,
+						 MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (master_region == MAP_FAILED || backup_region == MAP_FAILED) {
+		printf("Error : %u MB region mmap failed\n", region_mb);
+		return -1;
+	}
+	for (start = 0; start < region_len; start += 8) {
+		*(uint64_t *)(master_region + start) = start;
+	}
+
+	conn_mgmt_init();
+	conn_mgmt_set_io_mode(CONN_MGMT_IO_EVENT_LOOP, 1);
+
+	conn_mgmt_configure_connection("master", "127.0.0.1", BENCH_CONN_PORT,
+		"127.0.0.1", BENCH_CONN_PORT + 1, "master");
+	conn_mgmt_configure_connection("backup", "127.0.0.1", BENCH_CONN_PORT + 1,
+		"127.0.0.1", BENCH_CONN_PORT, "backup");
+	master_conn = conn_mgmt_lookup_connection_by_name("master");
+	backup_conn = conn_mgmt_lookup_connection_by_name("backup");
+	if (!master_conn || !backup_conn) return -1;
+
+	master = mirror_create_on_xport(master_conn, XPORT_TCP,
+		BENCH_DATA_PORT, BENCH_DATA_PORT + 1, BENCH_LOG_SIZE);
+	backup = mirror_create_on_xport(backup_conn, XPORT_TCP,
+		BENCH_DATA_PORT + 1, BENCH_DATA_PORT, BENCH_LOG_SIZE);
+	if (!master || !backup) return -1;
+
+	master_pm = page_mirror_create(master, epoch_msec);
+	backup_pm = page_mirror_create(backup, epoch_msec);
+	if (!master_pm || !backup_pm) return -1;
+	page_mirror_set_delta(master_pm, delta);
+	/* Patches of a page written twice in a window must both go out */
+	if (coalesce_usec) mirror_set_coalescing(master, coalesce_usec, 0);
+
+	if (!page_mirror_register_region(master_pm, BENCH_REGION_ID,
+									 master_region, region_len) ||
+		!page_mirror_register_region(backup_pm, BENCH_REGION_ID,
+									 backup_region, region_len)) {
+		return -1;
+	}
+
+	/* The backup comes up with nothing, the sync brings it every page */
+	start = bench_now_usec();
+	while (master->sync_state != MIRROR_SYNC_READY &&
+		   bench_now_usec() - start < 30000000) {
+		usleep(1000);
+	}
+	printf("%u MB region tracked, %u msec epochs, %s, backup"
+		" synced after %.1f msec\n", region_mb, epoch_msec, delta ? "page deltas" : "whole pages",
+		(bench_now_usec() - start) / 1e3);
+
+	printf("%u msec per run, 8 byte writes at random, latency in usec\n",
+		run_msec);
+	printf("%9s %7s %10s %10s %9s %9s %11s %9s %7s %7s %7s\n",
+		"writes/s", "epochs", "scanned", "shipped", "scan", "scan99",
+		"scan per GB", "ship MB/s", "saved%", "write50", "write99");
+
+	for (i = 0; i < sizeof(write_rates) / sizeof(write_rates[0]); i++) {
+		bench_run(master_pm, master_region, write_rates[i]);
+	}
+
+	/* Quiesce : one more epoch, then the backup must match */
+	page_mirror_run_epoch(master_pm);
+	start = bench_now_usec();
+	while ((master->n_staged ||
+			backup->stats.applied_lsn < master->next_lsn - 1) &&
+		   bench_now_usec() - start < 10000000) {
+		usleep(1000);
+	}
+	printf("%s : backup region %s the master's\n",
+		memcmp(master_region, backup_region, region_len) ? "FAIL" : "PASS",
+		memcmp(master_region, backup_region, region_len) ?
+			"differs from" : "matches");
+
+	printf("\n");
+	page_mirror_print_stats(master_pm);
+	page_mirror_print_stats(backup_pm);
+	mirror_print_stats(master);
+
+	page_mirror_destroy(master_pm);
+	page_mirror_destroy(backup_pm);
+	mirror_destroy(master);
+	mirror_destroy(backup);
+	return 0;
+}
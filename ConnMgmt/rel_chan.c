@@ -0,0 +1,660 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  rel_chan.c
+ *
+ *    Description: This file implements the reliable msg channel : the send window,
+ *                 selective NACKs, retransmits and in order delivery
+ *
+ *        Version:  1.0
+ *        Created:  10/17/2026 10:58:12 PM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  ABHISHEK SAGAR (), sachinites@gmail.com
+ *   Organization:  Juniper Networks
+ *
+ * =====================================================================================
+ */
+
+#define _GNU_SOURCE	/* recvmmsg() */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+#include <time.h>
+#include <unistd.h>
+#include <endian.h>
+#include <arpa/inet.h>
+#include <sys/uio.h>
+#include "rel_chan.h"
+
+static uint64_t
+rel_chan_get_time_usec() {
+
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (ts.tv_sec * 1000000ULL) + (ts.tv_nsec / 1000);
+}
+
+/* Seq nos wrap, a before b */
+static inline bool
+rel_chan_seq_before(uint32_t a, uint32_t b) {
+
+    return (int32_t)(a - b) < 0;
+}
+
+/* Sends one pkt, unless the loss emulation eats it. A pkt the socket
+ * has no room for is as good as lost, the peer NACKs it : never block
+ * with the tx mutex held, on loopback the peer's unread pkts count
+ * against our send buffer, and the peer may well be blocked on us */
+static void
+rel_chan_xmit(rel_chan_t *chan, const void *pkt, uint32_t pkt_len) {
+
+    uint64_t r;
+
+    if (chan->loss_ppm) {
+        /* xorshift, races between the threads sending only stir the
+         * state further */
+        r = chan->loss_rand_state;
+        r ^= r << 13;
+        r ^= r >> 7;
+        r ^= r << 17;
+        chan->loss_rand_state = r;
+        if ((r % 1000000) < chan->loss_ppm) {
+            chan->stats.tx_dropped++;
+            return;
+        }
+    }
+
+    while (send(chan->sock_fd, pkt, pkt_len, MSG_DONTWAIT) < 0 &&
+           errno == EINTR);
+}
+
+/* Send side, all under the tx mutex */
+
+static void
+rel_chan_retransmit(rel_chan_t *chan, uint32_t seq, uint64_t now) {
+
+    rel_chan_tx_slot_t *slot = &chan->tx_slots[seq & (chan->window - 1)];
+
+    slot->tx_time = now;
+    slot->n_tx++;
+    ((rel_chan_data_hdr_t *)slot->pkt)->una = htonl(chan->snd_una);
+    if (!rel_chan_seq_before(seq + 1, chan->recover_seq)) {
+        chan->recover_seq = seq + 1;
+    }
+    rel_chan_xmit(chan, slot->pkt, slot->pkt_len);
+}
+
+/* A seq no in [snd_una, snd_nxt) */
+static inline bool
+rel_chan_in_flight(rel_chan_t *chan, uint32_t seq) {
+
+    return (seq - chan->snd_una) < (chan->snd_nxt - chan->snd_una);
+}
+
+bool
+rel_chan_sendv(rel_chan_t *chan, const struct iovec *iov, int iovcnt) {
+
+    int i;
+    uint32_t msg_len = 0;
+    unsigned char *msg;
+    rel_chan_tx_slot_t *slot;
+    rel_chan_data_hdr_t *hdr;
+
+    for (i = 0; i < iovcnt; i++) {
+        msg_len += iov[i].iov_len;
+    }
+
+    if (msg_len > REL_CHAN_MAX_MSG_SIZE) {
+        printf("Error : rel chan msg of %u bytes is too large\n", msg_len);
+        return false;
+    }
+
+    pthread_mutex_lock(&chan->tx_mutex);
+
+    while (chan->snd_nxt - chan->snd_una >= chan->window && !chan->stop) {
+        chan->stats.window_stalls++;
+        pthread_cond_wait(&chan->tx_room_cond, &chan->tx_mutex);
+    }
+    if (chan->stop) {
+        pthread_mutex_unlock(&chan->tx_mutex);
+        return false;
+    }
+
+    slot = &chan->tx_slots[chan->snd_nxt & (chan->window - 1)];
+    hdr = (rel_chan_data_hdr_t *)slot->pkt;
+    hdr->pkt_type = REL_CHAN_PKT_DATA;
+    hdr->flags = 0;
+    hdr->len = htons(msg_len);
+    hdr->seq = htonl(chan->snd_nxt);
+    hdr->incarnation = htobe64(chan->incarnation);
+    hdr->una = htonl(chan->snd_una);
+    /* The one copy : the msg must outlive the caller's buffers until
+     * acked */
+    for (msg = (unsigned char *)(hdr + 1), i = 0; i < iovcnt; i++) {
+        memcpy(msg, iov[i].iov_base, iov[i].iov_len);
+        msg += iov[i].iov_len;
+    }
+    slot->pkt_len = sizeof(*hdr) + msg_len;
+    slot->n_tx = 1;
+    slot->tx_time = rel_chan_get_time_usec();
+    chan->snd_nxt++;
+    chan->stats.tx_msgs++;
+    chan->stats.tx_bytes += msg_len;
+
+    /* Still under the mutex : once the peer acks the msg, the slot may
+     * be handed over to the next send */
+    rel_chan_xmit(chan, slot->pkt, slot->pkt_len);
+
+    pthread_mutex_unlock(&chan->tx_mutex);
+    return true;
+}
+
+bool
+rel_chan_send(rel_chan_t *chan, const void *msg, uint32_t msg_len) {
+
+    struct iovec iov;
+
+    iov.iov_base = (void *)msg;
+    iov.iov_len = msg_len;
+    return rel_chan_sendv(chan, &iov, 1);
+}
+
+static void
+rel_chan_rx_ack(rel_chan_t *chan, rel_chan_ack_t *ack) {
+
+    uint32_t i, cum_seq, seq;
+    uint64_t now, rtt, holdoff, bits;
+    rel_chan_tx_slot_t *slot;
+
+    /* For msgs of ours past, before a restart */
+    if (be64toh(ack->incarnation) != chan->incarnation) return;
+
+    cum_seq = ntohl(ack->cum_seq);
+    now = rel_chan_get_time_usec();
+
+    pthread_mutex_lock(&chan->tx_mutex);
+
+    chan->stats.acks_rx++;
+
+    if (rel_chan_seq_before(chan->snd_una, cum_seq) &&
+        cum_seq - chan->snd_una <= chan->snd_nxt - chan->snd_una) {
+
+        /* Karn : only msgs sent once tell the RTT, and only if no hole
+         * before them held up the ack */
+        slot = &chan->tx_slots[(cum_seq - 1) & (chan->window - 1)];
+        if (slot->n_tx == 1 &&
+            !rel_chan_seq_before(chan->snd_una, chan->recover_seq) &&
+            now > slot->tx_time) {
+            rtt = now - slot->tx_time;
+            chan->stats.srtt_usec = chan->stats.srtt_usec ?
+                ((7 * chan->stats.srtt_usec) + rtt) / 8 : rtt;
+        }
+        chan->snd_una = cum_seq;
+        pthread_cond_broadcast(&chan->tx_room_cond);
+    }
+
+    if (!(ack->flags & REL_CHAN_ACK_F_HOLE)) {
+        pthread_mutex_unlock(&chan->tx_mutex);
+        return;
+    }
+
+    chan->stats.nacks_rx++;
+
+    /* The peer NACKs a hole on every ack until the retransmit makes it
+     * there : one retransmit per RTT or so */
+    holdoff = chan->stats.srtt_usec + (chan->stats.srtt_usec / 2) + 100;
+
+    if (rel_chan_in_flight(chan, cum_seq)) {
+        slot = &chan->tx_slots[cum_seq & (chan->window - 1)];
+        if (now - slot->tx_time >= holdoff) {
+            rel_chan_retransmit(chan, cum_seq, now);
+            chan->stats.nack_retransmits++;
+        }
+    }
+
+    for (i = 0; i < REL_CHAN_NACK_BITMAP_SIZE / 64; i++) {
+
+        bits = be64toh(ack->nack_bitmap[i]);
+
+        while (bits) {
+            seq = cum_seq + 1 + (i * 64) + __builtin_ctzll(bits);
+            bits &= bits - 1;
+            if (!rel_chan_in_flight(chan, seq)) continue;
+            slot = &chan->tx_slots[seq & (chan->window - 1)];
+            if (now - slot->tx_time < holdoff) continue;
+            rel_chan_retransmit(chan, seq, now);
+            chan->stats.nack_retransmits++;
+        }
+    }
+
+    pthread_mutex_unlock(&chan->tx_mutex);
+}
+
+static void
+rel_chan_free(rel_chan_t *chan) {
+
+    uint32_t i;
+
+    for (i = 0; i < chan->window; i++) {
+        free(chan->tx_slots[i].pkt);
+        free(chan->rx_slots[i].msg);
+    }
+    free(chan->tx_slots);
+    free(chan->rx_slots);
+    pthread_mutex_destroy(&chan->tx_mutex);
+    pthread_cond_destroy(&chan->tx_room_cond);
+    free(chan);
+}
+
+/* Recurring on the connection's wheel timer : msgs unacked for an RTO
+ * are sent again, the RTO doubling with every retransmit */
+static void
+rel_chan_rto_timer_expired(void *arg, unsigned int arg_size) {
+
+    uint32_t seq, n_rtx = 0;
+    uint64_t now, rto;
+    rel_chan_tx_slot_t *slot;
+    rel_chan_t *chan = (rel_chan_t *)arg;
+
+    pthread_mutex_lock(&chan->tx_mutex);
+
+    /* The timer deletion takes effect at the end of this tic, the
+     * channel is not touched again */
+    if (chan->destroyed) {
+        pthread_mutex_unlock(&chan->tx_mutex);
+        timer_de_register_app_event(chan->rto_timer);
+        rel_chan_free(chan);
+        return;
+    }
+
+    if (chan->stop || chan->snd_una == chan->snd_nxt) {
+        pthread_mutex_unlock(&chan->tx_mutex);
+        return;
+    }
+
+    now = rel_chan_get_time_usec();
+    rto = 4 * chan->stats.srtt_usec;
+    if (rto < REL_CHAN_MIN_RTO_USEC) rto = REL_CHAN_MIN_RTO_USEC;
+
+    for (seq = chan->snd_una;
+         seq != chan->snd_nxt && n_rtx < REL_CHAN_RTO_BURST; seq++) {
+
+        slot = &chan->tx_slots[seq & (chan->window - 1)];
+        if (now - slot->tx_time <
+            rto << (slot->n_tx > 5 ? 4 : slot->n_tx - 1)) {
+            continue;
+        }
+        rel_chan_retransmit(chan, seq, now);
+        chan->stats.rto_retransmits++;
+        n_rtx++;
+    }
+
+    pthread_mutex_unlock(&chan->tx_mutex);
+}
+
+bool
+rel_chan_drain(rel_chan_t *chan, uint32_t timeout_msec) {
+
+    bool drained;
+    uint64_t deadline;
+    struct timespec ts;
+
+    deadline = rel_chan_get_time_usec() + (timeout_msec * 1000ULL);
+    ts.tv_sec = deadline / 1000000;
+    ts.tv_nsec = (deadline % 1000000) * 1000;
+
+    pthread_mutex_lock(&chan->tx_mutex);
+    while (chan->snd_una != chan->snd_nxt && !chan->stop) {
+        if (pthread_cond_timedwait(&chan->tx_room_cond, &chan->tx_mutex,
+                                   &ts) == ETIMEDOUT) {
+            break;
+        }
+    }
+    drained = chan->snd_una == chan->snd_nxt;
+    pthread_mutex_unlock(&chan->tx_mutex);
+    return drained;
+}
+
+/* Recv side, on the recv thread only */
+
+/* The peer restarted : msgs held are from its past incarnation, and
+ * the new one resumes at una */
+static void
+rel_chan_rx_reset(rel_chan_t *chan, uint64_t incarnation, uint32_t una) {
+
+    uint32_t i;
+
+    for (i = 0; i < chan->window; i++) {
+        chan->rx_slots[i].present = false;
+    }
+    if (chan->peer_incarnation) chan->stats.peer_restarts++;
+    chan->peer_incarnation = incarnation;
+    chan->rcv_nxt = una;
+    chan->rcv_max = una;
+}
+
+static void
+rel_chan_rx_data(rel_chan_t *chan, unsigned char *pkt, uint32_t pkt_len) {
+
+    uint32_t seq, msg_len;
+    uint64_t incarnation;
+    rel_chan_rx_slot_t *slot;
+    rel_chan_data_hdr_t *hdr = (rel_chan_data_hdr_t *)pkt;
+
+    msg_len = ntohs(hdr->len);
+    if (pkt_len < sizeof(*hdr) + msg_len) return;
+
+    incarnation = be64toh(hdr->incarnation);
+    /* Late pkts of a past incarnation */
+    if (incarnation < chan->peer_incarnation) return;
+    if (incarnation != chan->peer_incarnation) {
+        rel_chan_rx_reset(chan, incarnation, ntohl(hdr->una));
+    }
+
+    seq = ntohl(hdr->seq);
+
+    if (rel_chan_seq_before(seq, chan->rcv_nxt)) {
+        chan->stats.rx_dups++;
+        return;
+    }
+    /* Past the window, the sender has no business sending it */
+    if (seq - chan->rcv_nxt >= chan->window) return;
+
+    if (!rel_chan_seq_before(seq, chan->rcv_max)) {
+        chan->rcv_max = seq + 1;
+    }
+
+    if (seq != chan->rcv_nxt) {
+
+        slot = &chan->rx_slots[seq & (chan->window - 1)];
+        if (slot->present) {
+            chan->stats.rx_dups++;
+            return;
+        }
+        if (!slot->msg) slot->msg = malloc(REL_CHAN_MAX_MSG_SIZE);
+        memcpy(slot->msg, hdr + 1, msg_len);
+        slot->msg_len = msg_len;
+        slot->present = true;
+        chan->stats.rx_out_of_order++;
+        return;
+    }
+
+    /* In order, straight from the recv buffer */
+    chan->recv_cb(chan, chan->recv_cb_arg, (unsigned char *)(hdr + 1),
+                  msg_len);
+    chan->rcv_nxt++;
+    chan->stats.delivered_msgs++;
+    chan->stats.delivered_bytes += msg_len;
+
+    /* And whatever it held up */
+    while ((slot = &chan->rx_slots[chan->rcv_nxt & (chan->window - 1)])->
+                present) {
+        chan->recv_cb(chan, chan->recv_cb_arg, slot->msg, slot->msg_len);
+        slot->present = false;
+        chan->rcv_nxt++;
+        chan->stats.delivered_msgs++;
+        chan->stats.delivered_bytes += slot->msg_len;
+    }
+}
+
+static void
+rel_chan_send_ack(rel_chan_t *chan) {
+
+    uint32_t i, n_after;
+    uint64_t bitmap[REL_CHAN_NACK_BITMAP_SIZE / 64];
+    rel_chan_ack_t ack;
+
+    memset(&ack, 0, sizeof(ack));
+    memset(bitmap, 0, sizeof(bitmap));
+    ack.pkt_type = REL_CHAN_PKT_ACK;
+    ack.cum_seq = htonl(chan->rcv_nxt);
+    ack.incarnation = htobe64(chan->peer_incarnation);
+
+    /* Msgs recvd past rcv_nxt : it is a hole, and so is every seq no up
+     * to rcv_max not held */
+    n_after = chan->rcv_max - chan->rcv_nxt;
+
+    if (n_after) {
+        ack.flags |= REL_CHAN_ACK_F_HOLE;
+        n_after--;
+        if (n_after > REL_CHAN_NACK_BITMAP_SIZE) {
+            n_after = REL_CHAN_NACK_BITMAP_SIZE;
+        }
+        for (i = 0; i < n_after; i++) {
+            if (!chan->rx_slots[(chan->rcv_nxt + 1 + i) &
+                                (chan->window - 1)].present) {
+                bitmap[i / 64] |= 1ULL << (i % 64);
+            }
+        }
+        for (i = 0; i < REL_CHAN_NACK_BITMAP_SIZE / 64; i++) {
+            ack.nack_bitmap[i] = htobe64(bitmap[i]);
+        }
+    }
+
+    rel_chan_xmit(chan, &ack, sizeof(ack));
+    chan->stats.acks_tx++;
+}
+
+static void *
+rel_chan_recv_thread_fn(void *arg) {
+
+    int i, n_msgs;
+    bool ack_due;
+    unsigned char *pkt;
+    rel_chan_t *chan = (rel_chan_t *)arg;
+    unsigned char *pkts;
+    struct iovec iovs[REL_CHAN_IO_BATCH_SIZE];
+    struct mmsghdr msgs[REL_CHAN_IO_BATCH_SIZE];
+
+    pkts = malloc(REL_CHAN_IO_BATCH_SIZE * REL_CHAN_MAX_PKT_SIZE);
+    memset(msgs, 0, sizeof(msgs));
+
+    for (i = 0; i < REL_CHAN_IO_BATCH_SIZE; i++) {
+        iovs[i].iov_base = pkts + (i * REL_CHAN_MAX_PKT_SIZE);
+        iovs[i].iov_len = REL_CHAN_MAX_PKT_SIZE;
+        msgs[i].msg_hdr.msg_iov = &iovs[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    while (!chan->stop) {
+
+        n_msgs = recvmmsg(chan->sock_fd, msgs, REL_CHAN_IO_BATCH_SIZE,
+                          MSG_WAITFORONE, NULL);
+        chan->stats.rx_syscalls++;
+
+        if (n_msgs < 0) {
+            /* ECONNREFUSED : the peer's socket is not there yet, an
+             * ICMP error for one of our datagrams */
+            if (errno == EINTR || errno == ECONNREFUSED) continue;
+            break;
+        }
+        /* Socket shut down by rel_chan_destroy() */
+        if (chan->stop) break;
+
+        chan->stats.rx_pkts += n_msgs;
+        ack_due = false;
+
+        for (i = 0; i < n_msgs; i++) {
+
+            pkt = iovs[i].iov_base;
+
+            if (pkt[0] == REL_CHAN_PKT_DATA &&
+                msgs[i].msg_len >= sizeof(rel_chan_data_hdr_t)) {
+                rel_chan_rx_data(chan, pkt, msgs[i].msg_len);
+                ack_due = true;
+            }
+            else if (pkt[0] == REL_CHAN_PKT_ACK &&
+                     msgs[i].msg_len == sizeof(rel_chan_ack_t)) {
+                rel_chan_rx_ack(chan, (rel_chan_ack_t *)pkt);
+            }
+        }
+
+        /* One ack per batch of data pkts */
+        if (ack_due) rel_chan_send_ack(chan);
+    }
+
+    free(pkts);
+    return NULL;
+}
+
+static int
+rel_chan_open_sock(rel_chan_t *chan, uint16_t src_port, uint16_t dst_port) {
+
+    int sock_fd, buf_size = REL_CHAN_SOCK_BUF_SIZE;
+    struct sockaddr_in src_addr;
+
+    sock_fd = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (sock_fd < 0) {
+        printf("Error : rel chan socket creation failed, errno = %d\n", errno);
+        return -1;
+    }
+
+    if (setsockopt(sock_fd, SOL_SOCKET, SO_RCVBUFFORCE,
+                   &buf_size, sizeof(buf_size)) < 0) {
+        setsockopt(sock_fd, SOL_SOCKET, SO_RCVBUF,
+                   &buf_size, sizeof(buf_size));
+    }
+    if (setsockopt(sock_fd, SOL_SOCKET, SO_SNDBUFFORCE,
+                   &buf_size, sizeof(buf_size)) < 0) {
+        setsockopt(sock_fd, SOL_SOCKET, SO_SNDBUF,
+                   &buf_size, sizeof(buf_size));
+    }
+
+    memset(&src_addr, 0, sizeof(src_addr));
+    src_addr.sin_family      = AF_INET;
+    src_addr.sin_port        = src_port;
+    src_addr.sin_addr.s_addr = INADDR_ANY;
+
+    if (bind(sock_fd, (struct sockaddr *)&src_addr, sizeof(src_addr)) < 0) {
+        printf("Error : rel chan socket bind failed, errno = %d\n", errno);
+        close(sock_fd);
+        return -1;
+    }
+
+    chan->peer_addr = chan->conn->peer_addr;
+    chan->peer_addr.sin_port = dst_port;
+
+    if (connect(sock_fd, (struct sockaddr *)&chan->peer_addr,
+                sizeof(chan->peer_addr)) < 0) {
+        printf("Error : rel chan socket connect failed, errno = %d\n", errno);
+        close(sock_fd);
+        return -1;
+    }
+    return sock_fd;
+}
+
+rel_chan_t *
+rel_chan_create(conn_mgmt_conn_state_t *conn, uint16_t src_port,
+                uint16_t dst_port, uint32_t window,
+                rel_chan_recv_fn recv_cb, void *recv_cb_arg) {
+
+    uint32_t i;
+    rel_chan_t *chan;
+    struct timespec ts;
+    pthread_condattr_t cond_attr;
+
+    if (!window) window = REL_CHAN_DEFAULT_WINDOW;
+
+    if ((window & (window - 1)) || window > REL_CHAN_MAX_WINDOW) {
+        printf("Error : rel chan window must be a power of 2 up to %u\n",
+               REL_CHAN_MAX_WINDOW);
+        return NULL;
+    }
+    assert(conn->wt);
+    assert(recv_cb);
+
+    chan = calloc(1, sizeof(rel_chan_t));
+    chan->conn = conn;
+    chan->window = window;
+    chan->recv_cb = recv_cb;
+    chan->recv_cb_arg = recv_cb_arg;
+    chan->loss_rand_state = 0x9E3779B97F4A7C15ULL ^ (uintptr_t)chan;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    chan->incarnation = (ts.tv_sec * 1000000ULL) + (ts.tv_nsec / 1000);
+    pthread_mutex_init(&chan->tx_mutex, NULL);
+    /* rel_chan_drain() waits on the monotonic clock */
+    pthread_condattr_init(&cond_attr);
+    pthread_condattr_setclock(&cond_attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&chan->tx_room_cond, &cond_attr);
+    pthread_condattr_destroy(&cond_attr);
+
+    chan->tx_slots = calloc(window, sizeof(rel_chan_tx_slot_t));
+    chan->rx_slots = calloc(window, sizeof(rel_chan_rx_slot_t));
+    for (i = 0; i < window; i++) {
+        chan->tx_slots[i].pkt = malloc(REL_CHAN_MAX_PKT_SIZE);
+    }
+
+    chan->sock_fd = rel_chan_open_sock(chan, src_port, dst_port);
+
+    if (chan->sock_fd < 0) {
+        rel_chan_free(chan);
+        return NULL;
+    }
+
+    pthread_create(&chan->recv_thread, NULL, rel_chan_recv_thread_fn, chan);
+    chan->rto_timer = timer_register_app_event(conn->wt,
+                                               rel_chan_rto_timer_expired,
+                                               (void *)chan, sizeof(chan),
+                                               CONN_MGMT_TIMER_TIC_MSEC, 1);
+    return chan;
+}
+
+/* A deleted wheel timer event may still fire in the current tic, so
+ * the channel is handed over to its rto timer to free instead */
+void
+rel_chan_destroy(rel_chan_t *chan) {
+
+    pthread_mutex_lock(&chan->tx_mutex);
+    chan->stop = true;
+    pthread_cond_broadcast(&chan->tx_room_cond);
+    pthread_mutex_unlock(&chan->tx_mutex);
+
+    /* Wakes up the recv thread */
+    shutdown(chan->sock_fd, SHUT_RDWR);
+    pthread_join(chan->recv_thread, NULL);
+    close(chan->sock_fd);
+
+    pthread_mutex_lock(&chan->tx_mutex);
+    chan->destroyed = true;
+    pthread_mutex_unlock(&chan->tx_mutex);
+}
+
+void
+rel_chan_set_loss(rel_chan_t *chan, uint32_t loss_ppm) {
+
+    chan->loss_ppm = loss_ppm;
+}
+
+void
+rel_chan_get_stats(rel_chan_t *chan, rel_chan_stats_t *stats) {
+
+    memcpy(stats, &chan->stats, sizeof(*stats));
+}
+
+void
+rel_chan_print_stats(rel_chan_t *chan) {
+
+    rel_chan_stats_t *stats = &chan->stats;
+
+    printf("rel chan %s : window %u  in flight %u  srtt %lu usec\n",
+           chan->conn->conn_name, chan->window,
+           chan->snd_nxt - chan->snd_una, stats->srtt_usec);
+    printf("\tsent : %lu msgs  %lu bytes  window stalls %lu  retransmits"
+           " on NACK %lu on timeout %lu  dropped %lu\n",
+           stats->tx_msgs, stats->tx_bytes, stats->window_stalls,
+           stats->nack_retransmits, stats->rto_retransmits,
+           stats->tx_dropped);
+    printf("\tacks : rx %lu (with holes %lu)  tx %lu  peer restarts %lu\n",
+           stats->acks_rx, stats->nacks_rx, stats->acks_tx,
+           stats->peer_restarts);
+    printf("\trecvd : %lu pkts  %lu syscalls  dups %lu  out of order %lu"
+           "  delivered %lu msgs  %lu bytes\n",
+           stats->rx_pkts, stats->rx_syscalls, stats->rx_dups,
+           stats->rx_out_of_order, stats->delivered_msgs,
+           stats->delivered_bytes);
+}
@@ -0,0 +1,238 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  rel_chan.h
+ *
+ *    Description: This file defines the interfaces of a reliable, ordered msg channel
+ *                 over UDP between the two ends of a connection
+ *
+ *        Version:  1.0
+ *        Created:  10/17/2026 10:58:12 PM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  ABHISHEK SAGAR (), sachinites@gmail.com
+ *   Organization:  Juniper Networks
+ *
+ * =====================================================================================
+ */
+#ifndef __REL_CHAN__
+#define __REL_CHAN__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <netinet/in.h>
+#include "conn_mgmt.h"
+
+/* Msgs sent on a channel are numbered, and kept by the sender until
+ * the peer acks them, up to a window of msgs in flight. The receiver
+ * acks every batch of pkts it recvs with the next seq no it expects,
+ * and a bitmap of the holes past it (selective NACKs) : the sender
+ * retransmits only those, right away. Msgs recvd out of order are held
+ * until the holes before them fill up, and are then delivered in order.
+ * A retransmit timer on the connection's wheel timer covers the tail
+ * of a burst, whose loss no later pkt reveals.
+ *
+ * Each end stamps its pkts with an incarnation, the wall clock time the
+ * channel was created at. A peer which comes back with a later one
+ * starts its seq nos over : the receiver then resets and takes the
+ * stream from the oldest msg the peer still holds, and acks for a past
+ * incarnation of ours are thrown away.
+ *
+ * A channel rides on a connection, over a UDP socket of its own. Both
+ * ends can send */
+
+#define REL_CHAN_MAX_PKT_SIZE		8192
+/* Msgs in flight, a power of 2 */
+#define REL_CHAN_DEFAULT_WINDOW		1024
+#define REL_CHAN_MAX_WINDOW		(64 * 1024)
+/* Pkts moved by one recvmmsg() */
+#define REL_CHAN_IO_BATCH_SIZE		64
+#define REL_CHAN_SOCK_BUF_SIZE		(16 * 1024 * 1024)
+/* Seq nos past the cumulative ack covered by the NACK bitmap */
+#define REL_CHAN_NACK_BITMAP_SIZE	256
+/* Retransmit timeout floor, msgs unacked for longer are sent again */
+#define REL_CHAN_MIN_RTO_USEC		(2 * CONN_MGMT_TIMER_TIC_MSEC * 1000)
+/* Msgs retransmitted per timer tic at most, from the oldest : those
+ * past a hole likely made it, and are NACKed if not */
+#define REL_CHAN_RTO_BURST		64
+
+#define REL_CHAN_PKT_DATA		1
+#define REL_CHAN_PKT_ACK		2
+
+#pragma pack (push,1)
+
+/* All fields in network byte order */
+typedef struct rel_chan_data_hdr_ {
+
+    uint8_t pkt_type;
+    uint8_t flags;
+    uint16_t len;
+    uint32_t seq;
+    /* Sender's incarnation, and its oldest msg unacked */
+    uint64_t incarnation;
+    uint32_t una;
+} rel_chan_data_hdr_t;
+
+/* Later msgs were recvd, cum_seq is missing */
+#define REL_CHAN_ACK_F_HOLE		(1 << 0)
+
+typedef struct rel_chan_ack_ {
+
+    uint8_t pkt_type;
+    uint8_t flags;
+    uint16_t reserved;
+    /* Next seq no expected, all before it were recvd */
+    uint32_t cum_seq;
+    /* Incarnation of the sender whose msgs are acked */
+    uint64_t incarnation;
+    /* Bit i set : cum_seq + 1 + i is missing, while later ones were
+     * recvd */
+    uint64_t nack_bitmap[REL_CHAN_NACK_BITMAP_SIZE / 64];
+} rel_chan_ack_t;
+
+#pragma pack(pop)
+
+#define REL_CHAN_MAX_MSG_SIZE	\
+    (REL_CHAN_MAX_PKT_SIZE - sizeof(rel_chan_data_hdr_t))
+
+typedef struct rel_chan_ rel_chan_t;
+
+/* Called on the channel's recv thread with every msg, in order */
+typedef void (*rel_chan_recv_fn)(rel_chan_t *chan,
+                                 void *arg,
+                                 unsigned char *msg,
+                                 uint32_t msg_len);
+
+typedef struct rel_chan_stats_ {
+
+    /* Sender */
+    uint64_t tx_msgs;
+    uint64_t tx_bytes;
+    uint64_t nack_retransmits;
+    uint64_t rto_retransmits;
+    /* Sends which waited for the window to open */
+    uint64_t window_stalls;
+    uint64_t acks_rx;
+    uint64_t nacks_rx;
+    /* Pkts thrown away by the loss emulation, see rel_chan_set_loss() */
+    uint64_t tx_dropped;
+    /* Smoothed RTT, from acks of msgs sent once */
+    uint64_t srtt_usec;
+    /* Receiver */
+    uint64_t rx_pkts;
+    uint64_t rx_syscalls;
+    uint64_t rx_dups;
+    uint64_t rx_out_of_order;
+    uint64_t delivered_msgs;
+    uint64_t delivered_bytes;
+    uint64_t acks_tx;
+    /* Peer came back as a new incarnation */
+    uint64_t peer_restarts;
+} rel_chan_stats_t;
+
+/* A msg sent, and kept until acked */
+typedef struct rel_chan_tx_slot_ {
+
+    /* Monotonic time in usec of the last transmission */
+    uint64_t tx_time;
+    uint32_t pkt_len;
+    uint32_t n_tx;
+    unsigned char *pkt;
+} rel_chan_tx_slot_t;
+
+/* A msg recvd ahead of a hole */
+typedef struct rel_chan_rx_slot_ {
+
+    bool present;
+    uint32_t msg_len;
+    unsigned char *msg;
+} rel_chan_rx_slot_t;
+
+struct rel_chan_ {
+
+    conn_mgmt_conn_state_t *conn;
+    int sock_fd;
+    struct sockaddr_in peer_addr;
+    uint32_t window;
+    bool stop;
+    /* Done with by rel_chan_destroy(), for the rto timer to free */
+    bool destroyed;
+    /* Ours, and the latest seen from the peer */
+    uint64_t incarnation;
+    uint64_t peer_incarnation;
+    /* Send side, msgs [snd_una, snd_nxt) are in flight */
+    pthread_mutex_t tx_mutex;
+    pthread_cond_t tx_room_cond;
+    uint32_t snd_una;
+    uint32_t snd_nxt;
+    /* Past the last msg retransmitted, acks below it tell no RTT */
+    uint32_t recover_seq;
+    rel_chan_tx_slot_t *tx_slots;
+    wheel_timer_elem_t *rto_timer;
+    /* Recv side, all msgs before rcv_nxt were delivered, rcv_max is
+     * past the highest seq no recvd */
+    uint32_t rcv_nxt;
+    uint32_t rcv_max;
+    rel_chan_rx_slot_t *rx_slots;
+    rel_chan_recv_fn recv_cb;
+    void *recv_cb_arg;
+    pthread_t recv_thread;
+    /* Loss emulation, pkts dropped per million */
+    uint32_t loss_ppm;
+    uint64_t loss_rand_state;
+    rel_chan_stats_t stats;
+};
+
+/* Channel between the two ends of conn, with pkts sent from src_port
+ * to dst_port at the connection's addresses. window 0 picks
+ * REL_CHAN_DEFAULT_WINDOW */
+rel_chan_t *
+rel_chan_create(conn_mgmt_conn_state_t *conn,
+                uint16_t src_port,
+                uint16_t dst_port,
+                uint32_t window,
+                rel_chan_recv_fn recv_cb,
+                void *recv_cb_arg);
+
+/* Stops the channel and closes its socket before returning, the
+ * memory is freed a timer tic later from the wheel timer thread */
+void
+rel_chan_destroy(rel_chan_t *chan);
+
+/* Sends a msg of up to REL_CHAN_MAX_MSG_SIZE bytes, blocks while the
+ * window is full. Returns false if the msg is too large or the channel
+ * is being destroyed */
+bool
+rel_chan_send(rel_chan_t *chan,
+              const void *msg,
+              uint32_t msg_len);
+
+/* rel_chan_send() of the msg gathered from iovcnt buffers */
+bool
+rel_chan_sendv(rel_chan_t *chan,
+               const struct iovec *iov,
+               int iovcnt);
+
+/* Waits for the peer to ack all msgs sent, for up to timeout_msec.
+ * Returns false on timeout */
+bool
+rel_chan_drain(rel_chan_t *chan,
+               uint32_t timeout_msec);
+
+/* Drops pkts sent, data and acks, with the given probability in parts
+ * per million : lossy link emulation for tests and benchmarks */
+void
+rel_chan_set_loss(rel_chan_t *chan,
+                  uint32_t loss_ppm);
+
+void
+rel_chan_get_stats(rel_chan_t *chan, rel_chan_stats_t *stats);
+
+void
+rel_chan_print_stats(rel_chan_t *chan);
+
+#endif /* __REL_CHAN__ */
@@ -0,0 +1,232 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  xport.c
+ *
+ *    Description: This file implements the transport independent calls, and the
+ *                 reliable UDP transport on top of a rel_chan
+ *
+ *        Version:  1.0
+ *        Created:  10/17/2026 11:52:09 PM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  ABHISHEK SAGAR (), sachinites@gmail.com
+ *   Organization:  Juniper Networks
+ *
+ * =====================================================================================
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "xport.h"
+#include "rel_chan.h"
+
+static const char *xport_type_names[XPORT_TYPE_MAX] = {
+
+    "udp-reliable",
+    "tcp",
+    "shm"
+};
+
+typedef bool (*xport_init_fn)(xport_t *xport, uint16_t src_port,
+                              uint16_t dst_port);
+
+static xport_init_fn xport_init_fns[XPORT_TYPE_MAX] = {
+
+    xport_udp_init,
+    xport_tcp_init,
+    xport_shm_init
+};
+
+const char *
+xport_type_str(xport_type_t type) {
+
+    return type < XPORT_TYPE_MAX ? xport_type_names[type] : "unknown";
+}
+
+xport_t *
+xport_create(conn_mgmt_conn_state_t *conn, xport_type_t type,
+             uint16_t src_port, uint16_t dst_port,
+             xport_recv_fn recv_cb, void *recv_cb_arg) {
+
+    xport_t *xport;
+
+    if (type >= XPORT_TYPE_MAX) {
+        printf("Error : unknown transport type %d\n", type);
+        return NULL;
+    }
+    assert(recv_cb);
+
+    xport = calloc(1, sizeof(xport_t));
+    xport->type = type;
+    xport->conn = conn;
+    xport->recv_cb = recv_cb;
+    xport->recv_cb_arg = recv_cb_arg;
+
+    if (!xport_init_fns[type](xport, src_port, dst_port)) {
+        free(xport);
+        return NULL;
+    }
+    return xport;
+}
+
+void
+xport_destroy(xport_t *xport) {
+
+    xport->ops->destroy(xport);
+    free(xport);
+}
+
+bool
+xport_sendv(xport_t *xport, const struct iovec *iov, int iovcnt) {
+
+    int i;
+    uint32_t msg_len = 0;
+
+    for (i = 0; i < iovcnt; i++) {
+        msg_len += iov[i].iov_len;
+    }
+    if (msg_len > xport->max_msg_size || iovcnt > XPORT_MAX_IOV) {
+        printf("Error : %s msg of %u bytes in %d buffers is too large\n",
+               xport_type_str(xport->type), msg_len, iovcnt);
+        return false;
+    }
+    if (!xport->ops->sendv(xport, iov, iovcnt)) return false;
+
+    __sync_fetch_and_add(&xport->stats.tx_msgs, 1);
+    __sync_fetch_and_add(&xport->stats.tx_bytes, msg_len);
+    return true;
+}
+
+bool
+xport_send(xport_t *xport, const void *msg, uint32_t msg_len) {
+
+    struct iovec iov;
+
+    iov.iov_base = (void *)msg;
+    iov.iov_len = msg_len;
+    return xport_sendv(xport, &iov, 1);
+}
+
+bool
+xport_drain(xport_t *xport, uint32_t timeout_msec) {
+
+    return xport->ops->drain(xport, timeout_msec);
+}
+
+bool
+xport_is_ready(xport_t *xport) {
+
+    return xport->ops->is_ready(xport);
+}
+
+void
+xport_deliver(xport_t *xport, unsigned char *msg, uint32_t msg_len) {
+
+    xport->stats.rx_msgs++;
+    xport->stats.rx_bytes += msg_len;
+    xport->recv_cb(xport, xport->recv_cb_arg, msg, msg_len);
+}
+
+void
+xport_get_stats(xport_t *xport, xport_stats_t *stats) {
+
+    memcpy(stats, &xport->stats, sizeof(*stats));
+    if (xport->ops->get_stats) {
+        xport->ops->get_stats(xport, stats);
+    }
+}
+
+void
+xport_print_stats(xport_t *xport) {
+
+    xport_stats_t stats;
+
+    xport_get_stats(xport, &stats);
+    printf("xport %s over %s : tx %lu msgs  %lu bytes  %lu syscalls"
+           "  rx %lu msgs  %lu bytes  %lu syscalls\n",
+           xport_type_str(xport->type), xport->conn->conn_name,
+           stats.tx_msgs, stats.tx_bytes, stats.tx_syscalls,
+           stats.rx_msgs, stats.rx_bytes, stats.rx_syscalls);
+    if (xport->ops->print_stats) {
+        xport->ops->print_stats(xport);
+    }
+}
+
+/* Reliable UDP, msgs are copied into the rel_chan's send window and
+ * stay there until acked */
+
+static void
+xport_udp_recv(rel_chan_t *chan, void *arg, unsigned char *msg,
+               uint32_t msg_len) {
+
+    xport_deliver((xport_t *)arg, msg, msg_len);
+}
+
+static bool
+xport_udp_sendv(xport_t *xport, const struct iovec *iov, int iovcnt) {
+
+    return rel_chan_sendv((rel_chan_t *)xport->impl, iov, iovcnt);
+}
+
+static bool
+xport_udp_drain(xport_t *xport, uint32_t timeout_msec) {
+
+    return rel_chan_drain((rel_chan_t *)xport->impl, timeout_msec);
+}
+
+static bool
+xport_udp_is_ready(xport_t *xport) {
+
+    return true;
+}
+
+static void
+xport_udp_get_stats(xport_t *xport, xport_stats_t *stats) {
+
+    rel_chan_t *chan = (rel_chan_t *)xport->impl;
+
+    /* One send() per msg, retransmit and ack */
+    stats->tx_syscalls = chan->stats.tx_msgs + chan->stats.acks_tx +
+                         chan->stats.nack_retransmits +
+                         chan->stats.rto_retransmits -
+                         chan->stats.tx_dropped;
+    stats->rx_syscalls = chan->stats.rx_syscalls;
+}
+
+static void
+xport_udp_print_stats(xport_t *xport) {
+
+    rel_chan_print_stats((rel_chan_t *)xport->impl);
+}
+
+static void
+xport_udp_destroy(xport_t *xport) {
+
+    rel_chan_destroy((rel_chan_t *)xport->impl);
+}
+
+static const xport_ops_t xport_udp_ops = {
+
+    .sendv = xport_udp_sendv,
+    .drain = xport_udp_drain,
+    .is_ready = xport_udp_is_ready,
+    .get_stats = xport_udp_get_stats,
+    .print_stats = xport_udp_print_stats,
+    .destroy = xport_udp_destroy
+};
+
+bool
+xport_udp_init(xport_t *xport, uint16_t src_port, uint16_t dst_port) {
+
+    xport->impl = rel_chan_create(xport->conn, src_port, dst_port, 0,
+                                  xport_udp_recv, xport);
+    if (!xport->impl) return false;
+
+    xport->ops = &xport_udp_ops;
+    xport->max_msg_size = REL_CHAN_MAX_MSG_SIZE;
+    return true;
+}
@@ -0,0 +1,176 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  xport.h
+ *
+ *    Description: This file defines the pluggable transports which carry replication
+ *                 data between the two ends of a connection
+ *
+ *        Version:  1.0
+ *        Created:  10/17/2026 11:52:09 PM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  ABHISHEK SAGAR (), sachinites@gmail.com
+ *   Organization:  Juniper Networks
+ *
+ * =====================================================================================
+ */
+#ifndef __XPORT__
+#define __XPORT__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <sys/uio.h>
+#include <netinet/in.h>
+#include "conn_mgmt.h"
+
+/* A transport moves msgs, reliably and in order, between the two ends
+ * of a connection. The app picks one when it creates the transport and
+ * talks to all of them through the same calls, which dispatch through
+ * the transport's ops :
+ *
+ *  XPORT_UDP_RELIABLE : a rel_chan, msgs up to REL_CHAN_MAX_MSG_SIZE
+ *  XPORT_TCP : length framed msgs on a TCP stream with TCP_NODELAY.
+ *      The end which is backup listens, the master connects, and
+ *      reconnects whenever the stream breaks
+ *  XPORT_SHM : a ring in shared memory per direction, for ends on the
+ *      same host. Msgs are copied into the ring and handed to the app
+ *      in place, syscalls are made only to wake up an end which sleeps */
+
+typedef enum {
+
+    XPORT_UDP_RELIABLE,
+    XPORT_TCP,
+    XPORT_SHM,
+    XPORT_TYPE_MAX
+} xport_type_t;
+
+/* Most buffers one msg is gathered from */
+#define XPORT_MAX_IOV			16
+/* TCP */
+#define XPORT_TCP_MAX_MSG_SIZE		(1024 * 1024)
+#define XPORT_TCP_RX_BUF_SIZE		(4 * 1024 * 1024)
+#define XPORT_TCP_SOCK_BUF_SIZE		(4 * 1024 * 1024)
+#define XPORT_TCP_CONNECT_RETRY_MSEC	10
+/* Shared memory, the ring is named after the ports of its two ends */
+#define XPORT_SHM_NAME_FMT		"/conn_mgmt_xport_%u_%u"
+#define XPORT_SHM_RING_SIZE		(16 * 1024 * 1024)
+#define XPORT_SHM_MAX_MSG_SIZE		(1024 * 1024)
+#define XPORT_SHM_MAGIC			0x58534852	/* "XSHR" */
+/* Polls of an empty (or full) ring before going to sleep */
+#define XPORT_SHM_SPIN_LOOPS		256
+/* Longest sleep between checks for the transport being destroyed */
+#define XPORT_SHM_SLEEP_MSEC		100
+/* The recv side hands room back to the sender every so many bytes */
+#define XPORT_SHM_RELEASE_BYTES		(64 * 1024)
+
+typedef struct xport_ xport_t;
+
+/* Called on the transport's recv thread with every msg, in order. msg
+ * points into the transport's buffers, valid until the cb returns */
+typedef void (*xport_recv_fn)(xport_t *xport,
+                              void *arg,
+                              unsigned char *msg,
+                              uint32_t msg_len);
+
+typedef struct xport_stats_ {
+
+    uint64_t tx_msgs;
+    uint64_t tx_bytes;
+    uint64_t tx_syscalls;
+    uint64_t rx_msgs;
+    uint64_t rx_bytes;
+    uint64_t rx_syscalls;
+    /* Streams (re)established */
+    uint64_t connects;
+} xport_stats_t;
+
+typedef struct xport_ops_ {
+
+    bool (*sendv)(xport_t *xport, const struct iovec *iov, int iovcnt);
+    bool (*drain)(xport_t *xport, uint32_t timeout_msec);
+    bool (*is_ready)(xport_t *xport);
+    /* Fills in the counters kept by the transport itself */
+    void (*get_stats)(xport_t *xport, xport_stats_t *stats);
+    void (*print_stats)(xport_t *xport);
+    void (*destroy)(xport_t *xport);
+} xport_ops_t;
+
+struct xport_ {
+
+    xport_type_t type;
+    const xport_ops_t *ops;
+    conn_mgmt_conn_state_t *conn;
+    uint32_t max_msg_size;
+    xport_recv_fn recv_cb;
+    void *recv_cb_arg;
+    xport_stats_t stats;
+    /* The transport's own state */
+    void *impl;
+};
+
+/* Transport of the given type between the two ends of conn, from
+ * src_port to dst_port at the connection's addresses */
+xport_t *
+xport_create(conn_mgmt_conn_state_t *conn,
+             xport_type_t type,
+             uint16_t src_port,
+             uint16_t dst_port,
+             xport_recv_fn recv_cb,
+             void *recv_cb_arg);
+
+void
+xport_destroy(xport_t *xport);
+
+/* Sends a msg of up to max_msg_size bytes gathered from iovcnt buffers
+ * without copying them first, where the transport can. Blocks until the
+ * transport has room, and a stream transport is connected. Returns
+ * false if the msg is too large or could not be sent */
+bool
+xport_sendv(xport_t *xport,
+            const struct iovec *iov,
+            int iovcnt);
+
+bool
+xport_send(xport_t *xport,
+           const void *msg,
+           uint32_t msg_len);
+
+/* Waits for all msgs sent to reach the peer, for up to timeout_msec.
+ * Returns false on timeout */
+bool
+xport_drain(xport_t *xport,
+            uint32_t timeout_msec);
+
+/* Msgs can be sent without waiting for the transport to come up */
+bool
+xport_is_ready(xport_t *xport);
+
+const char *
+xport_type_str(xport_type_t type);
+
+void
+xport_get_stats(xport_t *xport, xport_stats_t *stats);
+
+void
+xport_print_stats(xport_t *xport);
+
+/* For the transports : hands a msg recvd to the app */
+void
+xport_deliver(xport_t *xport,
+              unsigned char *msg,
+              uint32_t msg_len);
+
+/* Transport constructors, for xport_create() */
+bool
+xport_udp_init(xport_t *xport, uint16_t src_port, uint16_t dst_port);
+
+bool
+xport_tcp_init(xport_t *xport, uint16_t src_port, uint16_t dst_port);
+
+bool
+xport_shm_init(xport_t *xport, uint16_t src_port, uint16_t dst_port);
+
+#endif /* __XPORT__ */
@@ -0,0 +1,196 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  xport_bench.c
+ *
+ *    Description: This file benchmarks the transports on the same replication
+ *                 workload over loopback : records gathered from a hdr and an app
+ *                 buffer, flat out for throughput and paced for tail latency
+ *
+ *        Version:  1.0
+ *        Created:  10/18/2026 12:21:37 AM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  ABHISHEK SAGAR (), sachinites@gmail.com
+ *   Organization:  Juniper Networks
+ *
+ * =====================================================================================
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "xport.h"
+
+#define BENCH_CONN_PORT		24750
+#define BENCH_DATA_PORT		24800
+
+static uint32_t payload_sizes[] = {64, 1024, 8000};
+
+typedef struct bench_rec_hdr_ {
+
+	uint64_t rec_no;
+	uint64_t send_time;
+} bench_rec_hdr_t;
+
+/* Receiver's view */
+static uint64_t rx_next_rec_no;
+static uint64_t rx_order_errors;
+static conn_mgmt_hist_t rx_latency;
+
+static uint64_t
+bench_now_usec() {
+
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (ts.tv_sec * 1000000ULL) + (ts.tv_nsec / 1000);
+}
+
+static void
+bench_recv(xport_t *xport, void *arg, unsigned char *msg,
+		   uint32_t msg_len) {
+
+	bench_rec_hdr_t rec_hdr;
+	uint64_t now = bench_now_usec();
+
+	memcpy(&rec_hdr, msg, sizeof(rec_hdr));
+	if (rec_hdr.rec_no != rx_next_rec_no) rx_order_errors++;
+	rx_next_rec_no = rec_hdr.rec_no + 1;
+	conn_mgmt_hist_add(&rx_latency,
+		now > rec_hdr.send_time ? now - rec_hdr.send_time : 0);
+}
+
+/* Sends records of payload_size for duration_usec at rate records/s
+ * (0 : as fast as possible), straight from the app's buffer */
+static void
+bench_run(xport_t *sender, xport_t *receiver, uint32_t payload_size,
+		  uint64_t duration_usec, uint32_t rate) {
+
+	uint64_t start, now, elapsed, due, n_recs;
+	bench_rec_hdr_t rec_hdr;
+	struct iovec iov[2];
+	xport_stats_t s0, s1, r0, r1;
+	static unsigned char payload[XPORT_TCP_MAX_MSG_SIZE];
+	double secs;
+
+	xport_get_stats(sender, &s0);
+	xport_get_stats(receiver, &r0);
+	memset(&rx_latency, 0, sizeof(rx_latency));
+	rx_order_errors = 0;
+	n_recs = rx_next_rec_no = s0.tx_msgs;
+
+	iov[0].iov_base = &rec_hdr;
+	iov[0].iov_len = sizeof(rec_hdr);
+	iov[1].iov_base = payload;
+	iov[1].iov_len = payload_size;
+
+	start = bench_now_usec();
+
+	do {
+		rec_hdr.rec_no = n_recs++;
+		rec_hdr.send_time = bench_now_usec();
+		xport_sendv(sender, iov, 2);
+		now = bench_now_usec();
+		if (rate) {
+			due = start + ((n_recs - s0.tx_msgs) * 1000000ULL) / rate;
+			if (due > now + 50) {
+				usleep(due - now);
+				now = bench_now_usec();
+			}
+		}
+	} while (now - start < duration_usec);
+
+	xport_drain(sender, 10000);
+	while (rx_next_rec_no != n_recs && bench_now_usec() - now < 10000000) {
+		usleep(100);
+	}
+	elapsed = bench_now_usec() - start;
+
+	xport_get_stats(sender, &s1);
+	xport_get_stats(receiver, &r1);
+	secs = elapsed / 1e6;
+
+	printf("%-12s %6u %6u %9.0f %8.1f %6.2f %6.2f %7lu %7lu %7lu %7lu %s\n",
+		xport_type_str(sender->type), payload_size, rate,
+		(r1.rx_msgs - r0.rx_msgs) / secs,
+		(r1.rx_bytes - r0.rx_bytes) / secs / 1e6,
+		(double)(s1.tx_syscalls - s0.tx_syscalls) /
+			(s1.tx_msgs - s0.tx_msgs),
+		(double)(r1.rx_syscalls - r0.rx_syscalls) /
+			(r1.rx_msgs - r0.rx_msgs),
+		conn_mgmt_hist_percentile(&rx_latency, 50),
+		conn_mgmt_hist_percentile(&rx_latency, 99),
+		conn_mgmt_hist_percentile(&rx_latency, 99.9),
+		conn_mgmt_hist_percentile(&rx_latency, 100),
+		rx_next_rec_no == n_recs && !rx_order_errors ? "ok" : "FAIL");
+	fflush(stdout);
+}
+
+int
+main(int argc, char **argv) {
+
+	uint32_t i, type;
+	uint32_t duration_msec = 1000;
+	uint32_t paced_rate = 20000;
+	uint64_t start;
+	xport_t *sender, *receiver;
+	conn_mgmt_conn_state_t *master_conn, *backup_conn;
+
+	if (argc > 1) duration_msec = atoi(argv[1]);
+	if (argc > 2) paced_rate = atoi(argv[2]);
+
+	conn_mgmt_init();
+	conn_mgmt_set_io_mode(CONN_MGMT_IO_EVENT_LOOP, 1);
+
+	conn_mgmt_configure_connection("master", "127.0.0.1", BENCH_CONN_PORT,
+		"127.0.0.1", BENCH_CONN_PORT + 1, "master");
+	conn_mgmt_configure_connection("backup", "127.0.0.1", BENCH_CONN_PORT + 1,
+		"127.0.0.1", BENCH_CONN_PORT, "backup");
+	master_conn = conn_mgmt_lookup_connection_by_name("master");
+	backup_conn = conn_mgmt_lookup_connection_by_name("backup");
+	if (!master_conn || !backup_conn) return -1;
+
+	printf("%u msec per run, latency in usec, rate 0 : as fast as possible\n",
+		duration_msec);
+	printf("%-12s %6s %6s %9s %8s %6s %6s %7s %7s %7s %7s\n",
+		"xport", "size", "rate", "recs/s", "MB/s", "tx s/r", "rx s/r",
+		"p50", "p99", "p99.9", "max");
+
+	for (type = 0; type < XPORT_TYPE_MAX; type++) {
+
+		sender = xport_create(master_conn, type,
+							  BENCH_DATA_PORT + (2 * type),
+							  BENCH_DATA_PORT + (2 * type) + 1,
+							  bench_recv, NULL);
+		receiver = xport_create(backup_conn, type,
+								BENCH_DATA_PORT + (2 * type) + 1,
+								BENCH_DATA_PORT + (2 * type),
+								bench_recv, NULL);
+		if (!sender || !receiver) return -1;
+
+		start = bench_now_usec();
+		while ((!xport_is_ready(sender) || !xport_is_ready(receiver)) &&
+			   bench_now_usec() - start < 5000000) {
+			usleep(1000);
+		}
+
+		for (i = 0; i < sizeof(payload_sizes)/sizeof(payload_sizes[0]); i++) {
+			bench_run(sender, receiver, payload_sizes[i],
+					  duration_msec * 1000ULL, 0);
+		}
+		for (i = 0; i < sizeof(payload_sizes)/sizeof(payload_sizes[0]); i++) {
+			bench_run(sender, receiver, payload_sizes[i],
+					  duration_msec * 1000ULL, paced_rate);
+		}
+
+		xport_print_stats(sender);
+		xport_print_stats(receiver);
+		xport_destroy(sender);
+		xport_destroy(receiver);
+	}
+	return 0;
+}
@@ -0,0 +1,534 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  xport_shm.c
+ *
+ *    Description: This file implements the shared memory transport : a single
+ *                 producer single consumer ring of msgs per direction, in POSIX
+ *                 shared memory named after the ports of the two ends
+ *
+ *        Version:  1.0
+ *        Created:  10/18/2026 01:14:52 AM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  ABHISHEK SAGAR (), sachinites@gmail.com
+ *   Organization:  Juniper Networks
+ *
+ * =====================================================================================
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include "xport.h"
+
+/* Every msg in the ring starts on an 8 byte boundary with its length.
+ * A msg never wraps : when it does not fit before the end of the ring,
+ * the sender marks the rest of the ring as skipped and starts over at
+ * its front */
+#define XPORT_SHM_ALIGN(len)	(((len) + 7) & ~7ULL)
+#define XPORT_SHM_SKIP		0xFFFFFFFF
+
+typedef struct xport_shm_frame_hdr_ {
+
+    uint32_t msg_len;
+    uint32_t reserved;
+} xport_shm_frame_hdr_t;
+
+/* Lives at the start of the shared memory. Positions are byte offsets
+ * which only ever grow, each end writes its own cache line only. The
+ * futex words hold the low 32 bits of the positions, an end which
+ * sleeps waits for the other end's word to move */
+typedef struct xport_shm_ring_ {
+
+    uint32_t magic;
+    /* Set by the recv end when it goes away, the send end then looks
+     * for the ring of the recv end's next incarnation */
+    volatile uint32_t closed;
+    uint64_t size;
+
+    /* Send end */
+    volatile uint64_t tail __attribute__((aligned(64)));
+    volatile uint32_t tail_word;
+    volatile uint32_t sender_sleeping;
+
+    /* Recv end */
+    volatile uint64_t head __attribute__((aligned(64)));
+    volatile uint32_t head_word;
+    volatile uint32_t receiver_sleeping;
+
+    unsigned char data[] __attribute__((aligned(64)));
+} xport_shm_ring_t;
+
+#define XPORT_SHM_MAP_SIZE	(sizeof(xport_shm_ring_t) + XPORT_SHM_RING_SIZE)
+
+typedef struct xport_shm_ {
+
+    xport_t *xport;
+    /* The ring this end recvs on is created by this end, the one it
+     * sends on by the peer, and mapped once it shows up */
+    char rx_name[64];
+    char tx_name[64];
+    xport_shm_ring_t *rx_ring;
+    xport_shm_ring_t *tx_ring;
+    /* Shared memory object of tx_ring, a peer which comes back after
+     * a crash creates a new one under the same name */
+    ino_t tx_ino;
+    bool stop;
+    /* Polls before sleeping, none with a single CPU : the other end
+     * can not make progress while we spin */
+    uint32_t spin_loops;
+    /* Senders are serialized, the ring has a single producer */
+    pthread_mutex_t tx_mutex;
+    pthread_t recv_thread;
+} xport_shm_t;
+
+static inline void
+xport_shm_cpu_relax() {
+
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#endif
+}
+
+/* The rings are shared between processes, hence no FUTEX_PRIVATE_FLAG */
+static void
+xport_shm_futex_wait(volatile uint32_t *word, uint32_t val) {
+
+    struct timespec ts;
+
+    ts.tv_sec = XPORT_SHM_SLEEP_MSEC / 1000;
+    ts.tv_nsec = (XPORT_SHM_SLEEP_MSEC % 1000) * 1000000;
+    syscall(SYS_futex, word, FUTEX_WAIT, val, &ts, NULL, 0);
+}
+
+static void
+xport_shm_futex_wake(volatile uint32_t *word) {
+
+    syscall(SYS_futex, word, FUTEX_WAKE, 1, NULL, NULL, 0);
+}
+
+static xport_shm_ring_t *
+xport_shm_map(const char *name, int flags, ino_t *ino) {
+
+    int fd;
+    struct stat st;
+    xport_shm_ring_t *ring;
+
+    fd = shm_open(name, flags, 0600);
+    if (fd < 0) return NULL;
+
+    if (flags & O_CREAT) {
+        if (ftruncate(fd, XPORT_SHM_MAP_SIZE) < 0) {
+            close(fd);
+            return NULL;
+        }
+    } else if (fstat(fd, &st) < 0 || (size_t)st.st_size < XPORT_SHM_MAP_SIZE) {
+        /* Still being set up by the peer */
+        close(fd);
+        return NULL;
+    }
+    if (ino && !(flags & O_CREAT)) *ino = st.st_ino;
+
+    ring = mmap(NULL, XPORT_SHM_MAP_SIZE, PROT_READ | PROT_WRITE,
+                MAP_SHARED, fd, 0);
+    close(fd);
+    return ring == MAP_FAILED ? NULL : ring;
+}
+
+/* True once the name of the send ring no longer refers to the mapped
+ * ring : the peer went away without closing it, and it or its next
+ * incarnation unlinked or replaced it */
+static bool
+xport_shm_tx_ring_replaced(xport_shm_t *shm) {
+
+    int fd;
+    struct stat st;
+    bool replaced;
+
+    fd = shm_open(shm->tx_name, O_RDONLY, 0600);
+    if (fd < 0) return errno == ENOENT;
+
+    replaced = fstat(fd, &st) == 0 && st.st_ino != shm->tx_ino;
+    close(fd);
+    return replaced;
+}
+
+/* Maps the peer's ring if it is there by now, tx_mutex held */
+static bool
+xport_shm_attach(xport_shm_t *shm) {
+
+    xport_shm_ring_t *ring;
+
+    if (shm->tx_ring && shm->tx_ring->closed) {
+        munmap(shm->tx_ring, XPORT_SHM_MAP_SIZE);
+        shm->tx_ring = NULL;
+    }
+    if (shm->tx_ring) return true;
+
+    ring = xport_shm_map(shm->tx_name, O_RDWR, &shm->tx_ino);
+    if (!ring) return false;
+
+    if (__atomic_load_n(&ring->magic, __ATOMIC_ACQUIRE) != XPORT_SHM_MAGIC ||
+        ring->size != XPORT_SHM_RING_SIZE || ring->closed) {
+        munmap(ring, XPORT_SHM_MAP_SIZE);
+        return false;
+    }
+    shm->tx_ring = ring;
+    shm->xport->stats.connects++;
+    return true;
+}
+
+/* Wakes up the other end if it sleeps on word. The full barrier orders
+ * the store of the position before the load of the sleeping flag, the
+ * sleeper sets its flag before it checks the position once more. The
+ * flag is taken down here, so that a sleeper not scheduled yet is not
+ * woken up again by every msg which follows */
+static bool
+xport_shm_kick(volatile uint32_t *word, volatile uint32_t *sleeping) {
+
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (!*sleeping ||
+        !__atomic_exchange_n(sleeping, 0, __ATOMIC_SEQ_CST)) {
+        return false;
+    }
+    xport_shm_futex_wake(word);
+    return true;
+}
+
+/* Until the ring has room for len bytes at tail, false if the
+ * transport is destroyed or the ring is abandoned meanwhile. A full
+ * ring may be one whose recv end crashed, it is looked for a new
+ * incarnation of the recv end before every sleep */
+static bool
+xport_shm_wait_room(xport_shm_t *shm, xport_shm_ring_t *ring,
+                    uint64_t tail, uint64_t len) {
+
+    uint32_t spins = 0;
+    uint64_t head;
+
+    while (1) {
+
+        head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+        if (ring->size - (tail - head) >= len) return true;
+        if (shm->stop || ring->closed) return false;
+
+        if (spins++ < shm->spin_loops) {
+            xport_shm_cpu_relax();
+            continue;
+        }
+
+        if (xport_shm_tx_ring_replaced(shm)) {
+            ring->closed = 1;
+            return false;
+        }
+
+        ring->sender_sleeping = 1;
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        if (__atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) == head) {
+            xport_shm_futex_wait(&ring->head_word, (uint32_t)head);
+            shm->xport->stats.tx_syscalls++;
+        }
+        ring->sender_sleeping = 0;
+    }
+}
+
+/* Copies the app's buffers into the ring, the only copy the msg sees
+ * on its way to the peer's recv cb */
+static bool
+xport_shm_sendv(xport_t *xport, const struct iovec *iov, int iovcnt) {
+
+    int i;
+    uint32_t msg_len = 0;
+    uint64_t tail, offset, contig, frame_len, need;
+    unsigned char *p;
+    xport_shm_frame_hdr_t *frame_hdr;
+    xport_shm_ring_t *ring;
+    xport_shm_t *shm = (xport_shm_t *)xport->impl;
+
+    for (i = 0; i < iovcnt; i++) {
+        msg_len += iov[i].iov_len;
+    }
+    frame_len = XPORT_SHM_ALIGN(sizeof(xport_shm_frame_hdr_t) + msg_len);
+
+    pthread_mutex_lock(&shm->tx_mutex);
+
+    /* Until the peer's ring shows up */
+    while (!xport_shm_attach(shm)) {
+        if (shm->stop) {
+            pthread_mutex_unlock(&shm->tx_mutex);
+            return false;
+        }
+        usleep(1000);
+    }
+    ring = shm->tx_ring;
+
+    tail = ring->tail;
+    offset = tail & (ring->size - 1);
+    contig = ring->size - offset;
+    need = contig < frame_len ? contig + frame_len : frame_len;
+
+    if (!xport_shm_wait_room(shm, ring, tail, need)) {
+        pthread_mutex_unlock(&shm->tx_mutex);
+        return false;
+    }
+
+    if (contig < frame_len) {
+        ((xport_shm_frame_hdr_t *)(ring->data + offset))->msg_len =
+            XPORT_SHM_SKIP;
+        tail += contig;
+        offset = 0;
+    }
+
+    frame_hdr = (xport_shm_frame_hdr_t *)(ring->data + offset);
+    frame_hdr->msg_len = msg_len;
+    p = (unsigned char *)(frame_hdr + 1);
+    for (i = 0; i < iovcnt; i++) {
+        memcpy(p, iov[i].iov_base, iov[i].iov_len);
+        p += iov[i].iov_len;
+    }
+
+    tail += frame_len;
+    __atomic_store_n(&ring->tail, tail, __ATOMIC_RELEASE);
+    __atomic_store_n(&ring->tail_word, (uint32_t)tail, __ATOMIC_RELEASE);
+
+    if (xport_shm_kick(&ring->tail_word, &ring->receiver_sleeping)) {
+        xport->stats.tx_syscalls++;
+    }
+
+    pthread_mutex_unlock(&shm->tx_mutex);
+    return true;
+}
+
+/* Hands room in the ring back to the sender */
+static void
+xport_shm_release(xport_shm_t *shm, xport_shm_ring_t *ring, uint64_t head) {
+
+    __atomic_store_n(&ring->head, head, __ATOMIC_RELEASE);
+    __atomic_store_n(&ring->head_word, (uint32_t)head, __ATOMIC_RELEASE);
+
+    if (xport_shm_kick(&ring->head_word, &ring->sender_sleeping)) {
+        shm->xport->stats.rx_syscalls++;
+    }
+}
+
+/* Returns the sender's tail once it moved past head, or head if the
+ * transport is being destroyed */
+static uint64_t
+xport_shm_wait_data(xport_shm_t *shm, xport_shm_ring_t *ring,
+                    uint64_t head) {
+
+    uint32_t spins = 0;
+    uint64_t tail;
+
+    while (!shm->stop) {
+
+        tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+        if (tail != head) return tail;
+
+        if (spins++ < shm->spin_loops) {
+            xport_shm_cpu_relax();
+            continue;
+        }
+
+        ring->receiver_sleeping = 1;
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        if (__atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) == head) {
+            xport_shm_futex_wait(&ring->tail_word, (uint32_t)head);
+            shm->xport->stats.rx_syscalls++;
+        }
+        ring->receiver_sleeping = 0;
+    }
+    return head;
+}
+
+/* Delivers the msgs in place, from the shared memory. The frame
+ * headers are written by the peer, a length is read once and checked
+ * against the ring before it is used */
+static void *
+xport_shm_thread_fn(void *arg) {
+
+    uint32_t msg_len;
+    uint64_t head, tail, released, offset, frame_len;
+    xport_shm_frame_hdr_t *frame_hdr;
+    xport_shm_t *shm = (xport_shm_t *)arg;
+    xport_shm_ring_t *ring = shm->rx_ring;
+
+    head = released = ring->head;
+
+    while (!shm->stop) {
+
+        tail = xport_shm_wait_data(shm, ring, head);
+
+        while (head != tail) {
+
+            offset = head & (XPORT_SHM_RING_SIZE - 1);
+            frame_hdr = (xport_shm_frame_hdr_t *)(ring->data + offset);
+            msg_len = __atomic_load_n(&frame_hdr->msg_len, __ATOMIC_RELAXED);
+
+            if (msg_len == XPORT_SHM_SKIP) {
+                frame_len = XPORT_SHM_RING_SIZE - offset;
+            } else {
+                frame_len = XPORT_SHM_ALIGN(sizeof(xport_shm_frame_hdr_t) +
+                                            (uint64_t)msg_len);
+            }
+
+            if ((msg_len != XPORT_SHM_SKIP &&
+                 (msg_len > XPORT_SHM_MAX_MSG_SIZE ||
+                  frame_len > XPORT_SHM_RING_SIZE - offset)) ||
+                frame_len > tail - head ||
+                tail - head > XPORT_SHM_RING_SIZE) {
+                printf("Error : xport shm %s : msg of %u bytes at %lu, "
+                       "dropping the ring\n", shm->rx_name, msg_len, head);
+                head = tail;
+                break;
+            }
+
+            if (msg_len != XPORT_SHM_SKIP) {
+                xport_deliver(shm->xport, (unsigned char *)(frame_hdr + 1),
+                              msg_len);
+            }
+            head += frame_len;
+
+            if (head - released >= XPORT_SHM_RELEASE_BYTES) {
+                xport_shm_release(shm, ring, head);
+                released = head;
+            }
+        }
+
+        if (head != released) {
+            xport_shm_release(shm, ring, head);
+            released = head;
+        }
+    }
+    return NULL;
+}
+
+/* Until the peer took every msg out of the ring */
+static bool
+xport_shm_drain(xport_t *xport, uint32_t timeout_msec) {
+
+    uint32_t waited_usec = 0;
+    xport_shm_t *shm = (xport_shm_t *)xport->impl;
+    xport_shm_ring_t *ring = shm->tx_ring;
+
+    if (!ring) return true;
+
+    while (__atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) != ring->tail) {
+        if (ring->closed || waited_usec >= timeout_msec * 1000) return false;
+        usleep(100);
+        waited_usec += 100;
+    }
+    return true;
+}
+
+static bool
+xport_shm_is_ready(xport_t *xport) {
+
+    bool ready;
+    xport_shm_t *shm = (xport_shm_t *)xport->impl;
+
+    pthread_mutex_lock(&shm->tx_mutex);
+    ready = xport_shm_attach(shm);
+    pthread_mutex_unlock(&shm->tx_mutex);
+    return ready;
+}
+
+static void
+xport_shm_print_stats(xport_t *xport) {
+
+    xport_shm_t *shm = (xport_shm_t *)xport->impl;
+    xport_shm_ring_t *ring = shm->tx_ring;
+
+    printf("\trecv ring %s  send ring %s %s, %lu bytes queued, "
+           "attached %lu times\n", shm->rx_name, shm->tx_name,
+           ring ? "mapped" : "not mapped",
+           ring ? ring->tail - ring->head : 0, xport->stats.connects);
+}
+
+static void
+xport_shm_destroy(xport_t *xport) {
+
+    xport_shm_t *shm = (xport_shm_t *)xport->impl;
+
+    pthread_mutex_lock(&shm->tx_mutex);
+    shm->stop = true;
+    pthread_mutex_unlock(&shm->tx_mutex);
+
+    /* The recv thread is back within XPORT_SHM_SLEEP_MSEC if the wake
+     * up comes in before it sleeps */
+    xport_shm_futex_wake(&shm->rx_ring->tail_word);
+    pthread_join(shm->recv_thread, NULL);
+
+    shm->rx_ring->closed = 1;
+    munmap(shm->rx_ring, XPORT_SHM_MAP_SIZE);
+    shm_unlink(shm->rx_name);
+    if (shm->tx_ring) munmap(shm->tx_ring, XPORT_SHM_MAP_SIZE);
+    free(shm);
+}
+
+static const xport_ops_t xport_shm_ops = {
+
+    .sendv = xport_shm_sendv,
+    .drain = xport_shm_drain,
+    .is_ready = xport_shm_is_ready,
+    .print_stats = xport_shm_print_stats,
+    .destroy = xport_shm_destroy
+};
+
+/* The ring from the peer's src_port to ours is ours to create, a stale
+ * one left behind by a previous incarnation is replaced */
+bool
+xport_shm_init(xport_t *xport, uint16_t src_port, uint16_t dst_port) {
+
+    xport_shm_t *shm;
+    xport_shm_ring_t *ring;
+
+    shm = calloc(1, sizeof(xport_shm_t));
+    shm->xport = xport;
+    snprintf(shm->rx_name, sizeof(shm->rx_name), XPORT_SHM_NAME_FMT,
+             dst_port, src_port);
+    snprintf(shm->tx_name, sizeof(shm->tx_name), XPORT_SHM_NAME_FMT,
+             src_port, dst_port);
+    pthread_mutex_init(&shm->tx_mutex, NULL);
+    shm->spin_loops = sysconf(_SC_NPROCESSORS_ONLN) > 1 ?
+                      XPORT_SHM_SPIN_LOOPS : 0;
+
+    /* The sender of a stale ring may still have it mapped, closing it
+     * makes the sender look for this ring */
+    ring = xport_shm_map(shm->rx_name, O_RDWR, NULL);
+    if (ring) {
+        ring->closed = 1;
+        munmap(ring, XPORT_SHM_MAP_SIZE);
+    }
+
+    shm_unlink(shm->rx_name);
+    ring = xport_shm_map(shm->rx_name, O_RDWR | O_CREAT | O_EXCL, NULL);
+    if (!ring) {
+        printf("Error : xport shm %s creation failed, errno = %d\n",
+               shm->rx_name, errno);
+        free(shm);
+        return false;
+    }
+
+    /* Fresh shared memory is zeroed, positions start at 0 */
+    ring->size = XPORT_SHM_RING_SIZE;
+    __atomic_store_n(&ring->magic, XPORT_SHM_MAGIC, __ATOMIC_RELEASE);
+    shm->rx_ring = ring;
+
+    xport->impl = shm;
+    xport->ops = &xport_shm_ops;
+    xport->max_msg_size = XPORT_SHM_MAX_MSG_SIZE;
+
+    pthread_create(&shm->recv_thread, NULL, xport_shm_thread_fn, shm);
+    return true;
+}
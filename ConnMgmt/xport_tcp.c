@@ -0,0 +1,347 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  xport_tcp.c
+ *
+ *    Description: This file implements the TCP transport : length framed msgs on a
+ *                 stream, written gathered from the app's buffers and parsed in place
+ *                 from one large recv buffer
+ *
+ *        Version:  1.0
+ *        Created:  10/17/2026 11:52:09 PM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  ABHISHEK SAGAR (), sachinites@gmail.com
+ *   Organization:  Juniper Networks
+ *
+ * =====================================================================================
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/ioctl.h>
+#include <linux/sockios.h>
+#include "xport.h"
+
+typedef struct xport_tcp_ {
+
+    xport_t *xport;
+    struct sockaddr_in peer_addr;
+    /* The backup end listens, the master connects */
+    bool listener;
+    int listen_fd;
+    /* -1 while the stream is down */
+    int sock_fd;
+    bool stop;
+    /* Senders are serialized, a msg is written whole before the next */
+    pthread_mutex_t tx_mutex;
+    pthread_cond_t up_cond;
+    pthread_t recv_thread;
+    unsigned char *rx_buf;
+} xport_tcp_t;
+
+static void
+xport_tcp_setup_sock(int sock_fd) {
+
+    int one = 1, buf_size = XPORT_TCP_SOCK_BUF_SIZE;
+
+    /* Each msg goes out as soon as it is written, batching is up to
+     * the app */
+    setsockopt(sock_fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    setsockopt(sock_fd, SOL_SOCKET, SO_RCVBUF, &buf_size, sizeof(buf_size));
+    setsockopt(sock_fd, SOL_SOCKET, SO_SNDBUF, &buf_size, sizeof(buf_size));
+}
+
+/* Returns the stream to the peer, or -1 if none came up this time */
+static int
+xport_tcp_establish(xport_tcp_t *tcp) {
+
+    int sock_fd;
+
+    if (tcp->listener) {
+        return accept(tcp->listen_fd, NULL, NULL);
+    }
+
+    sock_fd = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (sock_fd < 0) return -1;
+
+    xport_tcp_setup_sock(sock_fd);
+
+    if (connect(sock_fd, (struct sockaddr *)&tcp->peer_addr,
+                sizeof(tcp->peer_addr)) < 0) {
+        close(sock_fd);
+        usleep(XPORT_TCP_CONNECT_RETRY_MSEC * 1000);
+        return -1;
+    }
+    return sock_fd;
+}
+
+/* Delivers the msgs of the stream until it breaks. Msgs are parsed in
+ * place, only a partial msg at the end of the buffer moves to its
+ * front */
+static void
+xport_tcp_read_stream(xport_tcp_t *tcp, int sock_fd) {
+
+    ssize_t rc;
+    uint32_t filled = 0, offset, msg_len;
+    xport_t *xport = tcp->xport;
+
+    while (!tcp->stop) {
+
+        rc = recv(sock_fd, tcp->rx_buf + filled,
+                  XPORT_TCP_RX_BUF_SIZE - filled, 0);
+        xport->stats.rx_syscalls++;
+
+        if (rc < 0 && errno == EINTR) continue;
+        if (rc <= 0) return;
+
+        filled += rc;
+        offset = 0;
+
+        while (filled - offset >= sizeof(uint32_t)) {
+
+            memcpy(&msg_len, tcp->rx_buf + offset, sizeof(msg_len));
+            msg_len = ntohl(msg_len);
+
+            if (msg_len > XPORT_TCP_MAX_MSG_SIZE) {
+                printf("Error : xport tcp %s : msg of %u bytes, "
+                       "dropping the stream\n", xport->conn->conn_name,
+                       msg_len);
+                return;
+            }
+            if (filled - offset - sizeof(uint32_t) < msg_len) break;
+
+            xport_deliver(xport, tcp->rx_buf + offset + sizeof(uint32_t),
+                          msg_len);
+            offset += sizeof(uint32_t) + msg_len;
+        }
+
+        if (offset) {
+            memmove(tcp->rx_buf, tcp->rx_buf + offset, filled - offset);
+            filled -= offset;
+        }
+    }
+}
+
+static void *
+xport_tcp_thread_fn(void *arg) {
+
+    int sock_fd;
+    xport_tcp_t *tcp = (xport_tcp_t *)arg;
+
+    while (!tcp->stop) {
+
+        sock_fd = xport_tcp_establish(tcp);
+        if (sock_fd < 0) continue;
+
+        if (tcp->listener) xport_tcp_setup_sock(sock_fd);
+
+        pthread_mutex_lock(&tcp->tx_mutex);
+        tcp->sock_fd = sock_fd;
+        tcp->xport->stats.connects++;
+        pthread_cond_broadcast(&tcp->up_cond);
+        pthread_mutex_unlock(&tcp->tx_mutex);
+
+        xport_tcp_read_stream(tcp, sock_fd);
+
+        /* Fails a sender blocked on the stream, before waiting for it */
+        shutdown(sock_fd, SHUT_RDWR);
+        pthread_mutex_lock(&tcp->tx_mutex);
+        tcp->sock_fd = -1;
+        pthread_mutex_unlock(&tcp->tx_mutex);
+        close(sock_fd);
+    }
+    return NULL;
+}
+
+/* Writes the frame hdr and the app's buffers with one gathering write,
+ * sendmsg() rather than writev() for MSG_NOSIGNAL : a peer gone away
+ * must not SIGPIPE the app */
+static bool
+xport_tcp_sendv(xport_t *xport, const struct iovec *iov, int iovcnt) {
+
+    int i;
+    ssize_t rc;
+    uint32_t msg_len = 0, frame_hdr;
+    struct iovec iovs[XPORT_MAX_IOV + 1];
+    struct msghdr msg;
+    xport_tcp_t *tcp = (xport_tcp_t *)xport->impl;
+
+    for (i = 0; i < iovcnt; i++) {
+        msg_len += iov[i].iov_len;
+        iovs[i + 1] = iov[i];
+    }
+    frame_hdr = htonl(msg_len);
+    iovs[0].iov_base = &frame_hdr;
+    iovs[0].iov_len = sizeof(frame_hdr);
+
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = iovs;
+    msg.msg_iovlen = iovcnt + 1;
+
+    pthread_mutex_lock(&tcp->tx_mutex);
+
+    while (tcp->sock_fd < 0 && !tcp->stop) {
+        pthread_cond_wait(&tcp->up_cond, &tcp->tx_mutex);
+    }
+    if (tcp->stop) {
+        pthread_mutex_unlock(&tcp->tx_mutex);
+        return false;
+    }
+
+    while (msg.msg_iovlen) {
+
+        rc = sendmsg(tcp->sock_fd, &msg, MSG_NOSIGNAL);
+        xport->stats.tx_syscalls++;
+
+        if (rc < 0) {
+            if (errno == EINTR) continue;
+            /* Half a frame went out, the stream is of no use now */
+            shutdown(tcp->sock_fd, SHUT_RDWR);
+            pthread_mutex_unlock(&tcp->tx_mutex);
+            return false;
+        }
+
+        /* Partial write, skip what went out */
+        while (msg.msg_iovlen && (size_t)rc >= msg.msg_iov->iov_len) {
+            rc -= msg.msg_iov->iov_len;
+            msg.msg_iov++;
+            msg.msg_iovlen--;
+        }
+        if (msg.msg_iovlen) {
+            msg.msg_iov->iov_base = (unsigned char *)msg.msg_iov->iov_base + rc;
+            msg.msg_iov->iov_len -= rc;
+        }
+    }
+
+    pthread_mutex_unlock(&tcp->tx_mutex);
+    return true;
+}
+
+/* Until the peer acked every byte written */
+static bool
+xport_tcp_drain(xport_t *xport, uint32_t timeout_msec) {
+
+    int unacked;
+    uint32_t waited_usec = 0;
+    xport_tcp_t *tcp = (xport_tcp_t *)xport->impl;
+
+    while (1) {
+        if (tcp->sock_fd < 0) return false;
+        if (ioctl(tcp->sock_fd, SIOCOUTQ, &unacked) < 0) return false;
+        if (!unacked) return true;
+        if (waited_usec >= timeout_msec * 1000) return false;
+        usleep(100);
+        waited_usec += 100;
+    }
+}
+
+static bool
+xport_tcp_is_ready(xport_t *xport) {
+
+    return ((xport_tcp_t *)xport->impl)->sock_fd >= 0;
+}
+
+static void
+xport_tcp_print_stats(xport_t *xport) {
+
+    xport_tcp_t *tcp = (xport_tcp_t *)xport->impl;
+
+    printf("\t%s, stream %s, connects %lu\n",
+           tcp->listener ? "listener" : "connector",
+           tcp->sock_fd >= 0 ? "up" : "down", xport->stats.connects);
+}
+
+static void
+xport_tcp_destroy(xport_t *xport) {
+
+    int sock_fd;
+    xport_tcp_t *tcp = (xport_tcp_t *)xport->impl;
+
+    pthread_mutex_lock(&tcp->tx_mutex);
+    tcp->stop = true;
+    pthread_cond_broadcast(&tcp->up_cond);
+    sock_fd = tcp->sock_fd;
+    pthread_mutex_unlock(&tcp->tx_mutex);
+
+    /* Wakes up the thread, in accept() or recv() */
+    if (tcp->listen_fd >= 0) shutdown(tcp->listen_fd, SHUT_RDWR);
+    if (sock_fd >= 0) shutdown(sock_fd, SHUT_RDWR);
+    pthread_join(tcp->recv_thread, NULL);
+
+    if (tcp->listen_fd >= 0) close(tcp->listen_fd);
+    pthread_cond_destroy(&tcp->up_cond);
+    pthread_mutex_destroy(&tcp->tx_mutex);
+    free(tcp->rx_buf);
+    free(tcp);
+}
+
+static const xport_ops_t xport_tcp_ops = {
+
+    .sendv = xport_tcp_sendv,
+    .drain = xport_tcp_drain,
+    .is_ready = xport_tcp_is_ready,
+    .print_stats = xport_tcp_print_stats,
+    .destroy = xport_tcp_destroy
+};
+
+bool
+xport_tcp_init(xport_t *xport, uint16_t src_port, uint16_t dst_port) {
+
+    int one = 1;
+    struct sockaddr_in src_addr;
+    xport_tcp_t *tcp;
+
+    tcp = calloc(1, sizeof(xport_tcp_t));
+    tcp->xport = xport;
+    tcp->listener = xport->conn->mastership_state == COMM_MGMT_BACKUP;
+    tcp->listen_fd = -1;
+    tcp->sock_fd = -1;
+    tcp->peer_addr = xport->conn->peer_addr;
+    tcp->peer_addr.sin_port = dst_port;
+
+    if (tcp->listener) {
+
+        tcp->listen_fd = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        if (tcp->listen_fd < 0) {
+            printf("Error : xport tcp socket creation failed, errno = %d\n",
+                   errno);
+            free(tcp);
+            return false;
+        }
+        setsockopt(tcp->listen_fd, SOL_SOCKET, SO_REUSEADDR,
+                   &one, sizeof(one));
+
+        memset(&src_addr, 0, sizeof(src_addr));
+        src_addr.sin_family      = AF_INET;
+        src_addr.sin_port        = src_port;
+        src_addr.sin_addr.s_addr = INADDR_ANY;
+
+        if (bind(tcp->listen_fd, (struct sockaddr *)&src_addr,
+                 sizeof(src_addr)) < 0 ||
+            listen(tcp->listen_fd, 1) < 0) {
+            printf("Error : xport tcp listen failed, errno = %d\n", errno);
+            close(tcp->listen_fd);
+            free(tcp);
+            return false;
+        }
+    }
+
+    pthread_mutex_init(&tcp->tx_mutex, NULL);
+    pthread_cond_init(&tcp->up_cond, NULL);
+    tcp->rx_buf = malloc(XPORT_TCP_RX_BUF_SIZE);
+    xport->impl = tcp;
+    xport->ops = &xport_tcp_ops;
+    xport->max_msg_size = XPORT_TCP_MAX_MSG_SIZE;
+
+    pthread_create(&tcp->recv_thread, NULL, xport_tcp_thread_fn, tcp);
+    return true;
+}
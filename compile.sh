@@ -3,6 +3,17 @@ rm ConnMgmt/*exe
 rm libtimer/*.o
 rm CommandParser/*.o
 gcc -g -c ConnMgmt/conn_mgmt.c -o ConnMgmt/conn_mgmt.o
+gcc -g -c ConnMgmt/conn_mgmt_ka.c -o ConnMgmt/conn_mgmt_ka.o
+gcc -g -c ConnMgmt/conn_mgmt_notif.c -o ConnMgmt/conn_mgmt_notif.o
+gcc -g -c ConnMgmt/clientipc.c -o ConnMgmt/clientipc.o
+gcc -g -c ConnMgmt/mirror.c -o ConnMgmt/mirror.o
+gcc -g -c ConnMgmt/rel_chan.c -o ConnMgmt/rel_chan.o
+gcc -g -c ConnMgmt/xport.c -o ConnMgmt/xport.o
+gcc -g -c ConnMgmt/xport_tcp.c -o ConnMgmt/xport_tcp.o
+gcc -g -c ConnMgmt/xport_shm.c -o ConnMgmt/xport_shm.o
+gcc -g -c ConnMgmt/mirror_delta.c -o ConnMgmt/mirror_delta.o
+gcc -g -c ConnMgmt/page_mirror.c -o ConnMgmt/page_mirror.o
+gcc -g -c ConnMgmt/mirror_journal.c -o ConnMgmt/mirror_journal.o
 gcc -g -c ConnMgmt/conn_mgmt_ui.c -o ConnMgmt/conn_mgmt_ui.o
 cd CommandParser
 make
@@ -11,4 +22,67 @@ cd libtimer
 sh compile.sh
 cd ..
 echo Building conn_mgmt.exe
-gcc -g ConnMgmt/conn_mgmt.o ConnMgmt/conn_mgmt_ui.o libtimer/WheelTimer.o  libtimer/timerlib.o libtimer/gluethread/glthread.o -o ConnMgmt/conn_mgmt.exe -lpthread -lrt -L CommandParser -lcli
+gcc -g ConnMgmt/conn_mgmt.o ConnMgmt/conn_mgmt_ka.o ConnMgmt/conn_mgmt_notif.o ConnMgmt/clientipc.o ConnMgmt/conn_mgmt_ui.o libtimer/WheelTimer.o  libtimer/timerlib.o libtimer/gluethread/glthread.o -o ConnMgmt/conn_mgmt.exe -lpthread -lrt -L CommandParser -lcli
+echo Building conn_mgmt_io_bench.exe
+gcc -g -c ConnMgmt/conn_mgmt_io_bench.c -o ConnMgmt/conn_mgmt_io_bench.o
+gcc -g ConnMgmt/conn_mgmt_io_bench.o ConnMgmt/conn_mgmt.o ConnMgmt/conn_mgmt_ka.o ConnMgmt/conn_mgmt_notif.o ConnMgmt/clientipc.o libtimer/WheelTimer.o  libtimer/timerlib.o libtimer/gluethread/glthread.o -o ConnMgmt/conn_mgmt_io_bench.exe -lpthread -lrt
+echo Building conn_mgmt_db_bench.exe
+gcc -g -c ConnMgmt/conn_mgmt_db_bench.c -o ConnMgmt/conn_mgmt_db_bench.o
+gcc -g ConnMgmt/conn_mgmt_db_bench.o ConnMgmt/conn_mgmt.o ConnMgmt/conn_mgmt_ka.o ConnMgmt/conn_mgmt_notif.o ConnMgmt/clientipc.o libtimer/WheelTimer.o  libtimer/timerlib.o libtimer/gluethread/glthread.o -o ConnMgmt/conn_mgmt_db_bench.exe -lpthread -lrt
+echo Building conn_mgmt_ka_batch_bench.exe
+gcc -g -c ConnMgmt/conn_mgmt_ka_batch_bench.c -o ConnMgmt/conn_mgmt_ka_batch_bench.o
+gcc -g ConnMgmt/conn_mgmt_ka_batch_bench.o ConnMgmt/conn_mgmt.o ConnMgmt/conn_mgmt_ka.o ConnMgmt/conn_mgmt_notif.o ConnMgmt/clientipc.o libtimer/WheelTimer.o  libtimer/timerlib.o libtimer/gluethread/glthread.o -o ConnMgmt/conn_mgmt_ka_batch_bench.exe -lpthread -lrt
+echo Building conn_mgmt_ka_send_bench.exe
+gcc -g -c ConnMgmt/conn_mgmt_ka_send_bench.c -o ConnMgmt/conn_mgmt_ka_send_bench.o
+gcc -g ConnMgmt/conn_mgmt_ka_send_bench.o ConnMgmt/conn_mgmt.o ConnMgmt/conn_mgmt_ka.o ConnMgmt/conn_mgmt_notif.o ConnMgmt/clientipc.o libtimer/WheelTimer.o  libtimer/timerlib.o libtimer/gluethread/glthread.o -o ConnMgmt/conn_mgmt_ka_send_bench.exe -lpthread -lrt
+echo Building conn_mgmt_detect_test.exe
+gcc -g -c ConnMgmt/conn_mgmt_detect_test.c -o ConnMgmt/conn_mgmt_detect_test.o
+gcc -g ConnMgmt/conn_mgmt_detect_test.o ConnMgmt/conn_mgmt.o ConnMgmt/conn_mgmt_ka.o ConnMgmt/conn_mgmt_notif.o ConnMgmt/clientipc.o libtimer/WheelTimer.o  libtimer/timerlib.o libtimer/gluethread/glthread.o -o ConnMgmt/conn_mgmt_detect_test.exe -lpthread -lrt
+echo Building conn_mgmt_ka_codec_bench.exe
+gcc -g -c ConnMgmt/conn_mgmt_ka_codec_bench.c -o ConnMgmt/conn_mgmt_ka_codec_bench.o
+gcc -g ConnMgmt/conn_mgmt_ka_codec_bench.o ConnMgmt/conn_mgmt_ka.o -o ConnMgmt/conn_mgmt_ka_codec_bench.exe -lpthread
+echo Building conn_mgmt_scale_bench.exe
+gcc -g -c ConnMgmt/conn_mgmt_scale_bench.c -o ConnMgmt/conn_mgmt_scale_bench.o
+gcc -g ConnMgmt/conn_mgmt_scale_bench.o ConnMgmt/conn_mgmt.o ConnMgmt/conn_mgmt_ka.o ConnMgmt/conn_mgmt_notif.o ConnMgmt/clientipc.o libtimer/WheelTimer.o  libtimer/timerlib.o libtimer/gluethread/glthread.o -o ConnMgmt/conn_mgmt_scale_bench.exe -lpthread -lrt
+echo Building conn_mgmt_peer_sim.exe
+gcc -g -c ConnMgmt/conn_mgmt_peer_sim.c -o ConnMgmt/conn_mgmt_peer_sim.o
+gcc -g ConnMgmt/conn_mgmt_peer_sim.o ConnMgmt/conn_mgmt.o ConnMgmt/conn_mgmt_ka.o ConnMgmt/conn_mgmt_notif.o ConnMgmt/clientipc.o libtimer/WheelTimer.o  libtimer/timerlib.o libtimer/gluethread/glthread.o -o ConnMgmt/conn_mgmt_peer_sim.exe -lpthread -lrt
+echo Building clientipc_bench.exe
+gcc -g -c ConnMgmt/clientipc_bench.c -o ConnMgmt/clientipc_bench.o
+gcc -g ConnMgmt/clientipc_bench.o ConnMgmt/conn_mgmt.o ConnMgmt/conn_mgmt_ka.o ConnMgmt/conn_mgmt_notif.o ConnMgmt/clientipc.o libtimer/WheelTimer.o  libtimer/timerlib.o libtimer/gluethread/glthread.o -o ConnMgmt/clientipc_bench.exe -lpthread -lrt
+echo Building conn_mgmt_notif_bench.exe
+gcc -g -c ConnMgmt/conn_mgmt_notif_bench.c -o ConnMgmt/conn_mgmt_notif_bench.o
+gcc -g ConnMgmt/conn_mgmt_notif_bench.o ConnMgmt/conn_mgmt.o ConnMgmt/conn_mgmt_ka.o ConnMgmt/conn_mgmt_notif.o ConnMgmt/clientipc.o libtimer/WheelTimer.o  libtimer/timerlib.o libtimer/gluethread/glthread.o -o ConnMgmt/conn_mgmt_notif_bench.exe -lpthread -lrt
+echo Building mirror_bench.exe
+gcc -g -c ConnMgmt/mirror_bench.c -o ConnMgmt/mirror_bench.o
+gcc -g ConnMgmt/mirror_bench.o ConnMgmt/mirror.o ConnMgmt/mirror_journal.o ConnMgmt/xport.o ConnMgmt/xport_tcp.o ConnMgmt/xport_shm.o ConnMgmt/rel_chan.o ConnMgmt/conn_mgmt.o ConnMgmt/conn_mgmt_ka.o ConnMgmt/conn_mgmt_notif.o ConnMgmt/clientipc.o libtimer/WheelTimer.o  libtimer/timerlib.o libtimer/gluethread/glthread.o -o ConnMgmt/mirror_bench.exe -lpthread -lrt
+echo Building mirror_coalesce_bench.exe
+gcc -g -c ConnMgmt/mirror_coalesce_bench.c -o ConnMgmt/mirror_coalesce_bench.o
+gcc -g ConnMgmt/mirror_coalesce_bench.o ConnMgmt/mirror.o ConnMgmt/mirror_journal.o ConnMgmt/xport.o ConnMgmt/xport_tcp.o ConnMgmt/xport_shm.o ConnMgmt/rel_chan.o ConnMgmt/conn_mgmt.o ConnMgmt/conn_mgmt_ka.o ConnMgmt/conn_mgmt_notif.o ConnMgmt/clientipc.o libtimer/WheelTimer.o  libtimer/timerlib.o libtimer/gluethread/glthread.o -o ConnMgmt/mirror_coalesce_bench.exe -lpthread -lrt
+echo Building mirror_durability_bench.exe
+gcc -g -c ConnMgmt/mirror_durability_bench.c -o ConnMgmt/mirror_durability_bench.o
+gcc -g ConnMgmt/mirror_durability_bench.o ConnMgmt/mirror.o ConnMgmt/mirror_journal.o ConnMgmt/xport.o ConnMgmt/xport_tcp.o ConnMgmt/xport_shm.o ConnMgmt/rel_chan.o ConnMgmt/conn_mgmt.o ConnMgmt/conn_mgmt_ka.o ConnMgmt/conn_mgmt_notif.o ConnMgmt/clientipc.o libtimer/WheelTimer.o  libtimer/timerlib.o libtimer/gluethread/glthread.o -o ConnMgmt/mirror_durability_bench.exe -lpthread -lrt
+echo Building rel_chan_bench.exe
+gcc -g -c ConnMgmt/rel_chan_bench.c -o ConnMgmt/rel_chan_bench.o
+gcc -g ConnMgmt/rel_chan_bench.o ConnMgmt/rel_chan.o ConnMgmt/conn_mgmt.o ConnMgmt/conn_mgmt_ka.o ConnMgmt/conn_mgmt_notif.o ConnMgmt/clientipc.o libtimer/WheelTimer.o  libtimer/timerlib.o libtimer/gluethread/glthread.o -o ConnMgmt/rel_chan_bench.exe -lpthread -lrt
+echo Building xport_bench.exe
+gcc -g -c ConnMgmt/xport_bench.c -o ConnMgmt/xport_bench.o
+gcc -g ConnMgmt/xport_bench.o ConnMgmt/xport.o ConnMgmt/xport_tcp.o ConnMgmt/xport_shm.o ConnMgmt/rel_chan.o ConnMgmt/conn_mgmt.o ConnMgmt/conn_mgmt_ka.o ConnMgmt/conn_mgmt_notif.o ConnMgmt/clientipc.o libtimer/WheelTimer.o  libtimer/timerlib.o libtimer/gluethread/glthread.o -o ConnMgmt/xport_bench.exe -lpthread -lrt
+echo Building mirror_xport_bench.exe
+gcc -g -c ConnMgmt/mirror_xport_bench.c -o ConnMgmt/mirror_xport_bench.o
+gcc -g ConnMgmt/mirror_xport_bench.o ConnMgmt/mirror.o ConnMgmt/mirror_journal.o ConnMgmt/xport.o ConnMgmt/xport_tcp.o ConnMgmt/xport_shm.o ConnMgmt/rel_chan.o ConnMgmt/conn_mgmt.o ConnMgmt/conn_mgmt_ka.o ConnMgmt/conn_mgmt_notif.o ConnMgmt/clientipc.o libtimer/WheelTimer.o  libtimer/timerlib.o libtimer/gluethread/glthread.o -o ConnMgmt/mirror_xport_bench.exe -lpthread -lrt
+echo Building mirror_sync_bench.exe
+gcc -g -c ConnMgmt/mirror_sync_bench.c -o ConnMgmt/mirror_sync_bench.o
+gcc -g ConnMgmt/mirror_sync_bench.o ConnMgmt/mirror.o ConnMgmt/mirror_journal.o ConnMgmt/xport.o ConnMgmt/xport_tcp.o ConnMgmt/xport_shm.o ConnMgmt/rel_chan.o ConnMgmt/conn_mgmt.o ConnMgmt/conn_mgmt_ka.o ConnMgmt/conn_mgmt_notif.o ConnMgmt/clientipc.o libtimer/WheelTimer.o  libtimer/timerlib.o libtimer/gluethread/glthread.o -o ConnMgmt/mirror_sync_bench.exe -lpthread -lrt
+echo Building page_mirror_bench.exe
+gcc -g -c ConnMgmt/page_mirror_bench.c -o ConnMgmt/page_mirror_bench.o
+gcc -g ConnMgmt/page_mirror_bench.o ConnMgmt/page_mirror.o ConnMgmt/mirror_delta.o ConnMgmt/mirror.o ConnMgmt/mirror_journal.o ConnMgmt/xport.o ConnMgmt/xport_tcp.o ConnMgmt/xport_shm.o ConnMgmt/rel_chan.o ConnMgmt/conn_mgmt.o ConnMgmt/conn_mgmt_ka.o ConnMgmt/conn_mgmt_notif.o ConnMgmt/clientipc.o libtimer/WheelTimer.o  libtimer/timerlib.o libtimer/gluethread/glthread.o -o ConnMgmt/page_mirror_bench.exe -lpthread -lrt
+echo Building mirror_delta_bench.exe
+gcc -g -c ConnMgmt/mirror_delta_bench.c -o ConnMgmt/mirror_delta_bench.o
+gcc -g ConnMgmt/mirror_delta_bench.o ConnMgmt/mirror_delta.o -o ConnMgmt/mirror_delta_bench.exe
+echo Building mirror_apply_bench.exe
+gcc -g -c ConnMgmt/mirror_apply_bench.c -o ConnMgmt/mirror_apply_bench.o
+gcc -g ConnMgmt/mirror_apply_bench.o ConnMgmt/mirror.o ConnMgmt/mirror_journal.o ConnMgmt/xport.o ConnMgmt/xport_tcp.o ConnMgmt/xport_shm.o ConnMgmt/rel_chan.o ConnMgmt/conn_mgmt.o ConnMgmt/conn_mgmt_ka.o ConnMgmt/conn_mgmt_notif.o ConnMgmt/clientipc.o libtimer/WheelTimer.o  libtimer/timerlib.o libtimer/gluethread/glthread.o -o ConnMgmt/mirror_apply_bench.exe -lpthread -lrt
+echo Building mirror_journal_bench.exe
+gcc -g -c ConnMgmt/mirror_journal_bench.c -o ConnMgmt/mirror_journal_bench.o
+gcc -g ConnMgmt/mirror_journal_bench.o ConnMgmt/mirror.o ConnMgmt/mirror_journal.o ConnMgmt/xport.o ConnMgmt/xport_tcp.o ConnMgmt/xport_shm.o ConnMgmt/rel_chan.o ConnMgmt/conn_mgmt.o ConnMgmt/conn_mgmt_ka.o ConnMgmt/conn_mgmt_notif.o ConnMgmt/clientipc.o libtimer/WheelTimer.o  libtimer/timerlib.o libtimer/gluethread/glthread.o -o ConnMgmt/mirror_journal_bench.exe -lpthread -lrt
@@ -172,6 +172,10 @@ wheel_fn(Timer_t *timer, void *arg){
 		}
 	} ITERATE_GLTHREAD_END(slot_list, curr)
 	process_wt_reschedule_slotlist(wt);
+
+	if(wt->tick_end_cb){
+		wt->tick_end_cb(wt->tick_end_cb_arg, 0);
+	}
 }
 
 wheel_timer_t*
@@ -394,6 +398,15 @@ hrs_min_sec_format(unsigned int seconds){
     return time_f;
 }
 
+void
+wt_register_tick_end_callback(wheel_timer_t *wt,
+                              app_call_back call_back,
+                              void *arg){
+
+	wt->tick_end_cb_arg = arg;
+	wt->tick_end_cb = call_back;
+}
+
 void
 cancel_wheel_timer(wheel_timer_t *wt){
 
@@ -60,6 +60,10 @@ struct _wheel_timer_t {
     unsigned int no_of_wt_elem;
 	timer_resolution_t timer_resolution;
 	bool debug;
+    /* Invoked once per clock tic, after all the wt_elems
+     * expiring in this tic have been processed */
+    app_call_back tick_end_cb;
+    void *tick_end_cb_arg;
     slotlist_t slotlist[0];
 };
 
@@ -154,4 +158,9 @@ hrs_min_sec_format(unsigned int seconds);
 void
 wt_enable_logging(wheel_timer_t *wt);
 
+void
+wt_register_tick_end_callback(wheel_timer_t *wt,
+                              app_call_back call_back,
+                              void *arg);
+
 #endif